@@ -0,0 +1,56 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#ifndef INCLUDE_BASE_CANCELLATIONTOKEN_H_
+#define INCLUDE_BASE_CANCELLATIONTOKEN_H_
+
+#include <atomic>  // NOLINT
+
+namespace QS {
+
+namespace Threading {
+
+/**
+ * A flag shared among the owner of some work and the tasks doing the work.
+ *
+ * The owner calls Cancel when the work is no longer wanted, and the tasks
+ * check IsCancelled before (or while) doing the work. Once cancelled, a token
+ * can never be reset, so the owner should hand out a new one for new work.
+ */
+class CancellationToken {
+ public:
+  CancellationToken() : m_cancelled(false) {}
+
+  CancellationToken(CancellationToken &&) = delete;
+  CancellationToken(const CancellationToken &) = delete;
+  CancellationToken &operator=(CancellationToken &&) = delete;
+  CancellationToken &operator=(const CancellationToken &) = delete;
+  ~CancellationToken() = default;
+
+ public:
+  void Cancel() { m_cancelled.store(true); }
+  bool IsCancelled() const { return m_cancelled.load(); }
+
+ private:
+  std::atomic<bool> m_cancelled;
+};
+
+}  // namespace Threading
+}  // namespace QS
+
+
+#endif  // INCLUDE_BASE_CANCELLATIONTOKEN_H_
@@ -17,30 +17,120 @@
 #ifndef INCLUDE_BASE_HASHUTILS_H_
 #define INCLUDE_BASE_HASHUTILS_H_
 
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
 #include <string>
 
 namespace QS {
 
 namespace HashUtils {
 
+// secret of wyhash
+const uint64_t kSecret0 = 0x2d358dccaa6c78a5ULL;
+const uint64_t kSecret1 = 0x8bb84b93962eacc9ULL;
+const uint64_t kSecret2 = 0x4b33a62ed433d4a3ULL;
+const uint64_t kSecret3 = 0x4d5a2da51de1aa47ULL;
+
+inline uint64_t Read8(const uint8_t *p) {
+  uint64_t v;
+  memcpy(&v, p, 8);
+  return v;
+}
+
+inline uint64_t Read4(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+inline uint64_t Read3(const uint8_t *p, size_t len) {
+  return (static_cast<uint64_t>(p[0]) << 16) |
+         (static_cast<uint64_t>(p[len >> 1]) << 8) | p[len - 1];
+}
+
+// 64x64 -> 128 bits multiply, return the low and high half in a and b
+inline void Multiply(uint64_t *a, uint64_t *b) {
+#ifdef __SIZEOF_INT128__
+  __uint128_t r = static_cast<__uint128_t>(*a) * *b;
+  *a = static_cast<uint64_t>(r);
+  *b = static_cast<uint64_t>(r >> 64);
+#else
+  uint64_t ha = *a >> 32, hb = *b >> 32;
+  uint64_t la = static_cast<uint32_t>(*a), lb = static_cast<uint32_t>(*b);
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t t = rl + (rm0 << 32);
+  uint64_t c = t < rl;
+  uint64_t lo = t + (rm1 << 32);
+  c += lo < t;
+  *a = lo;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+inline uint64_t Mix(uint64_t a, uint64_t b) {
+  Multiply(&a, &b);
+  return a ^ b;
+}
+
+// Hash bytes with wyhash (final version 4)
+//
+// @param  : data, data length, seed
+// @return : 64 bits hash
+//
+// It reads 8 bytes a time and mixes them with 128 bits multiplies, so it is
+// fast on long paths and well distributed for paths sharing long prefixes.
+inline uint64_t Hash64(const void *data, size_t len, uint64_t seed = 0) {
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  seed ^= Mix(seed ^ kSecret0, kSecret1);
+  uint64_t a = 0;
+  uint64_t b = 0;
+  if (len <= 16) {
+    if (len >= 4) {
+      a = (Read4(p) << 32) | Read4(p + ((len >> 3) << 2));
+      b = (Read4(p + len - 4) << 32) | Read4(p + len - 4 - ((len >> 3) << 2));
+    } else if (len > 0) {
+      a = Read3(p, len);
+    }
+  } else {
+    size_t i = len;
+    if (i > 48) {
+      uint64_t see1 = seed;
+      uint64_t see2 = seed;
+      do {
+        seed = Mix(Read8(p) ^ kSecret1, Read8(p + 8) ^ seed);
+        see1 = Mix(Read8(p + 16) ^ kSecret2, Read8(p + 24) ^ see1);
+        see2 = Mix(Read8(p + 32) ^ kSecret3, Read8(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= see1 ^ see2;
+    }
+    while (i > 16) {
+      seed = Mix(Read8(p) ^ kSecret1, Read8(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = Read8(p + i - 16);
+    b = Read8(p + i - 8);
+  }
+  a ^= kSecret1;
+  b ^= seed;
+  Multiply(&a, &b);
+  return Mix(a ^ kSecret0 ^ len, b ^ kSecret1);
+}
+
 struct EnumHash {
   template <typename T>
-  int operator()(T enumValue) const {
-    return static_cast<int>(enumValue);
+  size_t operator()(T enumValue) const {
+    return static_cast<size_t>(enumValue);
   }
 };
 
 struct StringHash {
-  int operator()(const std::string &strToHash) const {
-    if (strToHash.empty()) {
-      return 0;
-    }
-
-    int hash = 0;
-    for (const auto &charValue : strToHash) {
-      hash = charValue + 31 * hash;
-    }
-    return hash;
+  size_t operator()(const std::string &strToHash) const {
+    return static_cast<size_t>(Hash64(strToHash.data(), strToHash.size()));
   }
 };
 
@@ -0,0 +1,105 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#ifndef INCLUDE_BASE_ROUNDROBINSCHEDULER_H_
+#define INCLUDE_BASE_ROUNDROBINSCHEDULER_H_
+
+#include <stddef.h>
+
+#include <deque>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "base/HashUtils.h"
+#include "base/ThreadPool.h"
+
+namespace QS {
+
+namespace Threading {
+
+/**
+ * A per-key round-robin scheduler on top of a thread pool.
+ *
+ * Tasks are queued by key (e.g. the file path of a transfer). Each submission
+ * puts one runner to the thread pool, and a runner always picks the next task
+ * of the next key in round-robin order instead of the task submitted with it.
+ * So a key with thousands of queued tasks cannot starve keys submitted later,
+ * they get their turn after at most one task of every other key.
+ */
+class RoundRobinScheduler {
+ public:
+  explicit RoundRobinScheduler(ThreadPool *executor);
+
+  RoundRobinScheduler(RoundRobinScheduler &&) = delete;
+  RoundRobinScheduler(const RoundRobinScheduler &) = delete;
+  RoundRobinScheduler &operator=(RoundRobinScheduler &&) = delete;
+  RoundRobinScheduler &operator=(const RoundRobinScheduler &) = delete;
+  ~RoundRobinScheduler() = default;
+
+ public:
+  // Submit a task of a key
+  //
+  // @param  : key, task
+  // @return : void
+  void Submit(const std::string &key, Task &&task);
+
+  // Submit a task of a key, the handler will be called with task result
+  //
+  // @param  : key, handler, function and its arguments
+  // @return : void
+  template <typename ReceivedHandler, typename F, typename... Args>
+  void SubmitAsync(const std::string &key, ReceivedHandler &&handler, F &&f,
+                   Args &&... args);
+
+  // Return count of queued tasks not yet started
+  size_t GetQueuedTaskCount() const;
+
+  // Return count of keys which have queued tasks
+  size_t GetQueuedKeyCount() const;
+
+ private:
+  // Run the next task in round-robin order
+  void RunNext();
+
+ private:
+  ThreadPool *m_executor;
+  std::unordered_map<std::string, std::deque<Task>, HashUtils::StringHash>
+      m_queues;
+  std::deque<std::string> m_ring;  // keys having queued tasks
+  size_t m_queuedTaskCount;
+  mutable std::mutex m_mutex;
+};
+
+template <typename ReceivedHandler, typename F, typename... Args>
+void RoundRobinScheduler::SubmitAsync(const std::string &key,
+                                      ReceivedHandler &&handler, F &&f,
+                                      Args &&... args) {
+  auto task =
+      std::bind(std::forward<ReceivedHandler>(handler),
+                std::bind(std::forward<F>(f), std::forward<Args>(args)...),
+                std::forward<Args>(args)...);
+  Submit(key, Task([task]() { task(); }));
+}
+
+}  // namespace Threading
+}  // namespace QS
+
+
+#endif  // INCLUDE_BASE_ROUNDROBINSCHEDULER_H_
@@ -0,0 +1,95 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+#ifndef INCLUDE_BASE_SHAREDMUTEX_H_
+#define INCLUDE_BASE_SHAREDMUTEX_H_
+
+#include <assert.h>
+#include <pthread.h>
+
+namespace QS {
+
+namespace Threading {
+
+/**
+ * A reader-writer mutex, as std::shared_mutex is not available in C++11.
+ *
+ * Lock it exclusively with std::lock_guard or std::unique_lock, and shared
+ * with SharedLock. The mutex is not recursive, a thread should never lock it
+ * again while holding it in any mode.
+ * Writers are preferred where supported, so a stream of readers cannot starve
+ * a writer.
+ */
+class SharedMutex {
+ public:
+  SharedMutex() {
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+#ifdef __GLIBC__
+    pthread_rwlockattr_setkind_np(
+        &attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+    int ret = pthread_rwlock_init(&m_rwlock, &attr);
+    assert(ret == 0);
+    (void)ret;
+    pthread_rwlockattr_destroy(&attr);
+  }
+
+  SharedMutex(SharedMutex &&) = delete;
+  SharedMutex(const SharedMutex &) = delete;
+  SharedMutex &operator=(SharedMutex &&) = delete;
+  SharedMutex &operator=(const SharedMutex &) = delete;
+  ~SharedMutex() { pthread_rwlock_destroy(&m_rwlock); }
+
+ public:
+  // exclusive ownership
+  void lock() { pthread_rwlock_wrlock(&m_rwlock); }
+  bool try_lock() { return pthread_rwlock_trywrlock(&m_rwlock) == 0; }
+  void unlock() { pthread_rwlock_unlock(&m_rwlock); }
+
+  // shared ownership
+  void lock_shared() { pthread_rwlock_rdlock(&m_rwlock); }
+  bool try_lock_shared() { return pthread_rwlock_tryrdlock(&m_rwlock) == 0; }
+  void unlock_shared() { pthread_rwlock_unlock(&m_rwlock); }
+
+ private:
+  pthread_rwlock_t m_rwlock;
+};
+
+/**
+ * Scoped shared ownership of a SharedMutex, like std::lock_guard.
+ */
+class SharedLock {
+ public:
+  explicit SharedLock(SharedMutex &mutex) : m_mutex(mutex) {
+    m_mutex.lock_shared();
+  }
+
+  SharedLock(SharedLock &&) = delete;
+  SharedLock(const SharedLock &) = delete;
+  SharedLock &operator=(SharedLock &&) = delete;
+  SharedLock &operator=(const SharedLock &) = delete;
+  ~SharedLock() { m_mutex.unlock_shared(); }
+
+ private:
+  SharedMutex &m_mutex;
+};
+
+}  // namespace Threading
+}  // namespace QS
+
+
+#endif  // INCLUDE_BASE_SHAREDMUTEX_H_
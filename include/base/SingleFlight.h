@@ -0,0 +1,127 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+#ifndef INCLUDE_BASE_SINGLEFLIGHT_H_
+#define INCLUDE_BASE_SINGLEFLIGHT_H_
+
+#include <stdint.h>
+
+#include <atomic>  // NOLINT
+#include <exception>
+#include <functional>
+#include <future>  // NOLINT
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+
+#include "base/HashUtils.h"
+
+namespace QS {
+
+namespace Threading {
+
+/**
+ * Coalesce the concurrent calls with the same key.
+ *
+ * The first caller of a key (the leader) runs the call, and the callers of
+ * the key arriving before it finishes (the followers) wait for and share its
+ * result, so the call runs once for all of them. A caller arriving after the
+ * leader finishes runs the call again.
+ */
+template <typename Result>
+class SingleFlight {
+ public:
+  SingleFlight() : m_callCount(0), m_coalescedCount(0) {}
+
+  SingleFlight(SingleFlight &&) = delete;
+  SingleFlight(const SingleFlight &) = delete;
+  SingleFlight &operator=(SingleFlight &&) = delete;
+  SingleFlight &operator=(const SingleFlight &) = delete;
+  ~SingleFlight() = default;
+
+ public:
+  // Run the call for the key, or wait for the one running already
+  //
+  // @param  : key, call, coalesced(output) telling if the result is shared
+  //           from another caller
+  // @return : result of the call
+  //
+  // An exception thrown by the call is rethrown to all the callers.
+  Result Do(const std::string &key, const std::function<Result()> &call,
+            bool *coalesced = nullptr) {
+    std::promise<Result> promise;
+    std::shared_future<Result> future;
+    bool leader = false;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto it = m_calls.find(key);
+      if (it != m_calls.end()) {
+        future = it->second;
+      } else {
+        future = promise.get_future().share();
+        m_calls.emplace(key, future);
+        leader = true;
+      }
+    }
+    if (coalesced != nullptr) {
+      *coalesced = !leader;
+    }
+    if (!leader) {
+      ++m_coalescedCount;
+      return future.get();
+    }
+
+    ++m_callCount;
+    try {
+      auto result = call();
+      Finish(key);
+      promise.set_value(result);
+      return result;
+    } catch (...) {
+      Finish(key);
+      promise.set_exception(std::current_exception());
+      throw;
+    }
+  }
+
+ public:
+  uint64_t GetCallCount() const { return m_callCount.load(); }
+  uint64_t GetCoalescedCount() const { return m_coalescedCount.load(); }
+
+  std::string ToString() const {
+    return "[calls:coalesced=" + std::to_string(GetCallCount()) + ":" +
+           std::to_string(GetCoalescedCount()) + "]";
+  }
+
+ private:
+  void Finish(const std::string &key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_calls.erase(key);
+  }
+
+ private:
+  std::unordered_map<std::string, std::shared_future<Result>,
+                     HashUtils::StringHash>
+      m_calls;  // key to the result of the running call
+  std::atomic<uint64_t> m_callCount;
+  std::atomic<uint64_t> m_coalescedCount;
+  std::mutex m_mutex;
+};
+
+}  // namespace Threading
+}  // namespace QS
+
+#endif  // INCLUDE_BASE_SINGLEFLIGHT_H_
@@ -107,6 +107,7 @@ class ThreadPool {
   friend class TaskHandle;
   friend class ThreadPoolInitializer;
   friend class ThreadPoolTest;
+  friend class RoundRobinSchedulerTest;
 };
 
 template <typename F, typename... Args>
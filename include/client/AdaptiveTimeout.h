@@ -0,0 +1,107 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#ifndef INCLUDE_CLIENT_ADAPTIVETIMEOUT_H_
+#define INCLUDE_CLIENT_ADAPTIVETIMEOUT_H_
+
+#include <stdint.h>
+
+#include <atomic>  // NOLINT
+#include <mutex>  // NOLINT
+#include <string>
+
+namespace QS {
+
+namespace Client {
+
+enum class TimedOperation {
+  Download,     // units are bytes
+  Upload,       // units are bytes
+  ListObjects,  // units are objects
+  Count         // should always be the last one
+};
+
+/**
+ * Timeouts of requests derived from the measured time of recent requests.
+ *
+ * For each operation, the time per unit of request is estimated by an EWMA,
+ * where a fixed count of units is added to each request to account for the
+ * latency. The timeout is the estimated time of the request scaled by a
+ * margin which grows with the mean deviation of the samples, just like TCP
+ * retransmission timeout, and it is bounded by the floor and ceiling.
+ *
+ * Each timeout doubles the estimate of the operation, so a request which is
+ * re-sent over a slow link gets more time. A zero estimate, which doubling
+ * never recovers from, is dropped instead to fall back to the default.
+ */
+class AdaptiveTimeout {
+ public:
+  // Ceiling 0 means unbounded, and floor is at least 1ms.
+  AdaptiveTimeout(uint32_t floorInMs, uint32_t ceilingInMs);
+
+  AdaptiveTimeout(AdaptiveTimeout &&) = delete;
+  AdaptiveTimeout(const AdaptiveTimeout &) = delete;
+  AdaptiveTimeout &operator=(AdaptiveTimeout &&) = delete;
+  AdaptiveTimeout &operator=(const AdaptiveTimeout &) = delete;
+  ~AdaptiveTimeout() = default;
+
+ public:
+  // Get timeout of a request
+  //
+  // @param  : operation, units, default timeout in ms
+  // @return : timeout in ms
+  //
+  // Default timeout is returned until enough requests have been measured.
+  uint32_t GetTimeoutInMs(TimedOperation op, uint64_t units,
+                          uint32_t defaultInMs) const;
+
+  // Record the elapsed time of a successful request
+  void OnComplete(TimedOperation op, uint64_t units, uint32_t elapsedInMs);
+
+  // Record a request timed out
+  void OnTimeout(TimedOperation op);
+
+ public:
+  uint32_t GetFloorInMs() const { return m_floorInMs; }
+  uint32_t GetCeilingInMs() const { return m_ceilingInMs; }
+  uint64_t GetTimeoutCount(TimedOperation op) const {
+    return m_timeoutCounts[static_cast<int>(op)].load();
+  }
+
+  std::string ToString() const;
+
+ private:
+  struct Estimate {
+    double msPerUnit = 0;
+    double deviation = 0;  // relative to msPerUnit
+    unsigned sampleCount = 0;
+  };
+
+  static const int kOperationCount = static_cast<int>(TimedOperation::Count);
+
+  uint32_t m_floorInMs;
+  uint32_t m_ceilingInMs;
+  Estimate m_estimates[kOperationCount];
+  std::atomic<uint64_t> m_timeoutCounts[kOperationCount];
+  mutable std::mutex m_mutex;
+};
+
+}  // namespace Client
+}  // namespace QS
+
+
+#endif  // INCLUDE_CLIENT_ADAPTIVETIMEOUT_H_
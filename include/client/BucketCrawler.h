@@ -0,0 +1,104 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+#ifndef INCLUDE_CLIENT_BUCKETCRAWLER_H_
+#define INCLUDE_CLIENT_BUCKETCRAWLER_H_
+
+#include <stdint.h>
+
+#include <atomic>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "base/CancellationToken.h"
+
+namespace QS {
+
+namespace Client {
+
+/**
+ * Crawler listing the directories of a bucket in parallel.
+ *
+ * The key space is split by the common prefixes, i.e. the sub directories,
+ * which are listed by a bounded set of workers. The pages of one directory
+ * are listed in order, as each page needs the marker of the previous one, so
+ * a crawl is as fast as the dirs are listed concurrently.
+ */
+class BucketCrawler {
+ public:
+  // Lister of a whole directory, which outputs the paths of the sub dirs
+  // and returns false if fail to list the dir
+  using DirectoryLister = std::function<bool(
+      const std::string &dirPath, std::vector<std::string> *subDirPaths)>;
+
+  BucketCrawler(DirectoryLister lister, unsigned concurrency);
+
+  BucketCrawler(BucketCrawler &&) = delete;
+  BucketCrawler(const BucketCrawler &) = delete;
+  BucketCrawler &operator=(BucketCrawler &&) = delete;
+  BucketCrawler &operator=(const BucketCrawler &) = delete;
+  ~BucketCrawler() = default;
+
+ public:
+  // Crawl the directories under a dir
+  //
+  // @param  : dir path
+  // @return : count of dirs listed
+  //
+  // The dir and all its descendant dirs are listed, the dirs found are
+  // listed earlier than the ones found later, so the upper levels are listed
+  // first. It returns when all dirs are listed or the crawl is cancelled.
+  uint64_t Crawl(const std::string &dirPath);
+
+  // Cancel the crawl, the dirs being listed are still finished
+  void Cancel();
+
+ public:
+  unsigned GetConcurrency() const { return m_concurrency; }
+  bool IsCancelled() const { return m_cancellation.IsCancelled(); }
+  uint64_t GetListedCount() const { return m_listedCount.load(); }
+  uint64_t GetFailedCount() const { return m_failedCount.load(); }
+
+  std::string ToString() const;
+
+ private:
+  // Take the pending dirs and list them until no dir is pending or listing
+  void Work();
+
+ private:
+  DirectoryLister m_lister;
+  unsigned m_concurrency;
+
+  std::deque<std::string> m_pendingDirs;
+  unsigned m_busyWorkers;
+  QS::Threading::CancellationToken m_cancellation;
+
+  std::atomic<uint64_t> m_listedCount;
+  std::atomic<uint64_t> m_failedCount;
+
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+};
+
+}  // namespace Client
+}  // namespace QS
+
+
+#endif  // INCLUDE_CLIENT_BUCKETCRAWLER_H_
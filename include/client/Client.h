@@ -20,14 +20,17 @@
 #include <sys/statvfs.h>
 #include <time.h>
 
+#include <atomic>              // NOLINT
 #include <chrono>              // NOLINT
 #include <condition_variable>  // NOLINT
 #include <iostream>
 #include <memory>
 #include <mutex>  // NOLINT
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "base/SingleFlight.h"
 #include "base/ThreadPool.h"
 #include "client/ClientConfiguration.h"
 #include "client/ClientError.h"
@@ -37,6 +40,10 @@
 
 namespace QS {
 
+namespace Data {
+class FileMetaData;
+}  // namespace Data
+
 namespace FileSystem {
 class Drive;
 }  // namespace FileSystem
@@ -48,6 +55,9 @@ class RetryStrategy;
 
 class Client {
  public:
+  // result of stat, and the flag telling if the object is modified
+  using StatResult = std::pair<ClientError<QSError>, bool>;
+
   Client(std::shared_ptr<ClientImpl> impl =
              ClientFactory::Instance().MakeClientImpl(),
          std::unique_ptr<QS::Threading::ThreadPool> executor =
@@ -82,6 +92,18 @@ class Client {
   // files or subdirectories belongs to it).
   virtual ClientError<QSError> DeleteFile(const std::string &filePath) = 0;
 
+  // Delete files
+  //
+  // @param  : file paths, output of the paths not deleted (could be null)
+  // @return : ClientError
+  //
+  // DeleteFiles deletes the files or empty directories in batches.
+  // The error of the first failed batch is returned, the files which are
+  // not deleted still remain in dir tree.
+  virtual ClientError<QSError> DeleteFiles(
+      const std::vector<std::string> &filePaths,
+      std::vector<std::string> *undeletedPaths) = 0;
+
   // Create an empty file
   //
   // @param  : file path
@@ -186,6 +208,20 @@ class Client {
   virtual ClientError<QSError> ListDirectory(const std::string &dirPath,
                                              bool useThreadPool = true) = 0;
 
+  // List a page of directory
+  //
+  // @param  : dir path, marker(input and output), max count, child metas
+  //           (output)
+  // @return : ClientError
+  //
+  // ListDirectoryPage lists the children after the marker, and sets the
+  // marker to continue the listing, or empty if all children are listed.
+  // The listed children are appended to child metas, and the dir tree is
+  // not updated.
+  virtual ClientError<QSError> ListDirectoryPage(
+      const std::string &dirPath, std::string *marker, uint64_t maxCount,
+      std::vector<std::shared_ptr<QS::Data::FileMetaData>> *childMetas) = 0;
+
   // Get object meta data
   //
   // @param  : file path, modifiedSince, *modified(output)
@@ -200,6 +236,17 @@ class Client {
                                     time_t modifiedSince = 0,
                                     bool *modified = nullptr) = 0;
 
+  // Get meta data of the file, or the dir if no such file
+  //
+  // @param  : path without ending '/', isDirectory(output)
+  // @return : ClientError
+  //
+  // StatFileOrDirectory answers if "path" or "path/" exists at once, and
+  // grows the dir tree with the found one. Using isDirectory to know which
+  // one is found.
+  virtual ClientError<QSError> StatFileOrDirectory(
+      const std::string &path, bool *isDirectory = nullptr) = 0;
+
   // Get information about mounted bucket
   //
   // @param  : stvfs(output)
@@ -211,19 +258,48 @@ class Client {
 
   const RetryStrategy &GetRetryStrategy() const { return m_retryStrategy; }
   const std::shared_ptr<ClientImpl> &GetClientImpl() const { return m_impl; }
+  size_t GetBackgroundPoolSize() const { return m_backgroundPoolSize; }
+
+  // Concurrent stats of the same object, and listings of the same directory,
+  // are coalesced into one request by them
+  QS::Threading::SingleFlight<StatResult> &GetStatFlights() {
+    return m_statFlights;
+  }
+  QS::Threading::SingleFlight<ClientError<QSError>> &GetListFlights() {
+    return m_listFlights;
+  }
+  // Generation of the writes, the stats issued after a write never join the
+  // ones issued before it, which could miss the write
+  uint64_t GetWriteGeneration() const { return m_writeGeneration.load(); }
 
  protected:
   std::shared_ptr<ClientImpl> GetClientImpl() { return m_impl; }
+  // Called once a write request is done, whether it succeeds or not
+  void BumpWriteGeneration() { ++m_writeGeneration; }
   const std::unique_ptr<QS::Threading::ThreadPool> &GetExecutor() const {
     return m_executor;
   }
+  // Executor of the background tasks waiting for requests, such as the
+  // batch removals, the stat refreshes and the workers moving a directory.
+  // They share it instead of holding the workers of the executor, so the
+  // requests they wait for always have free workers.
+  const std::unique_ptr<QS::Threading::ThreadPool> &GetBackgroundExecutor()
+      const {
+    return m_backgroundExecutor;
+  }
 
  private:
   std::shared_ptr<ClientImpl> m_impl;
   std::unique_ptr<QS::Threading::ThreadPool> m_executor;
+  size_t m_backgroundPoolSize;
   RetryStrategy m_retryStrategy;
   mutable std::mutex m_retryLock;
   mutable std::condition_variable m_retrySignal;
+  QS::Threading::SingleFlight<StatResult> m_statFlights;
+  std::atomic<uint64_t> m_writeGeneration;
+  QS::Threading::SingleFlight<ClientError<QSError>> m_listFlights;
+  // declared last to stop the background tasks first
+  std::unique_ptr<QS::Threading::ThreadPool> m_backgroundExecutor;
 
   friend class QS::FileSystem::Drive;
 };
@@ -89,6 +89,15 @@ class ClientConfiguration {
   uint32_t GetTransferBufferSizeInMB() const {
     return m_transferBufferSizeInMB;
   }
+  uint32_t GetMaxDownloadInFlightSizeInMB() const {
+    return m_maxDownloadInFlightSizeInMB;
+  }
+  uint32_t GetDownloadRateLimitInKB() const { return m_downloadRateLimitInKB; }
+  uint32_t GetUploadRateLimitInKB() const { return m_uploadRateLimitInKB; }
+  uint32_t GetRequestRateLimit() const { return m_requestRateLimit; }
+  uint32_t GetHedgePercent() const { return m_hedgePercent; }
+  uint32_t GetTimeoutFloorInMs() const { return m_timeoutFloorInMs; }
+  uint32_t GetTimeoutCeilingInMs() const { return m_timeoutCeilingInMs; }
 
  private:
   const std::string& GetAccessKeyId() const { return m_accessKeyId; }
@@ -118,6 +127,13 @@ class ClientConfiguration {
   uint16_t m_clientPoolSize;           // pool size of client
   uint16_t m_parallelTransfers;        // number of file transfers in parallel
   uint32_t m_transferBufferSizeInMB;   // file transfer buffer size in MB
+  uint32_t m_maxDownloadInFlightSizeInMB;  // download budget in MB
+  uint32_t m_downloadRateLimitInKB;        // 0 means unlimited
+  uint32_t m_uploadRateLimitInKB;          // 0 means unlimited
+  uint32_t m_requestRateLimit;  // requests per second, 0 means unlimited
+  uint32_t m_hedgePercent;      // 0 means disable hedging
+  uint32_t m_timeoutFloorInMs;    // bounds of adaptive transfer timeouts
+  uint32_t m_timeoutCeilingInMs;  // 0 means unbounded
 };
 
 }  // namespace Client
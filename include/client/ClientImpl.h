@@ -20,7 +20,10 @@
 #include <memory>
 
 #include "base/ThreadPool.h"
+#include "client/AdaptiveTimeout.h"
 #include "client/ClientConfiguration.h"
+#include "client/HedgePolicy.h"
+#include "client/RateLimiter.h"
 
 namespace QS {
 
@@ -38,6 +41,24 @@ class ClientImpl {
   ClientImpl &operator=(const ClientImpl &) = default;
   virtual ~ClientImpl();
 
+ public:
+  // Rate limits of the requests, every request sent to object storage
+  // should acquire from it first.
+  const std::unique_ptr<RateLimiter> &GetRateLimiter() const {
+    return m_rateLimiter;
+  }
+
+  // Policy of hedged range downloads, it is shared with the requests which
+  // may be still running after the caller gives up waiting.
+  const std::shared_ptr<HedgePolicy> &GetHedgePolicy() const {
+    return m_hedgePolicy;
+  }
+
+  // Timeouts of file transfers and listing
+  const std::unique_ptr<AdaptiveTimeout> &GetAdaptiveTimeout() const {
+    return m_adaptiveTimeout;
+  }
+
  protected:
   const std::unique_ptr<QS::Threading::ThreadPool> &GetExecutor() const {
     return m_executor;
@@ -45,6 +66,9 @@ class ClientImpl {
 
  private:
   std::unique_ptr<QS::Threading::ThreadPool> m_executor;
+  std::unique_ptr<RateLimiter> m_rateLimiter;
+  std::shared_ptr<HedgePolicy> m_hedgePolicy;
+  std::unique_ptr<AdaptiveTimeout> m_adaptiveTimeout;
 };
 
 }  // namespace Client
@@ -0,0 +1,116 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#ifndef INCLUDE_CLIENT_CONCURRENCYCONTROLLER_H_
+#define INCLUDE_CLIENT_CONCURRENCYCONTROLLER_H_
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>
+
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <functional>
+#include <mutex>  // NOLINT
+#include <string>
+
+namespace QS {
+
+namespace Client {
+
+/**
+ * An AIMD (additive increase, multiplicative decrease) controller of the
+ * number of concurrent transfers.
+ *
+ * A transfer calls Acquire before sending its request, which blocks until
+ * the number of transfers in flight is under the limit, and calls Release
+ * with the transferred bytes and whether it hits congestion (i.e. throttled
+ * or timed out) when finished.
+ *
+ * The transfers are measured in windows, a window ends when as many transfers
+ * as the limit have completed. If the limit has been reached during a window
+ * and the throughput of the window improves, the limit is increased by one.
+ * The limit is halved on congestion, at most once for the transfers started
+ * before the last decrease.
+ */
+class ConcurrencyController {
+ public:
+  using TimePoint = std::chrono::steady_clock::time_point;
+  using LimitIncreasedHandler = std::function<void(size_t)>;
+
+  ConcurrencyController(size_t minLimit, size_t maxLimit, size_t initialLimit);
+
+  ConcurrencyController(ConcurrencyController &&) = delete;
+  ConcurrencyController(const ConcurrencyController &) = delete;
+  ConcurrencyController &operator=(ConcurrencyController &&) = delete;
+  ConcurrencyController &operator=(const ConcurrencyController &) = delete;
+  ~ConcurrencyController() = default;
+
+ public:
+  // Acquire a slot for a transfer
+  //
+  // @param  : void
+  // @return : start time of the transfer, which should be passed to Release
+  //
+  // Block waiting until the transfers in flight are under the limit.
+  TimePoint Acquire();
+
+  // Release the slot of a transfer
+  //
+  // @param  : start time, transferred bytes, flag of congestion
+  // @return : void
+  void Release(TimePoint start, uint64_t bytes, bool congested);
+
+  // Set handler which will be invoked with the new limit once it increases
+  void SetLimitIncreasedHandler(LimitIncreasedHandler handler);
+
+ public:
+  size_t GetMinLimit() const { return m_minLimit; }
+  size_t GetMaxLimit() const { return m_maxLimit; }
+  size_t GetLimit() const;
+  size_t GetInFlight() const;
+  uint64_t GetIncreaseCount() const;
+  uint64_t GetDecreaseCount() const;
+
+  std::string ToString() const;
+
+ private:
+  size_t m_minLimit;
+  size_t m_maxLimit;
+  size_t m_limit;
+  size_t m_inFlight;
+
+  // measure of current window
+  TimePoint m_windowStart;
+  uint64_t m_windowBytes;
+  size_t m_windowCompletions;
+  bool m_windowSaturated;  // denote if limit has been reached in the window
+  double m_lastThroughput;  // bytes per second of last window
+
+  TimePoint m_lastDecrease;
+  uint64_t m_increaseCount;
+  uint64_t m_decreaseCount;
+  LimitIncreasedHandler m_limitIncreasedHandler;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_released;
+};
+
+}  // namespace Client
+}  // namespace QS
+
+
+#endif  // INCLUDE_CLIENT_CONCURRENCYCONTROLLER_H_
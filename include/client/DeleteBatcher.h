@@ -0,0 +1,134 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#ifndef INCLUDE_CLIENT_DELETEBATCHER_H_
+#define INCLUDE_CLIENT_DELETEBATCHER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>  // NOLINT
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/HashUtils.h"
+
+namespace QS {
+
+namespace Client {
+
+/**
+ * Collector of the removals which are submitted as batches.
+ *
+ * The paths added within the linger time are grouped into one batch, a batch
+ * is dispatched as soon as it reaches the batch size. The batches are handled
+ * concurrently by up to max batches workers of the executor, each worker keeps
+ * taking the batches until none is left. Bound it below the executor pool
+ * size if the handler itself waits for tasks of the same executor.
+ */
+class DeleteBatcher {
+ public:
+  // Handler removing a batch of paths
+  using BatchHandler = std::function<void(const std::vector<std::string> &)>;
+  // Function submitting a task to an executor
+  using TaskSubmitter = std::function<void(std::function<void()>)>;
+
+  // A max batches of 0 leaves the concurrent batches unbounded
+  DeleteBatcher(TaskSubmitter submitter, BatchHandler handler,
+                size_t batchSize, std::chrono::milliseconds linger,
+                size_t maxBatches = 0);
+
+  DeleteBatcher(DeleteBatcher &&) = delete;
+  DeleteBatcher(const DeleteBatcher &) = delete;
+  DeleteBatcher &operator=(DeleteBatcher &&) = delete;
+  DeleteBatcher &operator=(const DeleteBatcher &) = delete;
+  // Flush the pending paths
+  ~DeleteBatcher();
+
+ public:
+  // Add a path to be removed
+  //
+  // @param  : path
+  // @return : void
+  void Add(const std::string &path);
+
+  // Check if a path is waiting for or in removal
+  //
+  // @param  : path
+  // @return : bool
+  bool IsPending(const std::string &path) const;
+
+  // Check if any path is waiting for or in removal
+  //
+  // @param  : void
+  // @return : bool
+  bool HasPending() const;
+
+  // Dispatch the collected paths and wait for all batches to finish
+  //
+  // @param  : void
+  // @return : void
+  void Flush();
+
+ public:
+  size_t GetBatchSize() const { return m_batchSize; }
+  size_t GetMaxBatches() const { return m_maxBatches; }
+  uint64_t GetBatchCount() const { return m_batchCount.load(); }
+  uint64_t GetPathCount() const { return m_pathCount.load(); }
+
+  std::string ToString() const;
+
+ private:
+  // Handle the full batches, or wait for the linger time then handle the
+  // batch being collected, until there is nothing left to handle
+  void ProcessBatches();
+
+ private:
+  TaskSubmitter m_submitter;
+  BatchHandler m_handler;
+  size_t m_batchSize;
+  std::chrono::milliseconds m_linger;
+  size_t m_maxBatches;
+
+  std::vector<std::string> m_batch;  // paths being collected
+  std::deque<std::vector<std::string>> m_fullBatches;
+  bool m_batchScheduled;             // a worker lingers for m_batch
+  size_t m_workers;                  // scheduled or running workers
+  unsigned m_flushWaiters;
+  // paths collected or being handled, with their occurrence count
+  std::unordered_map<std::string, unsigned, HashUtils::StringHash>
+      m_pendingPaths;
+
+  std::atomic<uint64_t> m_batchCount;
+  std::atomic<uint64_t> m_pathCount;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_batchCond;
+  std::condition_variable m_doneCond;
+};
+
+}  // namespace Client
+}  // namespace QS
+
+
+#endif  // INCLUDE_CLIENT_DELETEBATCHER_H_
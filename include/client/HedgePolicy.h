@@ -0,0 +1,120 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#ifndef INCLUDE_CLIENT_HEDGEPOLICY_H_
+#define INCLUDE_CLIENT_HEDGEPOLICY_H_
+
+#include <stdint.h>
+
+#include <atomic>  // NOLINT
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+namespace QS {
+
+namespace Client {
+
+/**
+ * Policy of hedged requests.
+ *
+ * If a request has not completed after the hedge delay, which is the given
+ * percentile of the latencies observed recently, a duplicate request could be
+ * issued and the one finishing first wins.
+ *
+ * Latencies are kept per size class of the requested bytes, so a small read is
+ * not hedged by the latencies of large parts and vice versa.
+ *
+ * Each request earns a fraction of a hedge, so the hedges issued are capped to
+ * the given percentage of the requests.
+ */
+class HedgePolicy {
+ public:
+  // Percent 0 means disable hedging.
+  HedgePolicy(unsigned maxHedgePercent, uint32_t minDelayInMs = 10,
+              size_t sampleWindowSize = 256, unsigned percentile = 95);
+
+  HedgePolicy(HedgePolicy &&) = delete;
+  HedgePolicy(const HedgePolicy &) = delete;
+  HedgePolicy &operator=(HedgePolicy &&) = delete;
+  HedgePolicy &operator=(const HedgePolicy &) = delete;
+  ~HedgePolicy() = default;
+
+ public:
+  // Get the hedge delay
+  //
+  // @param  : requested bytes
+  // @return : delay in milliseconds, 0 if no hedge should be issued
+  //
+  // No hedge is issued until enough latencies have been observed for requests
+  // of the same size class.
+  uint32_t GetDelayInMs(uint64_t bytes = 0) const;
+
+  // Record a hedgeable request, which earns the hedge budget
+  void OnRequest();
+
+  // Record the latency of a completed request of the requested bytes
+  void OnComplete(uint32_t latencyInMs, uint64_t bytes = 0);
+
+  // Try to issue a hedge
+  //
+  // @param  : void
+  // @return : true if the hedge budget affords it
+  bool TryHedge();
+
+  // Record a hedge which finished before the original request
+  void OnHedgeWon() { ++m_wonCount; }
+
+ public:
+  bool IsEnabled() const { return m_maxHedgePercent > 0; }
+  unsigned GetMaxHedgePercent() const { return m_maxHedgePercent; }
+  uint64_t GetRequestCount() const { return m_requestCount.load(); }
+  uint64_t GetIssuedCount() const { return m_issuedCount.load(); }
+  uint64_t GetWonCount() const { return m_wonCount.load(); }
+  // Count of hedges not issued due to the budget
+  uint64_t GetRejectedCount() const { return m_rejectedCount.load(); }
+
+  std::string ToString() const;
+
+ private:
+  struct SampleWindow {
+    std::vector<uint32_t> samples;  // ring buffer of latencies
+    size_t nextSample;
+    size_t sampleCount;
+    uint32_t delayInMs;
+  };
+
+  void UpdateDelayNoLock(SampleWindow *window);
+
+ private:
+  unsigned m_maxHedgePercent;
+  uint32_t m_minDelayInMs;
+  unsigned m_percentile;
+  std::vector<SampleWindow> m_windows;  // one per size class
+  unsigned m_budget;  // in percent of a hedge
+  std::atomic<uint64_t> m_requestCount;
+  std::atomic<uint64_t> m_issuedCount;
+  std::atomic<uint64_t> m_wonCount;
+  std::atomic<uint64_t> m_rejectedCount;
+  mutable std::mutex m_mutex;
+};
+
+}  // namespace Client
+}  // namespace QS
+
+
+#endif  // INCLUDE_CLIENT_HEDGEPOLICY_H_
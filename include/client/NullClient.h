@@ -42,6 +42,9 @@ class NullClient : public Client {
   ClientError<QSError> HeadBucket(bool useThreadPool) override;
 
   ClientError<QSError> DeleteFile(const std::string &filePath) override;
+  ClientError<QSError> DeleteFiles(
+      const std::vector<std::string> &filePaths,
+      std::vector<std::string> *undeletedPaths) override;
   ClientError<QSError> MakeFile(const std::string &filePath) override;
   ClientError<QSError> MakeDirectory(const std::string &dirPath) override;
   ClientError<QSError> MoveFile(const std::string &filePath,
@@ -78,9 +81,15 @@ class NullClient : public Client {
 
   ClientError<QSError> ListDirectory(const std::string &dirPath,
                                      bool useThreadPool) override;
+  ClientError<QSError> ListDirectoryPage(
+      const std::string &dirPath, std::string *marker, uint64_t maxCount,
+      std::vector<std::shared_ptr<QS::Data::FileMetaData>> *childMetas)
+      override;
 
   ClientError<QSError> Stat(const std::string &path, time_t modifiedSince = 0,
                             bool *modified = nullptr) override;
+  ClientError<QSError> StatFileOrDirectory(
+      const std::string &path, bool *isDirectory = nullptr) override;
   ClientError<QSError> Statvfs(struct statvfs *stvfs) override;
 };
 
@@ -50,7 +50,9 @@ class NullTransferManager : public TransferManager {
  public:
   std::shared_ptr<TransferHandle> DownloadFile(
       const std::string &filePath, off_t offset, uint64_t size,
-      std::shared_ptr<std::iostream> downStream, bool async = false) override {
+      std::shared_ptr<std::iostream> downStream, bool async = false,
+      std::shared_ptr<QS::Threading::CancellationToken> cancelToken =
+          nullptr) override {
     return nullptr;
   }
 
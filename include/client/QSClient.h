@@ -62,6 +62,19 @@ class QSClient : public Client {
   // files or subdirectories belongs to it).
   ClientError<QSError> DeleteFile(const std::string &filePath) override;
 
+  // Delete files
+  //
+  // @param  : file paths, output of the paths not deleted (could be null)
+  // @return : ClientError
+  //
+  // DeleteFiles groups the files into DeleteMultipleObjects requests of up
+  // to the api limit, and removes the deleted ones from dir tree and cache
+  // in bulk. Hard links are only removed from dir tree as DeleteFile does.
+  // The paths of a failed request are all reported as not deleted.
+  ClientError<QSError> DeleteFiles(
+      const std::vector<std::string> &filePaths,
+      std::vector<std::string> *undeletedPaths) override;
+
   // Create an empty file
   //
   // @param  : file path
@@ -95,6 +108,9 @@ class QSClient : public Client {
   // @return : ClientError
   //
   // MoveDirectory move dir, subdirs and subfiles recursively.
+  // The whole sub tree is listed page by page, then the objects are moved by
+  // a bounded set of workers if async is true, otherwise one by one. It
+  // returns when all objects are moved, and the dir itself is moved at last.
   // Notes: MoveDirectory will do nothing on dir tree and cache.
   ClientError<QSError> MoveDirectory(const std::string &sourceDirPath,
                                      const std::string &targetDirPath,
@@ -156,13 +172,27 @@ class QSClient : public Client {
   // @param  : dir path, falg to use thread pool or not
   // @return : ClientError
   //
-  // ListDirectory will update directory in tree if dir exists and is modified
-  // or grow the tree if the directory is not existing in tree.
+  // ListDirectory grows the tree with the listed children page by page. When
+  // the listing is complete, the children not listed are removed from tree
+  // and the dir is recorded as listed, see DirectoryTree::SetDirectoryListed.
+  // The concurrent listings of the same dir are coalesced into one.
   //
   // Notice the dirPath should end with delimiter.
   ClientError<QSError> ListDirectory(const std::string &dirPath,
                                      bool useThreadPool = true) override;
 
+  // List a page of directory
+  //
+  // @param  : dir path, marker(input and output), max count, child metas
+  //           (output)
+  // @return : ClientError
+  //
+  // This does no ops on dir tree and cache.
+  ClientError<QSError> ListDirectoryPage(
+      const std::string &dirPath, std::string *marker, uint64_t maxCount,
+      std::vector<std::shared_ptr<QS::Data::FileMetaData>> *childMetas)
+      override;
+
   // Create a symbolic link to a file
   //
   // @param  : file path to link to, link path
@@ -184,12 +214,28 @@ class QSClient : public Client {
   // Using modified to gain output of object modified status since given time.
   //
   // Stat will update the node meta in dir tree if the node is modified.
+  // The concurrent stats of the same object with the same modifiedSince are
+  // coalesced into one request.
   //
   // Notes: the meta will be return if object is modified, otherwise
   // the response code will be 304 (NOT MODIFIED) and no meta returned.
   ClientError<QSError> Stat(const std::string &path, time_t modifiedSince = 0,
                             bool *modified = nullptr) override;
 
+  // Get meta data of the file, or the dir if no such file
+  //
+  // @param  : path without ending '/', isDirectory(output)
+  // @return : ClientError
+  //
+  // Instead of heading "path" and "path/" one by one, this lists the objects
+  // with prefix of "path" and delimiter '/' by a limit of 2, in which the
+  // file is the key of "path" and the dir is the common prefix of "path/".
+  // Only when the names continuing "path" with a char less than '/' fill up
+  // the limit, it falls back to stat them one by one.
+  // The concurrent calls for the same path are coalesced into one request.
+  ClientError<QSError> StatFileOrDirectory(
+      const std::string &path, bool *isDirectory = nullptr) override;
+
   // Get information about mounted bucket
   //
   // @param  : *stvfs(output)
@@ -209,6 +255,17 @@ class QSClient : public Client {
   // This only submit skd delete object request, no ops on dir tree and cache.
   ClientError<QSError> DeleteObject(const std::string &path);
 
+  // Delete objects
+  //
+  // @param  : object paths, undeleted object paths(output)
+  // @return : ClientError
+  //
+  // The paths should be no more than BucketDeleteMultipleObjectsLimit.
+  // This only submit sdk delete multiple objects request, no ops on dir tree
+  // and cache.
+  ClientError<QSError> DeleteObjects(const std::vector<std::string> &paths,
+                                     std::vector<std::string> *undeleted);
+
   // Move object
   //
   // @param  : source file path, target file path
@@ -221,7 +278,7 @@ class QSClient : public Client {
   // List objects
   //
   // @param  : input, resultTruncated(output), resCount(outputu) maxCount,
-  //           flag to use thread pool or not
+  //           flag to use thread pool or not, marker(input and output)
   // @return : ListObjectsOutcome
   //
   // Use maxCount to specify the count limit of objects you want to list.
@@ -229,13 +286,16 @@ class QSClient : public Client {
   // Use resCount to obtain the actual listed objects number
   // Use resultTruncated to obtain the status of whether the operation has
   // list all of the objects of the bucket;
+  // Use marker to list from the given marker, it will be set with the marker
+  // to continue the listing, or empty if all objects are listed.
   //
   // This only submit skd listobjects request, no ops on dir tree and cache.
   ListObjectsOutcome ListObjects(const std::string &dirPath,
                                  bool *resultTruncated = nullptr,
                                  uint64_t *resCount = nullptr,
                                  uint64_t maxCount = 0,
-                                 bool useThreadPool = true);
+                                 bool useThreadPool = true,
+                                 std::string *marker = nullptr);
 
  public:
   static const std::unique_ptr<QingStor::QsConfig> &GetQingStorConfig();
@@ -243,6 +303,13 @@ class QSClient : public Client {
 
  private:
   std::shared_ptr<QSClientImpl> &GetQSClientImpl();
+  // Do the listing and stat, which are coalesced by ListDirectory and Stat
+  ClientError<QSError> DoListDirectory(const std::string &dirPath,
+                                       bool useThreadPool);
+  ClientError<QSError> DoStat(const std::string &path, time_t modifiedSince,
+                              bool *modified);
+  ClientError<QSError> DoStatFileOrDirectory(const std::string &path,
+                                             bool *isDirectory);
   static void StartQSService();
   void CloseQSService();
   void InitializeClientImpl();
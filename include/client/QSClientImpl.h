@@ -19,11 +19,14 @@
 
 #include <stdint.h>  // for uint64_t
 
+#include <future>  // NOLINT
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "qingstor/Bucket.h"  // for instantiation of QSClientImpl
+#include "qingstor/QsErrors.h"  // for sdk QsError
 
 #include "client/ClientConfiguration.h"
 #include "client/ClientImpl.h"
@@ -126,6 +129,8 @@ class QSClientImpl : public ClientImpl {
   //
   // @param  : object key, GetObjectInput
   // @return : GetObjectOutcome
+  //
+  // Range request is hedged if it is enabled by the hedge policy.
   GetObjectOutcome GetObject(
       const std::string &objKey, QingStor::GetObjectInput *input,
       uint32_t msTimeDuration =
@@ -216,6 +221,19 @@ class QSClientImpl : public ClientImpl {
   }
 
  private:
+  // Get object with hedged requests
+  //
+  // @param  : object key, GetObjectInput, time duration in ms, result(output)
+  // @return : status of the wait for result
+  //
+  // If the request has not completed after the hedge delay, a duplicate one is
+  // sent and the first successful response wins. The loser is skipped if it
+  // has not started yet, otherwise its response is discarded.
+  std::future_status HedgedGetObject(
+      const std::string &objKey, const QingStor::GetObjectInput &input,
+      uint32_t msTimeDuration,
+      std::pair<QsError, QingStor::GetObjectOutput> *result) const;
+
   void SetBucket(std::unique_ptr<QingStor::Bucket> bucket);
 
  private:
@@ -72,6 +72,8 @@ std::string QSErrorToString(QSError err);
 ClientError<QSError> GetQSErrorForCode(const std::string &errorCode);
 std::string GetMessageForQSError(const ClientError<QSError> &error);
 bool IsGoodQSError(const ClientError<QSError> &error);
+// Denote the server is overloaded or the network is congested
+bool IsThrottlingQSError(const ClientError<QSError> &error);
 
 QSError SDKErrorToQSError(QsError sdkErr);
 QSError SDKResponseToQSError(QingStor::Http::HttpResponseCode code);
@@ -20,6 +20,9 @@
 #include <memory>
 #include <string>
 
+#include "client/ClientError.h"
+#include "client/ConcurrencyController.h"
+#include "client/QSError.h"
 #include "client/TransferManager.h"
 
 namespace QS {
@@ -41,11 +44,14 @@ class QSTransferManager : public TransferManager {
  public:
   // Download a file
   //
-  // @param  : file path, file offset, size, bufStream
+  // @param  : file path, file offset, size, bufStream, flag asynchronizely,
+  //           cancellation token
   // @return : transfer handle
   std::shared_ptr<TransferHandle> DownloadFile(
       const std::string &filePath, off_t offset, uint64_t size,
-      std::shared_ptr<std::iostream> bufStream, bool async = false) override;
+      std::shared_ptr<std::iostream> bufStream, bool async = false,
+      std::shared_ptr<QS::Threading::CancellationToken> cancelToken =
+          nullptr) override;
 
   // Retry a failed download
   //
@@ -99,6 +105,10 @@ class QSTransferManager : public TransferManager {
                          bool async = false);
   void DoUpload(const std::shared_ptr<TransferHandle> &handlebool,
                 bool async = false);
+
+  // Report a finished transfer to the concurrency controller
+  void ReleaseConcurrency(ConcurrencyController::TimePoint start,
+                          uint64_t bytes, const ClientError<QSError> &err);
 };
 
 }  // namespace Client
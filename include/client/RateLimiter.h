@@ -0,0 +1,163 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#ifndef INCLUDE_CLIENT_RATELIMITER_H_
+#define INCLUDE_CLIENT_RATELIMITER_H_
+
+#include <stdint.h>
+
+#include <atomic>  // NOLINT
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <mutex>  // NOLINT
+#include <string>
+
+namespace QS {
+
+namespace Client {
+
+enum class RequestPriority {
+  Foreground,  // requests someone is waiting for, e.g. synchronous read
+  Background   // requests such as prefetch and asynchronous upload
+};
+
+/**
+ * A token bucket which refills at a fixed rate up to the burst size.
+ *
+ * Acquire blocks until the bucket could afford the tokens. A single
+ * acquisition larger than the burst is granted once the bucket is full, and
+ * it leaves the bucket in debt which will be paid by the following refill.
+ *
+ * Foreground acquisitions are throttled last: they are granted as soon as
+ * the bucket is not in debt, while background acquisitions wait until the
+ * bucket holds all the tokens they want and no foreground one is waiting.
+ */
+class TokenBucket {
+ public:
+  // Rate 0 means unlimited, burst 0 means same as rate (one second).
+  explicit TokenBucket(uint64_t rate, uint64_t burst = 0);
+
+  TokenBucket(TokenBucket &&) = delete;
+  TokenBucket(const TokenBucket &) = delete;
+  TokenBucket &operator=(TokenBucket &&) = delete;
+  TokenBucket &operator=(const TokenBucket &) = delete;
+  ~TokenBucket() = default;
+
+ public:
+  // Acquire tokens from bucket
+  //
+  // @param  : tokens, priority
+  // @return : void
+  //
+  // Block waiting until the tokens are affordable.
+  void Acquire(uint64_t tokens,
+               RequestPriority priority = RequestPriority::Foreground);
+
+ public:
+  bool IsUnlimited() const { return m_rate == 0; }
+  uint64_t GetRate() const { return m_rate; }
+  uint64_t GetBurst() const { return m_burst; }
+  // Total tokens granted
+  uint64_t GetAcquiredCount() const { return m_acquiredCount.load(); }
+  // Count of acquisitions which have been blocked
+  uint64_t GetWaitCount(RequestPriority priority) const;
+  // Total time of acquisitions being blocked
+  uint64_t GetWaitTimeInMs() const { return m_waitTimeInMs.load(); }
+
+  std::string ToString() const;
+
+ private:
+  void RefillNoLock(std::chrono::steady_clock::time_point now);
+
+ private:
+  uint64_t m_rate;  // tokens per second
+  uint64_t m_burst;
+  double m_tokens;  // negative value means in debt
+  std::chrono::steady_clock::time_point m_lastRefill;
+  unsigned m_foregroundWaiters;
+  std::atomic<uint64_t> m_acquiredCount;
+  std::atomic<uint64_t> m_foregroundWaitCount;
+  std::atomic<uint64_t> m_backgroundWaitCount;
+  std::atomic<uint64_t> m_waitTimeInMs;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cond;
+};
+
+/**
+ * Rate limits of the requests sent to object storage.
+ *
+ * The priority of a request is taken from the calling thread, which is
+ * foreground unless it is set by a ScopedRequestPriority.
+ */
+class RateLimiter {
+ public:
+  // Rate 0 means unlimited.
+  RateLimiter(uint64_t downloadBytesPerSec, uint64_t uploadBytesPerSec,
+              uint64_t requestsPerSec);
+
+  RateLimiter(RateLimiter &&) = delete;
+  RateLimiter(const RateLimiter &) = delete;
+  RateLimiter &operator=(RateLimiter &&) = delete;
+  RateLimiter &operator=(const RateLimiter &) = delete;
+  ~RateLimiter() = default;
+
+ public:
+  // Block until a request could be sent
+  void AcquireRequest();
+  // Block until the bytes could be downloaded
+  void AcquireDownload(uint64_t bytes);
+  // Block until the bytes could be uploaded
+  void AcquireUpload(uint64_t bytes);
+
+ public:
+  const TokenBucket &GetDownloadBucket() const { return m_download; }
+  const TokenBucket &GetUploadBucket() const { return m_upload; }
+  const TokenBucket &GetRequestBucket() const { return m_request; }
+
+  std::string ToString() const;
+
+  // Return priority of the requests sent from current thread
+  static RequestPriority GetThreadPriority();
+
+ private:
+  TokenBucket m_download;  // bytes per second
+  TokenBucket m_upload;    // bytes per second
+  TokenBucket m_request;   // requests per second
+};
+
+/**
+ * Set the priority of the requests sent from current thread during its life.
+ */
+class ScopedRequestPriority {
+ public:
+  explicit ScopedRequestPriority(RequestPriority priority);
+
+  ScopedRequestPriority(ScopedRequestPriority &&) = delete;
+  ScopedRequestPriority(const ScopedRequestPriority &) = delete;
+  ScopedRequestPriority &operator=(ScopedRequestPriority &&) = delete;
+  ScopedRequestPriority &operator=(const ScopedRequestPriority &) = delete;
+  ~ScopedRequestPriority();
+
+ private:
+  RequestPriority m_previous;
+};
+
+}  // namespace Client
+}  // namespace QS
+
+
+#endif  // INCLUDE_CLIENT_RATELIMITER_H_
@@ -0,0 +1,86 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#ifndef INCLUDE_CLIENT_RETRYBUDGET_H_
+#define INCLUDE_CLIENT_RETRYBUDGET_H_
+
+#include <stdint.h>
+
+#include <atomic>  // NOLINT
+#include <chrono>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+
+namespace QS {
+
+namespace Client {
+
+/**
+ * Budget of the retries shared by all requests.
+ *
+ * It is a token bucket, each retry takes a token and the bucket refills at
+ * a fixed rate up to its capacity. When the service keeps failing, the
+ * retries are limited to the refill rate instead of growing with the
+ * number of requests.
+ */
+class RetryBudget {
+ public:
+  // Capacity 0 means unlimited.
+  RetryBudget(unsigned capacity, unsigned refillPerSec);
+
+  RetryBudget(RetryBudget &&) = delete;
+  RetryBudget(const RetryBudget &) = delete;
+  RetryBudget &operator=(RetryBudget &&) = delete;
+  RetryBudget &operator=(const RetryBudget &) = delete;
+  ~RetryBudget() = default;
+
+ public:
+  // Try to take a token for a retry
+  //
+  // @param  : void
+  // @return : true if the budget affords the retry
+  bool TryAcquire();
+
+ public:
+  bool IsUnlimited() const { return m_capacity == 0; }
+  unsigned GetCapacity() const { return m_capacity; }
+  unsigned GetRefillPerSec() const { return m_refillPerSec; }
+  uint64_t GetAcquiredCount() const { return m_acquiredCount.load(); }
+  // Count of retries given up due to the budget
+  uint64_t GetRejectedCount() const { return m_rejectedCount.load(); }
+
+  std::string ToString() const;
+
+ private:
+  unsigned m_capacity;
+  unsigned m_refillPerSec;
+  double m_tokens;
+  std::chrono::steady_clock::time_point m_lastRefill;
+  std::atomic<uint64_t> m_acquiredCount;
+  std::atomic<uint64_t> m_rejectedCount;
+  std::mutex m_mutex;
+};
+
+// Return the retry budget shared by the process
+const std::shared_ptr<RetryBudget> &GetDefaultRetryBudget();
+
+}  // namespace Client
+}  // namespace QS
+
+
+#endif  // INCLUDE_CLIENT_RETRYBUDGET_H_
@@ -14,11 +14,17 @@
 // | limitations under the License.
 // +-------------------------------------------------------------------------
 
+
 #ifndef INCLUDE_CLIENT_RETRYSTRATEGY_H_
 #define INCLUDE_CLIENT_RETRYSTRATEGY_H_
 
+#include <stdint.h>
+
+#include <memory>
+
 #include "client/ClientError.h"
 #include "client/QSError.h"
+#include "client/RetryBudget.h"
 
 namespace QS {
 
@@ -28,21 +34,61 @@ namespace Retry {
 static const unsigned DefaultScaleFactor = 25;
 }  // namespace Retry
 
+enum class RetryErrorClass {
+  Throttle,      // server is overloaded, e.g. 429, 503
+  Timeout,       // request timeout or network failure
+  ServerError,   // other retryable errors, e.g. 500
+  NonRetryable,  // client errors such as 403, 404
+  Count          // should always be the last one
+};
+
+RetryErrorClass ClassifyRetryError(const ClientError<QSError> &error);
+
+struct RetryPolicy {
+  unsigned maxRetryTimes;
+  uint32_t baseDelayInMs;
+  uint32_t maxDelayInMs;
+};
+
+/**
+ * Retry strategy with decorrelated jitter backoff.
+ *
+ * The delay before a retry is picked randomly between the base delay and
+ * three times the last delay, and capped by the max delay, so the retries of
+ * concurrent requests failed at the same time are spread out.
+ *
+ * Each class of error has its own policy. The retries are also limited by the
+ * retry budget if there is one.
+ */
 class RetryStrategy {
  public:
-  RetryStrategy(unsigned maxRetryTimes, unsigned scaleFactor)
-      : m_maxRetryTimes(maxRetryTimes), m_scaleFactor(scaleFactor) {}
+  RetryStrategy(unsigned maxRetryTimes, unsigned scaleFactor,
+                std::shared_ptr<RetryBudget> budget = nullptr);
 
   bool ShouldRetry(const ClientError<QSError> &error,
                    unsigned attemptedRetryTimes) const;
 
+  // Calculate the delay before next retry
+  //
+  // @param  : error, attempted retry times, last delay in ms
+  // @return : delay in ms
   uint32_t CalculateDelayBeforeNextRetry(const ClientError<QSError> &error,
-                                         unsigned attemptedRetryTimes) const;
+                                         unsigned attemptedRetryTimes,
+                                         uint32_t lastDelayInMs = 0) const;
+
+ public:
+  const RetryPolicy &GetPolicy(RetryErrorClass errorClass) const {
+    return m_policies[static_cast<int>(errorClass)];
+  }
+  void SetPolicy(RetryErrorClass errorClass, const RetryPolicy &policy) {
+    m_policies[static_cast<int>(errorClass)] = policy;
+  }
+  const std::shared_ptr<RetryBudget> &GetBudget() const { return m_budget; }
 
  private:
   RetryStrategy() = default;
-  unsigned m_maxRetryTimes;
-  unsigned m_scaleFactor;
+  RetryPolicy m_policies[static_cast<int>(RetryErrorClass::Count)];
+  std::shared_ptr<RetryBudget> m_budget;
 };
 
 RetryStrategy GetDefaultRetryStrategy();
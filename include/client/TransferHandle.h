@@ -28,6 +28,7 @@
 #include <string>
 #include <vector>
 
+#include "base/CancellationToken.h"
 #include "client/ClientError.h"
 #include "client/QSError.h"
 
@@ -147,7 +148,9 @@ class TransferHandle {
   uint64_t GetBytesTransferred() const { return m_bytesTransferred.load(); }
   uint64_t GetBytesTotalSize() const { return m_bytesTotalSize.load(); }
   TransferDirection GetDirection() const { return m_direction; }
-  bool ShouldContinue() const { return !m_cancel.load(); }
+  bool ShouldContinue() const {
+    return !m_cancel.load() && !(m_cancelToken && m_cancelToken->IsCancelled());
+  }
   TransferStatus GetStatus() const;
 
   const std::string &GetTargetFilePath() const { return m_targetFilePath; }
@@ -185,6 +188,12 @@ class TransferHandle {
   // Reset the cancellation for a retry. This will be done automatically by
   // transfer manager
   void Restart() { m_cancel.store(false); }
+  // Bind the transfer with a cancellation token owned by someone else, the
+  // transfer is cancelled too once the token is cancelled.
+  void SetCancellationToken(
+      const std::shared_ptr<QS::Threading::CancellationToken> &token) {
+    m_cancelToken = token;
+  }
   void UpdateStatus(TransferStatus status);
 
   void WritePartToDownloadStream(
@@ -228,6 +237,7 @@ class TransferHandle {
                                              // to be transferred
   TransferDirection m_direction;
   std::atomic<bool> m_cancel;
+  std::shared_ptr<QS::Threading::CancellationToken> m_cancelToken;
   TransferStatus m_status;
   mutable std::mutex m_statusLock;
   mutable std::condition_variable m_waitUntilFinishSignal;
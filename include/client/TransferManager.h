@@ -19,18 +19,25 @@
 
 #include <stdint.h>
 
+#include <atomic>  // NOLINT
 #include <iostream>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 
+#include "base/CancellationToken.h"
+#include "base/RoundRobinScheduler.h"
 #include "configure/Default.h"
 #include "client/ClientConfiguration.h"
+#include "client/ConcurrencyController.h"
+#include "data/ByteBudget.h"
 #include "data/ResourceManager.h"
 #include "data/Size.h"
 
 namespace QS {
 
 namespace Data {
+class ByteBudget;
 class ResourceManager;
 }  // namespace Data
 
@@ -39,6 +46,7 @@ class Drive;
 }  // namespace FileSystem
 
 namespace Threading {
+class RoundRobinScheduler;
 class ThreadPool;
 }  // namespace Threading
 
@@ -54,12 +62,20 @@ struct TransferManagerConfigure {
   // increase your max heap size if you plan on increasing buffer size.
   uint64_t m_bufferSize;
 
-  // Maximum number of file transfers to run in parallel.
+  // Number of file transfers to run in parallel at start, it is adjusted
+  // by the concurrency controller at runtime.
   size_t m_maxParallelTransfers;
 
-  // Maximum size of the working buffers to use
+  // Maximum size of the working buffers to use, this bounds the number of
+  // transfers in parallel. Buffers are allocated as the parallel transfers
+  // grow, so the memory is not occupied until it is needed.
   uint64_t m_bufferMaxHeapSize;
 
+  // Maximum size of file data being downloaded or queued for download.
+  // This bounds the memory held by pending download streams in total, the
+  // foreground reads could over-commit it by the same size at most.
+  uint64_t m_maxDownloadInFlightSize;
+
   TransferManagerConfigure(
       uint64_t bufSize =
           ClientConfiguration::Instance().GetTransferBufferSizeInMB() *
@@ -69,10 +85,14 @@ struct TransferManagerConfigure {
       uint64_t bufMaxHeapSize =
           ClientConfiguration::Instance().GetTransferBufferSizeInMB() *
           QS::Data::Size::MB1 *
-          ClientConfiguration::Instance().GetParallelTransfers())
+          ClientConfiguration::Instance().GetParallelTransfers() * 2,
+      uint64_t maxDownloadInFlightSize =
+          ClientConfiguration::Instance().GetMaxDownloadInFlightSizeInMB() *
+          QS::Data::Size::MB1)
       : m_bufferSize(bufSize),
         m_maxParallelTransfers(maxParallelTransfers),
-        m_bufferMaxHeapSize(bufMaxHeapSize) {}
+        m_bufferMaxHeapSize(bufMaxHeapSize),
+        m_maxDownloadInFlightSize(maxDownloadInFlightSize) {}
 };
 
 class TransferManager {
@@ -87,11 +107,17 @@ class TransferManager {
  public:
   // Download a file
   //
-  // @param  : file path, file offset, size, bufStream, falg asynchornizely
+  // @param  : file path, file offset, size, bufStream, falg asynchornizely,
+  //           cancellation token
   // @return : transfer handle
+  //
+  // If the token is cancelled, the queued parts will be skipped and the
+  // transfer will be cancelled.
   virtual std::shared_ptr<TransferHandle> DownloadFile(
       const std::string &filePath, off_t offset, uint64_t size,
-      std::shared_ptr<std::iostream> bufStream, bool async = false) = 0;
+      std::shared_ptr<std::iostream> bufStream, bool async = false,
+      std::shared_ptr<QS::Threading::CancellationToken> cancelToken =
+          nullptr) = 0;
 
   // Retry a failed download
   //
@@ -136,12 +162,32 @@ class TransferManager {
     return m_configure.m_maxParallelTransfers;
   }
   size_t GetBufferCount() const;
+  uint64_t GetMaxDownloadInFlightSize() const {
+    return m_configure.m_maxDownloadInFlightSize;
+  }
+  const std::unique_ptr<QS::Data::ByteBudget> &GetDownloadBudget() const {
+    return m_downloadBudget;
+  }
+  // Size of download data skipped or dropped as no longer wanted
+  uint64_t GetCancelledDownloadBytes() const {
+    return m_cancelledDownloadBytes.load();
+  }
+  // Controller of the number of transfers in parallel
+  const std::unique_ptr<ConcurrencyController> &GetConcurrencyController()
+      const {
+    return m_concurrencyController;
+  }
 
  protected:
   const std::shared_ptr<Client> GetClient() const { return m_client; }
   const std::unique_ptr<QS::Threading::ThreadPool> &GetExecutor() const {
     return m_executor;
   }
+  // Scheduler to share the executor among files in round-robin order
+  const std::unique_ptr<QS::Threading::RoundRobinScheduler> &GetScheduler()
+      const {
+    return m_scheduler;
+  }
   const std::unique_ptr<QS::Data::ResourceManager> &GetBufferManager() const {
     return m_bufferManager;
   }
@@ -149,13 +195,33 @@ class TransferManager {
  private:
   void SetClient(const std::shared_ptr<Client> &client);
 
+ protected:
+  void AddCancelledDownloadBytes(uint64_t bytes) {
+    m_cancelledDownloadBytes += bytes;
+  }
+
  private:
   void InitializeResources();
+  // Allocate buffers until there are count buffers, bounded by buffer count
+  void GrowBuffers(size_t count);
 
  private:
   TransferManagerConfigure m_configure;
   std::unique_ptr<QS::Data::ResourceManager> m_bufferManager;
 
+  // Budget of file data being downloaded or queued for download.
+  std::unique_ptr<QS::Data::ByteBudget> m_downloadBudget;
+  std::atomic<uint64_t> m_cancelledDownloadBytes;
+
+  // Buffers are allocated as the concurrency limit grows.
+  size_t m_allocatedBufferCount;
+  std::mutex m_bufferAllocationLock;
+  std::unique_ptr<ConcurrencyController> m_concurrencyController;
+
+  // Scheduler submitting transfer tasks to executor, it should be declared
+  // before executor, as it must outlive the executor worker threads.
+  std::unique_ptr<QS::Threading::RoundRobinScheduler> m_scheduler;
+
   // This executor is used in a different context with the client used one.
   std::unique_ptr<QS::Threading::ThreadPool> m_executor;
   std::shared_ptr<Client> m_client;
@@ -58,6 +58,9 @@ blkcnt_t GetBlocks(off_t size);  // Number of 512B blocks allocated
 uint64_t GetMaxCacheSize();      // File data cache size in bytes
 size_t GetMaxStatCount();        // File meta data cache max count
 uint16_t GetMaxListObjectsCount();  // max count for list operation
+uint32_t GetDefaultNegativeTTLInSec();  // 0 means disable negative cache
+uint32_t GetDefaultMaxStaleInMin();  // 0 means disable stale stat entries
+uint32_t GetDefaultWarmUpListings();  // 0 means disable warm-up crawl
 
 int GetQSConnectionDefaultRetries();
 uint32_t GetTransactionDefaultTimeDuration();  // in milliseconds
@@ -67,6 +70,13 @@ const char* GetQingStorSDKLogFileName();
 size_t GetDefaultParallelTransfers();
 uint64_t GetDefaultTransferMaxBufHeapSize();
 uint64_t GetDefaultTransferBufSize();
+uint64_t GetDefaultMaxDownloadInFlightSize();  // download budget in bytes
+uint32_t GetDefaultDownloadRateLimitInKB();  // in KB/s, 0 means unlimited
+uint32_t GetDefaultUploadRateLimitInKB();    // in KB/s, 0 means unlimited
+uint32_t GetDefaultRequestRateLimit();  // requests per second, 0 is unlimited
+uint32_t GetDefaultHedgePercent();  // 0 means disable hedging
+uint32_t GetDefaultTimeoutFloorInMs();    // floor of adaptive timeout
+uint32_t GetDefaultTimeoutCeilingInMs();  // ceiling of adaptive timeout
 
 uint64_t GetUploadMultipartMinPartSize();
 uint64_t GetUploadMultipartMaxPartSize();
@@ -70,10 +70,23 @@ class Options {
   uint32_t GetMaxStatCountInK() const { return m_maxStatCountInK; }
   int32_t GetMaxListCount() const { return m_maxListCount; }
   int32_t GetStatExpireInMin() const { return m_statExpireInMin; }
+  uint32_t GetNegativeTTLInSec() const { return m_negativeTTLInSec; }
+  uint32_t GetMaxStaleInMin() const { return m_maxStaleInMin; }
+  const std::string &GetSnapshotFile() const { return m_snapshotFile; }
+  uint32_t GetWarmUpListings() const { return m_warmUpListings; }
   uint16_t GetParallelTransfers() const { return m_parallelTransfers; }
   uint32_t GetTransferBufferSizeInMB() const {
     return m_transferBufferSizeInMB;
   }
+  uint32_t GetMaxDownloadInFlightSizeInMB() const {
+    return m_maxDownloadInFlightSizeInMB;
+  }
+  uint32_t GetDownloadRateLimitInKB() const { return m_downloadRateLimitInKB; }
+  uint32_t GetUploadRateLimitInKB() const { return m_uploadRateLimitInKB; }
+  uint32_t GetRequestRateLimit() const { return m_requestRateLimit; }
+  uint32_t GetHedgePercent() const { return m_hedgePercent; }
+  uint32_t GetTimeoutFloorInMs() const { return m_timeoutFloorInMs; }
+  uint32_t GetTimeoutCeilingInMs() const { return m_timeoutCeilingInMs; }
   uint16_t GetClientPoolSize() const { return m_clientPoolSize; }
   const std::string &GetHost() const { return m_host; }
   const std::string &GetProtocol() const { return m_protocol; }
@@ -115,12 +128,27 @@ class Options {
     m_maxListCount = maxlist;
   }
   void SetStatExpireInMin(int32_t expire) { m_statExpireInMin = expire; }
+  void SetNegativeTTLInSec(uint32_t ttl) { m_negativeTTLInSec = ttl; }
+  void SetMaxStaleInMin(uint32_t maxStale) { m_maxStaleInMin = maxStale; }
+  void SetSnapshotFile(const char *file) { m_snapshotFile = file; }
+  void SetWarmUpListings(uint32_t listings) { m_warmUpListings = listings; }
   void SetParallelTransfers(unsigned numtransfers) {
     m_parallelTransfers = numtransfers;
   }
   void SetTransferBufferSizeInMB(uint32_t bufsize) {
     m_transferBufferSizeInMB = bufsize;
   }
+  void SetMaxDownloadInFlightSizeInMB(uint32_t maxdownload) {
+    m_maxDownloadInFlightSizeInMB = maxdownload;
+  }
+  void SetDownloadRateLimitInKB(uint32_t rate) {
+    m_downloadRateLimitInKB = rate;
+  }
+  void SetUploadRateLimitInKB(uint32_t rate) { m_uploadRateLimitInKB = rate; }
+  void SetRequestRateLimit(uint32_t rate) { m_requestRateLimit = rate; }
+  void SetHedgePercent(uint32_t percent) { m_hedgePercent = percent; }
+  void SetTimeoutFloorInMs(uint32_t ms) { m_timeoutFloorInMs = ms; }
+  void SetTimeoutCeilingInMs(uint32_t ms) { m_timeoutCeilingInMs = ms; }
   void SetClientPoolSize(uint32_t poolsize) {
     m_clientPoolSize = poolsize;
   }
@@ -156,8 +184,22 @@ class Options {
   uint32_t m_maxStatCountInK;
   int32_t m_maxListCount;  // negative value will list all files for ls
   int32_t m_statExpireInMin;  //  negative value will disable state expire
+  uint32_t m_negativeTTLInSec;  // 0 means disable negative cache
+  // time after stat expire, within which the expired stat entries are used
+  // while being refreshed in background, 0 means disable it
+  uint32_t m_maxStaleInMin;
+  std::string m_snapshotFile;  // snapshot of dir tree, empty means disable it
+  // listings in parallel to crawl the bucket at mount, 0 means disable it
+  uint32_t m_warmUpListings;
   uint16_t m_parallelTransfers;  // count of file transfers in parallel
   uint32_t m_transferBufferSizeInMB;
+  uint32_t m_maxDownloadInFlightSizeInMB;  // budget of downloading file data
+  uint32_t m_downloadRateLimitInKB;  // 0 means unlimited
+  uint32_t m_uploadRateLimitInKB;    // 0 means unlimited
+  uint32_t m_requestRateLimit;       // requests per second, 0 means unlimited
+  uint32_t m_hedgePercent;  // max percent of range downloads to hedge
+  uint32_t m_timeoutFloorInMs;    // bounds of adaptive transfer timeouts
+  uint32_t m_timeoutCeilingInMs;  // 0 means unbounded
   uint16_t m_clientPoolSize;
   std::string m_host;
   std::string m_protocol;
@@ -0,0 +1,158 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#ifndef INCLUDE_DATA_BYTEBUDGET_H_
+#define INCLUDE_DATA_BYTEBUDGET_H_
+
+#include <stdint.h>
+
+#include <atomic>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <mutex>  // NOLINT
+#include <string>
+
+namespace QS {
+
+namespace Data {
+
+/**
+ * A counting budget of bytes with Acquire/Release semantics.
+ *
+ * Acquire will block until the requested bytes fit into the budget.
+ * TryAcquire never blocks, it just fails if the budget is exhausted.
+ * Release returns bytes to the budget and unblocks waiting acquisitions.
+ *
+ * A single acquisition larger than the whole budget is granted once no
+ * bytes are in use, so a caller is never blocked forever.
+ *
+ * ForceAcquire over-commits the budget for the callers which must not wait
+ * for the other holders. The forced bytes are counted in the bytes in use and
+ * reported on their own. They could be capped by max forced bytes, then a
+ * capped forced acquisition only waits for the other forced bytes to be
+ * released. The callers which some forced holder could be waiting for, such
+ * as the transfer workers, should not be capped.
+ */
+class ByteBudget {
+ public:
+  // A max forced bytes of 0 leaves the forced bytes uncapped
+  explicit ByteBudget(uint64_t maxBytes, uint64_t maxForcedBytes = 0);
+
+  ByteBudget(ByteBudget &&) = delete;
+  ByteBudget(const ByteBudget &) = delete;
+  ByteBudget &operator=(ByteBudget &&) = delete;
+  ByteBudget &operator=(const ByteBudget &) = delete;
+  ~ByteBudget() = default;
+
+ public:
+  // Acquire bytes from budget
+  //
+  // @param  : bytes
+  // @return : void
+  //
+  // Block waiting until the bytes are available.
+  void Acquire(uint64_t bytes);
+
+  // Try to acquire bytes from budget
+  //
+  // @param  : bytes
+  // @return : true if acquired, otherwise false
+  //
+  // Does not block.
+  bool TryAcquire(uint64_t bytes);
+
+  // Acquire bytes from budget even if it is exhausted
+  //
+  // @param  : bytes, flag to wait for the forced bytes over the cap
+  // @return : void
+  //
+  // Does not wait for the bytes of Acquire or TryAcquire, the bytes are
+  // still accounted and must be released by ReleaseForced. If capped, block
+  // waiting while the forced bytes would exceed the max forced bytes.
+  void ForceAcquire(uint64_t bytes, bool capped = true);
+
+  // Release bytes back to budget
+  //
+  // @param  : bytes
+  // @return : void
+  void Release(uint64_t bytes);
+
+  // Release bytes acquired by ForceAcquire back to budget
+  //
+  // @param  : bytes
+  // @return : void
+  void ReleaseForced(uint64_t bytes);
+
+ public:
+  uint64_t GetMaxBytes() const { return m_maxBytes; }
+  uint64_t GetBytesInUse() const;
+  uint64_t GetPeakBytesInUse() const;
+  uint64_t GetMaxForcedBytes() const { return m_maxForcedBytes; }
+  // Bytes in use which are acquired by ForceAcquire
+  uint64_t GetForcedBytesInUse() const;
+  uint64_t GetPeakForcedBytesInUse() const;
+  // Count of Acquire calls which have been blocked
+  uint64_t GetWaitCount() const { return m_waitCount.load(); }
+  // Count of TryAcquire calls which have failed
+  uint64_t GetRejectCount() const { return m_rejectCount.load(); }
+  // Count of ForceAcquire calls which have been blocked
+  uint64_t GetForcedWaitCount() const { return m_forcedWaitCount.load(); }
+
+  std::string ToString() const;
+
+ private:
+  bool HasRoomNoLock(uint64_t bytes) const;
+  bool HasForcedRoomNoLock(uint64_t bytes) const;
+  void AcquireNoLock(uint64_t bytes);
+  void ReleaseNoLock(uint64_t bytes);
+
+ private:
+  uint64_t m_maxBytes;
+  uint64_t m_bytesInUse;
+  uint64_t m_peakBytesInUse;
+  uint64_t m_maxForcedBytes;
+  uint64_t m_forcedBytesInUse;
+  uint64_t m_peakForcedBytesInUse;
+  std::atomic<uint64_t> m_waitCount;
+  std::atomic<uint64_t> m_rejectCount;
+  std::atomic<uint64_t> m_forcedWaitCount;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_released;
+};
+
+/**
+ * Hold the forced bytes of a budget during its life.
+ */
+class ScopedForcedBytes {
+ public:
+  ScopedForcedBytes(ByteBudget *budget, uint64_t bytes, bool capped = true);
+
+  ScopedForcedBytes(ScopedForcedBytes &&) = delete;
+  ScopedForcedBytes(const ScopedForcedBytes &) = delete;
+  ScopedForcedBytes &operator=(ScopedForcedBytes &&) = delete;
+  ScopedForcedBytes &operator=(const ScopedForcedBytes &) = delete;
+  ~ScopedForcedBytes();
+
+ private:
+  ByteBudget *m_budget;
+  uint64_t m_bytes;
+};
+
+}  // namespace Data
+}  // namespace QS
+
+
+#endif  // INCLUDE_DATA_BYTEBUDGET_H_
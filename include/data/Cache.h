@@ -29,6 +29,7 @@
 #include <unordered_map>
 #include <utility>
 
+#include "base/CancellationToken.h"
 #include "base/HashUtils.h"
 #include "data/File.h"
 #include "data/Page.h"
@@ -200,6 +201,15 @@ class Cache {
   // @return : void
   void Rename(const std::string &oldFileId, const std::string &newFileId);
 
+  // Rename the files under a directory
+  //
+  // @param  : old dir path, new dir path (ending with '/')
+  // @return : void
+  //
+  // This renames all the cached files under the dir in one pass.
+  void RenameDirectory(const std::string &oldDirPath,
+                       const std::string &newDirPath);
+
   // Change file mtime
   //
   // @param  : file id, mtime
@@ -218,6 +228,22 @@ class Cache {
   // @return : void
   void Resize(const std::string &fileId, size_t newSize, time_t mtime);
 
+  // Get cancellation token for speculative downloads of a file
+  //
+  // @param  : file id, mtime
+  // @return : token
+  //
+  // If File of fileId doesn't exist, create an empty one, so the token will
+  // be cancelled once the file is removed from cache.
+  std::shared_ptr<QS::Threading::CancellationToken> GetCancellationToken(
+      const std::string &fileId, time_t mtime);
+
+  // Cancel speculative downloads of a file
+  //
+  // @param  : file id
+  // @return : void
+  void CancelDownloads(const std::string &fileId);
+
  private:
   // Create an empty File with fileId in cache, without checking input.
   // If success return reference to insert file, else return m_cache.end().
@@ -23,16 +23,15 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <atomic>  // NOLINT
 #include <deque>
 #include <memory>
-#include <mutex>  // NOLINT
 #include <set>
 #include <string>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
-#include "base/HashUtils.h"
+#include "base/SharedMutex.h"
 #include "data/FileMetaData.h"
 
 namespace QS {
@@ -53,17 +52,32 @@ class File;
 class DirectoryTree;
 class Node;
 
-using FilePathToNodeUnorderedMap =
-    std::unordered_map<std::string, std::shared_ptr<Node>,
-                       HashUtils::StringHash>;
-using FilePathToWeakNodeUnorderedMap =
-    std::unordered_map<std::string, std::weak_ptr<Node>, HashUtils::StringHash>;
-using ParentFilePathToChildrenMultiMap =
-    std::unordered_multimap<std::string, std::weak_ptr<Node>,
-                            HashUtils::StringHash>;
-using ChildrenMultiMapIterator = ParentFilePathToChildrenMultiMap::iterator;
-using ChildrenMultiMapConstIterator =
-    ParentFilePathToChildrenMultiMap::const_iterator;
+// Children sorted by name
+using ChildrenVector = std::vector<std::shared_ptr<Node>>;
+
+/**
+ * Snapshot of the attributes of an entry
+ *
+ * A plain copy taken within one lock of the meta data. Use it when several
+ * attributes are needed at once, as every accessor of Entry and Node locks
+ * the meta data.
+ */
+struct EntrySnapshot {
+  EntrySnapshot() : st() {}
+
+  bool IsDirectory() const { return operable && S_ISDIR(st.st_mode); }
+  bool IsSymLink() const { return operable && S_ISLNK(st.st_mode); }
+  bool FileAccess(uid_t uid, gid_t gid, int amode) const {
+    return operable && CheckFileAccess(st.st_uid, st.st_gid, st.st_mode, uid,
+                                       gid, amode);
+  }
+
+  bool operable = false;  // false if the meta data has been released
+  struct stat st;
+  time_t cachedTime = 0;
+  bool needUpload = false;
+  bool fileOpen = false;
+};
 
 class Entry {
  public:
@@ -121,6 +135,9 @@ class Entry {
     return m_metaData.lock()->ToStat();
   }
 
+  // Take a snapshot of the attributes within one lock
+  EntrySnapshot GetSnapshot() const;
+
   bool FileAccess(uid_t uid, gid_t gid, int amode) const {
     return m_metaData.lock()->FileAccess(uid, gid, amode);
   }
@@ -133,6 +150,9 @@ class Entry {
     m_metaData.lock()->m_needUpload = needUpload;
   }
   void SetFileOpen(bool fileOpen) { m_metaData.lock()->m_fileOpen = fileOpen; }
+  void SetCachedTime(time_t cachedTime) {
+    m_metaData.lock()->m_cachedTime = cachedTime;
+  }
 
   void Rename(const std::string &newFilePath);
 
@@ -146,6 +166,11 @@ class Entry {
 
 /**
  * Representation of a Node in the directory tree.
+ *
+ * A node only stores its name relative to its parent (the base name, ending
+ * with '/' for a directory), the full path is built from the names along the
+ * parent links. A node which is not attached to the tree keeps its full path
+ * as its name.
  */
 class Node {
  public:
@@ -154,7 +179,7 @@ class Node {
   Node() : m_entry(Entry()), m_parent(std::shared_ptr<Node>(nullptr)) {}
 
   Node(Entry &&entry,
-       const std::shared_ptr<Node> &parent = std::make_shared<Node>());
+       const std::shared_ptr<Node> &parent = std::shared_ptr<Node>(nullptr));
 
   Node(Entry &&entry, const std::shared_ptr<Node> &parent,
        const std::string &symbolicLink);
@@ -180,37 +205,49 @@ class Node {
 
  public:
   bool IsEmpty() const { return m_children.empty(); }
-  bool HaveChild(const std::string &childFilePath) const;
-  std::shared_ptr<Node> Find(const std::string &childFilePath) const;
+  bool HaveChild(const std::string &childName) const;
+  std::shared_ptr<Node> Find(const std::string &childName) const;
+
+  // Find the child file named name, or the child dir named name + "/"
+  //
+  // @param  : child name without ending '/'
+  // @return : the file if existing, otherwise the dir
+  //
+  // The dir sorts after the file, only behind the names which continue the
+  // name with a char less than '/', so both are found with a lower bound
+  // search each in a narrow range, without building the dir name.
+  std::shared_ptr<Node> FindFileOrDirectory(const std::string &name) const;
 
   // Get Children
-  const FilePathToNodeUnorderedMap &GetChildren()
-      const;  // DO NOT store the map
+  const ChildrenVector &GetChildren() const;  // DO NOT store the vector
 
-  // Get the children's id (one level)
+  // Get the children's names (one level)
   std::set<std::string> GetChildrenIds() const;
 
-  // Get the children file names recursively
+  // Get the children file paths recursively
   //
   // @param  : void
-  // @return : a list of all children's file names and chilren's chidlren's ones
+  // @return : a list of all children's file paths and chilren's chidlren's ones
   //           in a recursively way. The nearest child is put at front.
   std::deque<std::string> GetChildrenIdsRecursively() const;
 
   std::shared_ptr<Node> Insert(const std::shared_ptr<Node> &child);
   void Remove(const std::shared_ptr<Node> &child);
-  void Remove(const std::string &childFilePath);
-  void RenameChild(const std::string &oldFilePath,
-                   const std::string &newFilePath);
+  void Remove(const std::string &childName);
+  void RenameChild(const std::string &oldName, const std::string &newName);
 
   // accessor
   const Entry &GetEntry() const { return m_entry; }
   std::shared_ptr<Node> GetParent() const { return m_parent.lock(); }
-  std::string GetSymbolicLink() const { return m_symbolicLink; }
-
-  std::string GetFilePath() const {
-    return m_entry ? m_entry.GetFilePath() : std::string();
+  std::string GetSymbolicLink() const {
+    return m_symbolicLink ? *m_symbolicLink : std::string();
   }
+  const std::string &GetName() const { return m_name; }
+  // Time of the last complete listing of the dir, 0 if not listed completely
+  time_t GetListedTime() const { return m_listedTime.load(); }
+
+  // Build the full path from the names of the node and its ancestors
+  std::string GetFilePath() const;
 
   uint64_t GetFileSize() const { return m_entry ? m_entry.GetFileSize() : 0; }
   int GetNumLink() const { return m_entry ? m_entry.GetNumLink() : 0; }
@@ -222,20 +259,21 @@ class Node {
   bool IsNeedUpload() const { return m_entry ? m_entry.IsNeedUpload() : false; }
   bool IsFileOpen() const { return m_entry ? m_entry.IsFileOpen() : false; }
 
-  std::string MyDirName() const {
-    return m_entry ? m_entry.MyDirName() : std::string();
-  }
-  std::string MyBaseName() const {
-    return m_entry ? m_entry.MyBaseName() : std::string();
-  }
+  std::string MyDirName() const;
+  std::string MyBaseName() const;
 
   bool FileAccess(uid_t uid, gid_t gid, int amode) const {
     return m_entry ? m_entry.FileAccess(uid, gid, amode) : false;
   }
 
+  EntrySnapshot GetSnapshot() const { return m_entry.GetSnapshot(); }
+
  private:
   Entry &GetEntry() { return m_entry; }
 
+  // Return the position of the first child not ordered before the name
+  ChildrenVector::const_iterator LowerBound(const std::string &childName) const;
+
   void SetNeedUpload(bool needUpload) {
     if (m_entry) {
       m_entry.SetNeedUpload(needUpload);
@@ -262,8 +300,17 @@ class Node {
 
   void SetEntry(Entry &&entry) { m_entry = std::move(entry); }
   void SetParent(const std::shared_ptr<Node> &parent) { m_parent = parent; }
-  void SetSymbolicLink(const std::string &symLnk) { m_symbolicLink = symLnk; }
+  void SetName(const std::string &name) { m_name = name; }
+  void SetSymbolicLink(const std::string &symLnk) {
+    m_symbolicLink.reset(new std::string(symLnk));
+  }
   void SetHardLink(bool isHardLink) { m_hardLink = isHardLink; }
+  void SetListedTime(time_t listedTime) { m_listedTime.store(listedTime); }
+  void SetCachedTime(time_t cachedTime) {
+    if (m_entry) {
+      m_entry.SetCachedTime(cachedTime);
+    }
+  }
 
   void IncreaseNumLink() {
     if (m_entry) {
@@ -271,22 +318,35 @@ class Node {
     }
   }
 
+  void DecreaseNumLink() {
+    if (m_entry) {
+      m_entry.DecreaseNumLink();
+    }
+  }
+
  private:
   Entry m_entry;
   std::weak_ptr<Node> m_parent;
-  std::string m_symbolicLink;
-  bool m_hardLink = false;
+  std::string m_name;  // name relative to parent
   // Node will control the life of its children, so only Node hold a shared_ptr
-  // to its children, others should use weak_ptr instead
-  FilePathToNodeUnorderedMap m_children;
+  // to its children, others should use weak_ptr instead.
+  // The children are sorted by their names.
+  ChildrenVector m_children;
+  std::unique_ptr<std::string> m_symbolicLink;  // only set for symlink
+  std::atomic<time_t> m_listedTime{0};  // only set for dir
+  bool m_hardLink = false;
 
   friend class QS::Data::Cache;  // for GetEntry
   friend class QS::Data::DirectoryTree;
-  friend class QS::FileSystem::Drive;  // for SetSymbolicLink, IncreaseNumLink
+  // for SetSymbolicLink, IncreaseNumLink, SetListedTime, SetCachedTime
+  friend class QS::FileSystem::Drive;
 };
 
 /**
  * Representation of the filesystem's directory tree.
+ *
+ * Lookups take the tree lock shared, so they run concurrently with each other
+ * and only wait for the updates, which take it exclusively.
  */
 class DirectoryTree {
  public:
@@ -296,7 +356,7 @@ class DirectoryTree {
   DirectoryTree(const DirectoryTree &) = delete;
   DirectoryTree &operator=(DirectoryTree &&) = delete;
   DirectoryTree &operator=(const DirectoryTree &) = delete;
-  ~DirectoryTree() { m_map.clear(); }
+  ~DirectoryTree() = default;
 
  public:
   // Get root
@@ -310,6 +370,8 @@ class DirectoryTree {
   //
   // @param  : file path (absolute path)
   // @return : node
+  //
+  // Find walks down from root by the path components.
   std::weak_ptr<Node> Find(const std::string &filePath) const;
 
   // Return if dir tree has node
@@ -318,6 +380,15 @@ class DirectoryTree {
   // @return : node
   bool Has(const std::string &filePath) const;
 
+  // Find the file, or the dir if no such file
+  //
+  // @param  : file path (absolute path) without ending '/'
+  // @return : node
+  //
+  // This resolves both "path" and "path/" by a single walk from root, see
+  // Node::FindFileOrDirectory. A path ending with '/' is found as Find does.
+  std::weak_ptr<Node> FindFileOrDirectory(const std::string &path) const;
+
   // Find children
   //
   // @param  : dir name which should be ending with "/"
@@ -325,11 +396,17 @@ class DirectoryTree {
   std::vector<std::weak_ptr<Node>> FindChildren(
       const std::string &dirName) const;
 
-  // Const iterator point to begin of the parent to children map
-  ChildrenMultiMapConstIterator CBeginParentToChildrenMap() const;
-
-  // Const iterator point to end of the parent to children map
-  ChildrenMultiMapConstIterator CEndParentToChildrenMap() const;
+  // Save a snapshot of the directory tree
+  //
+  // @param  : file path
+  // @return : true if the snapshot is saved
+  //
+  // The nodes are written in a compact binary format, parents ahead of their
+  // children, including the cached time of the meta data and the listing
+  // time of the dirs. The nodes not uploaded yet and the hard links are
+  // skipped. The snapshot is written to a temporary file which replaces the
+  // file at last, so a crash never leaves a partial snapshot.
+  bool SaveSnapshot(const std::string &filePath) const;
 
  private:
   // Grow the directory tree
@@ -339,6 +416,8 @@ class DirectoryTree {
   //
   // If the node reference to the meta data already exist, update meta data;
   // otherwise add node to the tree and build up the references.
+  // The missing ancestors are added with default directory meta data, so
+  // the tree is always connected.
   std::shared_ptr<Node> Grow(std::shared_ptr<FileMetaData> &&fileMeta);
 
   // Grow the directory tree
@@ -349,6 +428,20 @@ class DirectoryTree {
   // This will walk through the meta data list to Grow the dir tree.
   void Grow(std::vector<std::shared_ptr<FileMetaData>> &&fileMetas);
 
+  // Grow the children of a directory in bulk
+  //
+  // @param  : dir path, meta data of children
+  // @return : the dir node or null if fail to add it
+  //
+  // This is the bulk path for a page of listing. Within one lock of the tree,
+  // the children are sorted and merged with the existing ones in one pass,
+  // and their meta datas are added to the manager within one lock of it.
+  // The missing dir is added with default meta data, and the meta datas not
+  // belonging to the dir are grown one by one.
+  std::shared_ptr<Node> GrowChildren(
+      const std::string &dirPath,
+      std::vector<std::shared_ptr<FileMetaData>> &&childMetas);
+
   // Update a directory node in the directory tree
   //
   // @param  : dirpath, meta data of children
@@ -357,13 +450,39 @@ class DirectoryTree {
       const std::string &dirPath,
       std::vector<std::shared_ptr<FileMetaData>> &&childrenMetas);
 
+  // Record a complete listing of a directory
+  //
+  // @param  : dir path, paths of all listed children, time listing started
+  // @return : the dir node or null if the dir is not existing
+  //
+  // The children not listed are removed, except the ones cached after the
+  // listing started. The listing time is recorded in the dir node, so the
+  // children can be told not existing without asking object storage.
+  std::shared_ptr<Node> SetDirectoryListed(
+      const std::string &dirPath, const std::vector<std::string> &childPaths,
+      time_t listedTime);
+
   // Rename node
   //
   // @param  : old file path, new file path (absolute path)
   // @return : the node has been renamed or null if rename doesn't happen
+  //
+  // The node is moved to the new parent with the new name, so the children
+  // of a directory go along with it. The meta datas of the descendants are
+  // rekeyed by their new paths in meta data manager within one lock.
   std::shared_ptr<Node> Rename(const std::string &oldFilePath,
                                const std::string &newFilePath);
 
+  // Rename directory
+  //
+  // @param  : old dir path, new dir path (absolute path ending with '/')
+  // @return : the dir node has been renamed or null if rename doesn't happen
+  //
+  // As the descendants are keyed by names, this only moves the dir node in
+  // dir tree, and rekeys their meta datas, see Rename.
+  std::shared_ptr<Node> RenameDirectory(const std::string &oldDirPath,
+                                        const std::string &newDirPath);
+
   // Remove node
   //
   // @param  : path
@@ -372,6 +491,14 @@ class DirectoryTree {
   // This will remove node and all its childrens (recursively)
   void Remove(const std::string &path);
 
+  // Remove nodes
+  //
+  // @param  : paths
+  // @return : void
+  //
+  // Remove all the nodes within one lock of the tree.
+  void Remove(const std::vector<std::string> &paths);
+
   // Creat a hard link to a file
   //
   // @param  : the file path, the hard link path
@@ -379,21 +506,39 @@ class DirectoryTree {
   std::shared_ptr<Node> HardLink(const std::string &filePath,
                                  const std::string &hardlinkPath);
 
+  // Load the snapshot saved by SaveSnapshot
+  //
+  // @param  : file path
+  // @return : count of nodes loaded
+  //
+  // The nodes are loaded with a cached time and listed time of 0, so they
+  // are served at once and revalidated on their first access.
+  // The loading stops when the meta data manager is full, so the nodes loaded
+  // are kept, and the count returned is the nodes kept.
+  size_t LoadSnapshot(const std::string &filePath);
+
+ private:
+  // internal use only, the caller should hold the lock
+  std::shared_ptr<Node> FindNoLock(const std::string &filePath) const;
+  std::shared_ptr<Node> GrowNoLock(std::shared_ptr<FileMetaData> &&fileMeta);
+  std::shared_ptr<Node> GrowChildrenNoLock(
+      const std::string &dirPath,
+      std::vector<std::shared_ptr<FileMetaData>> &&childMetas);
+  std::shared_ptr<Node> RenameNoLock(const std::string &oldFilePath,
+                                     const std::string &newFilePath);
+  // Rekey the meta datas of the descendants of a renamed dir by their new
+  // paths in meta data manager
+  void RekeyDescendantsNoLock(const std::shared_ptr<Node> &dir);
+  void RemoveNoLock(const std::string &path);
+
  private:
   std::shared_ptr<Node> m_root;
   // std::shared_ptr<Node> m_currentNode;
-  mutable std::recursive_mutex m_mutex;
-  FilePathToWeakNodeUnorderedMap m_map;  // record all nodes map
-
-  // As we grow directory tree gradually, that means the directory tree can
-  // be a partial part of the entire tree, at some point some nodes haven't
-  // built the reference to its parent or children because which have not been
-  // added to the tree yet.
-  // So, the dirName to children map which will help to update these references.
-  ParentFilePathToChildrenMultiMap m_parentToChildrenMap;
+  mutable QS::Threading::SharedMutex m_mutex;
 
   friend class QS::Client::QSClient;
   friend class QS::FileSystem::Drive;
+  friend class DirectoryTreeTest;
 };
 
 }  // namespace Data
@@ -0,0 +1,124 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+#ifndef INCLUDE_DATA_DIRECTORYSTREAM_H_
+#define INCLUDE_DATA_DIRECTORYSTREAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sys/stat.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+namespace QS {
+
+namespace Data {
+
+/**
+ * Children of a directory read page by page while they are listed.
+ *
+ * The children are numbered in the listing order, and can be read from any
+ * offset, such as the readdir offset. Only a bounded window of children is
+ * kept in memory. The marker of each listed page is recorded, so reading
+ * before the window lists again from the page holding the offset.
+ */
+class DirectoryStream {
+ public:
+  struct Child {
+    std::string name;  // base name
+    struct stat st;
+  };
+
+  // Fetch a page of children
+  //
+  // @param  : offset of the first child of the page, marker(input and
+  //           output), children(output)
+  // @return : false if fails to list
+  //
+  // The marker should be set to the one of the next page, or empty if all
+  // children are listed.
+  using PageFetcher = std::function<bool(uint64_t, std::string *,
+                                         std::vector<Child> *)>;
+
+  // Put a child
+  //
+  // @param  : child, offset of the next child
+  // @return : false if there is no room for the child
+  using Filler = std::function<bool(const Child &, uint64_t)>;
+
+  // Ctor
+  //
+  // @param  : page fetcher, max count of children to read (0 for no limit),
+  //           max count of children kept in memory
+  DirectoryStream(PageFetcher fetcher, uint64_t maxCount,
+                  size_t maxWindowSize);
+
+  DirectoryStream(DirectoryStream &&) = delete;
+  DirectoryStream(const DirectoryStream &) = delete;
+  DirectoryStream &operator=(DirectoryStream &&) = delete;
+  DirectoryStream &operator=(const DirectoryStream &) = delete;
+  ~DirectoryStream() = default;
+
+ public:
+  // Read children from the offset
+  //
+  // @param  : offset, filler
+  // @return : false if fails to list
+  //
+  // The children are put until the filler has no room or all children are
+  // read, the pages are fetched when needed.
+  bool Read(uint64_t offset, const Filler &filler);
+
+ public:
+  uint64_t GetWindowStart() const;
+  size_t GetWindowSize() const;
+  uint64_t GetFetchCount() const;
+
+ private:
+  // Fetch the next page, and drop the children before keepFrom when the
+  // window is full
+  bool FetchNoLock(uint64_t keepFrom);
+
+  // Restart the listing from the page holding the offset
+  void SeekNoLock(uint64_t offset);
+
+ private:
+  PageFetcher m_fetcher;
+  uint64_t m_maxCount;
+  size_t m_maxWindowSize;
+
+  std::deque<Child> m_window;
+  uint64_t m_windowStart = 0;  // offset of the first child in window
+  std::string m_marker;        // marker of the page after the window
+  bool m_listed = false;       // all children are listed
+  uint64_t m_fetchCount = 0;
+
+  // offset of the first child of a page to the marker of the page
+  std::map<uint64_t, std::string> m_pageMarkers;
+
+  mutable std::mutex m_mutex;
+};
+
+}  // namespace Data
+}  // namespace QS
+
+#endif  // INCLUDE_DATA_DIRECTORYSTREAM_H_
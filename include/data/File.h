@@ -30,6 +30,7 @@
 #include <tuple>
 #include <utility>
 
+#include "base/CancellationToken.h"
 #include "data/Page.h"
 
 namespace QS {
@@ -48,7 +49,8 @@ class File {
         m_size(size),
         m_cacheSize(size),
         m_useDiskFile(false),
-        m_open(false) {}
+        m_open(false),
+        m_cancelToken(std::make_shared<QS::Threading::CancellationToken>()) {}
 
   File(File &&) = delete;
   File(const File &) = delete;
@@ -97,6 +99,16 @@ class File {
   // Return num of pages
   size_t GetNumPages() const;
 
+  // Return the cancellation token for speculative downloads of the file
+  //
+  // @param  : void
+  // @return : token
+  //
+  // The token will be cancelled when the file is closed or removed from
+  // cache, so the pending downloads should stop and not write cache any more.
+  std::shared_ptr<QS::Threading::CancellationToken> GetCancellationToken()
+      const;
+
  private:
   // Read from the cache (file pages)
   //
@@ -150,7 +162,11 @@ class File {
   void SetUseDiskFile(bool useDiskFile) { m_useDiskFile.store(useDiskFile); }
 
   // Set file open state
-  void SetOpen(bool open) { m_open.store(open); }
+  // Closing a file will cancel its speculative downloads.
+  void SetOpen(bool open);
+
+  // Cancel the speculative downloads, and renew the cancellation token.
+  void CancelDownloads();
 
   // Returns an iterator pointing to the first Page that is not ahead of offset.
   // If no such Page is found, a past-the-end iterator is returned.
@@ -201,6 +217,9 @@ class File {
   mutable std::recursive_mutex m_mutex;
   PageSet m_pages;              // a set of pages suppose to be successive
 
+  // token shared with the speculative downloads of the file
+  std::shared_ptr<QS::Threading::CancellationToken> m_cancelToken;
+
   friend class Cache;
   friend class FileTest;
 };
@@ -24,6 +24,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <array>
 #include <memory>
 #include <mutex>  // NOLINT
 #include <string>
@@ -36,7 +37,7 @@ class Entry;
 class FileMetaData;
 class FileMetaDataManager;
 
-enum class FileType {
+enum class FileType : uint8_t {
   File,
   Directory,
   SymLink,
@@ -53,6 +54,13 @@ std::string GetFileTypeName(FileType fileType);
 std::shared_ptr<QS::Data::FileMetaData> BuildDefaultDirectoryMeta(
     const std::string &dirPath, time_t mtime = 0);
 
+// Check access permission of a file
+//
+// @param  : file owner uid, file owner gid, file mode, uid, gid, access mode
+// @return : flag if access is allowed
+bool CheckFileAccess(uid_t fileUid, gid_t fileGid, mode_t fileMode, uid_t uid,
+                     gid_t gid, int amode);
+
 /**
  * Object file metadata
  */
@@ -86,10 +94,17 @@ class FileMetaData {
   const std::string &GetFilePath() const { return m_filePath; }
   time_t GetMTime() const { return m_mtime; }
   bool IsFileOpen() const { return m_fileOpen; }
+  const std::string &GetMimeType() const;
+  std::string GetETag() const;
 
  private:
   FileMetaData() = default;
 
+  void SetETag(const std::string &eTag);
+
+  // The members are ordered by size to avoid padding, as there could be
+  // millions of meta datas.
+
   // file full path name
   std::string m_filePath;  // For a directory, this will be ending with "/"
   uint64_t m_fileSize;
@@ -98,18 +113,24 @@ class FileMetaData {
   time_t m_mtime;  // time of last modification
   time_t m_ctime;  // time of last file status change
   time_t m_cachedTime;
+  dev_t m_dev = 0;  // device number (file system)
+  // mime types are interned, as there are only a few kinds of them
+  const std::string *m_mimeType = nullptr;
+  // etag which is not a md5 hex string, usually it's null
+  std::shared_ptr<const std::string> m_eTagString;
+  std::array<uint8_t, 16> m_eTagDigest;  // md5 digest of etag
   uid_t m_uid;        // user ID of owner
   gid_t m_gid;        // group ID of owner
   mode_t m_fileMode;  // file type & mode (permissions)
+  int m_numLink = 1;
   FileType m_fileType;
-  std::string m_mimeType;
-  std::string m_eTag;
+  bool m_hasETagDigest = false;
+  bool m_eTagQuoted = false;  // if etag digest is enclosed in double quotes
   bool m_encrypted = false;
-  dev_t m_dev = 0;  // device number (file system)
-  int m_numLink = 1;
   bool m_needUpload = false;
   bool m_fileOpen = false;
 
+  friend class DirectoryTree;  // for snapshot
   friend class Entry;
   friend class FileMetaDataManager;
 };
@@ -19,9 +19,9 @@
 
 #include <assert.h>
 
+#include <atomic>  // NOLINT
 #include <list>
 #include <memory>
-#include <mutex>  // NOLINT
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -29,24 +29,46 @@
 
 
 #include "base/HashUtils.h"
+#include "base/SharedMutex.h"
 #include "data/FileMetaData.h"
 
 namespace QS {
 
 namespace Data {
 
+class DirectoryTree;
 class Entry;
 class Node;
 
 using FileIdToMetaDataPair =
     std::pair<std::string, std::shared_ptr<FileMetaData>>;
-using MetaDataList = std::list<FileIdToMetaDataPair>;
+
+// The referenced bit is set by the lookups which only hold the shared lock,
+// instead of moving the meta data to the front of the list.
+struct MetaDataListItem : public FileIdToMetaDataPair {
+  MetaDataListItem(const std::string &fileId,
+                   std::shared_ptr<FileMetaData> &&fileMetaData)
+      : FileIdToMetaDataPair(fileId, std::move(fileMetaData)),
+        referenced(false) {}
+
+  mutable std::atomic<bool> referenced;
+};
+
+using MetaDataList = std::list<MetaDataListItem>;
 using MetaDataListIterator = MetaDataList::iterator;
 using MetaDataListConstIterator = MetaDataList::const_iterator;
 using FileIdToMetaDataListIteratorMap =
     std::unordered_map<std::string, MetaDataListIterator,
                        HashUtils::StringHash>;
 
+/**
+ * Manager of the file meta datas with a capacity.
+ *
+ * Lookups take the lock shared and only mark the meta data as referenced,
+ * the updates take it exclusively. When it is full, the meta data at back is
+ * discarded, unless it has been referenced since it was last checked, then it
+ * is moved to front with the bit cleared (CLOCK, an approximate LRU).
+ */
 class FileMetaDataManager {
  public:
   FileMetaDataManager(FileMetaDataManager &&) = delete;
@@ -109,8 +131,20 @@ class FileMetaDataManager {
   // Rename
   void Rename(const std::string &oldFilePath, const std::string &newFilePath);
 
+  // Rename file meta datas in bulk
+  //
+  // @param  : pairs of old file path and new file path
+  // @return : void
+  //
+  // This rekeys the meta datas of the descendants of a renamed dir within one
+  // lock. A meta data already keyed by a new path is replaced, as it is left
+  // by a node no longer in dir tree.
+  void Rename(
+      const std::vector<std::pair<std::string, std::string>> &renames);
+
  private:
   // internal use only
+  MetaDataListIterator GetNoLock(const std::string &filePath) const;
   MetaDataListIterator UnguardedMakeMetaDataMostRecentlyUsed(
       MetaDataListConstIterator pos);
   bool HasFreeSpaceNoLock(size_t needCount) const;
@@ -120,17 +154,19 @@ class FileMetaDataManager {
  private:
   explicit FileMetaDataManager(size_t maxCount = 0);
 
-  // Most recently used meta data is put at front,
-  // Least recently used meta data in put at back.
+  // Most recently added meta data is put at front,
+  // the one to be discarded first is put at back.
   MetaDataList m_metaDatas;
   FileIdToMetaDataListIteratorMap m_map;
   size_t m_maxCount;  // max count of meta datas
 
-  mutable std::recursive_mutex m_mutex;
+  mutable QS::Threading::SharedMutex m_mutex;
 
+  friend class QS::Data::DirectoryTree;  // for GrowChildren
   friend class QS::Data::Entry;
   friend class QS::Data::Node;
   friend class FileMetaDataManagerTest;
+  friend class DirectoryTreeTest;  // for benchmark
 };
 
 }  // namespace Data
@@ -0,0 +1,121 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+#ifndef INCLUDE_DATA_NEGATIVECACHE_H_
+#define INCLUDE_DATA_NEGATIVECACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>  // NOLINT
+#include <chrono>  // NOLINT
+#include <deque>
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "base/HashUtils.h"
+
+namespace QS {
+
+namespace Data {
+
+/**
+ * Cache of the paths known to be not existing in object storage.
+ *
+ * A path is added when object storage answers it does not exist, and stays
+ * for the ttl, so the repeated lookups of it cost no round trip. The local
+ * operations creating a path should invalidate it. When full, the oldest
+ * path is discarded first.
+ */
+class NegativeCache {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  NegativeCache(std::chrono::milliseconds ttl, size_t maxCount);
+
+  NegativeCache(NegativeCache &&) = delete;
+  NegativeCache(const NegativeCache &) = delete;
+  NegativeCache &operator=(NegativeCache &&) = delete;
+  NegativeCache &operator=(const NegativeCache &) = delete;
+  ~NegativeCache() = default;
+
+ public:
+  // Check if a path is known to be not existing
+  //
+  // @param  : path
+  // @return : bool
+  bool Has(const std::string &path);
+
+  // Add a path which is not existing
+  //
+  // @param  : path
+  // @return : void
+  void Add(const std::string &path);
+
+  // Invalidate a path
+  //
+  // @param  : path
+  // @return : void
+  //
+  // Both the file form and the dir form (ending with '/') of the path are
+  // invalidated.
+  void Invalidate(const std::string &path);
+
+  // Invalidate a directory and all paths under it
+  //
+  // @param  : dir path
+  // @return : void
+  void InvalidateDirectory(const std::string &dirPath);
+
+  // Remove all paths
+  void Clear();
+
+ public:
+  bool IsEnabled() const { return m_ttl.count() > 0 && m_maxCount > 0; }
+  size_t GetSize() const;
+  uint64_t GetHitCount() const { return m_hitCount.load(); }
+  uint64_t GetMissCount() const { return m_missCount.load(); }
+
+  std::string ToString() const;
+
+ private:
+  // Discard the expired paths, and the oldest ones until there is room for
+  // needCount paths
+  void PurgeNoLock(Clock::time_point now, size_t needCount);
+
+ private:
+  std::chrono::milliseconds m_ttl;
+  size_t m_maxCount;
+
+  // path to its expiry, and the paths in order of adding (with the expiry
+  // to tell the stale ones which are invalidated or added again)
+  std::unordered_map<std::string, Clock::time_point, HashUtils::StringHash>
+      m_expiries;
+  std::deque<std::pair<Clock::time_point, std::string>> m_queue;
+
+  std::atomic<uint64_t> m_hitCount;
+  std::atomic<uint64_t> m_missCount;
+
+  mutable std::mutex m_mutex;
+};
+
+}  // namespace Data
+}  // namespace QS
+
+
+#endif  // INCLUDE_DATA_NEGATIVECACHE_H_
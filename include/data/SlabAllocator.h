@@ -0,0 +1,144 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+#ifndef INCLUDE_DATA_SLABALLOCATOR_H_
+#define INCLUDE_DATA_SLABALLOCATOR_H_
+
+#include <stddef.h>
+
+#include <memory>
+#include <mutex>  // NOLINT
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace QS {
+
+namespace Data {
+
+/**
+ * Pool of fixed size blocks
+ *
+ * Blocks are carved from slabs of about 64KB, a freed block is put into
+ * the free list for reuse. The slabs are never released, so the pool is for
+ * objects with a large and stable population such as the directory tree
+ * nodes. There is one pool for each block size and alignment.
+ */
+template <size_t BlockSize, size_t Alignment>
+class SlabPool {
+ public:
+  SlabPool(SlabPool &&) = delete;
+  SlabPool(const SlabPool &) = delete;
+  SlabPool &operator=(SlabPool &&) = delete;
+  SlabPool &operator=(const SlabPool &) = delete;
+  ~SlabPool() = default;
+
+ public:
+  static SlabPool &Instance() {
+    // never destroyed, as blocks could be freed during exiting
+    static SlabPool *pool = new SlabPool;
+    return *pool;
+  }
+
+  void *Allocate() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_freeList == nullptr) {
+      AddSlab();
+    }
+    Block *block = m_freeList;
+    m_freeList = block->next;
+    return block;
+  }
+
+  void Deallocate(void *p) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Block *block = static_cast<Block *>(p);
+    block->next = m_freeList;
+    m_freeList = block;
+  }
+
+ private:
+  SlabPool() = default;
+
+  union Block {
+    Block *next;
+    typename std::aligned_storage<BlockSize, Alignment>::type storage;
+  };
+
+  static const size_t kBlocksPerSlab =
+      sizeof(Block) < 65536 ? 65536 / sizeof(Block) : 1;
+
+  void AddSlab() {
+    std::unique_ptr<Block[]> slab(new Block[kBlocksPerSlab]);
+    for (size_t i = 0; i < kBlocksPerSlab; ++i) {
+      slab[i].next = m_freeList;
+      m_freeList = &slab[i];
+    }
+    m_slabs.push_back(std::move(slab));
+  }
+
+  std::mutex m_mutex;
+  Block *m_freeList = nullptr;
+  std::vector<std::unique_ptr<Block[]>> m_slabs;
+};
+
+/**
+ * Allocator of single objects from the slab pool
+ *
+ * Use it with std::allocate_shared, so the object and its control block are
+ * put in one block without the malloc overhead.
+ */
+template <typename T>
+class SlabAllocator {
+ public:
+  using value_type = T;
+
+  SlabAllocator() = default;
+  template <typename U>
+  SlabAllocator(const SlabAllocator<U> &) {}  // NOLINT
+
+  T *allocate(size_t n) {
+    if (n != 1) {
+      return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+    return static_cast<T *>(
+        SlabPool<sizeof(T), alignof(T)>::Instance().Allocate());
+  }
+
+  void deallocate(T *p, size_t n) {
+    if (n != 1) {
+      ::operator delete(p);
+      return;
+    }
+    SlabPool<sizeof(T), alignof(T)>::Instance().Deallocate(p);
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const SlabAllocator<T> &, const SlabAllocator<U> &) {
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const SlabAllocator<T> &, const SlabAllocator<U> &) {
+  return false;
+}
+
+}  // namespace Data
+}  // namespace QS
+
+
+#endif  // INCLUDE_DATA_SLABALLOCATOR_H_
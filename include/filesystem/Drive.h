@@ -23,19 +23,26 @@
 #include <atomic>  // NOLINT
 #include <memory>
 #include <string>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "base/HashUtils.h"
 #include "data/Cache.h"
 #include "data/Directory.h"
+#include "data/DirectoryStream.h"
+#include "data/NegativeCache.h"
 
 
 namespace QS {
 
 namespace Client {
+class BucketCrawler;
 class Client;
+class DeleteBatcher;
 class QSClient;
 class QSTransferManager;
 class TransferHandle;
@@ -74,6 +81,9 @@ class Drive {
   const std::unique_ptr<QS::Data::DirectoryTree> &GetDirectoryTree() const {
     return m_directoryTree;
   }
+  const std::unique_ptr<QS::Data::NegativeCache> &GetNegativeCache() const {
+    return m_negativeCache;
+  }
 
  public:
   // Connect to object storage
@@ -88,6 +98,18 @@ class Drive {
   // Return the drive root node.
   std::shared_ptr<QS::Data::Node> GetRoot();
 
+  // Start crawling the whole bucket in background to warm up the dir tree
+  //
+  // @param  : void
+  // @return : void
+  //
+  // The dirs are listed in parallel by the count of listings specified by
+  // option warmup, it does nothing if the option is 0. The crawl stops when
+  // the stat entries reach the max count, and it is cancelled at clean up.
+  // Notes: call it after fuse_main, as the crawling thread will exit when
+  // the process goes into the background.
+  void StartWarmUp();
+
   // Get the node
   //
   // @param  : file path, flag update if is dir, flag update dir async
@@ -100,7 +122,10 @@ class Drive {
   // directory will be add to the tree.
   //
   // Notes: GetNode will connect to object storage to retrive the object and
-  // update the local dir tree
+  // update the local dir tree. A path not in local dir tree, which object
+  // storage answered not existing within the negative ttl, or which is not
+  // in the complete listing of its dir done within the negative ttl, is not
+  // retrived again.
   std::pair<std::weak_ptr<QS::Data::Node>, bool> GetNode(
       const std::string &path, bool updateIfDirectory = false,
       bool updateDirAsync = false);
@@ -112,6 +137,40 @@ class Drive {
   // GetNodeSimple just find the node in local dir tree
   std::weak_ptr<QS::Data::Node> GetNodeSimple(const std::string &path);
 
+  // Get the file, or the dir if no such file, from local dir tree
+  //
+  // @param  : path
+  // @return : node
+  //
+  // This resolves both "path" and "path/" by a single lookup, see
+  // DirectoryTree::FindFileOrDirectory.
+  std::weak_ptr<QS::Data::Node> GetFileOrDirectorySimple(
+      const std::string &path);
+
+  // Resolve the path of the file, or the dir if no such file
+  //
+  // @param  : path
+  // @return : "path" or "path/", or empty if neither is existing
+  //
+  // The path is resolved in local dir tree at first, and then in object
+  // storage by a single request, see Client::StatFileOrDirectory, which
+  // grows the dir tree with the found one. Object storage is not asked again
+  // within the negative ttl once it answers neither is existing.
+  std::string ResolveFileOrDirectory(const std::string &path);
+
+  // Open a stream of the children of a directory
+  //
+  // @param  : dir path
+  // @return : stream, or null if the dir should be read from local dir tree
+  //
+  // A dir listed completely before the stat expires is read from local dir
+  // tree. Otherwise its children are listed page by page while they are
+  // read. The listed children are added to the dir tree until the count of
+  // them exceeds the max stat count, beyond that only the window of the
+  // stream is kept in memory.
+  std::unique_ptr<QS::Data::DirectoryStream> OpenDirectoryStream(
+      const std::string &dirPath);
+
   //
   //
   // Following APIs handle request from fuse, they
@@ -147,10 +206,19 @@ class Drive {
 
   // Remove a file or an empty directory
   //
-  // @param  : file path
+  // @param  : file path, flag asynchornizely
   // @return : void
+  //
+  // The asynchronous removals are collected and deleted in batches, the
+  // file is removed from dir tree and cache at once and looked up as absent.
   void RemoveFile(const std::string &filePath, bool async = false);
 
+  // Wait for the pending asynchronous removals to finish
+  //
+  // @param  : void
+  // @return : void
+  void FlushRemovals();
+
   // Create a hard link to a file
   //
   // @param  : file path to link to, hard link path
@@ -180,6 +248,17 @@ class Drive {
   // @return : void
   void OpenFile(const std::string &filePath, bool async = false);
 
+  // Release a file
+  //
+  // @param  : file path
+  // @return : void
+  //
+  // The file could be opened more than once, only the last release means no
+  // more reads will happen, which cancels the speculative downloads of the
+  // file. The data not downloaded yet will be loaded again by the following
+  // reading if any.
+  void ReleaseFile(const std::string &filePath);
+
   // Read data from a file
   //
   // @param  : file path to read data from, offset, size, buf, flag doCheck
@@ -260,6 +339,9 @@ class Drive {
                                  const QS::Data::ContentRangeDeque &ranges,
                                  time_t mtime, bool async = false);
 
+  // Wait for the removal of the path if it is pending
+  void WaitForRemoval(const std::string &path);
+
  private:
   std::shared_ptr<QS::Client::Client> &GetClient() { return m_client; }
   std::unique_ptr<QS::Client::TransferManager> &GetTransferManager() {
@@ -280,12 +362,69 @@ class Drive {
   void CleanUp();
   Drive();
 
+  // Refresh the node by getting its meta data from object storage
+  //
+  // @param  : path, modified since, modified(output)
+  // @return : void
+  //
+  // The node is removed if it is not existing any more.
+  void RefreshNode(const std::string &path, time_t modifiedSince,
+                   bool *modified);
+
+  // Refresh the node in background, if it is not being refreshed already.
+  // The refreshes are bounded by the client background pool size.
+  void RefreshNodeAsync(const std::string &path, time_t modifiedSince);
+
+  // List a dir for the warm-up crawl
+  //
+  // @param  : dir path, sub dir paths(output)
+  // @return : false if fail to list the dir
+  //
+  // The children are grown into dir tree page by page.
+  bool WarmUpDirectory(const std::string &dirPath,
+                       std::vector<std::string> *subDirPaths);
+
+  // Return if the file is still opened by any file descriptor
+  bool IsFileOpen(const std::string &filePath);
+
+  // Save the snapshot of dir tree to the snapshot file if it is specified
+  void SaveSnapshot();
+
+  // Save the snapshot in background, if it is not saved within the interval
+  void SaveSnapshotPeriodically();
+
+  // Check if a path not in dir tree is told not existing by the complete
+  // listing of its dir, which is done within the negative ttl
+  bool IsAbsentInListing(const std::string &path);
+
+  // Forget the lookups telling a path not existing
+  //
+  // @param  : path, flag to forget the ones of the paths under a dir
+  // @return : void
+  void InvalidateNegativeLookups(const std::string &path,
+                                 bool recursive = false);
+
   mutable std::atomic<bool> m_mountable;
   mutable std::atomic<bool> m_cleanup;  // denote if drive get cleaned up
+  std::atomic<uint64_t> m_listingHitCount;  // lookups answered by listings
+  std::atomic<uint64_t> m_staleHitCount;  // lookups using stale stat
+  std::atomic<uint64_t> m_staleRefreshCount;  // refreshes of stale stat
+  std::atomic<time_t> m_snapshotTime;  // time of the last snapshot
   std::shared_ptr<QS::Client::Client> m_client;
   std::unique_ptr<QS::Client::TransferManager> m_transferManager;
   std::unique_ptr<QS::Data::Cache> m_cache;
   std::unique_ptr<QS::Data::DirectoryTree> m_directoryTree;
+  std::unique_ptr<QS::Data::NegativeCache> m_negativeCache;
+  std::unique_ptr<QS::Client::DeleteBatcher> m_deleteBatcher;
+  std::unique_ptr<QS::Client::BucketCrawler> m_crawler;  // for warm-up
+  std::thread m_warmUpThread;
+  // paths of the nodes being refreshed in background
+  std::unordered_set<std::string, HashUtils::StringHash> m_refreshingPaths;
+  std::mutex m_refreshMutex;
+  std::mutex m_snapshotMutex;  // serialize the savings of snapshot
+  // open counts of the files, for the ones opened more than once
+  std::unordered_map<std::string, int, HashUtils::StringHash> m_openCounts;
+  std::mutex m_openCountsMutex;
   std::unordered_map<std::string, std::shared_ptr<QS::Client::TransferHandle>,
                      HashUtils::StringHash>
       m_unfinishedMultipartUploadHandles;
@@ -0,0 +1,88 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#include "base/RoundRobinScheduler.h"
+
+#include <assert.h>
+
+#include <string>
+#include <utility>
+
+namespace QS {
+
+namespace Threading {
+
+using std::lock_guard;
+using std::mutex;
+using std::string;
+
+RoundRobinScheduler::RoundRobinScheduler(ThreadPool *executor)
+    : m_executor(executor), m_queuedTaskCount(0) {
+  assert(m_executor != nullptr);
+}
+
+void RoundRobinScheduler::Submit(const string &key, Task &&task) {
+  {
+    lock_guard<mutex> lock(m_mutex);
+    auto &queue = m_queues[key];
+    if (queue.empty()) {
+      m_ring.push_back(key);
+    }
+    queue.push_back(std::move(task));
+    ++m_queuedTaskCount;
+  }
+  // One runner per task, so every queued task will be run by some runner
+  m_executor->SubmitToThread([this] { RunNext(); });
+}
+
+size_t RoundRobinScheduler::GetQueuedTaskCount() const {
+  lock_guard<mutex> lock(m_mutex);
+  return m_queuedTaskCount;
+}
+
+size_t RoundRobinScheduler::GetQueuedKeyCount() const {
+  lock_guard<mutex> lock(m_mutex);
+  return m_ring.size();
+}
+
+void RoundRobinScheduler::RunNext() {
+  Task task;
+  {
+    lock_guard<mutex> lock(m_mutex);
+    if (m_ring.empty()) {
+      return;
+    }
+    string key = std::move(m_ring.front());
+    m_ring.pop_front();
+    auto it = m_queues.find(key);
+    assert(it != m_queues.end() && !it->second.empty());
+    task = std::move(it->second.front());
+    it->second.pop_front();
+    --m_queuedTaskCount;
+    if (it->second.empty()) {
+      m_queues.erase(it);
+    } else {
+      m_ring.push_back(std::move(key));
+    }
+  }
+  if (task) {
+    task();
+  }
+}
+
+}  // namespace Threading
+}  // namespace QS
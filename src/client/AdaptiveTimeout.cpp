@@ -0,0 +1,152 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#include "client/AdaptiveTimeout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>  // NOLINT
+#include <string>
+
+#include "data/Size.h"
+
+namespace QS {
+
+namespace Client {
+
+using std::lock_guard;
+using std::mutex;
+using std::string;
+using std::to_string;
+
+namespace {
+
+// Samples needed before the estimate takes effect
+const unsigned kMinSampleCount = 5;
+// Gains of EWMA of the time and its deviation, as the ones of TCP RTO
+const double kEstimateGain = 0.125;
+const double kDeviationGain = 0.25;
+// Timeout is the estimated time multiplied by
+// (kMarginBase + kDeviationFactor * deviation)
+const double kMarginBase = 2;
+const double kDeviationFactor = 4;
+
+// Return the units charged for the latency of a request
+uint64_t GetLatencyUnits(TimedOperation op) {
+  switch (op) {
+    case TimedOperation::Download:
+    case TimedOperation::Upload:
+      return 256 * QS::Data::Size::KB1;
+    case TimedOperation::ListObjects:
+      return 100;
+    default:
+      return 1;
+  }
+}
+
+const char *GetOperationName(TimedOperation op) {
+  switch (op) {
+    case TimedOperation::Download:
+      return "download";
+    case TimedOperation::Upload:
+      return "upload";
+    case TimedOperation::ListObjects:
+      return "list";
+    default:
+      return "unknown";
+  }
+}
+
+}  // namespace
+
+// --------------------------------------------------------------------------
+AdaptiveTimeout::AdaptiveTimeout(uint32_t floorInMs, uint32_t ceilingInMs)
+    : m_floorInMs(std::max(floorInMs, 1u)), m_ceilingInMs(ceilingInMs) {
+  if (m_ceilingInMs > 0 && m_ceilingInMs < m_floorInMs) {
+    m_ceilingInMs = m_floorInMs;
+  }
+  for (auto &count : m_timeoutCounts) {
+    count.store(0);
+  }
+}
+
+// --------------------------------------------------------------------------
+uint32_t AdaptiveTimeout::GetTimeoutInMs(TimedOperation op, uint64_t units,
+                                         uint32_t defaultInMs) const {
+  double timeout = 0;
+  {
+    lock_guard<mutex> lock(m_mutex);
+    const auto &estimate = m_estimates[static_cast<int>(op)];
+    if (estimate.sampleCount < kMinSampleCount) {
+      return defaultInMs;
+    }
+    timeout = estimate.msPerUnit * (units + GetLatencyUnits(op)) *
+              (kMarginBase + kDeviationFactor * estimate.deviation);
+  }
+  timeout = std::max(timeout, static_cast<double>(m_floorInMs));
+  if (m_ceilingInMs > 0) {
+    timeout = std::min(timeout, static_cast<double>(m_ceilingInMs));
+  }
+  return static_cast<uint32_t>(std::ceil(timeout));
+}
+
+// --------------------------------------------------------------------------
+void AdaptiveTimeout::OnComplete(TimedOperation op, uint64_t units,
+                                 uint32_t elapsedInMs) {
+  double sample =
+      static_cast<double>(elapsedInMs) / (units + GetLatencyUnits(op));
+  lock_guard<mutex> lock(m_mutex);
+  auto &estimate = m_estimates[static_cast<int>(op)];
+  if (estimate.sampleCount == 0 || estimate.msPerUnit <= 0) {
+    estimate.msPerUnit = sample;
+    estimate.deviation = 0.5;
+  } else {
+    double error = std::fabs(sample - estimate.msPerUnit) / estimate.msPerUnit;
+    estimate.deviation += kDeviationGain * (error - estimate.deviation);
+    estimate.msPerUnit += kEstimateGain * (sample - estimate.msPerUnit);
+  }
+  ++estimate.sampleCount;
+}
+
+// --------------------------------------------------------------------------
+void AdaptiveTimeout::OnTimeout(TimedOperation op) {
+  ++m_timeoutCounts[static_cast<int>(op)];
+  lock_guard<mutex> lock(m_mutex);
+  auto &estimate = m_estimates[static_cast<int>(op)];
+  if (estimate.msPerUnit > 0) {
+    estimate.msPerUnit *= 2;
+  } else {
+    // measured as no time, use the default until measured again
+    estimate = Estimate();
+  }
+}
+
+// --------------------------------------------------------------------------
+string AdaptiveTimeout::ToString() const {
+  string str = "[floor:ceiling(ms)=" + to_string(m_floorInMs) + ":" +
+               to_string(m_ceilingInMs) + ", timeouts=";
+  for (int i = 0; i < kOperationCount; ++i) {
+    auto op = static_cast<TimedOperation>(i);
+    str += (i == 0 ? "" : ",") + string(GetOperationName(op)) + ":" +
+           to_string(GetTimeoutCount(op));
+  }
+  str += "]";
+  return str;
+}
+
+}  // namespace Client
+}  // namespace QS
@@ -0,0 +1,114 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+#include "client/BucketCrawler.h"
+
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+namespace QS {
+
+namespace Client {
+
+using std::lock_guard;
+using std::mutex;
+using std::string;
+using std::thread;
+using std::to_string;
+using std::unique_lock;
+using std::vector;
+
+// --------------------------------------------------------------------------
+BucketCrawler::BucketCrawler(DirectoryLister lister, unsigned concurrency)
+    : m_lister(std::move(lister)),
+      m_concurrency(concurrency > 0 ? concurrency : 1),
+      m_busyWorkers(0),
+      m_listedCount(0),
+      m_failedCount(0) {}
+
+// --------------------------------------------------------------------------
+uint64_t BucketCrawler::Crawl(const string &dirPath) {
+  auto listedCount = GetListedCount();
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_pendingDirs.push_back(dirPath);
+  }
+
+  vector<thread> workers;
+  for (unsigned i = 0; i < m_concurrency; ++i) {
+    workers.emplace_back([this] { Work(); });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  return GetListedCount() - listedCount;
+}
+
+// --------------------------------------------------------------------------
+void BucketCrawler::Cancel() {
+  m_cancellation.Cancel();
+  lock_guard<mutex> lock(m_mutex);
+  m_pendingDirs.clear();
+  m_cond.notify_all();
+}
+
+// --------------------------------------------------------------------------
+void BucketCrawler::Work() {
+  unique_lock<mutex> lock(m_mutex);
+  while (true) {
+    // wait for the dirs found by the busy workers
+    m_cond.wait(lock, [this] {
+      return !m_pendingDirs.empty() || m_busyWorkers == 0 || IsCancelled();
+    });
+    if (m_pendingDirs.empty() || IsCancelled()) {
+      break;
+    }
+    auto dirPath = std::move(m_pendingDirs.front());
+    m_pendingDirs.pop_front();
+    ++m_busyWorkers;
+    lock.unlock();
+
+    vector<string> subDirPaths;
+    bool success = m_lister(dirPath, &subDirPaths);
+    if (success) {
+      ++m_listedCount;
+    } else {
+      ++m_failedCount;
+    }
+
+    lock.lock();
+    --m_busyWorkers;
+    if (!IsCancelled()) {
+      for (auto &subDirPath : subDirPaths) {
+        m_pendingDirs.push_back(std::move(subDirPath));
+      }
+    }
+    m_cond.notify_all();
+  }
+}
+
+// --------------------------------------------------------------------------
+string BucketCrawler::ToString() const {
+  return "[concurrency=" + to_string(m_concurrency) +
+         ", listed:failed=" + to_string(GetListedCount()) + ":" +
+         to_string(GetFailedCount()) + "]";
+}
+
+}  // namespace Client
+}  // namespace QS
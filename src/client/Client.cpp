@@ -16,6 +16,7 @@
 
 #include "client/Client.h"
 
+#include <algorithm>
 #include <memory>
 #include <mutex>  // NOLINT
 #include <utility>
@@ -39,8 +40,14 @@ Client::Client(std::shared_ptr<ClientImpl> impl,
                RetryStrategy retryStratety)
     : m_impl(std::move(impl)),
       m_executor(std::move(executor)),
-      m_retryStrategy(std::move(retryStratety)) {
+      m_backgroundPoolSize(static_cast<size_t>(
+          std::max(1, ClientConfiguration::Instance().GetPoolSize() / 2))),
+      m_retryStrategy(std::move(retryStratety)),
+      m_writeGeneration(0),
+      m_backgroundExecutor(new ThreadPool(m_backgroundPoolSize)) {
   QS::Threading::ThreadPoolInitializer::Instance().Register(m_executor.get());
+  QS::Threading::ThreadPoolInitializer::Instance().Register(
+      m_backgroundExecutor.get());
 }
 
 // --------------------------------------------------------------------------
@@ -45,6 +45,13 @@ using QS::Exception::QSException;
 using QS::Configure::Default::GetClientDefaultPoolSize;
 using QS::Configure::Default::GetDefaultLogDirectory;
 using QS::Configure::Default::GetDefaultMaxRetries;
+using QS::Configure::Default::GetDefaultMaxDownloadInFlightSize;
+using QS::Configure::Default::GetDefaultDownloadRateLimitInKB;
+using QS::Configure::Default::GetDefaultUploadRateLimitInKB;
+using QS::Configure::Default::GetDefaultRequestRateLimit;
+using QS::Configure::Default::GetDefaultHedgePercent;
+using QS::Configure::Default::GetDefaultTimeoutFloorInMs;
+using QS::Configure::Default::GetDefaultTimeoutCeilingInMs;
 using QS::Configure::Default::GetDefaultParallelTransfers;
 using QS::Configure::Default::GetDefaultTransferBufSize;
 using QS::Configure::Default::GetDefaultHostName;
@@ -140,7 +147,15 @@ ClientConfiguration::ClientConfiguration(const Credentials &credentials)
       m_clientPoolSize(GetClientDefaultPoolSize()),
       m_parallelTransfers(GetDefaultParallelTransfers()),
       m_transferBufferSizeInMB(GetDefaultTransferBufSize() /
-                                QS::Data::Size::MB1) {}
+                                QS::Data::Size::MB1),
+      m_maxDownloadInFlightSizeInMB(GetDefaultMaxDownloadInFlightSize() /
+                                    QS::Data::Size::MB1),
+      m_downloadRateLimitInKB(GetDefaultDownloadRateLimitInKB()),
+      m_uploadRateLimitInKB(GetDefaultUploadRateLimitInKB()),
+      m_requestRateLimit(GetDefaultRequestRateLimit()),
+      m_hedgePercent(GetDefaultHedgePercent()),
+      m_timeoutFloorInMs(GetDefaultTimeoutFloorInMs()),
+      m_timeoutCeilingInMs(GetDefaultTimeoutCeilingInMs()) {}
 
 ClientConfiguration::ClientConfiguration(const CredentialsProvider &provider)
     : ClientConfiguration(provider.GetCredentials()) {}
@@ -188,6 +203,13 @@ void ClientConfiguration::InitializeByOptions() {
   m_clientPoolSize = options.GetClientPoolSize();
   m_parallelTransfers = options.GetParallelTransfers();
   m_transferBufferSizeInMB = options.GetTransferBufferSizeInMB();
+  m_maxDownloadInFlightSizeInMB = options.GetMaxDownloadInFlightSizeInMB();
+  m_downloadRateLimitInKB = options.GetDownloadRateLimitInKB();
+  m_uploadRateLimitInKB = options.GetUploadRateLimitInKB();
+  m_requestRateLimit = options.GetRequestRateLimit();
+  m_hedgePercent = options.GetHedgePercent();
+  m_timeoutFloorInMs = options.GetTimeoutFloorInMs();
+  m_timeoutCeilingInMs = options.GetTimeoutCeilingInMs();
 }
 
 }  // namespace Client
@@ -20,6 +20,11 @@
 #include <utility>
 
 #include "base/ThreadPoolInitializer.h"
+#include "client/AdaptiveTimeout.h"
+#include "client/ClientConfiguration.h"
+#include "client/HedgePolicy.h"
+#include "client/RateLimiter.h"
+#include "data/Size.h"
 
 namespace QS {
 
@@ -28,6 +33,14 @@ namespace Client {
 // --------------------------------------------------------------------------
 ClientImpl::ClientImpl(std::unique_ptr<QS::Threading::ThreadPool> executor)
     : m_executor(std::move(executor)) {
+  const auto &config = ClientConfiguration::Instance();
+  m_rateLimiter = std::unique_ptr<RateLimiter>(new RateLimiter(
+      config.GetDownloadRateLimitInKB() * QS::Data::Size::KB1,
+      config.GetUploadRateLimitInKB() * QS::Data::Size::KB1,
+      config.GetRequestRateLimit()));
+  m_hedgePolicy = std::make_shared<HedgePolicy>(config.GetHedgePercent());
+  m_adaptiveTimeout = std::unique_ptr<AdaptiveTimeout>(new AdaptiveTimeout(
+      config.GetTimeoutFloorInMs(), config.GetTimeoutCeilingInMs()));
   QS::Threading::ThreadPoolInitializer::Instance().Register(m_executor.get());
 }
 
@@ -0,0 +1,171 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#include "client/ConcurrencyController.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <mutex>  // NOLINT
+#include <string>
+#include <utility>
+
+namespace QS {
+
+namespace Client {
+
+using std::chrono::duration;
+using std::chrono::steady_clock;
+using std::lock_guard;
+using std::mutex;
+using std::string;
+using std::to_string;
+using std::unique_lock;
+
+namespace {
+
+// Throughput should improve by this ratio at least to increase the limit,
+// so noise will not drive the limit up.
+const double kImprovementRatio = 1.05;
+
+}  // namespace
+
+// --------------------------------------------------------------------------
+ConcurrencyController::ConcurrencyController(size_t minLimit, size_t maxLimit,
+                                             size_t initialLimit)
+    : m_minLimit(std::max<size_t>(minLimit, 1)),
+      m_maxLimit(std::max(maxLimit, m_minLimit)),
+      m_limit(std::min(std::max(initialLimit, m_minLimit), m_maxLimit)),
+      m_inFlight(0),
+      m_windowStart(steady_clock::now()),
+      m_windowBytes(0),
+      m_windowCompletions(0),
+      m_windowSaturated(false),
+      m_lastThroughput(0),
+      m_lastDecrease(steady_clock::now()),
+      m_increaseCount(0),
+      m_decreaseCount(0) {}
+
+// --------------------------------------------------------------------------
+ConcurrencyController::TimePoint ConcurrencyController::Acquire() {
+  unique_lock<mutex> lock(m_mutex);
+  if (m_inFlight >= m_limit) {
+    m_windowSaturated = true;
+    m_released.wait(lock, [this] { return m_inFlight < m_limit; });
+  }
+  ++m_inFlight;
+  if (m_inFlight >= m_limit) {
+    m_windowSaturated = true;
+  }
+  return steady_clock::now();
+}
+
+// --------------------------------------------------------------------------
+void ConcurrencyController::Release(TimePoint start, uint64_t bytes,
+                                    bool congested) {
+  size_t increasedLimit = 0;
+  LimitIncreasedHandler handler;
+  {
+    lock_guard<mutex> lock(m_mutex);
+    if (m_inFlight > 0) {
+      --m_inFlight;
+    }
+    auto now = steady_clock::now();
+    if (congested) {
+      // the transfers started before last decrease have been counted in it
+      if (start >= m_lastDecrease) {
+        if (m_limit > m_minLimit) {
+          m_limit = std::max(m_limit / 2, m_minLimit);
+          ++m_decreaseCount;
+        }
+        m_lastDecrease = now;
+        // start over the measure, so the limit is able to grow again
+        m_windowStart = now;
+        m_windowBytes = 0;
+        m_windowCompletions = 0;
+        m_windowSaturated = false;
+        m_lastThroughput = 0;
+      }
+    } else {
+      m_windowBytes += bytes;
+      ++m_windowCompletions;
+      if (m_windowCompletions >= m_limit) {
+        double elapsed = duration<double>(now - m_windowStart).count();
+        double throughput = elapsed > 0 ? m_windowBytes / elapsed : 0;
+        if (m_windowSaturated && m_limit < m_maxLimit &&
+            throughput > m_lastThroughput * kImprovementRatio) {
+          ++m_limit;
+          ++m_increaseCount;
+          increasedLimit = m_limit;
+          handler = m_limitIncreasedHandler;
+        }
+        m_lastThroughput = throughput;
+        m_windowStart = now;
+        m_windowBytes = 0;
+        m_windowCompletions = 0;
+        m_windowSaturated = m_inFlight >= m_limit;
+      }
+    }
+  }
+  if (increasedLimit > 0 && handler) {
+    handler(increasedLimit);
+  }
+  m_released.notify_all();
+}
+
+// --------------------------------------------------------------------------
+void ConcurrencyController::SetLimitIncreasedHandler(
+    LimitIncreasedHandler handler) {
+  lock_guard<mutex> lock(m_mutex);
+  m_limitIncreasedHandler = std::move(handler);
+}
+
+// --------------------------------------------------------------------------
+size_t ConcurrencyController::GetLimit() const {
+  lock_guard<mutex> lock(m_mutex);
+  return m_limit;
+}
+
+// --------------------------------------------------------------------------
+size_t ConcurrencyController::GetInFlight() const {
+  lock_guard<mutex> lock(m_mutex);
+  return m_inFlight;
+}
+
+// --------------------------------------------------------------------------
+uint64_t ConcurrencyController::GetIncreaseCount() const {
+  lock_guard<mutex> lock(m_mutex);
+  return m_increaseCount;
+}
+
+// --------------------------------------------------------------------------
+uint64_t ConcurrencyController::GetDecreaseCount() const {
+  lock_guard<mutex> lock(m_mutex);
+  return m_decreaseCount;
+}
+
+// --------------------------------------------------------------------------
+string ConcurrencyController::ToString() const {
+  lock_guard<mutex> lock(m_mutex);
+  return "[min:max:limit=" + to_string(m_minLimit) + ":" +
+         to_string(m_maxLimit) + ":" + to_string(m_limit) +
+         ", inflight=" + to_string(m_inFlight) +
+         ", increases:decreases=" + to_string(m_increaseCount) + ":" +
+         to_string(m_decreaseCount) + "]";
+}
+
+}  // namespace Client
+}  // namespace QS
@@ -0,0 +1,160 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#include "client/DeleteBatcher.h"
+
+#include <chrono>  // NOLINT
+#include <deque>
+#include <limits>
+#include <mutex>  // NOLINT
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace QS {
+
+namespace Client {
+
+using std::chrono::milliseconds;
+using std::lock_guard;
+using std::mutex;
+using std::string;
+using std::to_string;
+using std::unique_lock;
+using std::vector;
+
+// --------------------------------------------------------------------------
+DeleteBatcher::DeleteBatcher(TaskSubmitter submitter, BatchHandler handler,
+                             size_t batchSize, milliseconds linger,
+                             size_t maxBatches)
+    : m_submitter(std::move(submitter)),
+      m_handler(std::move(handler)),
+      m_batchSize(batchSize > 0 ? batchSize : 1),
+      m_linger(linger),
+      m_maxBatches(maxBatches > 0 ? maxBatches
+                                  : std::numeric_limits<size_t>::max()),
+      m_batchScheduled(false),
+      m_workers(0),
+      m_flushWaiters(0),
+      m_batchCount(0),
+      m_pathCount(0) {}
+
+// --------------------------------------------------------------------------
+DeleteBatcher::~DeleteBatcher() { Flush(); }
+
+// --------------------------------------------------------------------------
+void DeleteBatcher::Add(const string &path) {
+  bool schedule = false;
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_batch.push_back(path);
+    ++m_pendingPaths[path];
+    bool sealed = false;
+    if (m_batch.size() >= m_batchSize) {
+      // seal the full batch, wake up the lingering worker to take it
+      m_fullBatches.push_back(std::move(m_batch));
+      m_batch.clear();
+      m_batchCond.notify_all();
+      sealed = true;
+    }
+    // the busy workers take the rest once they are done, so a new worker is
+    // only needed for a sealed batch or a batch nobody lingers for
+    if ((sealed || !m_batchScheduled) && m_workers < m_maxBatches) {
+      ++m_workers;
+      schedule = true;
+    }
+  }
+  if (schedule) {
+    m_submitter([this] { ProcessBatches(); });
+  }
+}
+
+// --------------------------------------------------------------------------
+bool DeleteBatcher::IsPending(const string &path) const {
+  lock_guard<mutex> lock(m_mutex);
+  return m_pendingPaths.find(path) != m_pendingPaths.end();
+}
+
+// --------------------------------------------------------------------------
+bool DeleteBatcher::HasPending() const {
+  lock_guard<mutex> lock(m_mutex);
+  return !m_pendingPaths.empty();
+}
+
+// --------------------------------------------------------------------------
+void DeleteBatcher::Flush() {
+  unique_lock<mutex> lock(m_mutex);
+  ++m_flushWaiters;
+  m_batchCond.notify_all();
+  m_doneCond.wait(lock, [this] { return m_workers == 0; });
+  --m_flushWaiters;
+}
+
+// --------------------------------------------------------------------------
+void DeleteBatcher::ProcessBatches() {
+  unique_lock<mutex> lock(m_mutex);
+  while (true) {
+    vector<string> batch;
+    if (!m_fullBatches.empty()) {
+      batch.swap(m_fullBatches.front());
+      m_fullBatches.pop_front();
+    } else if (!m_batch.empty() && !m_batchScheduled) {
+      m_batchScheduled = true;
+      m_batchCond.wait_for(lock, m_linger, [this] {
+        return m_flushWaiters > 0 || !m_fullBatches.empty();
+      });
+      m_batchScheduled = false;
+      if (!m_fullBatches.empty()) {
+        continue;  // the full batch goes first, then linger again
+      }
+      batch.swap(m_batch);
+    } else {
+      // exit within the same critical section which sees no work left, so a
+      // path added afterwards always schedules a new worker
+      --m_workers;
+      m_doneCond.notify_all();
+      return;
+    }
+
+    if (batch.empty()) {
+      continue;
+    }
+    lock.unlock();
+    m_handler(batch);
+    ++m_batchCount;
+    m_pathCount += batch.size();
+    lock.lock();
+
+    for (auto &path : batch) {
+      auto it = m_pendingPaths.find(path);
+      if (it != m_pendingPaths.end() && --it->second == 0) {
+        m_pendingPaths.erase(it);
+      }
+    }
+  }
+}
+
+// --------------------------------------------------------------------------
+string DeleteBatcher::ToString() const {
+  return "[batch size=" + to_string(m_batchSize) +
+         ", linger(ms)=" + to_string(m_linger.count()) +
+         ", batches:paths=" + to_string(GetBatchCount()) + ":" +
+         to_string(GetPathCount()) + "]";
+}
+
+}  // namespace Client
+}  // namespace QS
@@ -0,0 +1,161 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#include "client/HedgePolicy.h"
+
+#include <algorithm>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+namespace QS {
+
+namespace Client {
+
+using std::lock_guard;
+using std::mutex;
+using std::string;
+using std::to_string;
+using std::vector;
+
+namespace {
+
+// Latencies needed before issuing any hedge
+const size_t kMinSampleCount = 20;
+// Hedge delay is updated every so many latencies
+const size_t kDelayUpdateInterval = 16;
+// Max hedges could be accumulated in budget
+const unsigned kMaxBudget = 10 * 100;
+// Size classes of requests: up to 256K, 1M, 4M, 16M and beyond
+const uint64_t kMinSizeClassBytes = 256 * 1024;
+const size_t kSizeClassCount = 5;
+
+// --------------------------------------------------------------------------
+size_t GetSizeClass(uint64_t bytes) {
+  size_t sizeClass = 0;
+  uint64_t limit = kMinSizeClassBytes;
+  while (bytes > limit && sizeClass + 1 < kSizeClassCount) {
+    limit *= 4;
+    ++sizeClass;
+  }
+  return sizeClass;
+}
+
+}  // namespace
+
+// --------------------------------------------------------------------------
+HedgePolicy::HedgePolicy(unsigned maxHedgePercent, uint32_t minDelayInMs,
+                         size_t sampleWindowSize, unsigned percentile)
+    : m_maxHedgePercent(std::min(maxHedgePercent, 100u)),
+      m_minDelayInMs(minDelayInMs),
+      m_percentile(std::min(percentile, 100u)),
+      m_windows(kSizeClassCount),
+      m_budget(0),
+      m_requestCount(0),
+      m_issuedCount(0),
+      m_wonCount(0),
+      m_rejectedCount(0) {
+  for (auto &window : m_windows) {
+    window.samples.resize(std::max(sampleWindowSize, kMinSampleCount));
+    window.nextSample = 0;
+    window.sampleCount = 0;
+    window.delayInMs = 0;
+  }
+}
+
+// --------------------------------------------------------------------------
+uint32_t HedgePolicy::GetDelayInMs(uint64_t bytes) const {
+  if (!IsEnabled()) {
+    return 0;
+  }
+  lock_guard<mutex> lock(m_mutex);
+  return m_windows[GetSizeClass(bytes)].delayInMs;
+}
+
+// --------------------------------------------------------------------------
+void HedgePolicy::OnRequest() {
+  ++m_requestCount;
+  if (!IsEnabled()) {
+    return;
+  }
+  lock_guard<mutex> lock(m_mutex);
+  m_budget = std::min(m_budget + m_maxHedgePercent, kMaxBudget);
+}
+
+// --------------------------------------------------------------------------
+void HedgePolicy::OnComplete(uint32_t latencyInMs, uint64_t bytes) {
+  if (!IsEnabled()) {
+    return;
+  }
+  lock_guard<mutex> lock(m_mutex);
+  auto &window = m_windows[GetSizeClass(bytes)];
+  window.samples[window.nextSample] = latencyInMs;
+  window.nextSample = (window.nextSample + 1) % window.samples.size();
+  if (window.sampleCount < window.samples.size()) {
+    ++window.sampleCount;
+  }
+  if (window.sampleCount >= kMinSampleCount &&
+      (window.sampleCount == kMinSampleCount ||
+       window.nextSample % kDelayUpdateInterval == 0)) {
+    UpdateDelayNoLock(&window);
+  }
+}
+
+// --------------------------------------------------------------------------
+bool HedgePolicy::TryHedge() {
+  if (!IsEnabled()) {
+    return false;
+  }
+  {
+    lock_guard<mutex> lock(m_mutex);
+    if (m_budget >= 100) {
+      m_budget -= 100;
+      ++m_issuedCount;
+      return true;
+    }
+  }
+  ++m_rejectedCount;
+  return false;
+}
+
+// --------------------------------------------------------------------------
+void HedgePolicy::UpdateDelayNoLock(SampleWindow *window) {
+  vector<uint32_t> samples(window->samples.begin(),
+                           window->samples.begin() + window->sampleCount);
+  size_t index = (samples.size() - 1) * m_percentile / 100;
+  std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+  window->delayInMs = std::max(samples[index], m_minDelayInMs);
+}
+
+// --------------------------------------------------------------------------
+string HedgePolicy::ToString() const {
+  string delays;
+  {
+    lock_guard<mutex> lock(m_mutex);
+    for (auto &window : m_windows) {
+      delays += (delays.empty() ? "" : ":") + to_string(window.delayInMs);
+    }
+  }
+  return "[max percent=" + to_string(m_maxHedgePercent) +
+         ", delays(ms) by size=" + delays +
+         ", requests=" + to_string(GetRequestCount()) +
+         ", issued:won:rejected=" + to_string(GetIssuedCount()) + ":" +
+         to_string(GetWonCount()) + ":" + to_string(GetRejectedCount()) + "]";
+}
+
+}  // namespace Client
+}  // namespace QS
@@ -43,6 +43,12 @@ ClientError<QSError> NullClient::DeleteFile(const string &filePath) {
   return GoodState();
 }
 
+ClientError<QSError> NullClient::DeleteFiles(
+    const std::vector<std::string> &filePaths,
+    std::vector<std::string> *undeletedPaths) {
+  return GoodState();
+}
+
 ClientError<QSError> NullClient::MakeFile(const std::string &filePath) {
   return GoodState();
 }
@@ -106,11 +112,25 @@ ClientError<QSError> NullClient::ListDirectory(const std::string &dirPath,
   return GoodState();
 }
 
+ClientError<QSError> NullClient::ListDirectoryPage(
+    const std::string &dirPath, std::string *marker, uint64_t maxCount,
+    std::vector<std::shared_ptr<QS::Data::FileMetaData>> *childMetas) {
+  if (marker != nullptr) {
+    marker->clear();
+  }
+  return GoodState();
+}
+
 ClientError<QSError> NullClient::Stat(const std::string &path,
                                       time_t modifiedSince, bool *modified) {
   return GoodState();
 }
 
+ClientError<QSError> NullClient::StatFileOrDirectory(const std::string &path,
+                                                     bool *isDirectory) {
+  return GoodState();
+}
+
 ClientError<QSError> NullClient::Statvfs(struct statvfs *stvfs) {
   return GoodState();
 }
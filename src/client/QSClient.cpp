@@ -18,9 +18,13 @@
 
 #include <assert.h>
 #include <stdint.h>  // for uint64_t
+#include <time.h>
 
+#include <algorithm>
+#include <atomic>  // NOLINT
 #include <chrono>  // NOLINT
 #include <cmath>
+#include <condition_variable>  // NOLINT
 #include <iostream>
 #include <memory>
 #include <mutex>  // NOLINT
@@ -33,12 +37,15 @@
 #include "qingstor/HttpCommon.h"
 #include "qingstor/QingStor.h"
 #include "qingstor/QsConfig.h"
+#include "qingstor/types/KeyDeleteErrorType.h"
+#include "qingstor/types/KeyType.h"
 #include "qingstor/types/ObjectPartType.h"
 
 #include "base/LogMacros.h"
 #include "base/StringUtils.h"
 #include "base/TimeUtils.h"
 #include "base/Utils.h"
+#include "client/AdaptiveTimeout.h"
 #include "client/ClientConfiguration.h"
 #include "client/ClientImpl.h"
 #include "client/Constants.h"
@@ -61,10 +68,12 @@ namespace Client {
 using QingStor::AbortMultipartUploadInput;
 using QingStor::Bucket;
 using QingStor::CompleteMultipartUploadInput;
+using QingStor::DeleteMultipleObjectsInput;
 using QingStor::GetObjectInput;
 using QingStor::HeadObjectInput;
 using QingStor::Http::HttpResponseCode;
 using QingStor::InitiateMultipartUploadInput;
+using QingStor::KeyType;
 using QingStor::ListObjectsInput;
 using QingStor::PutObjectInput;
 using QingStor::QingStorService;
@@ -73,6 +82,7 @@ using QingStor::UploadMultipartInput;
 
 using QS::Client::Utils::ParseRequestContentRange;
 using QS::Data::BuildDefaultDirectoryMeta;
+using QS::Data::FileMetaData;
 using QS::Data::Node;
 using QS::FileSystem::Drive;
 using QS::FileSystem::GetDirectoryMimeType;
@@ -90,13 +100,29 @@ using QS::Utils::IsRootDirectory;
 using std::chrono::milliseconds;
 using std::make_shared;
 using std::iostream;
+using std::pair;
 using std::shared_ptr;
 using std::string;
 using std::stringstream;
+using std::to_string;
 using std::unique_ptr;
+using std::vector;
 
 namespace {
 
+// log the progress of moving directory every this number of objects
+const size_t kMoveProgressInterval = 1000;
+
+// Moves shared by the workers of MoveDirectory
+struct MoveDirectoryContext {
+  vector<pair<string, string>> moves;  // pairs of {source, target}
+  std::atomic<size_t> next{0};         // index of the next move
+  std::mutex mutex;
+  std::condition_variable cond;
+  size_t finished = 0;
+  ClientError<QSError> err = ClientError<QSError>(QSError::GOOD, false);
+};
+
 // --------------------------------------------------------------------------
 string BuildXQSSourceString(const string &objKey) {
   const auto &clientConfig = ClientConfiguration::Instance();
@@ -109,21 +135,32 @@ string BuildXQSSourceString(const string &objKey) {
 }
 
 // --------------------------------------------------------------------------
-uint32_t CalculateTransferTimeForFile(uint64_t fileSize) {
+uint32_t CalculateTransferTimeForFile(const AdaptiveTimeout &timeout,
+                                      TimedOperation op, uint64_t fileSize) {
   const auto &clientConfig = ClientConfiguration::Instance();
-  // 2000 milliseconds per MB1 by default
-  return std::ceil(static_cast<long double>(fileSize) / QS::Data::Size::MB1) *
-         clientConfig.GetTransactionTimeDuration() * 4 +
-         1000;
+  // 2000 milliseconds per MB1 by default, until the speed is measured
+  uint32_t defaultTime =
+      std::ceil(static_cast<long double>(fileSize) / QS::Data::Size::MB1) *
+          clientConfig.GetTransactionTimeDuration() * 4 +
+      1000;
+  return timeout.GetTimeoutInMs(op, fileSize, defaultTime);
 }
 
 // --------------------------------------------------------------------------
-uint32_t CalculateTimeForListObjects(uint64_t maxCount) {
+uint32_t CalculateTimeForListObjects(const AdaptiveTimeout &timeout,
+                                     uint64_t maxCount) {
   const auto &clientConfig = ClientConfiguration::Instance();
-  // 1000 milliseconds per 200 objects by default
-  return std::ceil(static_cast<long double>(maxCount) / 200) *
-         clientConfig.GetTransactionTimeDuration() * 2 +
-         1000;
+  // 1000 milliseconds per 200 objects by default, until the speed is measured
+  uint32_t defaultTime = std::ceil(static_cast<long double>(maxCount) / 200) *
+                             clientConfig.GetTransactionTimeDuration() * 2 +
+                         1000;
+  // the timeout is applied to each page of the listing
+  uint64_t pageCount =
+      maxCount == 0 ? Constants::BucketListObjectsLimit
+                    : std::min<uint64_t>(maxCount,
+                                         Constants::BucketListObjectsLimit);
+  return timeout.GetTimeoutInMs(TimedOperation::ListObjects, pageCount,
+                                defaultTime);
 }
 
 }  // namespace
@@ -147,11 +184,11 @@ ClientError<QSError> QSClient::HeadBucket(bool useThreadPool) {
       ClientConfiguration::Instance().GetTransactionTimeDuration();
   auto outcome = GetQSClientImpl()->HeadBucket(msTimeDuration, useThreadPool);
   unsigned attemptedRetries = 0;
+  uint32_t sleepMilliseconds = 0;
   while (!outcome.IsSuccess() &&
          GetRetryStrategy().ShouldRetry(outcome.GetError(), attemptedRetries)) {
-    uint32_t sleepMilliseconds =
-        GetRetryStrategy().CalculateDelayBeforeNextRetry(outcome.GetError(),
-                                                         attemptedRetries);
+    sleepMilliseconds = GetRetryStrategy().CalculateDelayBeforeNextRetry(
+        outcome.GetError(), attemptedRetries, sleepMilliseconds);
     RetryRequestSleep(std::chrono::milliseconds(sleepMilliseconds));
     outcome = GetQSClientImpl()->HeadBucket(msTimeDuration, useThreadPool);
     ++attemptedRetries;
@@ -195,20 +232,140 @@ ClientError<QSError> QSClient::DeleteFile(const string &filePath) {
   return err;
 }
 
+// --------------------------------------------------------------------------
+ClientError<QSError> QSClient::DeleteFiles(const vector<string> &filePaths,
+                                           vector<string> *undeletedPaths) {
+  auto &drive = Drive::Instance();
+  auto &dirTree = drive.GetDirectoryTree();
+  assert(dirTree);
+  vector<string> hardLinks;
+  vector<string> objects;
+  for (auto &path : filePaths) {
+    auto node = dirTree->Find(path).lock();
+    if (node && *node &&
+        (node->IsHardLink() ||
+         (!node->IsDirectory() && node->GetNumLink() >= 2))) {
+      hardLinks.push_back(path);
+    } else {
+      objects.push_back(path);
+    }
+  }
+  dirTree->Remove(hardLinks);
+
+  auto &cache = drive.GetCache();
+  ClientError<QSError> ret(QSError::GOOD, false);
+  size_t limit = Constants::BucketDeleteMultipleObjectsLimit;
+  for (size_t begin = 0; begin < objects.size(); begin += limit) {
+    auto end = std::min(begin + limit, objects.size());
+    vector<string> paths(objects.begin() + begin, objects.begin() + end);
+    vector<string> undeleted;
+    auto err = DeleteObjects(paths, &undeleted);
+    if (!IsGoodQSError(err)) {
+      Error("Fail to delete " + to_string(paths.size()) + " files " +
+            GetMessageForQSError(err));
+      if (undeletedPaths != nullptr) {
+        undeletedPaths->insert(undeletedPaths->end(), paths.begin(),
+                               paths.end());
+      }
+      if (IsGoodQSError(ret)) {
+        ret = err;
+      }
+      continue;
+    }
+
+    if (!undeleted.empty()) {
+      if (undeletedPaths != nullptr) {
+        undeletedPaths->insert(undeletedPaths->end(), undeleted.begin(),
+                               undeleted.end());
+      }
+      // keep the undeleted ones in dir tree
+      std::sort(undeleted.begin(), undeleted.end());
+      paths.erase(std::remove_if(paths.begin(), paths.end(),
+                                 [&undeleted](const string &path) {
+                                   return std::binary_search(
+                                       undeleted.begin(), undeleted.end(),
+                                       path);
+                                 }),
+                  paths.end());
+      if (IsGoodQSError(ret)) {
+        ret = ClientError<QSError>(QSError::UNKNOWN, "QSClient::DeleteFiles",
+                                   "Unable to delete " +
+                                       to_string(undeleted.size()) + " files",
+                                   false);
+      }
+    }
+    dirTree->Remove(paths);
+    if (cache) {
+      for (auto &path : paths) {
+        if (cache->HasFile(path)) {
+          cache->Erase(path);
+        }
+      }
+    }
+  }
+
+  return ret;
+}
+
+// --------------------------------------------------------------------------
+ClientError<QSError> QSClient::DeleteObjects(const vector<string> &paths,
+                                             vector<string> *undeleted) {
+  if (paths.empty()) {
+    return ClientError<QSError>(QSError::GOOD, false);
+  }
+  vector<KeyType> keys;
+  keys.reserve(paths.size());
+  for (auto &path : paths) {
+    KeyType key;
+    key.SetKey(LTrim(path, '/'));
+    keys.push_back(std::move(key));
+  }
+  DeleteMultipleObjectsInput input;
+  input.SetObjects(keys);
+  input.SetQuiet(true);  // only report the errors
+
+  auto outcome = GetQSClientImpl()->DeleteMultipleObjects(&input);
+  unsigned attemptedRetries = 0;
+  uint32_t sleepMilliseconds = 0;
+  while (!outcome.IsSuccess() &&
+         GetRetryStrategy().ShouldRetry(outcome.GetError(), attemptedRetries)) {
+    sleepMilliseconds = GetRetryStrategy().CalculateDelayBeforeNextRetry(
+        outcome.GetError(), attemptedRetries, sleepMilliseconds);
+    RetryRequestSleep(std::chrono::milliseconds(sleepMilliseconds));
+    outcome = GetQSClientImpl()->DeleteMultipleObjects(&input);
+    ++attemptedRetries;
+    DebugInfo("Retry delete " + to_string(paths.size()) + " objects");
+  }
+  BumpWriteGeneration();
+
+  if (!outcome.IsSuccess()) {
+    return outcome.GetError();
+  }
+  if (undeleted != nullptr) {
+    for (auto &error : outcome.GetResult().GetErrors()) {
+      DebugWarning("Unable to delete object " + error.GetKey() + " " +
+                   error.GetCode());
+      undeleted->push_back("/" + error.GetKey());
+    }
+  }
+  return ClientError<QSError>(QSError::GOOD, false);
+}
+
 // --------------------------------------------------------------------------
 ClientError<QSError> QSClient::DeleteObject(const std::string &filePath) {
   auto outcome = GetQSClientImpl()->DeleteObject(filePath);
   unsigned attemptedRetries = 0;
+  uint32_t sleepMilliseconds = 0;
   while (!outcome.IsSuccess() &&
          GetRetryStrategy().ShouldRetry(outcome.GetError(), attemptedRetries)) {
-    uint32_t sleepMilliseconds =
-        GetRetryStrategy().CalculateDelayBeforeNextRetry(outcome.GetError(),
-                                                         attemptedRetries);
+    sleepMilliseconds = GetRetryStrategy().CalculateDelayBeforeNextRetry(
+        outcome.GetError(), attemptedRetries, sleepMilliseconds);
     RetryRequestSleep(std::chrono::milliseconds(sleepMilliseconds));
     outcome = GetQSClientImpl()->DeleteObject(filePath);
     ++attemptedRetries;
     DebugInfo("Retry delete object " + FormatPath(filePath));
   }
+  BumpWriteGeneration();
 
   return outcome.IsSuccess() ? ClientError<QSError>(QSError::GOOD, false)
                              : outcome.GetError();
@@ -222,16 +379,17 @@ ClientError<QSError> QSClient::MakeFile(const string &filePath) {
 
   auto outcome = GetQSClientImpl()->PutObject(filePath, &input);
   unsigned attemptedRetries = 0;
+  uint32_t sleepMilliseconds = 0;
   while (!outcome.IsSuccess() &&
          GetRetryStrategy().ShouldRetry(outcome.GetError(), attemptedRetries)) {
-    uint32_t sleepMilliseconds =
-        GetRetryStrategy().CalculateDelayBeforeNextRetry(outcome.GetError(),
-                                                         attemptedRetries);
+    sleepMilliseconds = GetRetryStrategy().CalculateDelayBeforeNextRetry(
+        outcome.GetError(), attemptedRetries, sleepMilliseconds);
     RetryRequestSleep(std::chrono::milliseconds(sleepMilliseconds));
     outcome = GetQSClientImpl()->PutObject(filePath, &input);
     ++attemptedRetries;
     DebugInfo("Retry make file " + FormatPath(filePath));
   }
+  BumpWriteGeneration();
 
   if (outcome.IsSuccess()) {
     // As sdk doesn't return the created file meta data in PutObjectOutput,
@@ -258,16 +416,17 @@ ClientError<QSError> QSClient::MakeDirectory(const string &dirPath) {
 
   auto outcome = GetQSClientImpl()->PutObject(dir, &input);
   unsigned attemptedRetries = 0;
+  uint32_t sleepMilliseconds = 0;
   while (!outcome.IsSuccess() &&
          GetRetryStrategy().ShouldRetry(outcome.GetError(), attemptedRetries)) {
-    uint32_t sleepMilliseconds =
-        GetRetryStrategy().CalculateDelayBeforeNextRetry(outcome.GetError(),
-                                                         attemptedRetries);
+    sleepMilliseconds = GetRetryStrategy().CalculateDelayBeforeNextRetry(
+        outcome.GetError(), attemptedRetries, sleepMilliseconds);
     RetryRequestSleep(std::chrono::milliseconds(sleepMilliseconds));
     outcome = GetQSClientImpl()->PutObject(dir, &input);
     ++attemptedRetries;
     DebugInfo("Retry make directory " + FormatPath(dirPath));
   }
+  BumpWriteGeneration();
 
   if (outcome.IsSuccess()) {
     // As sdk doesn't return the created file meta data in PutObjectOutput,
@@ -330,69 +489,116 @@ ClientError<QSError> QSClient::MoveDirectory(const string &sourceDirPath,
                                              const string &targetDirPath,
                                              bool async) {
   string sourceDir = AppendPathDelim(sourceDirPath);
-  // List the source directory all objects
-  auto outcome = ListObjects(sourceDir);
-  if (!outcome.IsSuccess()) {
-    DebugError("Fail to list objects " + FormatPath(sourceDir));
-    return outcome.GetError();
-  }
-
-  auto receivedHandler = [](const ClientError<QSError> &err) {
-    DebugErrorIf(!IsGoodQSError(err), GetMessageForQSError(err));
-  };
-
   string targetDir = AppendPathDelim(targetDirPath);
   size_t lenSourceDir = sourceDir.size();
-  auto &listObjOutputs = outcome.GetResult();
-
-  // move sub files
   auto prefix = LTrim(sourceDir, '/');
-  for (auto &listObjOutput : listObjOutputs) {
-    for (auto &key : listObjOutput.GetKeys()) {
-      // sdk will put dir (if exists) itself into keys, ignore it
-      if (prefix == key.GetKey()) {
-        continue;
-      }
-      auto sourceSubFile = "/" + key.GetKey();
-      auto targetSubFile = targetDir + sourceSubFile.substr(lenSourceDir);
-
-      if (async) {  // asynchronously
-        GetExecutor()->SubmitAsync(
-            receivedHandler, [this, sourceSubFile, targetSubFile] {
-              return MoveObject(sourceSubFile, targetSubFile);
-            });
-      } else {  // synchronizely
-        receivedHandler(MoveObject(sourceSubFile, targetSubFile));
+
+  // List the whole sub tree page by page, without delimiter the sub folders
+  // are listed as keys too
+  ListObjectsInput listObjInput;
+  listObjInput.SetLimit(Constants::BucketListObjectsLimit);
+  listObjInput.SetPrefix(prefix);
+  auto context = make_shared<MoveDirectoryContext>();
+  bool hasDirObject = false;
+  bool resultTruncated = true;
+  while (resultTruncated) {
+    auto timeDuration = CalculateTimeForListObjects(
+        *GetQSClientImpl()->GetAdaptiveTimeout(),
+        Constants::BucketListObjectsLimit);
+    auto outcome = GetQSClientImpl()->ListObjects(
+        &listObjInput, &resultTruncated, nullptr,
+        Constants::BucketListObjectsLimit, timeDuration);
+    unsigned attemptedRetries = 0;
+    uint32_t sleepMilliseconds = 0;
+    while (!outcome.IsSuccess() &&
+           GetRetryStrategy().ShouldRetry(outcome.GetError(),
+                                          attemptedRetries)) {
+      sleepMilliseconds = GetRetryStrategy().CalculateDelayBeforeNextRetry(
+          outcome.GetError(), attemptedRetries, sleepMilliseconds);
+      RetryRequestSleep(std::chrono::milliseconds(sleepMilliseconds));
+      timeDuration = CalculateTimeForListObjects(
+          *GetQSClientImpl()->GetAdaptiveTimeout(),
+          Constants::BucketListObjectsLimit);
+      outcome = GetQSClientImpl()->ListObjects(
+          &listObjInput, &resultTruncated, nullptr,
+          Constants::BucketListObjectsLimit, timeDuration);
+      ++attemptedRetries;
+      DebugInfo("Retry list objects " + FormatPath(sourceDir));
+    }
+    if (!outcome.IsSuccess()) {
+      DebugError("Fail to list objects " + FormatPath(sourceDir));
+      return outcome.GetError();
+    }
+
+    for (auto &listObjOutput : outcome.GetResult()) {
+      for (auto &key : listObjOutput.GetKeys()) {
+        // dir itself is moved at last
+        if (prefix == key.GetKey()) {
+          hasDirObject = true;
+          continue;
+        }
+        auto sourceSubFile = "/" + key.GetKey();
+        context->moves.emplace_back(
+            sourceSubFile, targetDir + sourceSubFile.substr(lenSourceDir));
       }
     }
   }
 
-  // move sub folders
-  for (auto &listObjOutput : listObjOutputs) {
-    for (const auto &commonPrefix : listObjOutput.GetCommonPrefixes()) {
-      auto sourceSubDir = AppendPathDelim("/" + commonPrefix);
-      auto targetSubDir = targetDir + sourceSubDir.substr(lenSourceDir);
-
-      if (async) {  // asynchronously
-        GetExecutor()->SubmitAsync(
-            receivedHandler, [this, sourceSubDir, targetSubDir] {
-              return MoveDirectory(sourceSubDir, targetSubDir);
-            });
-      } else {  // synchronizely
-        receivedHandler(MoveDirectory(sourceSubDir, targetSubDir));
+  // Move sub files and sub folders with a bounded set of workers of the
+  // background executor. The caller is one of the workers, so the moving
+  // goes on even if the background executor is busy.
+  auto DoMoves = [this, sourceDir, targetDir, context]() {
+    size_t total = context->moves.size();
+    size_t i = 0;
+    while ((i = context->next++) < total) {
+      auto &move = context->moves[i];
+      auto err = MoveObject(move.first, move.second);
+      std::lock_guard<std::mutex> lock(context->mutex);
+      if (!IsGoodQSError(err)) {
+        DebugError(GetMessageForQSError(err));
+        if (IsGoodQSError(context->err)) {
+          context->err = err;
+        }
+      }
+      ++context->finished;
+      if (context->finished % kMoveProgressInterval == 0) {
+        Info("Moved " + to_string(context->finished) + "/" +
+             to_string(total) + " objects " +
+             FormatPath(sourceDir, targetDir));
+      }
+      if (context->finished == total) {
+        context->cond.notify_all();
       }
     }
-  }
+  };
 
-  // move dir itself
-  if (async) {  // asynchronously
-    GetExecutor()->SubmitAsync(receivedHandler, [this, sourceDir, targetDir] {
-      return MoveObject(sourceDir, targetDir);
+  size_t workers = 1;
+  if (async) {
+    workers = std::min(GetBackgroundPoolSize(), context->moves.size());
+  }
+  for (size_t i = 1; i < workers; ++i) {
+    GetBackgroundExecutor()->Submit(DoMoves);
+  }
+  DoMoves();
+  {
+    std::unique_lock<std::mutex> lock(context->mutex);
+    context->cond.wait(lock, [&context] {
+      return context->finished == context->moves.size();
     });
-  } else {  // synchronizely
-    receivedHandler(MoveObject(sourceDir, targetDir));
+  }
+  if (!IsGoodQSError(context->err)) {
+    return context->err;
   }
 
+  // move dir itself
+  if (hasDirObject) {
+    auto err = MoveObject(sourceDir, targetDir);
+    if (!IsGoodQSError(err)) {
+      return err;
+    }
+  }
+  DebugInfo("Moved " + to_string(context->moves.size()) + " objects " +
+            FormatPath(sourceDir, targetDir));
   return ClientError<QSError>(QSError::GOOD, false);
 }
 
@@ -417,16 +623,17 @@ ClientError<QSError> QSClient::MoveObject(const std::string &sourcePath,
 
   auto outcome = GetQSClientImpl()->PutObject(targetPath, &input, timeDuration);
   unsigned attemptedRetries = 0;
+  uint32_t sleepMilliseconds = 0;
   while (!outcome.IsSuccess() &&
          GetRetryStrategy().ShouldRetry(outcome.GetError(), attemptedRetries)) {
-    uint32_t sleepMilliseconds =
-        GetRetryStrategy().CalculateDelayBeforeNextRetry(outcome.GetError(),
-                                                         attemptedRetries);
+    sleepMilliseconds = GetRetryStrategy().CalculateDelayBeforeNextRetry(
+        outcome.GetError(), attemptedRetries, sleepMilliseconds);
     RetryRequestSleep(std::chrono::milliseconds(sleepMilliseconds));
     outcome = GetQSClientImpl()->PutObject(targetPath, &input, timeDuration);
     ++attemptedRetries;
     DebugInfo("Retry move object " + FormatPath(sourcePath, targetPath));
   }
+  BumpWriteGeneration();
 
   if (outcome.IsSuccess()) {
     return ClientError<QSError>(QSError::GOOD, false);
@@ -453,18 +660,25 @@ ClientError<QSError> QSClient::DownloadFile(const string &filePath,
                               .GetTransactionTimeDuration();  // milliseconds
   if (!range.empty()) {
     input.SetRange(range);
-    timeDuration =
-        CalculateTransferTimeForFile(ParseRequestContentRange(range).second);
+    timeDuration = CalculateTransferTimeForFile(
+        *GetQSClientImpl()->GetAdaptiveTimeout(), TimedOperation::Download,
+        ParseRequestContentRange(range).second);
   }
 
   auto outcome = GetQSClientImpl()->GetObject(filePath, &input, timeDuration);
   unsigned attemptedRetries = 0;
+  uint32_t sleepMilliseconds = 0;
   while (!outcome.IsSuccess() &&
          GetRetryStrategy().ShouldRetry(outcome.GetError(), attemptedRetries)) {
-    uint32_t sleepMilliseconds =
-        GetRetryStrategy().CalculateDelayBeforeNextRetry(outcome.GetError(),
-                                                         attemptedRetries);
+    sleepMilliseconds = GetRetryStrategy().CalculateDelayBeforeNextRetry(
+        outcome.GetError(), attemptedRetries, sleepMilliseconds);
     RetryRequestSleep(std::chrono::milliseconds(sleepMilliseconds));
+    if (!range.empty()) {
+      // timeout grows if the last request timed out
+      timeDuration = CalculateTransferTimeForFile(
+          *GetQSClientImpl()->GetAdaptiveTimeout(), TimedOperation::Download,
+          ParseRequestContentRange(range).second);
+    }
     outcome = GetQSClientImpl()->GetObject(filePath, &input, timeDuration);
     ++attemptedRetries;
     DebugInfo("Retry download file " + FormatPath(filePath));
@@ -493,11 +707,11 @@ ClientError<QSError> QSClient::InitiateMultipartUpload(const string &filePath,
 
   auto outcome = GetQSClientImpl()->InitiateMultipartUpload(filePath, &input);
   unsigned attemptedRetries = 0;
+  uint32_t sleepMilliseconds = 0;
   while (!outcome.IsSuccess() &&
          GetRetryStrategy().ShouldRetry(outcome.GetError(), attemptedRetries)) {
-    uint32_t sleepMilliseconds =
-        GetRetryStrategy().CalculateDelayBeforeNextRetry(outcome.GetError(),
-                                                         attemptedRetries);
+    sleepMilliseconds = GetRetryStrategy().CalculateDelayBeforeNextRetry(
+        outcome.GetError(), attemptedRetries, sleepMilliseconds);
     RetryRequestSleep(std::chrono::milliseconds(sleepMilliseconds));
     outcome = GetQSClientImpl()->InitiateMultipartUpload(filePath, &input);
     ++attemptedRetries;
@@ -527,16 +741,21 @@ ClientError<QSError> QSClient::UploadMultipart(
     input.SetBody(buffer);
   }
 
-  auto timeDuration = CalculateTransferTimeForFile(contentLength);
+  auto timeDuration = CalculateTransferTimeForFile(
+      *GetQSClientImpl()->GetAdaptiveTimeout(), TimedOperation::Upload,
+      contentLength);
   auto outcome =
       GetQSClientImpl()->UploadMultipart(filePath, &input, timeDuration);
   unsigned attemptedRetries = 0;
+  uint32_t sleepMilliseconds = 0;
   while (!outcome.IsSuccess() &&
          GetRetryStrategy().ShouldRetry(outcome.GetError(), attemptedRetries)) {
-    uint32_t sleepMilliseconds =
-        GetRetryStrategy().CalculateDelayBeforeNextRetry(outcome.GetError(),
-                                                         attemptedRetries);
+    sleepMilliseconds = GetRetryStrategy().CalculateDelayBeforeNextRetry(
+        outcome.GetError(), attemptedRetries, sleepMilliseconds);
     RetryRequestSleep(std::chrono::milliseconds(sleepMilliseconds));
+    timeDuration = CalculateTransferTimeForFile(
+        *GetQSClientImpl()->GetAdaptiveTimeout(), TimedOperation::Upload,
+        contentLength);
     outcome =
         GetQSClientImpl()->UploadMultipart(filePath, &input, timeDuration);
     ++attemptedRetries;
@@ -566,16 +785,17 @@ ClientError<QSError> QSClient::CompleteMultipartUpload(
 
   auto outcome = GetQSClientImpl()->CompleteMultipartUpload(filePath, &input);
   unsigned attemptedRetries = 0;
+  uint32_t sleepMilliseconds = 0;
   while (!outcome.IsSuccess() &&
          GetRetryStrategy().ShouldRetry(outcome.GetError(), attemptedRetries)) {
-    uint32_t sleepMilliseconds =
-        GetRetryStrategy().CalculateDelayBeforeNextRetry(outcome.GetError(),
-                                                         attemptedRetries);
+    sleepMilliseconds = GetRetryStrategy().CalculateDelayBeforeNextRetry(
+        outcome.GetError(), attemptedRetries, sleepMilliseconds);
     RetryRequestSleep(std::chrono::milliseconds(sleepMilliseconds));
     outcome = GetQSClientImpl()->CompleteMultipartUpload(filePath, &input);
     ++attemptedRetries;
     DebugInfo("Retry complete multipart upload " + FormatPath(filePath));
   }
+  BumpWriteGeneration();
 
   if (outcome.IsSuccess()) {
     return ClientError<QSError>(QSError::GOOD, false);
@@ -592,11 +812,11 @@ ClientError<QSError> QSClient::AbortMultipartUpload(const string &filePath,
 
   auto outcome = GetQSClientImpl()->AbortMultipartUpload(filePath, &input);
   unsigned attemptedRetries = 0;
+  uint32_t sleepMilliseconds = 0;
   while (!outcome.IsSuccess() &&
          GetRetryStrategy().ShouldRetry(outcome.GetError(), attemptedRetries)) {
-    uint32_t sleepMilliseconds =
-        GetRetryStrategy().CalculateDelayBeforeNextRetry(outcome.GetError(),
-                                                         attemptedRetries);
+    sleepMilliseconds = GetRetryStrategy().CalculateDelayBeforeNextRetry(
+        outcome.GetError(), attemptedRetries, sleepMilliseconds);
     RetryRequestSleep(std::chrono::milliseconds(sleepMilliseconds));
     outcome = GetQSClientImpl()->AbortMultipartUpload(filePath, &input);
     ++attemptedRetries;
@@ -621,20 +841,26 @@ ClientError<QSError> QSClient::UploadFile(const string &filePath,
     input.SetBody(buffer);
   }
 
-  auto timeDuration = CalculateTransferTimeForFile(fileSize);
+  auto timeDuration = CalculateTransferTimeForFile(
+      *GetQSClientImpl()->GetAdaptiveTimeout(), TimedOperation::Upload,
+      fileSize);
 
   auto outcome = GetQSClientImpl()->PutObject(filePath, &input, timeDuration);
   unsigned attemptedRetries = 0;
+  uint32_t sleepMilliseconds = 0;
   while (!outcome.IsSuccess() &&
          GetRetryStrategy().ShouldRetry(outcome.GetError(), attemptedRetries)) {
-    uint32_t sleepMilliseconds =
-        GetRetryStrategy().CalculateDelayBeforeNextRetry(outcome.GetError(),
-                                                         attemptedRetries);
+    sleepMilliseconds = GetRetryStrategy().CalculateDelayBeforeNextRetry(
+        outcome.GetError(), attemptedRetries, sleepMilliseconds);
     RetryRequestSleep(std::chrono::milliseconds(sleepMilliseconds));
+    timeDuration = CalculateTransferTimeForFile(
+        *GetQSClientImpl()->GetAdaptiveTimeout(), TimedOperation::Upload,
+        fileSize);
     outcome = GetQSClientImpl()->PutObject(filePath, &input, timeDuration);
     ++attemptedRetries;
     DebugInfo("Retry upload file " + FormatPath(filePath));
   }
+  BumpWriteGeneration();
 
   if (outcome.IsSuccess()) {
     // As sdk doesn't return the created file meta data in PutObjectOutput,
@@ -663,16 +889,17 @@ ClientError<QSError> QSClient::SymLink(const string &filePath,
 
   auto outcome = GetQSClientImpl()->PutObject(linkPath, &input);
   unsigned attemptedRetries = 0;
+  uint32_t sleepMilliseconds = 0;
   while (!outcome.IsSuccess() &&
          GetRetryStrategy().ShouldRetry(outcome.GetError(), attemptedRetries)) {
-    uint32_t sleepMilliseconds =
-        GetRetryStrategy().CalculateDelayBeforeNextRetry(outcome.GetError(),
-                                                         attemptedRetries);
+    sleepMilliseconds = GetRetryStrategy().CalculateDelayBeforeNextRetry(
+        outcome.GetError(), attemptedRetries, sleepMilliseconds);
     RetryRequestSleep(std::chrono::milliseconds(sleepMilliseconds));
     outcome = GetQSClientImpl()->PutObject(linkPath, &input);
     ++attemptedRetries;
     DebugInfo("Retry symlink " + FormatPath(filePath, linkPath));
   }
+  BumpWriteGeneration();
 
   if (outcome.IsSuccess()) {
     // As sdk doesn't return the created file meta data in PutObjectOutput,
@@ -693,6 +920,14 @@ ClientError<QSError> QSClient::SymLink(const string &filePath,
 // --------------------------------------------------------------------------
 ClientError<QSError> QSClient::ListDirectory(const string &dirPath,
                                              bool useThreadPool) {
+  return GetListFlights().Do(dirPath, [this, &dirPath, useThreadPool] {
+    return DoListDirectory(dirPath, useThreadPool);
+  });
+}
+
+// --------------------------------------------------------------------------
+ClientError<QSError> QSClient::DoListDirectory(const string &dirPath,
+                                               bool useThreadPool) {
   uint64_t maxListCount = ClientConfiguration::Instance().GetMaxListCount();
   bool listAll = maxListCount <= 0;
 
@@ -710,38 +945,64 @@ ClientError<QSError> QSClient::ListDirectory(const string &dirPath,
   auto &dirTree = drive.GetDirectoryTree();
   assert(dirTree);
   auto dirNode = drive.GetNodeSimple(dirPath).lock();
-
+  // add dir itself if it is not existing at this moment
+  bool addSelf = !(dirNode && *dirNode);
+
+  // The children are grown page by page, the ones not listed are removed
+  // only when the whole listing is done, as a single page is not complete.
+  time_t listingTime = time(NULL);
+  vector<string> childPaths;
+  string marker;
   bool resultTruncated = false;
   uint64_t resCount = 0;
   do {
     uint64_t countPerList = 0;
     auto outcome = ListObjects(dirPath, &resultTruncated, &countPerList,
-                               maxCountPerList, useThreadPool);
+                               maxCountPerList, useThreadPool, &marker);
     if (!outcome.IsSuccess()) {
       return outcome.GetError();
     }
 
     resCount += countPerList;
     for (auto &listObjOutput : outcome.GetResult()) {
-      if (!(dirNode && *dirNode)) {  // directory not existing at this moment
-        // Add its children to dir tree
-        auto fileMetaDatas =
-            QSClientConverter::ListObjectsOutputToFileMetaDatas(
-                listObjOutput, true);  // add dir itself
-        dirTree->Grow(std::move(fileMetaDatas));
-      } else {  // directory existing
-        auto fileMetaDatas =
-            QSClientConverter::ListObjectsOutputToFileMetaDatas(
-                listObjOutput, false);  // not add dir itself
-        if (dirNode->IsEmpty()) {
-          dirTree->Grow(std::move(fileMetaDatas));
-        } else {
-          dirTree->UpdateDirectory(dirPath, std::move(fileMetaDatas));
+      auto fileMetaDatas =
+          QSClientConverter::ListObjectsOutputToFileMetaDatas(listObjOutput,
+                                                              addSelf);
+      for (auto &meta : fileMetaDatas) {
+        if (meta && meta->GetFilePath() != dirPath) {
+          childPaths.push_back(meta->GetFilePath());
         }
       }
+      dirTree->GrowChildren(dirPath, std::move(fileMetaDatas));
     }  // for list object output
   } while (resultTruncated && (listAll || resCount < maxListCount));
 
+  if (!resultTruncated) {
+    dirTree->SetDirectoryListed(dirPath, childPaths, listingTime);
+  }
+
+  return ClientError<QSError>(QSError::GOOD, false);
+}
+
+// --------------------------------------------------------------------------
+ClientError<QSError> QSClient::ListDirectoryPage(
+    const string &dirPath, string *marker, uint64_t maxCount,
+    vector<shared_ptr<FileMetaData>> *childMetas) {
+  assert(marker != nullptr && childMetas != nullptr);
+  bool resultTruncated = false;
+  auto outcome =
+      ListObjects(dirPath, &resultTruncated, nullptr, maxCount, true, marker);
+  if (!outcome.IsSuccess()) {
+    return outcome.GetError();
+  }
+
+  for (auto &listObjOutput : outcome.GetResult()) {
+    auto fileMetaDatas = QSClientConverter::ListObjectsOutputToFileMetaDatas(
+        listObjOutput, false);  // not add dir itself
+    for (auto &meta : fileMetaDatas) {
+      childMetas->push_back(std::move(meta));
+    }
+  }
   return ClientError<QSError>(QSError::GOOD, false);
 }
 
@@ -750,7 +1011,8 @@ ListObjectsOutcome QSClient::ListObjects(const string &dirPath,
                                          bool *resultTruncated,
                                          uint64_t *resCount,
                                          uint64_t maxCount,
-                                         bool useThreadPool) {
+                                         bool useThreadPool,
+                                         string *marker) {
   ListObjectsInput listObjInput;
   uint64_t limit = Constants::BucketListObjectsLimit < maxCount ? 
                    Constants::BucketListObjectsLimit : 
@@ -761,19 +1023,29 @@ ListObjectsOutcome QSClient::ListObjects(const string &dirPath,
                       ? string()
                       : AppendPathDelim(LTrim(dirPath, '/'));
   listObjInput.SetPrefix(prefix);
+  string startMarker = marker != nullptr ? *marker : string();
+  if (!startMarker.empty()) {
+    listObjInput.SetMarker(startMarker);
+  }
 
-  auto timeDuration = CalculateTimeForListObjects(maxCount);
+  auto timeDuration = CalculateTimeForListObjects(
+      *GetQSClientImpl()->GetAdaptiveTimeout(), maxCount);
 
   auto outcome =
       GetQSClientImpl()->ListObjects(&listObjInput, resultTruncated, resCount,
                                      maxCount, timeDuration, useThreadPool);
   unsigned attemptedRetries = 0;
+  uint32_t sleepMilliseconds = 0;
   while (!outcome.IsSuccess() &&
          GetRetryStrategy().ShouldRetry(outcome.GetError(), attemptedRetries)) {
-    uint32_t sleepMilliseconds =
-        GetRetryStrategy().CalculateDelayBeforeNextRetry(outcome.GetError(),
-                                                         attemptedRetries);
+    sleepMilliseconds = GetRetryStrategy().CalculateDelayBeforeNextRetry(
+        outcome.GetError(), attemptedRetries, sleepMilliseconds);
     RetryRequestSleep(std::chrono::milliseconds(sleepMilliseconds));
+    timeDuration = CalculateTimeForListObjects(
+        *GetQSClientImpl()->GetAdaptiveTimeout(), maxCount);
+    // the pages listed before the failure are dropped, so list them again
+    listObjInput.SetLimit(limit);
+    listObjInput.SetMarker(startMarker);
     outcome =
         GetQSClientImpl()->ListObjects(&listObjInput, resultTruncated, resCount,
                                        maxCount, timeDuration, useThreadPool);
@@ -781,12 +1053,34 @@ ListObjectsOutcome QSClient::ListObjects(const string &dirPath,
     DebugInfo("Retry list objects " + FormatPath(dirPath));
   }
 
+  if (marker != nullptr && outcome.IsSuccess()) {
+    bool truncated = resultTruncated != nullptr && *resultTruncated;
+    *marker = truncated ? listObjInput.GetMarker() : string();
+  }
   return outcome;
 }
 
 // --------------------------------------------------------------------------
 ClientError<QSError> QSClient::Stat(const string &path, time_t modifiedSince,
                                     bool *modified) {
+  // the stats with different modifiedSince get different results, and the
+  // ones issued after a write do not share the results issued before it
+  auto key = to_string(GetWriteGeneration()) + ":" +
+             to_string(modifiedSince) + ":" + path;
+  auto result = GetStatFlights().Do(key, [this, &path, modifiedSince] {
+    bool isModified = false;
+    auto err = DoStat(path, modifiedSince, &isModified);
+    return StatResult(err, isModified);
+  });
+  if (modified != nullptr) {
+    *modified = result.second;
+  }
+  return result.first;
+}
+
+// --------------------------------------------------------------------------
+ClientError<QSError> QSClient::DoStat(const string &path, time_t modifiedSince,
+                                      bool *modified) {
   if (modified != nullptr) {
     *modified = false;
   }
@@ -806,11 +1100,11 @@ ClientError<QSError> QSClient::Stat(const string &path, time_t modifiedSince,
 
   auto outcome = GetQSClientImpl()->HeadObject(path, &input);
   unsigned attemptedRetries = 0;
+  uint32_t sleepMilliseconds = 0;
   while (!outcome.IsSuccess() &&
          GetRetryStrategy().ShouldRetry(outcome.GetError(), attemptedRetries)) {
-    uint32_t sleepMilliseconds =
-        GetRetryStrategy().CalculateDelayBeforeNextRetry(outcome.GetError(),
-                                                         attemptedRetries);
+    sleepMilliseconds = GetRetryStrategy().CalculateDelayBeforeNextRetry(
+        outcome.GetError(), attemptedRetries, sleepMilliseconds);
     RetryRequestSleep(std::chrono::milliseconds(sleepMilliseconds));
     outcome = GetQSClientImpl()->HeadObject(path, &input);
     ++attemptedRetries;
@@ -879,6 +1173,102 @@ ClientError<QSError> QSClient::Stat(const string &path, time_t modifiedSince,
   }
 }
 
+// --------------------------------------------------------------------------
+ClientError<QSError> QSClient::StatFileOrDirectory(const string &path,
+                                                   bool *isDirectory) {
+  // the keys of Stat start with a digit, so they never collide
+  auto key = "?:" + to_string(GetWriteGeneration()) + ":" + path;
+  auto result = GetStatFlights().Do(key, [this, &path] {
+    bool isDir = false;
+    auto err = DoStatFileOrDirectory(path, &isDir);
+    return StatResult(err, isDir);
+  });
+  if (isDirectory != nullptr) {
+    *isDirectory = result.second;
+  }
+  return result.first;
+}
+
+// --------------------------------------------------------------------------
+ClientError<QSError> QSClient::DoStatFileOrDirectory(const string &path,
+                                                     bool *isDirectory) {
+  *isDirectory = false;
+  if (path.empty() || path.back() == '/') {
+    *isDirectory = !path.empty();
+    return DoStat(path, 0, nullptr);
+  }
+
+  // The file "path" sorts ahead of the dir "path/" and the names between
+  // them continue "path" with a char less than '/', such as "path.txt".
+  const uint64_t kLimit = 2;
+  string key = LTrim(path, '/');
+  string dirKey = AppendPathDelim(key);
+  ListObjectsInput listObjInput;
+  listObjInput.SetLimit(kLimit);
+  listObjInput.SetDelimiter(QS::Utils::GetPathDelimiter());
+  listObjInput.SetPrefix(key);
+  bool resultTruncated = false;
+  auto timeDuration = CalculateTimeForListObjects(
+      *GetQSClientImpl()->GetAdaptiveTimeout(), kLimit);
+  auto outcome = GetQSClientImpl()->ListObjects(
+      &listObjInput, &resultTruncated, nullptr, kLimit, timeDuration);
+  unsigned attemptedRetries = 0;
+  uint32_t sleepMilliseconds = 0;
+  while (!outcome.IsSuccess() &&
+         GetRetryStrategy().ShouldRetry(outcome.GetError(), attemptedRetries)) {
+    sleepMilliseconds = GetRetryStrategy().CalculateDelayBeforeNextRetry(
+        outcome.GetError(), attemptedRetries, sleepMilliseconds);
+    RetryRequestSleep(std::chrono::milliseconds(sleepMilliseconds));
+    // the timeout is backed off by the adaptive timeout of the last failure
+    timeDuration = CalculateTimeForListObjects(
+        *GetQSClientImpl()->GetAdaptiveTimeout(), kLimit);
+    outcome = GetQSClientImpl()->ListObjects(
+        &listObjInput, &resultTruncated, nullptr, kLimit, timeDuration);
+    ++attemptedRetries;
+    DebugInfo("Retry list objects " + FormatPath(path));
+  }
+  if (!outcome.IsSuccess()) {
+    return outcome.GetError();
+  }
+
+  auto &dirTree = Drive::Instance().GetDirectoryTree();
+  assert(dirTree);
+  bool dirExist = false;
+  for (auto &listObjOutput : outcome.GetResult()) {
+    for (auto &objKey : listObjOutput.GetKeys()) {
+      if (objKey.GetKey() == key) {
+        dirTree->Grow(
+            QSClientConverter::ObjectKeyToFileMetaData(objKey, time(NULL)));
+        return ClientError<QSError>(QSError::GOOD, false);
+      }
+    }
+    for (auto &commonPrefix : listObjOutput.GetCommonPrefixes()) {
+      dirExist = dirExist || commonPrefix == dirKey;
+    }
+  }
+  if (dirExist) {
+    // the dir could have no object of itself, see DoStat
+    *isDirectory = true;
+    dirTree->Grow(BuildDefaultDirectoryMeta(AppendPathDelim(path)));
+    return ClientError<QSError>(QSError::GOOD, false);
+  }
+  if (!resultTruncated) {
+    return ClientError<QSError>(QSError::KEY_NOT_EXIST, false);
+  }
+
+  // the names between them fill up the limit, so stat them one by one
+  DebugInfo("Stat file and dir one by one " + FormatPath(path));
+  auto err = DoStat(path, 0, nullptr);
+  if (err.GetError() == QSError::KEY_NOT_EXIST) {
+    *isDirectory = true;
+    err = DoStat(AppendPathDelim(path), 0, nullptr);
+    if (!IsGoodQSError(err)) {
+      *isDirectory = false;
+    }
+  }
+  return err;
+}
+
 // --------------------------------------------------------------------------
 ClientError<QSError> QSClient::Statvfs(struct statvfs *stvfs) {
   assert(stvfs != nullptr);
@@ -889,11 +1279,11 @@ ClientError<QSError> QSClient::Statvfs(struct statvfs *stvfs) {
 
   auto outcome = GetQSClientImpl()->GetBucketStatistics();
   unsigned attemptedRetries = 0;
+  uint32_t sleepMilliseconds = 0;
   while (!outcome.IsSuccess() &&
          GetRetryStrategy().ShouldRetry(outcome.GetError(), attemptedRetries)) {
-    uint32_t sleepMilliseconds =
-        GetRetryStrategy().CalculateDelayBeforeNextRetry(outcome.GetError(),
-                                                         attemptedRetries);
+    sleepMilliseconds = GetRetryStrategy().CalculateDelayBeforeNextRetry(
+        outcome.GetError(), attemptedRetries, sleepMilliseconds);
     RetryRequestSleep(std::chrono::milliseconds(sleepMilliseconds));
     outcome = GetQSClientImpl()->GetBucketStatistics();
     ++attemptedRetries;
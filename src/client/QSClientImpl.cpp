@@ -19,8 +19,10 @@
 #include <assert.h>
 
 #include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
 #include <future>  // NOLINT
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 #include <utility>
 #include <vector>
@@ -34,7 +36,9 @@
 
 #include "base/LogMacros.h"
 #include "base/ThreadPool.h"
+#include "client/AdaptiveTimeout.h"
 #include "client/ClientConfiguration.h"
+#include "client/HedgePolicy.h"
 #include "client/QSClient.h"
 #include "client/QSError.h"
 #include "client/Utils.h"
@@ -76,9 +80,15 @@ using QingStor::UploadMultipartInput;
 using QingStor::UploadMultipartOutput;
 using QS::Client::Utils::ParseRequestContentRange;
 using QS::Client::Utils::ParseResponseContentRange;
+using std::chrono::duration_cast;
 using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+using std::lock_guard;
+using std::mutex;
 using std::pair;
+using std::shared_ptr;
 using std::string;
+using std::unique_lock;
 using std::unique_ptr;
 using std::vector;
 
@@ -126,6 +136,23 @@ ClientError<QSError> TimeOutError(const string &exceptionName,
   return err;
 }
 
+// --------------------------------------------------------------------------
+uint32_t ElapsedInMs(steady_clock::time_point start) {
+  return static_cast<uint32_t>(
+      duration_cast<milliseconds>(steady_clock::now() - start).count());
+}
+
+// Shared by the hedged requests of an object, the first successful
+// response wins.
+struct HedgedGetObjectContext {
+  mutex lock;
+  std::condition_variable cond;
+  unsigned pending = 0;  // count of requests not finished
+  bool done = false;
+  bool hedgeWon = false;
+  pair<QsError, GetObjectOutput> result;
+};
+
 }  // namespace
 
 // --------------------------------------------------------------------------
@@ -143,6 +170,7 @@ QSClientImpl::QSClientImpl() : ClientImpl() {
 GetBucketStatisticsOutcome QSClientImpl::GetBucketStatistics(
     uint32_t msTimeDuration) const {
   string exceptionName = "QingStorGetBucketStatistics";
+  GetRateLimiter()->AcquireRequest();
   auto DoGetBucketStatistics =
       [this]() -> pair<QsError, GetBucketStatisticsOutput> {
     GetBucketStatisticsInput input;  // dummy input
@@ -174,6 +202,7 @@ GetBucketStatisticsOutcome QSClientImpl::GetBucketStatistics(
 HeadBucketOutcome QSClientImpl::HeadBucket(uint32_t msTimeDuration,
                                            bool useThreadPool) const {
   string exceptionName = "QingStorHeadBucket";
+  GetRateLimiter()->AcquireRequest();
   auto DoHeadBucket = [this]() -> pair<QsError, HeadBucketOutput> {
     HeadBucketInput input;  // dummy input
     HeadBucketOutput output;
@@ -244,12 +273,14 @@ ListObjectsOutcome QSClientImpl::ListObjects(ListObjectsInput *input,
       }
     }
 
+    GetRateLimiter()->AcquireRequest();
     auto DoListObjects = [this, input]() -> pair<QsError, ListObjectsOutput> {
       ListObjectsOutput output;
       auto sdkErr = m_bucket->ListObjects(*input, output);
       return {sdkErr, std::move(output)};
     };
     std::future<pair<QsError, ListObjectsOutput>> fListObjects;
+    auto start = steady_clock::now();
     if (useThreadPool) {
       fListObjects = GetExecutor()->SubmitCallablePrioritized(DoListObjects);
     } else {
@@ -263,8 +294,11 @@ ListObjectsOutcome QSClientImpl::ListObjects(ListObjectsInput *input,
 
       auto responseCode = output.GetResponseCode();
       if (SDKResponseSuccess(sdkErr, responseCode)) {
-        count += output.GetKeys().size();
-        count += output.GetCommonPrefixes().size();
+        auto pageCount =
+            output.GetKeys().size() + output.GetCommonPrefixes().size();
+        GetAdaptiveTimeout()->OnComplete(TimedOperation::ListObjects,
+                                         pageCount, ElapsedInMs(start));
+        count += pageCount;
         responseTruncated = !output.GetNextMarker().empty();
         if (responseTruncated) {
           input->SetMarker(output.GetNextMarker());
@@ -275,6 +309,9 @@ ListObjectsOutcome QSClientImpl::ListObjects(ListObjectsInput *input,
             sdkErr, exceptionName, output, SDKShouldRetry(responseCode))));
       }
     } else {
+      if (fStatus == std::future_status::timeout) {
+        GetAdaptiveTimeout()->OnTimeout(TimedOperation::ListObjects);
+      }
       return ListObjectsOutcome(
           std::move(TimeOutError(exceptionName, fStatus)));
     }
@@ -298,6 +335,7 @@ DeleteMultipleObjectsOutcome QSClientImpl::DeleteMultipleObjects(
                              "Null DeleteMultiplueObjectsInput", false));
   }
 
+  GetRateLimiter()->AcquireRequest();
   auto DoDeleteMultiObject =
       [this, input]() -> pair<QsError, DeleteMultipleObjectsOutput> {
     DeleteMultipleObjectsOutput output;
@@ -314,7 +352,8 @@ DeleteMultipleObjectsOutcome QSClientImpl::DeleteMultipleObjects(
 
     auto responseCode = output.GetResponseCode();
     if (SDKResponseSuccess(sdkErr, responseCode)) {
-      // TODO(jim): check undeleted objects
+      // undeleted objects are listed in output errors, refer to
+      // QSClient::DeleteObjects
       return DeleteMultipleObjectsOutcome(std::move(output));
     } else {
       return DeleteMultipleObjectsOutcome(std::move(BuildQSError(
@@ -359,6 +398,7 @@ ListMultipartUploadsOutcome QSClientImpl::ListMultipartUploads(
       if (remainingCount < input->GetLimit()) input->SetLimit(remainingCount);
     }
 
+    GetRateLimiter()->AcquireRequest();
     auto DoListMultipartUploads =
         [this, input]() -> pair<QsError, ListMultipartUploadsOutput> {
       ListMultipartUploadsOutput output;
@@ -406,6 +446,7 @@ DeleteObjectOutcome QSClientImpl::DeleteObject(const string &objKey,
   exceptionName.append(" object=");
   exceptionName.append(objKey);
 
+  GetRateLimiter()->AcquireRequest();
   auto DoDeleteObject = [this, objKey]() -> pair<QsError, DeleteObjectOutput> {
     DeleteObjectInput input;  // dummy input
     DeleteObjectOutput output;
@@ -446,16 +487,30 @@ GetObjectOutcome QSClientImpl::GetObject(const std::string &objKey,
 
   bool askPartialContent = !input->GetRange().empty();
 
+  GetRateLimiter()->AcquireRequest();
+  if (askPartialContent) {
+    GetRateLimiter()->AcquireDownload(
+        ParseRequestContentRange(input->GetRange()).second);
+  }
   auto DoGetObject = [this, objKey, input]() -> pair<QsError, GetObjectOutput> {
     GetObjectOutput output;
     auto sdkErr = m_bucket->GetObject(objKey, *input, output);
     return {sdkErr, std::move(output)};
   };
 
-  auto fGetObject = GetExecutor()->SubmitCallablePrioritized(DoGetObject);
-  auto fStatus = fGetObject.wait_for(milliseconds(msTimeDuration));
+  pair<QsError, GetObjectOutput> res;
+  std::future_status fStatus;
+  auto start = steady_clock::now();
+  if (askPartialContent && GetHedgePolicy()->IsEnabled()) {
+    fStatus = HedgedGetObject(objKey, *input, msTimeDuration, &res);
+  } else {
+    auto fGetObject = GetExecutor()->SubmitCallablePrioritized(DoGetObject);
+    fStatus = fGetObject.wait_for(milliseconds(msTimeDuration));
+    if (fStatus == std::future_status::ready) {
+      res = fGetObject.get();
+    }
+  }
   if (fStatus == std::future_status::ready) {
-    auto res = fGetObject.get();
     auto &sdkErr = res.first;
     auto &output = res.second;
     auto responseCode = output.GetResponseCode();
@@ -475,13 +530,22 @@ GetObjectOutcome QSClientImpl::GetObject(const std::string &objKey,
               "[content range request:response=" + input->GetRange() + ":" +
                   output.GetContentRange() + "]");
         }
+      } else {
+        // the size of whole object is unknown before, just charge afterwards
+        GetRateLimiter()->AcquireDownload(output.GetContentLength());
       }
+      GetAdaptiveTimeout()->OnComplete(TimedOperation::Download,
+                                       output.GetContentLength(),
+                                       ElapsedInMs(start));
       return GetObjectOutcome(std::move(output));
     } else {
       return GetObjectOutcome(std::move(BuildQSError(
           sdkErr, exceptionName, output, SDKShouldRetry(responseCode))));
     }
   } else {
+    if (fStatus == std::future_status::timeout && askPartialContent) {
+      GetAdaptiveTimeout()->OnTimeout(TimedOperation::Download);
+    }
     return GetObjectOutcome(std::move(TimeOutError(exceptionName, fStatus)));
   }
 }
@@ -499,6 +563,7 @@ HeadObjectOutcome QSClientImpl::HeadObject(const string &objKey,
   exceptionName.append(" object=");
   exceptionName.append(objKey);
 
+  GetRateLimiter()->AcquireRequest();
   auto DoHeadObject = [this, objKey,
                        input]() -> pair<QsError, HeadObjectOutput> {
     HeadObjectOutput output;
@@ -538,12 +603,15 @@ PutObjectOutcome QSClientImpl::PutObject(const string &objKey,
   exceptionName.append(" object=");
   exceptionName.append(objKey);
 
+  GetRateLimiter()->AcquireRequest();
+  GetRateLimiter()->AcquireUpload(input->GetContentLength());
   auto DoPutObject = [this, objKey, input]() -> pair<QsError, PutObjectOutput> {
     PutObjectOutput output;
     auto sdkErr = m_bucket->PutObject(objKey, *input, output);
     return {sdkErr, std::move(output)};
   };
 
+  auto start = steady_clock::now();
   auto fPutObject = GetExecutor()->SubmitCallablePrioritized(DoPutObject);
   auto fStatus = fPutObject.wait_for(milliseconds(msTimeDuration));
   if (fStatus == std::future_status::ready) {
@@ -552,12 +620,18 @@ PutObjectOutcome QSClientImpl::PutObject(const string &objKey,
     auto &output = res.second;
     auto responseCode = output.GetResponseCode();
     if (SDKResponseSuccess(sdkErr, responseCode)) {
+      GetAdaptiveTimeout()->OnComplete(TimedOperation::Upload,
+                                       input->GetContentLength(),
+                                       ElapsedInMs(start));
       return PutObjectOutcome(std::move(output));
     } else {
       return PutObjectOutcome(std::move(BuildQSError(
           sdkErr, exceptionName, output, SDKShouldRetry(responseCode))));
     }
   } else {
+    if (fStatus == std::future_status::timeout) {
+      GetAdaptiveTimeout()->OnTimeout(TimedOperation::Upload);
+    }
     return PutObjectOutcome(std::move(TimeOutError(exceptionName, fStatus)));
   }
 }
@@ -575,6 +649,7 @@ InitiateMultipartUploadOutcome QSClientImpl::InitiateMultipartUpload(
   exceptionName.append(" object=");
   exceptionName.append(objKey);
 
+  GetRateLimiter()->AcquireRequest();
   auto DoInitiateMultipartUpload =
       [this, objKey, input]() -> pair<QsError, InitiateMultipartUploadOutput> {
     InitiateMultipartUploadOutput output;
@@ -614,12 +689,15 @@ UploadMultipartOutcome QSClientImpl::UploadMultipart(
   exceptionName.append(" object=");
   exceptionName.append(objKey);
 
+  GetRateLimiter()->AcquireRequest();
+  GetRateLimiter()->AcquireUpload(input->GetContentLength());
   auto DoUploadMultipart = [this, objKey,
                             input]() -> pair<QsError, UploadMultipartOutput> {
     UploadMultipartOutput output;
     auto sdkErr = m_bucket->UploadMultipart(objKey, *input, output);
     return {sdkErr, std::move(output)};
   };
+  auto start = steady_clock::now();
   auto fUploadMultipart =
       GetExecutor()->SubmitCallablePrioritized(DoUploadMultipart);
   auto fStatus = fUploadMultipart.wait_for(milliseconds(msTimeDuration));
@@ -629,12 +707,18 @@ UploadMultipartOutcome QSClientImpl::UploadMultipart(
     auto &output = res.second;
     auto responseCode = output.GetResponseCode();
     if (SDKResponseSuccess(sdkErr, responseCode)) {
+      GetAdaptiveTimeout()->OnComplete(TimedOperation::Upload,
+                                       input->GetContentLength(),
+                                       ElapsedInMs(start));
       return UploadMultipartOutcome(std::move(output));
     } else {
       return UploadMultipartOutcome(std::move(BuildQSError(
           sdkErr, exceptionName, output, SDKShouldRetry(responseCode))));
     }
   } else {
+    if (fStatus == std::future_status::timeout) {
+      GetAdaptiveTimeout()->OnTimeout(TimedOperation::Upload);
+    }
     return UploadMultipartOutcome(
         std::move(TimeOutError(exceptionName, fStatus)));
   }
@@ -653,6 +737,7 @@ CompleteMultipartUploadOutcome QSClientImpl::CompleteMultipartUpload(
   exceptionName.append(" object=");
   exceptionName.append(objKey);
 
+  GetRateLimiter()->AcquireRequest();
   auto DoCompleteMultipartUpload =
       [this, objKey, input]() -> pair<QsError, CompleteMultipartUploadOutput> {
     CompleteMultipartUploadOutput output;
@@ -693,6 +778,7 @@ AbortMultipartUploadOutcome QSClientImpl::AbortMultipartUpload(
   exceptionName.append(" object=");
   exceptionName.append(objKey);
 
+  GetRateLimiter()->AcquireRequest();
   auto DoAbortMultipartUpload =
       [this, objKey, input]() -> pair<QsError, AbortMultipartUploadOutput> {
     AbortMultipartUploadOutput output;
@@ -751,6 +837,7 @@ ListMultipartOutcome QSClientImpl::ListMultipart(
       if (remainingCount < input->GetLimit()) input->SetLimit(remainingCount);
     }
 
+    GetRateLimiter()->AcquireRequest();
     auto DoListMultipart = [this, objKey,
                             input]() -> pair<QsError, ListMultipartOutput> {
       ListMultipartOutput output;
@@ -788,6 +875,71 @@ ListMultipartOutcome QSClientImpl::ListMultipart(
   return ListMultipartOutcome(std::move(result));
 }
 
+// --------------------------------------------------------------------------
+std::future_status QSClientImpl::HedgedGetObject(
+    const string &objKey, const GetObjectInput &input, uint32_t msTimeDuration,
+    pair<QsError, GetObjectOutput> *result) const {
+  auto deadline = steady_clock::now() + milliseconds(msTimeDuration);
+  auto hedgePolicy = GetHedgePolicy();
+  hedgePolicy->OnRequest();
+  size_t reqLen = ParseRequestContentRange(input.GetRange()).second;
+  // the requests may outlive this call, so they hold their own copies
+  auto context = std::make_shared<HedgedGetObjectContext>();
+  auto sharedInput = std::make_shared<GetObjectInput>(input);
+  auto DoGetObject = [this, objKey, sharedInput, context, hedgePolicy,
+                      reqLen](bool isHedge) {
+    {
+      lock_guard<mutex> lock(context->lock);
+      if (context->done) {
+        --context->pending;
+        return;
+      }
+    }
+    auto start = steady_clock::now();
+    GetObjectOutput output;
+    auto sdkErr = m_bucket->GetObject(objKey, *sharedInput, output);
+    bool success = SDKResponseSuccess(sdkErr, output.GetResponseCode());
+    if (success) {
+      hedgePolicy->OnComplete(ElapsedInMs(start), reqLen);
+    }
+    lock_guard<mutex> lock(context->lock);
+    --context->pending;
+    if (!context->done && (success || context->pending == 0)) {
+      context->done = true;
+      context->hedgeWon = isHedge;
+      context->result = {sdkErr, std::move(output)};
+      context->cond.notify_all();
+    }
+  };
+
+  unique_lock<mutex> lock(context->lock);
+  ++context->pending;
+  GetExecutor()->SubmitPrioritized(DoGetObject, false);
+
+  auto IsDone = [&context] { return context->done; };
+  uint32_t hedgeDelay = hedgePolicy->GetDelayInMs(reqLen);
+  if (hedgeDelay > 0 && hedgeDelay < msTimeDuration &&
+      !context->cond.wait_for(lock, milliseconds(hedgeDelay), IsDone) &&
+      hedgePolicy->TryHedge()) {
+    ++context->pending;
+    lock.unlock();
+    GetRateLimiter()->AcquireRequest();
+    GetRateLimiter()->AcquireDownload(reqLen);
+    GetExecutor()->SubmitPrioritized(DoGetObject, true);
+    lock.lock();
+  }
+
+  if (!context->cond.wait_until(lock, deadline, IsDone)) {
+    context->done = true;  // skip the requests not started yet
+    return std::future_status::timeout;
+  }
+  if (context->hedgeWon) {
+    hedgePolicy->OnHedgeWon();
+  }
+  *result = std::move(context->result);
+  return std::future_status::ready;
+}
+
 // --------------------------------------------------------------------------
 void QSClientImpl::SetBucket(unique_ptr<QingStor::Bucket> bucket) {
   assert(bucket);
@@ -226,6 +226,16 @@ bool IsGoodQSError(const ClientError<QSError> &error){
   return error.GetError() == QSError::GOOD;
 }
 
+// --------------------------------------------------------------------------
+bool IsThrottlingQSError(const ClientError<QSError> &error) {
+  // TooManyRequests(429) is mapped to SERVICE_UNAVAILABLE,
+  // REQUEST_EXPIRED denotes the request time out.
+  auto err = error.GetError();
+  return err == QSError::SERVICE_UNAVAILABLE ||
+         err == QSError::REQUEST_EXPIRED ||
+         err == QSError::NETWORK_CONNECTION;
+}
+
 // --------------------------------------------------------------------------
 QSError SDKErrorToQSError(QsError sdkErr) {
   static unordered_map<QsError, QSError, QS::HashUtils::EnumHash> sdkErrToQSErrMap =
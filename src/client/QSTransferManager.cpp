@@ -28,10 +28,13 @@
 #include <vector>
 
 #include "base/LogMacros.h"
+#include "base/RoundRobinScheduler.h"
 #include "client/Client.h"
 #include "client/ClientConfiguration.h"
 #include "client/ClientError.h"
+#include "client/ConcurrencyController.h"
 #include "client/QSError.h"
+#include "client/RateLimiter.h"
 #include "client/TransferHandle.h"
 #include "client/Utils.h"
 #include "configure/Default.h"
@@ -44,7 +47,10 @@ namespace QS {
 
 namespace Client {
 
+using QS::Client::RequestPriority;
+using QS::Client::ScopedRequestPriority;
 using QS::Client::Utils::BuildRequestRange;
+using QS::Threading::CancellationToken;
 using QS::Data::Buffer;
 using QS::Data::IOStream;
 using QS::Data::StreamBuf;
@@ -61,7 +67,8 @@ using std::vector;
 // --------------------------------------------------------------------------
 shared_ptr<TransferHandle> QSTransferManager::DownloadFile(
     const string &filePath, off_t offset, uint64_t size,
-    shared_ptr<iostream> bufStream, bool async) {
+    shared_ptr<iostream> bufStream, bool async,
+    shared_ptr<CancellationToken> cancelToken) {
   // Drive::ReadFile has checked the object existence, so no check here.
   // Drive::ReadFile has already ajust the download size, so no ajust here.
   if (!bufStream) {
@@ -73,6 +80,7 @@ shared_ptr<TransferHandle> QSTransferManager::DownloadFile(
   auto handle = std::make_shared<TransferHandle>(bucket, filePath, offset, size,
                                                  TransferDirection::Download);
   handle->SetDownloadStream(bufStream);
+  handle->SetCancellationToken(cancelToken);
 
   DoDownload(handle, async);
   return handle;
@@ -219,10 +227,13 @@ void QSTransferManager::DoSinglePartDownload(
     GetExecutor()->SubmitAsyncPrioritized(
         ReceivedHandler,
         [this, handle, part]() -> pair<ClientError<QSError>, string> {
+          ScopedRequestPriority priority(RequestPriority::Background);
           string eTag;
+          auto start = GetConcurrencyController()->Acquire();
           auto err = GetClient()->DownloadFile(
               handle->GetObjectKey(), handle->GetDownloadStream(),
               BuildRequestRange(part->GetRangeBegin(), part->GetSize()), &eTag);
+          ReleaseConcurrency(start, part->GetSize(), err);
           return {err, eTag};
         });
   } else {
@@ -292,6 +303,8 @@ void QSTransferManager::DoMultiPartDownload(
         if (!handle->HasPendingParts() && !handle->HasQueuedParts()) {
           if (!handle->HasFailedParts() && handle->DoneTransfer()) {
             handle->UpdateStatus(TransferStatus::Completed);
+          } else if (!handle->ShouldContinue()) {
+            handle->UpdateStatus(TransferStatus::Cancelled);
           } else {
             handle->UpdateStatus(TransferStatus::Failed);
           }
@@ -300,14 +313,23 @@ void QSTransferManager::DoMultiPartDownload(
 
       string objKey = handle->GetObjectKey();
       if (async) {
-        GetExecutor()->SubmitAsync(
-            ReceivedHandler,
-            [this, objKey, part]() -> pair<ClientError<QSError>, string> {
+        GetScheduler()->SubmitAsync(
+            objKey, ReceivedHandler,
+            [this, handle, objKey,
+             part]() -> pair<ClientError<QSError>, string> {
+              ScopedRequestPriority priority(RequestPriority::Background);
               string eTag;
+              // skip the part which is no longer wanted
+              if (!handle->ShouldContinue()) {
+                AddCancelledDownloadBytes(part->GetSize());
+                return {ClientError<QSError>(QSError::GOOD, false), eTag};
+              }
+              auto start = GetConcurrencyController()->Acquire();
               auto err = GetClient()->DownloadFile(
                   objKey, part->GetDownloadPartStream(),
                   BuildRequestRange(part->GetRangeBegin(), part->GetSize()),
                   &eTag);
+              ReleaseConcurrency(start, part->GetSize(), err);
               return {err, eTag};
             });
       } else {
@@ -326,6 +348,9 @@ void QSTransferManager::DoMultiPartDownload(
   for (; ipart != queuedParts.end(); ++ipart) {
     handle->ChangePartToFailed(ipart->second);
   }
+  if (!handle->ShouldContinue() && !handle->HasPendingParts()) {
+    handle->UpdateStatus(TransferStatus::Cancelled);
+  }
 }
 
 // --------------------------------------------------------------------------
@@ -472,7 +497,11 @@ void QSTransferManager::DoSinglePartUpload(
   if (async) {
     GetExecutor()->SubmitAsyncPrioritized(
         ReceivedHandler, [this, objKey, fileSize, stream]() {
-          return GetClient()->UploadFile(objKey, fileSize, stream);
+          ScopedRequestPriority priority(RequestPriority::Background);
+          auto start = GetConcurrencyController()->Acquire();
+          auto err = GetClient()->UploadFile(objKey, fileSize, stream);
+          ReleaseConcurrency(start, fileSize, err);
+          return err;
         });
   } else {
     auto err = GetClient()->UploadFile(objKey, fileSize, stream);
@@ -574,11 +603,15 @@ void QSTransferManager::DoMultiPartUpload(
       auto partId = part->GetPartId();
       auto partSize = part->GetSize();
       if (async) {
-        GetExecutor()->SubmitAsync(
-            ReceivedHandler,
+        GetScheduler()->SubmitAsync(
+            objKey, ReceivedHandler,
             [this, objKey, uploadId, partId, partSize, stream]() {
-              return GetClient()->UploadMultipart(objKey, uploadId, partId,
-                                                  partSize, stream);
+              ScopedRequestPriority priority(RequestPriority::Background);
+              auto start = GetConcurrencyController()->Acquire();
+              auto err = GetClient()->UploadMultipart(objKey, uploadId, partId,
+                                                      partSize, stream);
+              ReleaseConcurrency(start, partSize, err);
+              return err;
             });
 
       } else {
@@ -612,5 +645,14 @@ void QSTransferManager::DoUpload(const shared_ptr<TransferHandle> &handle,
   }
 }
 
+// --------------------------------------------------------------------------
+void QSTransferManager::ReleaseConcurrency(
+    ConcurrencyController::TimePoint start, uint64_t bytes,
+    const ClientError<QSError> &err) {
+  bool success = IsGoodQSError(err);
+  GetConcurrencyController()->Release(start, success ? bytes : 0,
+                                      IsThrottlingQSError(err));
+}
+
 }  // namespace Client
 }  // namespace QS
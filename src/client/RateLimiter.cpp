@@ -0,0 +1,178 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#include "client/RateLimiter.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <mutex>  // NOLINT
+#include <string>
+
+namespace QS {
+
+namespace Client {
+
+using std::chrono::duration;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+using std::lock_guard;
+using std::mutex;
+using std::string;
+using std::to_string;
+using std::unique_lock;
+
+namespace {
+
+thread_local RequestPriority threadPriority = RequestPriority::Foreground;
+
+}  // namespace
+
+// --------------------------------------------------------------------------
+TokenBucket::TokenBucket(uint64_t rate, uint64_t burst)
+    : m_rate(rate),
+      m_burst(burst > 0 ? burst : rate),
+      m_tokens(static_cast<double>(m_burst)),
+      m_lastRefill(steady_clock::now()),
+      m_foregroundWaiters(0),
+      m_acquiredCount(0),
+      m_foregroundWaitCount(0),
+      m_backgroundWaitCount(0),
+      m_waitTimeInMs(0) {}
+
+// --------------------------------------------------------------------------
+void TokenBucket::Acquire(uint64_t tokens, RequestPriority priority) {
+  if (IsUnlimited()) {
+    m_acquiredCount += tokens;
+    return;
+  }
+
+  bool foreground = priority == RequestPriority::Foreground;
+  // the tokens the bucket should hold before granting
+  double threshold =
+      foreground ? 0 : static_cast<double>(std::min(tokens, m_burst));
+  unique_lock<mutex> lock(m_mutex);
+  if (foreground) {
+    ++m_foregroundWaiters;
+  }
+  auto start = steady_clock::now();
+  bool waited = false;
+  while (true) {
+    RefillNoLock(steady_clock::now());
+    if (m_tokens >= threshold && (foreground || m_foregroundWaiters == 0)) {
+      break;
+    }
+    waited = true;
+    // wait until the deficit is refilled, or be woken up when a foreground
+    // acquisition finishes
+    double deficit = std::max(threshold - m_tokens, 1.0);
+    auto waitTime = microseconds(
+        static_cast<int64_t>(deficit * 1000000 / m_rate) + 1);
+    m_cond.wait_for(lock, waitTime);
+  }
+  m_tokens -= static_cast<double>(tokens);
+  if (foreground) {
+    --m_foregroundWaiters;
+  }
+  lock.unlock();
+
+  m_acquiredCount += tokens;
+  if (waited) {
+    if (foreground) {
+      ++m_foregroundWaitCount;
+      m_cond.notify_all();
+    } else {
+      ++m_backgroundWaitCount;
+    }
+    m_waitTimeInMs +=
+        duration_cast<milliseconds>(steady_clock::now() - start).count();
+  }
+}
+
+// --------------------------------------------------------------------------
+uint64_t TokenBucket::GetWaitCount(RequestPriority priority) const {
+  return priority == RequestPriority::Foreground
+             ? m_foregroundWaitCount.load()
+             : m_backgroundWaitCount.load();
+}
+
+// --------------------------------------------------------------------------
+string TokenBucket::ToString() const {
+  return "[rate:burst=" + to_string(m_rate) + ":" + to_string(m_burst) +
+         ", acquired=" + to_string(m_acquiredCount.load()) +
+         ", waits(foreground:background)=" +
+         to_string(m_foregroundWaitCount.load()) + ":" +
+         to_string(m_backgroundWaitCount.load()) +
+         ", wait time(ms)=" + to_string(m_waitTimeInMs.load()) + "]";
+}
+
+// --------------------------------------------------------------------------
+void TokenBucket::RefillNoLock(steady_clock::time_point now) {
+  if (now <= m_lastRefill) {
+    return;
+  }
+  double elapsed = duration<double>(now - m_lastRefill).count();
+  m_tokens = std::min(m_tokens + elapsed * static_cast<double>(m_rate),
+                      static_cast<double>(m_burst));
+  m_lastRefill = now;
+}
+
+// --------------------------------------------------------------------------
+RateLimiter::RateLimiter(uint64_t downloadBytesPerSec,
+                         uint64_t uploadBytesPerSec, uint64_t requestsPerSec)
+    : m_download(downloadBytesPerSec),
+      m_upload(uploadBytesPerSec),
+      m_request(requestsPerSec) {}
+
+// --------------------------------------------------------------------------
+void RateLimiter::AcquireRequest() {
+  m_request.Acquire(1, GetThreadPriority());
+}
+
+// --------------------------------------------------------------------------
+void RateLimiter::AcquireDownload(uint64_t bytes) {
+  m_download.Acquire(bytes, GetThreadPriority());
+}
+
+// --------------------------------------------------------------------------
+void RateLimiter::AcquireUpload(uint64_t bytes) {
+  m_upload.Acquire(bytes, GetThreadPriority());
+}
+
+// --------------------------------------------------------------------------
+string RateLimiter::ToString() const {
+  return "[download " + m_download.ToString() + ", upload " +
+         m_upload.ToString() + ", request " + m_request.ToString() + "]";
+}
+
+// --------------------------------------------------------------------------
+RequestPriority RateLimiter::GetThreadPriority() { return threadPriority; }
+
+// --------------------------------------------------------------------------
+ScopedRequestPriority::ScopedRequestPriority(RequestPriority priority)
+    : m_previous(threadPriority) {
+  threadPriority = priority;
+}
+
+// --------------------------------------------------------------------------
+ScopedRequestPriority::~ScopedRequestPriority() {
+  threadPriority = m_previous;
+}
+
+}  // namespace Client
+}  // namespace QS
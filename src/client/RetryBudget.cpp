@@ -0,0 +1,93 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#include "client/RetryBudget.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+
+namespace QS {
+
+namespace Client {
+
+using std::chrono::duration;
+using std::chrono::steady_clock;
+using std::lock_guard;
+using std::mutex;
+using std::shared_ptr;
+using std::string;
+using std::to_string;
+
+namespace {
+
+const unsigned kDefaultCapacity = 100;
+const unsigned kDefaultRefillPerSec = 10;
+
+}  // namespace
+
+// --------------------------------------------------------------------------
+RetryBudget::RetryBudget(unsigned capacity, unsigned refillPerSec)
+    : m_capacity(capacity),
+      m_refillPerSec(refillPerSec),
+      m_tokens(capacity),
+      m_lastRefill(steady_clock::now()),
+      m_acquiredCount(0),
+      m_rejectedCount(0) {}
+
+// --------------------------------------------------------------------------
+bool RetryBudget::TryAcquire() {
+  if (IsUnlimited()) {
+    ++m_acquiredCount;
+    return true;
+  }
+  {
+    lock_guard<mutex> lock(m_mutex);
+    auto now = steady_clock::now();
+    double elapsedSec = duration<double>(now - m_lastRefill).count();
+    m_lastRefill = now;
+    m_tokens = std::min(static_cast<double>(m_capacity),
+                        m_tokens + elapsedSec * m_refillPerSec);
+    if (m_tokens >= 1) {
+      m_tokens -= 1;
+      ++m_acquiredCount;
+      return true;
+    }
+  }
+  ++m_rejectedCount;
+  return false;
+}
+
+// --------------------------------------------------------------------------
+string RetryBudget::ToString() const {
+  return "[capacity=" + to_string(m_capacity) +
+         ", refill(/s)=" + to_string(m_refillPerSec) +
+         ", acquired:rejected=" + to_string(GetAcquiredCount()) + ":" +
+         to_string(GetRejectedCount()) + "]";
+}
+
+// --------------------------------------------------------------------------
+const shared_ptr<RetryBudget> &GetDefaultRetryBudget() {
+  static shared_ptr<RetryBudget> budget =
+      std::make_shared<RetryBudget>(kDefaultCapacity, kDefaultRefillPerSec);
+  return budget;
+}
+
+}  // namespace Client
+}  // namespace QS
@@ -14,8 +14,14 @@
 // | limitations under the License.
 // +-------------------------------------------------------------------------
 
+
 #include "client/RetryStrategy.h"
 
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <utility>
+
 #include "configure/Default.h"
 #include "configure/Options.h"
 
@@ -23,25 +29,84 @@ namespace QS {
 
 namespace Client {
 
+using std::shared_ptr;
+
+namespace {
+
+// Return a random number in [low, high]
+uint32_t RandomBetween(uint32_t low, uint32_t high) {
+  static thread_local std::mt19937 engine{std::random_device{}()};
+  std::uniform_int_distribution<uint32_t> distribution(low, high);
+  return distribution(engine);
+}
+
+}  // namespace
+
+// --------------------------------------------------------------------------
+RetryErrorClass ClassifyRetryError(const ClientError<QSError> &error) {
+  if (!error.ShouldRetry()) {
+    return RetryErrorClass::NonRetryable;
+  }
+  switch (error.GetError()) {
+    case QSError::SERVICE_UNAVAILABLE:  // TooManyRequests(429) mapped to it
+      return RetryErrorClass::Throttle;
+    case QSError::REQUEST_EXPIRED:
+    case QSError::NETWORK_CONNECTION:
+      return RetryErrorClass::Timeout;
+    default:
+      return RetryErrorClass::ServerError;
+  }
+}
+
+// --------------------------------------------------------------------------
+RetryStrategy::RetryStrategy(unsigned maxRetryTimes, unsigned scaleFactor,
+                             shared_ptr<RetryBudget> budget)
+    : m_budget(std::move(budget)) {
+  // back off most for throttling, and least for timeout as the request has
+  // waited long enough already
+  SetPolicy(RetryErrorClass::Throttle,
+            {maxRetryTimes, 4 * scaleFactor, 800 * scaleFactor});
+  SetPolicy(RetryErrorClass::Timeout,
+            {maxRetryTimes, scaleFactor, 40 * scaleFactor});
+  SetPolicy(RetryErrorClass::ServerError,
+            {maxRetryTimes, 2 * scaleFactor, 200 * scaleFactor});
+  SetPolicy(RetryErrorClass::NonRetryable, {0, 0, 0});
+}
+
+// --------------------------------------------------------------------------
 bool RetryStrategy::ShouldRetry(const ClientError<QSError> &error,
                                 unsigned attemptedRetryTimes) const {
-  return attemptedRetryTimes >= m_maxRetryTimes ? false : error.ShouldRetry();
+  const auto &policy = GetPolicy(ClassifyRetryError(error));
+  if (attemptedRetryTimes >= policy.maxRetryTimes) {
+    return false;
+  }
+  return m_budget ? m_budget->TryAcquire() : true;
 }
 
+// --------------------------------------------------------------------------
 uint32_t RetryStrategy::CalculateDelayBeforeNextRetry(
-    const ClientError<QSError> &error, unsigned attemptedRetryTimes) const {
-  return attemptedRetryTimes == 0 ? 0
-                                  : (1 << attemptedRetryTimes) * m_scaleFactor;
+    const ClientError<QSError> &error, unsigned attemptedRetryTimes,
+    uint32_t lastDelayInMs) const {
+  const auto &policy = GetPolicy(ClassifyRetryError(error));
+  uint32_t low = policy.baseDelayInMs;
+  uint32_t high = std::max(low, lastDelayInMs) * 3;
+  if (high == 0) {
+    return 0;
+  }
+  return std::min(RandomBetween(low, high), policy.maxDelayInMs);
 }
 
+// --------------------------------------------------------------------------
 RetryStrategy GetDefaultRetryStrategy() {
   return RetryStrategy(QS::Configure::Default::GetDefaultMaxRetries(),
-                       Retry::DefaultScaleFactor);
+                       Retry::DefaultScaleFactor, GetDefaultRetryBudget());
 }
 
+// --------------------------------------------------------------------------
 RetryStrategy GetCustomRetryStrategy() {
   const auto &options = QS::Configure::Options::Instance();
-  return RetryStrategy(options.GetRetries(), Retry::DefaultScaleFactor);
+  return RetryStrategy(options.GetRetries(), Retry::DefaultScaleFactor,
+                       GetDefaultRetryBudget());
 }
 
 }  // namespace Client
@@ -18,6 +18,7 @@
 
 #include <assert.h>
 
+#include <algorithm>
 #include <cmath>
 #include <memory>
 #include <mutex>  // NOLINT
@@ -25,9 +26,12 @@
 #include <vector>
 
 #include "base/LogMacros.h"
+#include "base/RoundRobinScheduler.h"
 #include "base/ThreadPool.h"
 #include "base/ThreadPoolInitializer.h"
+#include "client/ConcurrencyController.h"
 #include "client/NullClient.h"
+#include "data/ByteBudget.h"
 #include "data/ResourceManager.h"
 #include "data/Size.h"
 
@@ -35,8 +39,10 @@ namespace QS {
 
 namespace Client {
 
+using QS::Data::ByteBudget;
 using QS::Data::Resource;
 using QS::Data::ResourceManager;
+using QS::Threading::RoundRobinScheduler;
 using QS::Threading::ThreadPool;
 using std::make_shared;
 using std::unique_ptr;
@@ -46,14 +52,28 @@ std::once_flag initOnceFlag;
 
 // --------------------------------------------------------------------------
 TransferManager::TransferManager(const TransferManagerConfigure &config)
-    : m_configure(config), m_client(make_shared<NullClient>()) {
+    : m_configure(config),
+      // the foreground reads over-commit up to the same size again
+      m_downloadBudget(new ByteBudget(config.m_maxDownloadInFlightSize,
+                                      config.m_maxDownloadInFlightSize)),
+      m_cancelledDownloadBytes(0),
+      m_allocatedBufferCount(0),
+      m_client(make_shared<NullClient>()) {
   if (GetBufferCount() > 0) {
     m_bufferManager = unique_ptr<ResourceManager>(new ResourceManager);
   }
+  // the parallel transfers grow up to the buffer count
+  size_t maxConcurrency = std::max(GetBufferCount(), GetMaxParallelTransfers());
+  m_concurrencyController =
+      unique_ptr<ConcurrencyController>(new ConcurrencyController(
+          1, maxConcurrency, GetMaxParallelTransfers()));
+  m_concurrencyController->SetLimitIncreasedHandler(
+      [this](size_t limit) { GrowBuffers(limit); });
   if (GetMaxParallelTransfers() > 0) {
-    m_executor =
-        unique_ptr<ThreadPool>(new ThreadPool(config.m_maxParallelTransfers));
+    m_executor = unique_ptr<ThreadPool>(new ThreadPool(maxConcurrency));
     QS::Threading::ThreadPoolInitializer::Instance().Register(m_executor.get());
+    m_scheduler = unique_ptr<RoundRobinScheduler>(
+        new RoundRobinScheduler(m_executor.get()));
   }
 }
 
@@ -62,7 +82,13 @@ TransferManager::~TransferManager() {
   if (!m_bufferManager) {
     return;
   }
-  for (auto &resource : m_bufferManager->ShutdownAndWait(GetBufferCount())) {
+  size_t allocatedBufferCount = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_bufferAllocationLock);
+    allocatedBufferCount = m_allocatedBufferCount;
+  }
+  for (auto &resource :
+       m_bufferManager->ShutdownAndWait(allocatedBufferCount)) {
     if (resource) {
       resource.reset();
     }
@@ -95,8 +121,18 @@ void TransferManager::InitializeResources() {
     DebugError("Buffer Manager is null");
     return;
   }
-  for (uint64_t i = 0; i < GetBufferMaxHeapSize(); i += GetBufferSize()) {
-    m_bufferManager->PutResource(Resource(new vector<char>(GetBufferSize())));
+  GrowBuffers(m_concurrencyController->GetLimit());
+}
+
+// --------------------------------------------------------------------------
+void TransferManager::GrowBuffers(size_t count) {
+  if (!m_bufferManager) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(m_bufferAllocationLock);
+  count = std::min(count, GetBufferCount());
+  for (; m_allocatedBufferCount < count; ++m_allocatedBufferCount) {
+    m_bufferManager->Release(Resource(new vector<char>(GetBufferSize())));
   }
 }
 
@@ -137,6 +137,26 @@ uint64_t GetDefaultTransferBufSize() {
   return QS::Data::Size::MB10;
 }
 
+uint64_t GetDefaultMaxDownloadInFlightSize() { return QS::Data::Size::MB100; }
+
+uint32_t GetDefaultDownloadRateLimitInKB() { return 0; }
+
+uint32_t GetDefaultUploadRateLimitInKB() { return 0; }
+
+uint32_t GetDefaultRequestRateLimit() { return 0; }
+
+uint32_t GetDefaultHedgePercent() { return 0; }
+
+uint32_t GetDefaultNegativeTTLInSec() { return 10; }
+
+uint32_t GetDefaultMaxStaleInMin() { return 0; }
+
+uint32_t GetDefaultWarmUpListings() { return 0; }
+
+uint32_t GetDefaultTimeoutFloorInMs() { return 1000; }
+
+uint32_t GetDefaultTimeoutCeilingInMs() { return 600000; }  // 10 minutes
+
 uint64_t GetUploadMultipartMinPartSize() {
   // qs qingstor sepcific
   return QS::Data::Size::MB4;
@@ -39,6 +39,16 @@ using QS::Configure::Default::GetDefaultHostName;
 using QS::Configure::Default::GetDefaultMaxRetries;
 using QS::Configure::Default::GetDefaultPort;
 using QS::Configure::Default::GetDefaultProtocolName;
+using QS::Configure::Default::GetDefaultMaxDownloadInFlightSize;
+using QS::Configure::Default::GetDefaultDownloadRateLimitInKB;
+using QS::Configure::Default::GetDefaultUploadRateLimitInKB;
+using QS::Configure::Default::GetDefaultRequestRateLimit;
+using QS::Configure::Default::GetDefaultHedgePercent;
+using QS::Configure::Default::GetDefaultNegativeTTLInSec;
+using QS::Configure::Default::GetDefaultMaxStaleInMin;
+using QS::Configure::Default::GetDefaultWarmUpListings;
+using QS::Configure::Default::GetDefaultTimeoutFloorInMs;
+using QS::Configure::Default::GetDefaultTimeoutCeilingInMs;
 using QS::Configure::Default::GetDefaultParallelTransfers;
 using QS::Configure::Default::GetDefaultTransferBufSize;
 using QS::Configure::Default::GetDefaultZone;
@@ -74,9 +84,21 @@ Options::Options()
       m_maxStatCountInK(GetMaxStatCount() / QS::Data::Size::K1),
       m_maxListCount(GetMaxListObjectsCount()),
       m_statExpireInMin(-1),  // default disable state expire
+      m_negativeTTLInSec(GetDefaultNegativeTTLInSec()),
+      m_maxStaleInMin(GetDefaultMaxStaleInMin()),
+      m_snapshotFile(),
+      m_warmUpListings(GetDefaultWarmUpListings()),
       m_parallelTransfers(GetDefaultParallelTransfers()),
       m_transferBufferSizeInMB(GetDefaultTransferBufSize() /
                                QS::Data::Size::MB1),
+      m_maxDownloadInFlightSizeInMB(GetDefaultMaxDownloadInFlightSize() /
+                                    QS::Data::Size::MB1),
+      m_downloadRateLimitInKB(GetDefaultDownloadRateLimitInKB()),
+      m_uploadRateLimitInKB(GetDefaultUploadRateLimitInKB()),
+      m_requestRateLimit(GetDefaultRequestRateLimit()),
+      m_hedgePercent(GetDefaultHedgePercent()),
+      m_timeoutFloorInMs(GetDefaultTimeoutFloorInMs()),
+      m_timeoutCeilingInMs(GetDefaultTimeoutCeilingInMs()),
       m_clientPoolSize(GetClientDefaultPoolSize()),
       m_host(GetDefaultHostName()),
       m_protocol(GetDefaultProtocolName()),
@@ -118,8 +140,19 @@ ostream &operator<<(ostream &os, const Options &opts) {
          << "[max stat(K): " << to_string(opts.m_maxStatCountInK) << "] "
          << "[max list: " << to_string(opts.m_maxListCount) << "] "
          << "[stat expire(min): " << to_string(opts.m_statExpireInMin) << "] "
+         << "[negative ttl(s): " << to_string(opts.m_negativeTTLInSec) << "] "
+         << "[max stale(min): " << to_string(opts.m_maxStaleInMin) << "] "
+         << "[snapshot file: " << opts.m_snapshotFile << "] "
+         << "[warm-up listings: " << to_string(opts.m_warmUpListings) << "] "
          << "[num transfers: " << to_string(opts.m_parallelTransfers) << "] "
          << "[transfer buf(MB): " << to_string(opts.m_transferBufferSizeInMB) <<"] "  // NOLINT
+         << "[max download(MB): " << to_string(opts.m_maxDownloadInFlightSizeInMB) << "] "  // NOLINT
+         << "[download rate(KB/s): " << to_string(opts.m_downloadRateLimitInKB) << "] "  // NOLINT
+         << "[upload rate(KB/s): " << to_string(opts.m_uploadRateLimitInKB) << "] "  // NOLINT
+         << "[request rate(/s): " << to_string(opts.m_requestRateLimit) << "] "
+         << "[hedge percent: " << to_string(opts.m_hedgePercent) << "] "
+         << "[min timeout(ms): " << to_string(opts.m_timeoutFloorInMs) << "] "
+         << "[max timeout(ms): " << to_string(opts.m_timeoutCeilingInMs) << "] "  // NOLINT
          << "[pool size: " << to_string(opts.m_clientPoolSize) << "] "
          << "[host: " << opts.m_host << "] "
          << "[protocol: " << opts.m_protocol << "] "
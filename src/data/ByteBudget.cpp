@@ -0,0 +1,187 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#include "data/ByteBudget.h"
+
+#include <assert.h>
+
+#include <mutex>  // NOLINT
+#include <string>
+
+#include "base/LogMacros.h"
+
+namespace QS {
+
+namespace Data {
+
+using std::lock_guard;
+using std::mutex;
+using std::string;
+using std::to_string;
+using std::unique_lock;
+
+// --------------------------------------------------------------------------
+ByteBudget::ByteBudget(uint64_t maxBytes, uint64_t maxForcedBytes)
+    : m_maxBytes(maxBytes),
+      m_bytesInUse(0),
+      m_peakBytesInUse(0),
+      m_maxForcedBytes(maxForcedBytes),
+      m_forcedBytesInUse(0),
+      m_peakForcedBytesInUse(0),
+      m_waitCount(0),
+      m_rejectCount(0),
+      m_forcedWaitCount(0) {}
+
+// --------------------------------------------------------------------------
+void ByteBudget::Acquire(uint64_t bytes) {
+  unique_lock<mutex> lock(m_mutex);
+  if (!HasRoomNoLock(bytes)) {
+    ++m_waitCount;
+    m_released.wait(lock, [this, bytes] { return HasRoomNoLock(bytes); });
+  }
+  AcquireNoLock(bytes);
+}
+
+// --------------------------------------------------------------------------
+bool ByteBudget::TryAcquire(uint64_t bytes) {
+  lock_guard<mutex> lock(m_mutex);
+  if (!HasRoomNoLock(bytes)) {
+    ++m_rejectCount;
+    return false;
+  }
+  AcquireNoLock(bytes);
+  return true;
+}
+
+// --------------------------------------------------------------------------
+void ByteBudget::ForceAcquire(uint64_t bytes, bool capped) {
+  unique_lock<mutex> lock(m_mutex);
+  // only wait for the forced holders, as they never wait for the others
+  if (capped && !HasForcedRoomNoLock(bytes)) {
+    ++m_forcedWaitCount;
+    m_released.wait(lock,
+                    [this, bytes] { return HasForcedRoomNoLock(bytes); });
+  }
+  AcquireNoLock(bytes);
+  m_forcedBytesInUse += bytes;
+  if (m_forcedBytesInUse > m_peakForcedBytesInUse) {
+    m_peakForcedBytesInUse = m_forcedBytesInUse;
+  }
+}
+
+// --------------------------------------------------------------------------
+void ByteBudget::Release(uint64_t bytes) {
+  unique_lock<mutex> lock(m_mutex);
+  ReleaseNoLock(bytes);
+  lock.unlock();
+  m_released.notify_all();
+}
+
+// --------------------------------------------------------------------------
+void ByteBudget::ReleaseForced(uint64_t bytes) {
+  unique_lock<mutex> lock(m_mutex);
+  assert(bytes <= m_forcedBytesInUse);
+  DebugErrorIf(bytes > m_forcedBytesInUse,
+               "Try to release " + to_string(bytes) +
+                   " forced bytes while only " +
+                   to_string(m_forcedBytesInUse) + " bytes are in use");
+  m_forcedBytesInUse =
+      bytes > m_forcedBytesInUse ? 0 : m_forcedBytesInUse - bytes;
+  ReleaseNoLock(bytes);
+  lock.unlock();
+  m_released.notify_all();
+}
+
+// --------------------------------------------------------------------------
+uint64_t ByteBudget::GetBytesInUse() const {
+  lock_guard<mutex> lock(m_mutex);
+  return m_bytesInUse;
+}
+
+// --------------------------------------------------------------------------
+uint64_t ByteBudget::GetPeakBytesInUse() const {
+  lock_guard<mutex> lock(m_mutex);
+  return m_peakBytesInUse;
+}
+
+// --------------------------------------------------------------------------
+uint64_t ByteBudget::GetForcedBytesInUse() const {
+  lock_guard<mutex> lock(m_mutex);
+  return m_forcedBytesInUse;
+}
+
+// --------------------------------------------------------------------------
+uint64_t ByteBudget::GetPeakForcedBytesInUse() const {
+  lock_guard<mutex> lock(m_mutex);
+  return m_peakForcedBytesInUse;
+}
+
+// --------------------------------------------------------------------------
+string ByteBudget::ToString() const {
+  lock_guard<mutex> lock(m_mutex);
+  return "[max:inuse:peak=" + to_string(m_maxBytes) + ":" +
+         to_string(m_bytesInUse) + ":" + to_string(m_peakBytesInUse) +
+         ", waits:rejects=" + to_string(m_waitCount.load()) + ":" +
+         to_string(m_rejectCount.load()) +
+         ", forced max:inuse:peak:waits=" + to_string(m_maxForcedBytes) + ":" +
+         to_string(m_forcedBytesInUse) + ":" +
+         to_string(m_peakForcedBytesInUse) + ":" +
+         to_string(m_forcedWaitCount.load()) + "]";
+}
+
+// --------------------------------------------------------------------------
+bool ByteBudget::HasRoomNoLock(uint64_t bytes) const {
+  // an oversize acquisition is granted once the budget is totally free
+  return m_bytesInUse == 0 || m_bytesInUse + bytes <= m_maxBytes;
+}
+
+// --------------------------------------------------------------------------
+bool ByteBudget::HasForcedRoomNoLock(uint64_t bytes) const {
+  return m_maxForcedBytes == 0 || m_forcedBytesInUse == 0 ||
+         m_forcedBytesInUse + bytes <= m_maxForcedBytes;
+}
+
+// --------------------------------------------------------------------------
+void ByteBudget::AcquireNoLock(uint64_t bytes) {
+  m_bytesInUse += bytes;
+  if (m_bytesInUse > m_peakBytesInUse) {
+    m_peakBytesInUse = m_bytesInUse;
+  }
+}
+
+// --------------------------------------------------------------------------
+void ByteBudget::ReleaseNoLock(uint64_t bytes) {
+  assert(bytes <= m_bytesInUse);
+  DebugErrorIf(bytes > m_bytesInUse,
+               "Try to release " + to_string(bytes) + " bytes while only " +
+                   to_string(m_bytesInUse) + " bytes are in use");
+  m_bytesInUse = bytes > m_bytesInUse ? 0 : m_bytesInUse - bytes;
+}
+
+// --------------------------------------------------------------------------
+ScopedForcedBytes::ScopedForcedBytes(ByteBudget *budget, uint64_t bytes,
+                                     bool capped)
+    : m_budget(budget), m_bytes(bytes) {
+  assert(m_budget != nullptr);
+  m_budget->ForceAcquire(m_bytes, capped);
+}
+
+// --------------------------------------------------------------------------
+ScopedForcedBytes::~ScopedForcedBytes() { m_budget->ReleaseForced(m_bytes); }
+
+}  // namespace Data
+}  // namespace QS
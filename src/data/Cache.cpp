@@ -41,6 +41,7 @@ namespace Data {
 using QS::Data::StreamUtils::GetStreamSize;
 using QS::StringUtils::FormatPath;
 using QS::StringUtils::PointerAddress;
+using QS::Threading::CancellationToken;
 using QS::TimeUtils::SecondsToRFC822GMT;
 using QS::Utils::CreateDirectoryIfNotExists;
 using QS::Utils::GetBaseName;
@@ -499,6 +500,23 @@ void Cache::Rename(const string &oldFileId, const string &newFileId) {
   }
 }
 
+// --------------------------------------------------------------------------
+void Cache::RenameDirectory(const string &oldDirPath,
+                            const string &newDirPath) {
+  if (oldDirPath.empty() || oldDirPath == newDirPath) {
+    return;
+  }
+  vector<string> fileIds;
+  for (auto &pair : m_map) {
+    if (pair.first.compare(0, oldDirPath.size(), oldDirPath) == 0) {
+      fileIds.push_back(pair.first);
+    }
+  }
+  for (auto &fileId : fileIds) {
+    Rename(fileId, newDirPath + fileId.substr(oldDirPath.size()));
+  }
+}
+
 // --------------------------------------------------------------------------
 void Cache::SetTime(const string &fileId, time_t mtime) {
   auto it = m_map.find(fileId);
@@ -553,6 +571,31 @@ void Cache::Resize(const string &fileId, size_t newFileSize, time_t mtime) {
   }
 }
 
+// --------------------------------------------------------------------------
+shared_ptr<CancellationToken> Cache::GetCancellationToken(const string &fileId,
+                                                          time_t mtime) {
+  auto it = m_map.find(fileId);
+  if (it != m_map.end()) {
+    return it->second->second->GetCancellationToken();
+  }
+  auto pos = UnguardedNewEmptyFile(fileId, mtime);
+  if (pos != m_cache.end()) {
+    return pos->second->GetCancellationToken();
+  }
+  // should not go here, return a cancelled token to stop any download
+  auto token = make_shared<CancellationToken>();
+  token->Cancel();
+  return token;
+}
+
+// --------------------------------------------------------------------------
+void Cache::CancelDownloads(const string &fileId) {
+  auto it = m_map.find(fileId);
+  if (it != m_map.end()) {
+    it->second->second->CancelDownloads();
+  }
+}
+
 // --------------------------------------------------------------------------
 CacheListIterator Cache::UnguardedNewEmptyFile(const string &fileId,
                                                time_t mtime) {
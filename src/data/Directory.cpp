@@ -17,12 +17,15 @@
 #include "data/Directory.h"
 
 #include <cassert>
+#include <cstdio>
+#include <cstring>
 
 #include <algorithm>
 #include <deque>
+#include <fstream>
 #include <iterator>
 #include <memory>
-#include <queue>
+#include <mutex>  // NOLINT
 #include <set>
 #include <string>
 #include <utility>
@@ -32,21 +35,26 @@
 #include "base/StringUtils.h"
 #include "base/Utils.h"
 #include "data/FileMetaDataManager.h"
+#include "data/SlabAllocator.h"
 
 namespace QS {
 
 namespace Data {
 
 using QS::StringUtils::FormatPath;
+using QS::Threading::SharedLock;
+using QS::Threading::SharedMutex;
 using QS::Utils::AppendPathDelim;
+using QS::Utils::GetBaseName;
+using QS::Utils::GetDirName;
 using QS::Utils::IsRootDirectory;
 using std::deque;
 using std::lock_guard;
 using std::make_shared;
-using std::queue;
-using std::recursive_mutex;
+using std::pair;
 using std::set;
 using std::string;
+using std::to_string;
 using std::shared_ptr;
 using std::unique_ptr;
 using std::vector;
@@ -54,6 +62,64 @@ using std::weak_ptr;
 
 static const char *const ROOT_PATH = "/";
 
+namespace {
+
+// Return the name of a file relative to its parent, which is the base name
+// ending with '/' for a directory, e.g. "/a/b/" -> "b/", "/a/c" -> "c"
+string GetNameOfPath(const string &path) {
+  if (path.size() <= 1) {
+    return path;
+  }
+  auto pos = path.find_last_of('/', path.size() - 2);
+  return pos == string::npos ? path : path.substr(pos + 1);
+}
+
+// Nodes are allocated from the slab pool together with the control blocks
+template <typename... Args>
+shared_ptr<Node> MakeNode(Args &&... args) {
+  return std::allocate_shared<Node>(SlabAllocator<Node>(),
+                                    std::forward<Args>(args)...);
+}
+
+// The snapshot is in host byte order, as it is only loaded by the same host
+const char kSnapshotMagic[] = "QSFSMETA";
+const size_t kSnapshotMagicSize = sizeof(kSnapshotMagic) - 1;
+const uint32_t kSnapshotVersion = 1;
+
+template <typename T>
+void AppendValue(string *buf, T value) {
+  buf->append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void AppendString(string *buf, const string &str) {
+  AppendValue(buf, static_cast<uint32_t>(str.size()));
+  buf->append(str);
+}
+
+// Read a value at the position and move it forward, return false if there
+// is not enough data
+template <typename T>
+bool ReadValue(const string &buf, size_t *pos, T *value) {
+  if (buf.size() - *pos < sizeof(T)) {
+    return false;
+  }
+  memcpy(value, buf.data() + *pos, sizeof(T));
+  *pos += sizeof(T);
+  return true;
+}
+
+bool ReadString(const string &buf, size_t *pos, string *str) {
+  uint32_t size = 0;
+  if (!ReadValue(buf, pos, &size) || buf.size() - *pos < size) {
+    return false;
+  }
+  str->assign(buf, *pos, size);
+  *pos += size;
+  return true;
+}
+
+}  // namespace
+
 // --------------------------------------------------------------------------
 Entry::Entry(const std::string &filePath, uint64_t fileSize, time_t atime,
              time_t mtime, uid_t uid, gid_t gid, mode_t fileMode,
@@ -72,6 +138,20 @@ Entry::Entry(std::shared_ptr<FileMetaData> &&fileMetaData)
   FileMetaDataManager::Instance().Add(std::move(fileMetaData));
 }
 
+// --------------------------------------------------------------------------
+EntrySnapshot Entry::GetSnapshot() const {
+  EntrySnapshot snapshot;
+  auto meta = m_metaData.lock();
+  if (meta && !meta->m_filePath.empty()) {
+    snapshot.operable = true;
+    snapshot.st = meta->ToStat();
+    snapshot.cachedTime = meta->m_cachedTime;
+    snapshot.needUpload = meta->m_needUpload;
+    snapshot.fileOpen = meta->m_fileOpen;
+  }
+  return snapshot;
+}
+
 // --------------------------------------------------------------------------
 void Entry::Rename(const std::string &newFilePath) {
   FileMetaDataManager::Instance().Rename(GetFilePath(), newFilePath);
@@ -80,7 +160,11 @@ void Entry::Rename(const std::string &newFilePath) {
 // --------------------------------------------------------------------------
 Node::Node(Entry &&entry, const shared_ptr<Node> &parent)
     : m_entry(std::move(entry)), m_parent(parent) {
-  m_children.clear();
+  if (m_entry) {
+    // a node not attached to a parent keeps the full path as its name
+    m_name = parent && *parent ? GetNameOfPath(m_entry.GetFilePath())
+                               : m_entry.GetFilePath();
+  }
 }
 
 // --------------------------------------------------------------------------
@@ -89,7 +173,7 @@ Node::Node(Entry &&entry, const shared_ptr<Node> &parent,
     : Node(std::move(entry), parent) {
   // must use m_entry instead of entry which is moved to m_entry now
   if (m_entry && m_entry.GetFileSize() <= symbolicLink.size()) {
-    m_symbolicLink = std::string(symbolicLink, 0, m_entry.GetFileSize());
+    SetSymbolicLink(std::string(symbolicLink, 0, m_entry.GetFileSize()));
   }
 }
 
@@ -97,9 +181,9 @@ Node::Node(Entry &&entry, const shared_ptr<Node> &parent,
 Node::~Node() {
   if (!m_entry) return;
 
-  if (IsDirectory() || IsHardLink()) {
+  if (IsDirectory()) {
     auto parent = m_parent.lock();
-    if (parent) {
+    if (parent && *parent) {
       parent->GetEntry().DecreaseNumLink();
     }
   }
@@ -107,34 +191,109 @@ Node::~Node() {
   GetEntry().DecreaseNumLink();
   if (m_entry.GetNumLink() <= 0 ||
       (m_entry.GetNumLink() <= 1 && m_entry.IsDirectory())) {
-    FileMetaDataManager::Instance().Erase(GetFilePath());
+    // erase by the path which the meta data is recorded with
+    FileMetaDataManager::Instance().Erase(m_entry.GetFilePath());
+  }
+}
+
+// --------------------------------------------------------------------------
+string Node::GetFilePath() const {
+  vector<shared_ptr<Node>> ancestors;
+  size_t len = m_name.size();
+  auto parent = m_parent.lock();
+  while (parent) {
+    len += parent->m_name.size();
+    ancestors.push_back(parent);
+    parent = parent->m_parent.lock();
   }
+
+  string path;
+  path.reserve(len);
+  for (auto it = ancestors.rbegin(); it != ancestors.rend(); ++it) {
+    path.append((*it)->m_name);
+  }
+  path.append(m_name);
+  return path;
 }
 
 // --------------------------------------------------------------------------
-shared_ptr<Node> Node::Find(const string &childFileName) const {
-  auto child = m_children.find(childFileName);
-  if (child != m_children.end()) {
-    return child->second;
+string Node::MyDirName() const {
+  auto parent = m_parent.lock();
+  if (parent && !parent->m_name.empty()) {
+    return parent->GetFilePath();
+  }
+  return m_entry ? m_entry.MyDirName() : string();
+}
+
+// --------------------------------------------------------------------------
+string Node::MyBaseName() const {
+  return m_name.empty() ? string() : GetBaseName(m_name);
+}
+
+// --------------------------------------------------------------------------
+ChildrenVector::const_iterator Node::LowerBound(
+    const string &childName) const {
+  auto less = [](const shared_ptr<Node> &child, const string &name) {
+    return child->GetName() < name;
+  };
+  return std::lower_bound(m_children.cbegin(), m_children.cend(), childName,
+                          less);
+}
+
+// --------------------------------------------------------------------------
+shared_ptr<Node> Node::Find(const string &childName) const {
+  auto it = LowerBound(childName);
+  if (it != m_children.end() && (*it)->GetName() == childName) {
+    return *it;
   }
   return shared_ptr<Node>(nullptr);
 }
 
 // --------------------------------------------------------------------------
-bool Node::HaveChild(const std::string &childFilePath) const {
-  return m_children.find(childFilePath) != m_children.end();
+shared_ptr<Node> Node::FindFileOrDirectory(const string &name) const {
+  auto it = LowerBound(name);
+  if (it == m_children.end()) {
+    return shared_ptr<Node>(nullptr);
+  }
+  if ((*it)->GetName() == name) {
+    return *it;
+  }
+
+  // compare with name + "/" without building it
+  auto size = name.size();
+  auto lessThanDir = [&name, size](const shared_ptr<Node> &child,
+                                   char delim) {
+    auto &childName = child->GetName();
+    int res = childName.compare(0, size, name);
+    if (res != 0) {
+      return res < 0;
+    }
+    return childName.size() == size ||
+           static_cast<unsigned char>(childName[size]) <
+               static_cast<unsigned char>(delim);
+  };
+  it = std::lower_bound(it, m_children.cend(), '/', lessThanDir);
+  if (it != m_children.end() && (*it)->GetName().size() == size + 1 &&
+      (*it)->GetName().back() == '/' &&
+      (*it)->GetName().compare(0, size, name) == 0) {
+    return *it;
+  }
+  return shared_ptr<Node>(nullptr);
 }
 
 // --------------------------------------------------------------------------
-const FilePathToNodeUnorderedMap &Node::GetChildren() const {
-  return m_children;
+bool Node::HaveChild(const std::string &childName) const {
+  return static_cast<bool>(Find(childName));
 }
 
+// --------------------------------------------------------------------------
+const ChildrenVector &Node::GetChildren() const { return m_children; }
+
 // --------------------------------------------------------------------------
 set<string> Node::GetChildrenIds() const {
   set<string> ids;
-  for (const auto &pair : m_children) {
-    ids.emplace(pair.first);
+  for (const auto &child : m_children) {
+    ids.emplace_hint(ids.end(), child->GetName());
   }
   return ids;
 }
@@ -144,9 +303,9 @@ deque<string> Node::GetChildrenIdsRecursively() const {
   deque<string> ids;
   deque<shared_ptr<Node>> childs;
 
-  for (const auto &pair : m_children) {
-    ids.emplace_back(pair.first);
-    childs.push_back(pair.second);
+  for (const auto &child : m_children) {
+    ids.emplace_back(child->GetFilePath());
+    childs.push_back(child);
   }
 
   while (!childs.empty()) {
@@ -154,9 +313,9 @@ deque<string> Node::GetChildrenIdsRecursively() const {
     childs.pop_front();
 
     if (child->IsDirectory()) {
-      for (const auto &pair : child->GetChildren()) {
-        ids.emplace_back(pair.first);
-        childs.push_back(pair.second);
+      for (const auto &grandchild : child->GetChildren()) {
+        ids.emplace_back(grandchild->GetFilePath());
+        childs.push_back(grandchild);
       }
     }
   }
@@ -168,8 +327,10 @@ deque<string> Node::GetChildrenIdsRecursively() const {
 shared_ptr<Node> Node::Insert(const shared_ptr<Node> &child) {
   assert(IsDirectory());
   if (child) {
-    auto res = m_children.emplace(child->GetFilePath(), child);
-    if (res.second) {
+    // children from listing come in order, so it's mostly an appending
+    auto it = LowerBound(child->GetName());
+    if (it == m_children.end() || (*it)->GetName() != child->GetName()) {
+      m_children.insert(it, child);
       if (child->IsDirectory()) {
         m_entry.IncreaseNumLink();
       }
@@ -186,152 +347,242 @@ shared_ptr<Node> Node::Insert(const shared_ptr<Node> &child) {
 // --------------------------------------------------------------------------
 void Node::Remove(const shared_ptr<Node> &child) {
   if (child) {
-    Remove(child->GetFilePath());
+    Remove(child->GetName());
   } else {
     DebugWarning("Try to remove null Node")
   }
 }
 
 // --------------------------------------------------------------------------
-void Node::Remove(const std::string &childFilePath) {
-  if (childFilePath.empty()) return;
+void Node::Remove(const std::string &childName) {
+  if (childName.empty()) return;
 
-  bool reset = m_children.size() == 1 ? true : false;
-  auto it = m_children.find(childFilePath);
-  if (it != m_children.end()) {
+  auto it = LowerBound(childName);
+  if (it != m_children.end() && (*it)->GetName() == childName) {
     m_children.erase(it);
-    if (reset) m_children.clear();
+    if (m_children.empty()) {
+      ChildrenVector().swap(m_children);  // release the capacity
+    }
   } else {
-    DebugWarning("Node not exist, no remove " + FormatPath(childFilePath));
+    DebugWarning("Node not exist, no remove " + FormatPath(childName));
   }
 }
 
 // --------------------------------------------------------------------------
-void Node::RenameChild(const string &oldFilePath, const string &newFilePath) {
-  if (oldFilePath == newFilePath) {
-    DebugInfo("Same file name, no rename " + FormatPath(oldFilePath));
+void Node::RenameChild(const string &oldName, const string &newName) {
+  if (oldName == newName) {
+    DebugInfo("Same file name, no rename " + FormatPath(oldName));
     return;
   }
 
-  if (m_children.find(newFilePath) != m_children.end()) {
+  if (HaveChild(newName)) {
     DebugWarning("Cannot rename, target node already exist " +
-                 FormatPath(oldFilePath, newFilePath));
+                 FormatPath(oldName, newName));
     return;
   }
 
-  auto it = m_children.find(oldFilePath);
-  if (it != m_children.end()) {
-    auto child = it->second;
-    child->Rename(newFilePath);
-
-    auto hint = m_children.erase(it);
-    m_children.emplace_hint(hint, newFilePath, child);
+  auto it = LowerBound(oldName);
+  if (it != m_children.end() && (*it)->GetName() == oldName) {
+    auto child = *it;
+    m_children.erase(it);
+    child->SetName(newName);
+    child->Rename(child->GetFilePath());
+    m_children.insert(LowerBound(newName), child);
   } else {
-    DebugWarning("Node not exist, no rename " + FormatPath(oldFilePath));
+    DebugWarning("Node not exist, no rename " + FormatPath(oldName));
   }
 }
 
 // --------------------------------------------------------------------------
 shared_ptr<Node> DirectoryTree::GetRoot() const {
-  lock_guard<recursive_mutex> lock(m_mutex);
+  SharedLock lock(m_mutex);
   return m_root;
 }
 
 // --------------------------------------------------------------------------
 // shared_ptr<Node> DirectoryTree::GetCurrentNode() const {
-//   lock_guard<recursive_mutex> lock(m_mutex);
+//   SharedLock lock(m_mutex);
 //   return m_currentNode;
 // }
 
 // --------------------------------------------------------------------------
 weak_ptr<Node> DirectoryTree::Find(const string &filePath) const {
-  lock_guard<recursive_mutex> lock(m_mutex);
-  auto it = m_map.find(filePath);
-  if (it != m_map.end()) {
-    return it->second;
-  } else {
-    // Too many info, so disable it
-    // DebugInfo("Node (" + filePath + ") is not existing in directory tree");
-    return weak_ptr<Node>();
-  }
+  SharedLock lock(m_mutex);
+  return FindNoLock(filePath);
 }
 
 // --------------------------------------------------------------------------
 bool DirectoryTree::Has(const std::string &filePath) const {
-  lock_guard<recursive_mutex> lock(m_mutex);
-  return m_map.find(filePath) != m_map.end();
+  SharedLock lock(m_mutex);
+  return static_cast<bool>(FindNoLock(filePath));
+}
+
+// --------------------------------------------------------------------------
+weak_ptr<Node> DirectoryTree::FindFileOrDirectory(const string &path) const {
+  SharedLock lock(m_mutex);
+  if (path.empty() || path.back() == '/') {
+    return FindNoLock(path);
+  }
+  auto pos = path.rfind('/');
+  if (pos == string::npos) {
+    return weak_ptr<Node>();
+  }
+  auto parent = FindNoLock(path.substr(0, pos + 1));
+  if (!parent) {
+    return weak_ptr<Node>();
+  }
+  return parent->FindFileOrDirectory(path.substr(pos + 1));
 }
 
 // --------------------------------------------------------------------------
 vector<weak_ptr<Node>> DirectoryTree::FindChildren(
     const string &dirName) const {
-  lock_guard<recursive_mutex> lock(m_mutex);
-  auto range = m_parentToChildrenMap.equal_range(dirName);
+  SharedLock lock(m_mutex);
   vector<weak_ptr<Node>> childs;
-  for (auto it = range.first; it != range.second; ++it) {
-    childs.emplace_back(it->second);
+  auto node = FindNoLock(dirName);
+  if (node) {
+    childs.assign(node->GetChildren().begin(), node->GetChildren().end());
   }
   return childs;
 }
 
 // --------------------------------------------------------------------------
-ChildrenMultiMapConstIterator DirectoryTree::CBeginParentToChildrenMap() const {
-  lock_guard<recursive_mutex> lock(m_mutex);
-  return m_parentToChildrenMap.cbegin();
+bool DirectoryTree::SaveSnapshot(const string &filePath) const {
+  // Encode the nodes within the lock, and write them out of it
+  string records;
+  uint64_t count = 0;
+  {
+    SharedLock lock(m_mutex);
+    // pre-order, so parents go first. The paths are built from the names, as
+    // the meta datas could be keyed by the paths before renaming.
+    vector<pair<shared_ptr<Node>, string>> nodes;
+    if (m_root) {
+      nodes.emplace_back(m_root, m_root->GetName());
+    }
+    while (!nodes.empty()) {
+      auto node = std::move(nodes.back().first);
+      auto path = std::move(nodes.back().second);
+      nodes.pop_back();
+      auto &children = node->GetChildren();
+      for (auto it = children.rbegin(); it != children.rend(); ++it) {
+        nodes.emplace_back(*it, path + (*it)->GetName());
+      }
+
+      auto meta = node->GetEntry().GetMetaData().lock();
+      if (!meta || path.empty() || meta->m_needUpload || node->IsHardLink()) {
+        continue;
+      }
+      AppendString(&records, path);
+      AppendValue(&records, static_cast<uint64_t>(meta->m_fileSize));
+      AppendValue(&records, static_cast<int64_t>(meta->m_mtime));
+      AppendValue(&records, static_cast<int64_t>(meta->m_cachedTime));
+      AppendValue(&records, static_cast<int64_t>(node->GetListedTime()));
+      AppendValue(&records, static_cast<uint64_t>(meta->m_dev));
+      AppendValue(&records, static_cast<uint32_t>(meta->m_uid));
+      AppendValue(&records, static_cast<uint32_t>(meta->m_gid));
+      AppendValue(&records, static_cast<uint32_t>(meta->m_fileMode));
+      AppendValue(&records, static_cast<uint8_t>(meta->m_fileType));
+      AppendValue(&records, static_cast<uint8_t>(meta->m_encrypted));
+      AppendString(&records, meta->GetMimeType());
+      AppendString(&records, meta->GetETag());
+      AppendString(&records, node->GetSymbolicLink());
+      ++count;
+    }
+  }
+
+  string header(kSnapshotMagic, kSnapshotMagicSize);
+  AppendValue(&header, kSnapshotVersion);
+  AppendValue(&header, count);
+
+  auto tmpPath = filePath + ".tmp";
+  std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+  out.write(header.data(), header.size());
+  out.write(records.data(), records.size());
+  out.close();
+  if (!out) {
+    DebugWarning("Fail to write snapshot " + FormatPath(tmpPath));
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  if (std::rename(tmpPath.c_str(), filePath.c_str()) != 0) {
+    DebugWarning("Fail to rename snapshot " + FormatPath(tmpPath, filePath));
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  DebugInfo("Save snapshot of " + to_string(count) + " nodes " +
+            FormatPath(filePath));
+  return true;
 }
 
 // --------------------------------------------------------------------------
-ChildrenMultiMapConstIterator DirectoryTree::CEndParentToChildrenMap() const {
-  lock_guard<recursive_mutex> lock(m_mutex);
-  return m_parentToChildrenMap.cend();
+shared_ptr<Node> DirectoryTree::Grow(shared_ptr<FileMetaData> &&fileMeta) {
+  lock_guard<SharedMutex> lock(m_mutex);
+  return GrowNoLock(std::move(fileMeta));
 }
 
 // --------------------------------------------------------------------------
-shared_ptr<Node> DirectoryTree::Grow(shared_ptr<FileMetaData> &&fileMeta) {
-  lock_guard<recursive_mutex> lock(m_mutex);
+void DirectoryTree::Grow(vector<shared_ptr<FileMetaData>> &&fileMetas) {
+  lock_guard<SharedMutex> lock(m_mutex);
+  for (auto &meta : fileMetas) {
+    GrowNoLock(std::move(meta));
+  }
+}
+
+// --------------------------------------------------------------------------
+shared_ptr<Node> DirectoryTree::FindNoLock(const string &filePath) const {
+  if (!m_root || filePath.empty() || filePath[0] != '/') {
+    return nullptr;
+  }
+
+  // walk down from root, the name of a dir component keeps the ending '/'
+  auto node = m_root;
+  size_t pos = 1;
+  while (node && pos < filePath.size()) {
+    auto end = filePath.find('/', pos);
+    end = end == string::npos ? filePath.size() : end + 1;
+    node = node->Find(filePath.substr(pos, end - pos));
+    pos = end;
+  }
+  // Too many info, so disable it
+  // DebugInfoIf(!node, "Node (" + filePath + ") is not existing in tree");
+  return node;
+}
+
+// --------------------------------------------------------------------------
+shared_ptr<Node> DirectoryTree::GrowNoLock(
+    shared_ptr<FileMetaData> &&fileMeta) {
   if (!fileMeta) return nullptr;
 
   string filePath = fileMeta->GetFilePath();
 
-  auto node = Find(filePath).lock();
-  if (node && *node) {
-    if (fileMeta->GetMTime() > node->GetMTime()) {
+  auto node = FindNoLock(filePath);
+  if (node) {
+    // the entry of the node could be released by the meta data manager
+    if (!*node || fileMeta->GetMTime() > node->GetMTime()) {
       DebugInfo("Update Node " + FormatPath(filePath));
       node->SetEntry(Entry(std::move(fileMeta)));  // update entry
     }
+  } else if (IsRootDirectory(filePath)) {
+    DebugInfo("Add root Node");
+    m_root = MakeNode(Entry(std::move(fileMeta)), nullptr);
+    node = m_root;
   } else {
-    DebugInfo("Add Node " + FormatPath(filePath));
-    bool isDir = fileMeta->IsDirectory();
     auto dirName = fileMeta->MyDirName();
-    node = make_shared<Node>(Entry(std::move(fileMeta)));
-    m_map.emplace(filePath, node);
-
-    // hook up with parent
     assert(!dirName.empty());
-    auto it = m_map.find(dirName);
-    if (it != m_map.end()) {
-      if (auto parent = it->second.lock()) {
-        parent->Insert(node);
-        node->SetParent(parent);
-      } else {
-        DebugInfo("Parent node not exist " + FormatPath(filePath));
-      }
-    }
-
-    // hook up with children
-    if (isDir) {
-      auto childs = FindChildren(filePath);
-      for (auto &child : childs) {
-        auto childNode = child.lock();
-        if (childNode) {
-          childNode->SetParent(node);
-          node->Insert(childNode);
-        }
+    auto parent = FindNoLock(dirName);
+    if (!(parent && *parent)) {
+      // Add the parent with default meta to keep the tree connected, it will
+      // be updated when the dir is stat or listed.
+      parent = GrowNoLock(BuildDefaultDirectoryMeta(dirName));
+      if (!parent) {
+        DebugWarning("Fail to add parent node " + FormatPath(filePath));
+        return nullptr;
       }
     }
 
-    // record parent to children map
-    m_parentToChildrenMap.emplace(dirName, node);
+    DebugInfo("Add Node " + FormatPath(filePath));
+    node = MakeNode(Entry(std::move(fileMeta)), parent);
+    parent->Insert(node);
   }
   // m_currentNode = node;
 
@@ -339,11 +590,114 @@ shared_ptr<Node> DirectoryTree::Grow(shared_ptr<FileMetaData> &&fileMeta) {
 }
 
 // --------------------------------------------------------------------------
-void DirectoryTree::Grow(vector<shared_ptr<FileMetaData>> &&fileMetas) {
-  lock_guard<recursive_mutex> lock(m_mutex);
-  for (auto &meta : fileMetas) {
-    Grow(std::move(meta));
+shared_ptr<Node> DirectoryTree::GrowChildren(
+    const string &dirPath, vector<shared_ptr<FileMetaData>> &&childMetas) {
+  lock_guard<SharedMutex> lock(m_mutex);
+  return GrowChildrenNoLock(dirPath, std::move(childMetas));
+}
+
+// --------------------------------------------------------------------------
+shared_ptr<Node> DirectoryTree::GrowChildrenNoLock(
+    const string &dirPath, vector<shared_ptr<FileMetaData>> &&childMetas) {
+  auto dir = FindNoLock(dirPath);
+  if (!(dir && *dir)) {
+    dir = GrowNoLock(BuildDefaultDirectoryMeta(dirPath));
   }
+  if (!(dir && *dir && dir->IsDirectory())) {
+    DebugWarning("Not a directory " + FormatPath(dirPath));
+    return shared_ptr<Node>(nullptr);
+  }
+
+  // Pick the children of the dir with their names
+  using NamedMeta = std::pair<string, shared_ptr<FileMetaData>>;
+  vector<NamedMeta> children;
+  children.reserve(childMetas.size());
+  for (auto &meta : childMetas) {
+    if (!meta) {
+      continue;
+    }
+    if (meta->MyDirName() != dirPath) {
+      GrowNoLock(std::move(meta));
+      continue;
+    }
+    auto name = GetNameOfPath(meta->GetFilePath());
+    children.emplace_back(std::move(name), std::move(meta));
+  }
+  // a listing page is sorted already
+  auto less = [](const NamedMeta &lhs, const NamedMeta &rhs) {
+    return lhs.first < rhs.first;
+  };
+  if (!std::is_sorted(children.begin(), children.end(), less)) {
+    std::stable_sort(children.begin(), children.end(), less);
+  }
+
+  // Merge the sorted children with the existing ones. The existing ones are
+  // updated in place, and the new ones are inserted in one pass from the
+  // first insertion, which is an appending for the pages listed in order.
+  vector<shared_ptr<FileMetaData>> addedMetas;
+  addedMetas.reserve(children.size());
+  auto &existing = dir->m_children;
+  vector<std::pair<size_t, shared_ptr<Node>>> addedNodes;  // with positions
+  size_t pos = 0;
+  int addedDirs = 0;
+  for (auto &child : children) {
+    auto it = std::lower_bound(
+        existing.begin() + pos, existing.end(), child.first,
+        [](const shared_ptr<Node> &node, const string &name) {
+          return node->GetName() < name;
+        });
+    pos = it - existing.begin();
+    shared_ptr<Node> node;
+    if (it != existing.end() && (*it)->GetName() == child.first) {
+      node = *it;
+    } else if (!addedNodes.empty() &&
+               addedNodes.back().second->GetName() == child.first) {
+      node = addedNodes.back().second;  // listed twice
+    }
+
+    // the meta datas are kept by the manager, the entries only refer to them
+    if (!node) {
+      DebugInfo("Add Node " + FormatPath(child.second->GetFilePath()));
+      node = MakeNode(Entry(child.second), dir);
+      addedDirs += node->IsDirectory() ? 1 : 0;
+      addedNodes.emplace_back(pos, std::move(node));
+      addedMetas.push_back(std::move(child.second));
+    } else if (!*node || child.second->GetMTime() > node->GetMTime()) {
+      DebugInfo("Update Node " + FormatPath(child.second->GetFilePath()));
+      node->SetEntry(Entry(child.second));
+      addedMetas.push_back(std::move(child.second));
+    } else if (child.second->GetMTime() == node->GetMTime() &&
+               child.second->m_cachedTime > node->GetCachedTime()) {
+      // the listing confirms the unchanged child, so its stat is as fresh
+      // as the listing and needs no head request until it expires again
+      node->SetCachedTime(child.second->m_cachedTime);
+    }
+  }
+
+  if (!addedNodes.empty()) {
+    size_t first = addedNodes.front().first;
+    ChildrenVector tail;
+    tail.reserve(existing.size() - first + addedNodes.size());
+    size_t i = first;
+    for (auto &added : addedNodes) {
+      while (i < added.first) {
+        tail.push_back(std::move(existing[i++]));
+      }
+      tail.push_back(std::move(added.second));
+    }
+    while (i < existing.size()) {
+      tail.push_back(std::move(existing[i++]));
+    }
+    existing.resize(first);
+    existing.insert(existing.end(), std::make_move_iterator(tail.begin()),
+                    std::make_move_iterator(tail.end()));
+  }
+  for (int i = 0; i < addedDirs; ++i) {
+    dir->IncreaseNumLink();
+  }
+
+  FileMetaDataManager::Instance().Add(std::move(addedMetas));
+  return dir;
 }
 
 // --------------------------------------------------------------------------
@@ -360,10 +714,10 @@ shared_ptr<Node> DirectoryTree::UpdateDirectory(
   }
 
   DebugInfo("Update directory " + FormatPath(dirPath));
-  lock_guard<recursive_mutex> lock(m_mutex);
+  lock_guard<SharedMutex> lock(m_mutex);
   // Check children metas and collect valid ones
   vector<shared_ptr<FileMetaData>> newChildrenMetas;
-  set<string> newChildrenIds;
+  vector<string> newChildrenIds;
   for (auto &child : childrenMetas) {
     auto childDirName = child->MyDirName();
     auto childFilePath = child->GetFilePath();
@@ -377,57 +731,79 @@ shared_ptr<Node> DirectoryTree::UpdateDirectory(
                    " has different dir with " + path);
       continue;
     }
-    newChildrenIds.emplace(childFilePath);
+    newChildrenIds.push_back(GetNameOfPath(childFilePath));
     newChildrenMetas.push_back(std::move(child));
   }
+  std::sort(newChildrenIds.begin(), newChildrenIds.end());
 
   // Update
-  auto node = Find(path).lock();
+  auto node = FindNoLock(path);
   if (node && *node) {
     if (!node->IsDirectory()) {
       DebugWarning("Not a directory " + FormatPath(path));
       return shared_ptr<Node>(nullptr);
     }
 
-    // Do deleting
-    set<string> oldChildrenIds = node->GetChildrenIds();
-    set<string> deleteChildrenIds;
-    std::set_difference(
-        oldChildrenIds.begin(), oldChildrenIds.end(), newChildrenIds.begin(),
-        newChildrenIds.end(),
-        std::inserter(deleteChildrenIds, deleteChildrenIds.end()));
-    if (!deleteChildrenIds.empty()) {
-      auto childs = FindChildren(path);
-      m_parentToChildrenMap.erase(path);
-      for (auto &child : childs) {
-        auto childNode = child.lock();
-        if (childNode && (*childNode)) {
-          if (deleteChildrenIds.find(childNode->GetFilePath()) ==
-              deleteChildrenIds.end()) {
-            m_parentToChildrenMap.emplace(path, std::move(child));
-          }
-        }
-      }
-      for (auto &childId : deleteChildrenIds) {
-        m_map.erase(childId);
-        node->Remove(childId);
+    // Do deleting in one pass, the removed children are released along
+    // with the old vector
+    ChildrenVector keptChildren;
+    keptChildren.reserve(node->m_children.size());
+    for (auto &child : node->m_children) {
+      if (std::binary_search(newChildrenIds.begin(), newChildrenIds.end(),
+                             child->GetName())) {
+        keptChildren.push_back(child);
       }
     }
+    node->m_children.swap(keptChildren);
+  }
+
+  // Do updating
+  return GrowChildrenNoLock(path, std::move(newChildrenMetas));
+}
 
-    // Do updating
-    Grow(std::move(newChildrenMetas));
-  } else {  // directory not existing
-    node = Grow(std::move(BuildDefaultDirectoryMeta(path)));
-    Grow(std::move(newChildrenMetas));
+// --------------------------------------------------------------------------
+shared_ptr<Node> DirectoryTree::SetDirectoryListed(
+    const string &dirPath, const vector<string> &childPaths,
+    time_t listedTime) {
+  lock_guard<SharedMutex> lock(m_mutex);
+  auto node = FindNoLock(dirPath);
+  if (!(node && *node && node->IsDirectory())) {
+    DebugWarning("Not a directory " + FormatPath(dirPath));
+    return shared_ptr<Node>(nullptr);
   }
 
-  // m_currentNode = node;
+  set<string> listedNames;
+  for (auto &path : childPaths) {
+    listedNames.emplace(GetNameOfPath(path));
+  }
+  // keep the children added after the listing started, e.g. by a local
+  // creation, as they could be missed by the listing
+  vector<string> deletePaths;
+  auto path = node->GetFilePath();
+  for (auto &child : node->GetChildren()) {
+    if (listedNames.find(child->GetName()) == listedNames.end() &&
+        !(*child && child->GetCachedTime() >= listedTime)) {
+      deletePaths.push_back(path + child->GetName());
+    }
+  }
+  for (auto &deletePath : deletePaths) {
+    RemoveNoLock(deletePath);
+  }
+
+  node->SetListedTime(listedTime);
   return node;
 }
 
 // --------------------------------------------------------------------------
 shared_ptr<Node> DirectoryTree::Rename(const string &oldFilePath,
                                        const string &newFilePath) {
+  lock_guard<SharedMutex> lock(m_mutex);
+  return RenameNoLock(oldFilePath, newFilePath);
+}
+
+// --------------------------------------------------------------------------
+shared_ptr<Node> DirectoryTree::RenameNoLock(const string &oldFilePath,
+                                             const string &newFilePath) {
   if (oldFilePath.empty() || newFilePath.empty()) {
     DebugWarning("Cannot rename " + FormatPath(oldFilePath, newFilePath));
     return shared_ptr<Node>(nullptr);
@@ -437,35 +813,45 @@ shared_ptr<Node> DirectoryTree::Rename(const string &oldFilePath,
     return shared_ptr<Node>(nullptr);
   }
 
-  lock_guard<recursive_mutex> lock(m_mutex);
-  auto node = Find(oldFilePath).lock();
+  auto node = FindNoLock(oldFilePath);
   if (node && *node) {
     // Check parameter
-    if (Find(newFilePath).lock()) {
+    if (FindNoLock(newFilePath)) {
       DebugWarning("Node exist, no rename " + FormatPath(newFilePath));
       return node;
     }
-    if (!(*node)) {
-      DebugWarning("Node not operable, no rename " + FormatPath(oldFilePath));
-      return node;
+
+    auto newDirName = GetDirName(newFilePath);
+    auto newParent = FindNoLock(newDirName);
+    if (!(newParent && *newParent)) {
+      newParent = GrowNoLock(BuildDefaultDirectoryMeta(newDirName));
+      if (!newParent) {
+        DebugWarning("Fail to add parent node, no rename " +
+                     FormatPath(oldFilePath, newFilePath));
+        return node;
+      }
     }
 
     // Do Renaming
     DebugInfo("Rename Node " + FormatPath(oldFilePath, newFilePath));
-    auto parentName = node->MyDirName();
-    node->Rename(newFilePath);  // still need as parent maybe not added yet
+    auto newName = GetNameOfPath(newFilePath);
     auto parent = node->GetParent();
-    if (parent && *parent) {
-      parent->RenameChild(oldFilePath, newFilePath);
-    }
-    m_map.emplace(newFilePath, node);
-    m_map.erase(oldFilePath);
-    if (node->IsDirectory()) {
-      auto childs = FindChildren(oldFilePath);
-      for (auto &child : childs) {
-        m_parentToChildrenMap.emplace(newFilePath, std::move(child));
+    if (parent == newParent) {
+      parent->RenameChild(node->GetName(), newName);
+    } else {
+      if (parent) {
+        parent->Remove(node->GetName());
+        if (node->IsDirectory()) {
+          parent->DecreaseNumLink();
+        }
       }
-      m_parentToChildrenMap.erase(oldFilePath);
+      node->SetParent(newParent);
+      node->SetName(newName);
+      newParent->Insert(node);
+      node->Rename(newFilePath);
+    }
+    if (newName.back() == '/') {
+      RekeyDescendantsNoLock(node);
     }
     // m_currentNode = node;
   } else {
@@ -475,15 +861,76 @@ shared_ptr<Node> DirectoryTree::Rename(const string &oldFilePath,
   return node;
 }
 
+// --------------------------------------------------------------------------
+void DirectoryTree::RekeyDescendantsNoLock(const shared_ptr<Node> &dir) {
+  // The paths of the nodes are built from their names, while the meta datas
+  // are still keyed by the old paths, which could be taken by the new nodes
+  // grown under the old dir.
+  vector<pair<string, string>> renames;
+  vector<pair<shared_ptr<Node>, string>> dirs;
+  dirs.emplace_back(dir, dir->GetFilePath());
+  while (!dirs.empty()) {
+    auto parent = std::move(dirs.back());
+    dirs.pop_back();
+    for (auto &child : parent.first->GetChildren()) {
+      auto path = parent.second + child->GetName();
+      auto meta = child->GetEntry().GetMetaData().lock();
+      if (meta && !child->IsHardLink() && meta->m_filePath != path) {
+        renames.emplace_back(meta->m_filePath, path);
+      }
+      if (child->GetName().back() == '/') {
+        dirs.emplace_back(child, std::move(path));
+      }
+    }
+  }
+  FileMetaDataManager::Instance().Rename(renames);
+}
+
+// --------------------------------------------------------------------------
+shared_ptr<Node> DirectoryTree::RenameDirectory(const string &oldDirPath,
+                                                const string &newDirPath) {
+  lock_guard<SharedMutex> lock(m_mutex);
+  auto node = FindNoLock(oldDirPath);
+  if (!(node && *node && node->IsDirectory())) {
+    DebugWarning("Dir not exist, no rename " + FormatPath(oldDirPath));
+    return shared_ptr<Node>(nullptr);
+  }
+  if (FindNoLock(newDirPath)) {
+    DebugWarning("Node exist, no rename " + FormatPath(newDirPath));
+    return shared_ptr<Node>(nullptr);
+  }
+  if (!RenameNoLock(oldDirPath, newDirPath)) {
+    return shared_ptr<Node>(nullptr);
+  }
+  DebugInfo("Rename dir " + FormatPath(oldDirPath, newDirPath));
+  return node;
+}
+
 // --------------------------------------------------------------------------
 void DirectoryTree::Remove(const string &path) {
+  lock_guard<SharedMutex> lock(m_mutex);
+  RemoveNoLock(path);
+}
+
+// --------------------------------------------------------------------------
+void DirectoryTree::Remove(const vector<string> &paths) {
+  if (paths.empty()) {
+    return;
+  }
+  lock_guard<SharedMutex> lock(m_mutex);
+  for (auto &path : paths) {
+    RemoveNoLock(path);
+  }
+}
+
+// --------------------------------------------------------------------------
+void DirectoryTree::RemoveNoLock(const string &path) {
   if (IsRootDirectory(path)) {
     DebugWarning("Unable to remove root");
     return;
   }
 
-  lock_guard<recursive_mutex> lock(m_mutex);
-  auto node = Find(path).lock();
+  auto node = FindNoLock(path);
   if (!(node && *node)) {
     DebugInfo("No such file or directory, no remove " + FormatPath(path));
     return;
@@ -492,38 +939,16 @@ void DirectoryTree::Remove(const string &path) {
   DebugInfo("Remove node " + FormatPath(path));
   auto parent = node->GetParent();
   if (parent) {
-    // if path is a directory, when go out of this function, destructor
-    // will recursively delete all its children, as there is no references
-    // to the node now.
-    parent->Remove(path);
-  }
-  m_map.erase(path);
-  m_parentToChildrenMap.erase(path);
-
-  if (!node->IsDirectory()) {
-    node.reset();
-    return;
-  }
-
-  std::queue<shared_ptr<Node>> deleteNodes;
-  for (auto &pair : node->GetChildren()) {
-    deleteNodes.push(std::move(pair.second));
-  }
-  // recursively remove all children references
-  while (!deleteNodes.empty()) {
-    auto node_ = deleteNodes.front();
-    deleteNodes.pop();
-
-    auto path_ = node_->GetFilePath();
-    m_map.erase(path_);
-    m_parentToChildrenMap.erase(path_);
-
+    // if path is a directory, when the last reference to the node goes,
+    // destructor will recursively delete all its children.
+    parent->Remove(node->GetName());
     if (node->IsDirectory()) {
-      for (auto &pair : node_->GetChildren()) {
-        deleteNodes.push(std::move(pair.second));
-      }
+      parent->DecreaseNumLink();
     }
   }
+  // the detached node keeps its full path as name for the ones still hold it
+  node->SetParent(nullptr);
+  node->SetName(path);
 }
 
 // --------------------------------------------------------------------------
@@ -534,8 +959,8 @@ shared_ptr<Node> DirectoryTree::HardLink(const string &filePath,
   // Still need to synchronize with target file, to support this we may need
   // to refactory Node to contain a shared_ptr<Entry>.
   DebugInfo("Hard link " + FormatPath(filePath, hardlinkPath));
-  lock_guard<recursive_mutex> lock(m_mutex);
-  auto node = Find(filePath).lock();
+  lock_guard<SharedMutex> lock(m_mutex);
+  auto node = FindNoLock(filePath);
   if (!(node && *node)) {
     DebugWarning("No such file " + FormatPath(filePath));
     return shared_ptr<Node>(nullptr);
@@ -545,28 +970,111 @@ shared_ptr<Node> DirectoryTree::HardLink(const string &filePath,
                FormatPath(filePath, hardlinkPath));
     return shared_ptr<Node>(nullptr);
   }
+  auto parent = FindNoLock(GetDirName(hardlinkPath));
+  if (!(parent && *parent && parent->IsDirectory())) {
+    DebugWarning("No such directory " + FormatPath(hardlinkPath));
+    return shared_ptr<Node>(nullptr);
+  }
 
-  auto lnkNode = make_shared<Node>(Entry(node->GetEntry()), node);
+  auto lnkNode = MakeNode(Entry(node->GetEntry()), parent);
   if (!(lnkNode && *lnkNode)) {
     DebugWarning("Fail to hard link " + FormatPath(filePath, hardlinkPath));
     return shared_ptr<Node>(nullptr);
   }
+  lnkNode->SetName(GetNameOfPath(hardlinkPath));
   lnkNode->SetHardLink(true);
-  node->Insert(lnkNode);
+  parent->Insert(lnkNode);
   node->IncreaseNumLink();
-  m_map.emplace(hardlinkPath, lnkNode);
-  m_parentToChildrenMap.emplace(node->GetFilePath(), lnkNode);
   // m_currentNode = lnkNode;
   return lnkNode;
 }
 
+// --------------------------------------------------------------------------
+size_t DirectoryTree::LoadSnapshot(const string &filePath) {
+  std::ifstream in(filePath, std::ios::binary | std::ios::ate);
+  if (!in) {
+    DebugInfo("No snapshot " + FormatPath(filePath));
+    return 0;
+  }
+  string buf(static_cast<size_t>(in.tellg()), '\0');
+  in.seekg(0);
+  in.read(&buf[0], buf.size());
+  if (!in) {
+    DebugWarning("Fail to read snapshot " + FormatPath(filePath));
+    return 0;
+  }
+
+  size_t pos = kSnapshotMagicSize;
+  uint32_t version = 0;
+  uint64_t count = 0;
+  if (buf.compare(0, kSnapshotMagicSize, kSnapshotMagic) != 0 ||
+      !ReadValue(buf, &pos, &version) || version != kSnapshotVersion ||
+      !ReadValue(buf, &pos, &count)) {
+    DebugWarning("Invalid snapshot " + FormatPath(filePath));
+    return 0;
+  }
+
+  lock_guard<SharedMutex> lock(m_mutex);
+  auto &manager = FileMetaDataManager::Instance();
+  size_t loaded = 0;
+  for (uint64_t i = 0; i < count; ++i) {
+    // Stop when meta data manager is full, otherwise the nodes loaded first,
+    // which are the upper levels of the tree, would be discarded.
+    if (!manager.HasFreeSpace(1)) {
+      DebugInfo("Meta data manager is full, stop loading snapshot " +
+                FormatPath(filePath));
+      break;
+    }
+    string path, mimeType, eTag, symLink;
+    uint64_t fileSize = 0, dev = 0;
+    int64_t mtime = 0, cachedTime = 0, listedTime = 0;
+    uint32_t uid = 0, gid = 0, fileMode = 0;
+    uint8_t fileType = 0, encrypted = 0;
+    if (!(ReadString(buf, &pos, &path) && ReadValue(buf, &pos, &fileSize) &&
+          ReadValue(buf, &pos, &mtime) && ReadValue(buf, &pos, &cachedTime) &&
+          ReadValue(buf, &pos, &listedTime) && ReadValue(buf, &pos, &dev) &&
+          ReadValue(buf, &pos, &uid) && ReadValue(buf, &pos, &gid) &&
+          ReadValue(buf, &pos, &fileMode) && ReadValue(buf, &pos, &fileType) &&
+          ReadValue(buf, &pos, &encrypted) &&
+          ReadString(buf, &pos, &mimeType) && ReadString(buf, &pos, &eTag) &&
+          ReadString(buf, &pos, &symLink))) {
+      DebugWarning("Truncated snapshot " + FormatPath(filePath));
+      break;
+    }
+    if (path.empty() || path[0] != '/' ||
+        fileType > static_cast<uint8_t>(FileType::Socket)) {
+      DebugWarning("Invalid node in snapshot " + FormatPath(path));
+      continue;
+    }
+
+    auto node = GrowNoLock(make_shared<FileMetaData>(
+        path, fileSize, cachedTime, mtime, uid, gid, fileMode,
+        static_cast<FileType>(fileType), mimeType, eTag, encrypted != 0, dev));
+    if (!node) {
+      continue;
+    }
+    if (!symLink.empty()) {
+      node->SetSymbolicLink(symLink);
+    }
+    // The objects could be changed by others since the snapshot is saved, so
+    // the node is marked as never cached by this mount to be revalidated,
+    // and the listing is not trusted for absence.
+    node->SetCachedTime(0);
+    node->SetListedTime(0);
+    ++loaded;
+  }
+  DebugInfo("Load snapshot of " + to_string(loaded) + " nodes " +
+            FormatPath(filePath));
+  return loaded;
+}
+
 // --------------------------------------------------------------------------
 DirectoryTree::DirectoryTree(time_t mtime, uid_t uid, gid_t gid, mode_t mode) {
-  lock_guard<recursive_mutex> lock(m_mutex);
-  m_root = make_shared<Node>(
-      Entry(ROOT_PATH, 0, mtime, mtime, uid, gid, mode, FileType::Directory));
+  lock_guard<SharedMutex> lock(m_mutex);
+  m_root = MakeNode(
+      Entry(ROOT_PATH, 0, mtime, mtime, uid, gid, mode, FileType::Directory),
+      nullptr);
   // m_currentNode = m_root;
-  m_map.emplace(ROOT_PATH, m_root);
 }
 
 }  // namespace Data
@@ -0,0 +1,116 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+#include "data/DirectoryStream.h"
+
+#include <mutex>  // NOLINT
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace QS {
+
+namespace Data {
+
+using std::lock_guard;
+using std::mutex;
+using std::string;
+using std::vector;
+
+// --------------------------------------------------------------------------
+DirectoryStream::DirectoryStream(PageFetcher fetcher, uint64_t maxCount,
+                                 size_t maxWindowSize)
+    : m_fetcher(std::move(fetcher)),
+      m_maxCount(maxCount),
+      m_maxWindowSize(maxWindowSize) {}
+
+// --------------------------------------------------------------------------
+bool DirectoryStream::Read(uint64_t offset, const Filler &filler) {
+  lock_guard<mutex> lock(m_mutex);
+  if (offset < m_windowStart) {
+    SeekNoLock(offset);
+  }
+
+  for (auto pos = offset; m_maxCount == 0 || pos < m_maxCount; ++pos) {
+    while (pos >= m_windowStart + m_window.size()) {
+      if (m_listed) {
+        return true;
+      }
+      if (!FetchNoLock(pos)) {
+        return false;
+      }
+    }
+    if (!filler(m_window[pos - m_windowStart], pos + 1)) {
+      break;
+    }
+  }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+uint64_t DirectoryStream::GetWindowStart() const {
+  lock_guard<mutex> lock(m_mutex);
+  return m_windowStart;
+}
+
+// --------------------------------------------------------------------------
+size_t DirectoryStream::GetWindowSize() const {
+  lock_guard<mutex> lock(m_mutex);
+  return m_window.size();
+}
+
+// --------------------------------------------------------------------------
+uint64_t DirectoryStream::GetFetchCount() const {
+  lock_guard<mutex> lock(m_mutex);
+  return m_fetchCount;
+}
+
+// --------------------------------------------------------------------------
+bool DirectoryStream::FetchNoLock(uint64_t keepFrom) {
+  auto pageOffset = m_windowStart + m_window.size();
+  auto marker = m_marker;
+  vector<Child> children;
+  ++m_fetchCount;
+  if (!m_fetcher(pageOffset, &marker, &children)) {
+    return false;
+  }
+
+  m_pageMarkers.emplace(pageOffset, m_marker);
+  m_marker = std::move(marker);
+  m_listed = m_marker.empty();
+  for (auto &child : children) {
+    m_window.push_back(std::move(child));
+  }
+  while (m_window.size() > m_maxWindowSize && m_windowStart < keepFrom) {
+    m_window.pop_front();
+    ++m_windowStart;
+  }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+void DirectoryStream::SeekNoLock(uint64_t offset) {
+  // the page of offset 0 is always recorded when reading before the window
+  auto it = m_pageMarkers.upper_bound(offset);
+  --it;
+  m_window.clear();
+  m_windowStart = it->first;
+  m_marker = it->second;
+  m_listed = false;
+}
+
+}  // namespace Data
+}  // namespace QS
@@ -38,6 +38,7 @@ namespace QS {
 namespace Data {
 
 using QS::StringUtils::PointerAddress;
+using QS::Threading::CancellationToken;
 using QS::Utils::FileExists;
 using QS::Utils::RemoveFileIfExists;
 using QS::Utils::RemoveFileIfExistsNoLog;
@@ -76,6 +77,8 @@ string PrintFileName(const string &file) { return "[file=" + file + "]"; }
 
 // --------------------------------------------------------------------------
 File::~File() {
+  // Pending downloads are useless once file is removed from cache.
+  GetCancellationToken()->Cancel();
   // As pages using disk file will reference to the same disk file, so File
   // should manage the life cycle of the disk file.
   RemoveDiskFileIfExists(true);  // log on
@@ -485,6 +488,27 @@ void File::Clear() {
   m_useDiskFile.store(false);
 }
 
+// --------------------------------------------------------------------------
+shared_ptr<CancellationToken> File::GetCancellationToken() const {
+  lock_guard<recursive_mutex> lock(m_mutex);
+  return m_cancelToken;
+}
+
+// --------------------------------------------------------------------------
+void File::SetOpen(bool open) {
+  bool wasOpen = m_open.exchange(open);
+  if (wasOpen && !open) {
+    CancelDownloads();
+  }
+}
+
+// --------------------------------------------------------------------------
+void File::CancelDownloads() {
+  lock_guard<recursive_mutex> lock(m_mutex);
+  m_cancelToken->Cancel();
+  m_cancelToken = make_shared<CancellationToken>();
+}
+
 // --------------------------------------------------------------------------
 PageSetConstIterator File::LowerBoundPage(off_t offset) const {
   lock_guard<recursive_mutex> lock(m_mutex);
@@ -17,9 +17,12 @@
 #include "data/FileMetaData.h"
 
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 
+#include "base/HashUtils.h"
 #include "base/LogMacros.h"
 #include "base/StringUtils.h"
 #include "base/Utils.h"
@@ -37,10 +40,40 @@ using QS::Utils::AppendPathDelim;
 using QS::Utils::GetProcessEffectiveUserID;
 using QS::Utils::GetProcessEffectiveGroupID;
 using QS::Utils::IsRootDirectory;
+using std::lock_guard;
 using std::make_shared;
+using std::mutex;
 using std::string;
 using std::to_string;
 using std::unordered_map;
+using std::unordered_set;
+
+namespace {
+
+const size_t kETagDigestHexLength = 32;
+
+const string *const kEmptyString = new string;
+
+// Return the shared copy of the mime type
+const string *InternMimeType(const string &mimeType) {
+  if (mimeType.empty()) {
+    return kEmptyString;
+  }
+  // never freed, the pointers to the elements are kept by meta datas
+  static auto *mimeTypes = new unordered_set<string, HashUtils::StringHash>;
+  static mutex mimeTypesLock;
+  lock_guard<mutex> lock(mimeTypesLock);
+  return &*mimeTypes->emplace(mimeType).first;
+}
+
+// Return the value of a lower case hex digit or -1 if it's not
+int LowerHexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+}  // namespace
 
 // --------------------------------------------------------------------------
 string GetFileTypeName(FileType fileType) {
@@ -96,16 +129,16 @@ FileMetaData::FileMetaData(const string &filePath, uint64_t fileSize,
       m_mtime(mtime),
       m_ctime(mtime),
       m_cachedTime(atime),
+      m_dev(dev),
+      m_mimeType(InternMimeType(mimeType)),
       m_uid(uid),
       m_gid(gid),
       m_fileMode(fileMode),
       m_fileType(fileType),
-      m_mimeType(mimeType),
-      m_eTag(eTag),
       m_encrypted(encrypted),
-      m_dev(dev),
       m_needUpload(false),
       m_fileOpen(false) {
+  SetETag(eTag);
   m_numLink = fileType == FileType::Directory ? 2 : 1;
   if (fileType == FileType::Directory) {
     m_filePath = AppendPathDelim(m_filePath);
@@ -119,11 +152,68 @@ bool FileMetaData::operator==(const FileMetaData &rhs) const {
          m_ctime == rhs.m_ctime && m_cachedTime == rhs.m_cachedTime &&
          m_uid == rhs.m_uid && m_gid == rhs.m_gid &&
          m_fileMode == rhs.m_fileMode && m_fileType == rhs.m_fileType &&
-         m_mimeType == rhs.m_mimeType && m_eTag == rhs.m_eTag &&
+         m_mimeType == rhs.m_mimeType && GetETag() == rhs.GetETag() &&
          m_encrypted == rhs.m_encrypted && m_dev == rhs.m_dev &&
          m_needUpload == rhs.m_needUpload && m_fileOpen == rhs.m_fileOpen;
 }
 
+// --------------------------------------------------------------------------
+const string &FileMetaData::GetMimeType() const {
+  return m_mimeType ? *m_mimeType : *kEmptyString;
+}
+
+// --------------------------------------------------------------------------
+string FileMetaData::GetETag() const {
+  if (m_eTagString) {
+    return *m_eTagString;
+  }
+  if (!m_hasETagDigest) {
+    return string();
+  }
+  static const char *const kHexDigits = "0123456789abcdef";
+  string eTag;
+  eTag.reserve(kETagDigestHexLength + 2);
+  if (m_eTagQuoted) eTag.push_back('"');
+  for (auto byte : m_eTagDigest) {
+    eTag.push_back(kHexDigits[byte >> 4]);
+    eTag.push_back(kHexDigits[byte & 0x0f]);
+  }
+  if (m_eTagQuoted) eTag.push_back('"');
+  return eTag;
+}
+
+// --------------------------------------------------------------------------
+void FileMetaData::SetETag(const string &eTag) {
+  m_hasETagDigest = false;
+  m_eTagQuoted = false;
+  m_eTagString.reset();
+  if (eTag.empty()) {
+    return;
+  }
+
+  // Store the etag of md5 hex string (could be quoted) as 16 bytes digest,
+  // keep the others (e.g. etag of multipart object) as it is.
+  bool quoted = eTag.size() == kETagDigestHexLength + 2 &&
+                eTag.front() == '"' && eTag.back() == '"';
+  size_t start = quoted ? 1 : 0;
+  bool isDigest = eTag.size() == kETagDigestHexLength + 2 * start;
+  for (size_t i = 0; isDigest && i < m_eTagDigest.size(); ++i) {
+    // upper case etag is kept as it is, so it could be rebuilt exactly
+    int high = LowerHexValue(eTag[start + 2 * i]);
+    int low = LowerHexValue(eTag[start + 2 * i + 1]);
+    isDigest = high >= 0 && low >= 0;
+    if (isDigest) {
+      m_eTagDigest[i] = static_cast<uint8_t>((high << 4) | low);
+    }
+  }
+  if (isDigest) {
+    m_hasETagDigest = true;
+    m_eTagQuoted = quoted;
+  } else {
+    m_eTagString = make_shared<const string>(eTag);
+  }
+}
+
 // --------------------------------------------------------------------------
 struct stat FileMetaData::ToStat() const {
   struct stat st;
@@ -198,6 +288,12 @@ bool FileMetaData::FileAccess(uid_t uid, gid_t gid, int amode) const {
     return false;
   }
 
+  return CheckFileAccess(m_uid, m_gid, m_fileMode, uid, gid, amode);
+}
+
+// --------------------------------------------------------------------------
+bool CheckFileAccess(uid_t fileUid, gid_t fileGid, mode_t fileMode, uid_t uid,
+                     gid_t gid, int amode) {
   // Check file existence
   if (amode & F_OK) {
     return true;  // there is a file, always allowed
@@ -206,11 +302,11 @@ bool FileMetaData::FileAccess(uid_t uid, gid_t gid, int amode) const {
   bool ret = false;
   // Check read permission
   if (amode & R_OK) {
-    if ((uid == m_uid || uid == 0) && (m_fileMode & S_IRUSR)) {
+    if ((uid == fileUid || uid == 0) && (fileMode & S_IRUSR)) {
       ret = true;
-    } else if ((gid == m_gid || gid == 0) && (m_fileMode & S_IRGRP)) {
+    } else if ((gid == fileGid || gid == 0) && (fileMode & S_IRGRP)) {
       ret = true;
-    } else if (m_fileMode & S_IROTH) {
+    } else if (fileMode & S_IROTH) {
       ret = true;
     } else {
       return false;
@@ -218,11 +314,11 @@ bool FileMetaData::FileAccess(uid_t uid, gid_t gid, int amode) const {
   }
   // Check write permission
   if (amode & W_OK) {
-    if ((uid == m_uid || uid == 0) && (m_fileMode & S_IWUSR)) {
+    if ((uid == fileUid || uid == 0) && (fileMode & S_IWUSR)) {
       ret = true;
-    } else if ((gid == m_gid || gid == 0) && (m_fileMode & S_IWGRP)) {
+    } else if ((gid == fileGid || gid == 0) && (fileMode & S_IWGRP)) {
       ret = true;
-    } else if (m_fileMode & S_IWOTH) {
+    } else if (fileMode & S_IWOTH) {
       ret = true;
     } else {
       return false;
@@ -233,18 +329,18 @@ bool FileMetaData::FileAccess(uid_t uid, gid_t gid, int amode) const {
     if (uid == 0) {
       // if execute permission is allowed for any user,
       // root shall get execute permission too.
-      if ((m_fileMode & S_IXUSR) || (m_fileMode & S_IXGRP) ||
-          (m_fileMode & S_IXOTH)) {
+      if ((fileMode & S_IXUSR) || (fileMode & S_IXGRP) ||
+          (fileMode & S_IXOTH)) {
         ret = true;
       } else {
         return false;
       }
     } else {
-      if ((uid == m_uid) && (m_fileMode & S_IXUSR)) {
+      if ((uid == fileUid) && (fileMode & S_IXUSR)) {
         ret = true;
-      } else if ((gid == m_gid) && (m_fileMode & S_IXGRP)) {
+      } else if ((gid == fileGid) && (fileMode & S_IXGRP)) {
         ret = true;
-      } else if (m_fileMode & S_IXOTH) {
+      } else if (fileMode & S_IXOTH) {
         ret = true;
       } else {
         return false;
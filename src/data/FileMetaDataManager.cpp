@@ -16,6 +16,8 @@
 
 #include "data/FileMetaDataManager.h"
 
+#include <atomic>  // NOLINT
+#include <iterator>
 #include <memory>
 #include <mutex>  // NOLINT
 #include <string>
@@ -32,12 +34,15 @@ namespace QS {
 namespace Data {
 
 using QS::StringUtils::FormatPath;
+using QS::Threading::SharedLock;
+using QS::Threading::SharedMutex;
 using std::lock_guard;
-using std::recursive_mutex;
+using std::pair;
 using std::string;
 using std::to_string;
 using std::shared_ptr;
 using std::unique_ptr;
+using std::vector;
 
 static unique_ptr<FileMetaDataManager> instance(nullptr);
 static std::once_flag initOnceFlag;
@@ -56,56 +61,49 @@ FileMetaDataManager &FileMetaDataManager::Instance() {
 // --------------------------------------------------------------------------
 MetaDataListConstIterator FileMetaDataManager::Get(
     const std::string &filePath) const {
-  lock_guard<recursive_mutex> lock(m_mutex);
-  return const_cast<FileMetaDataManager *>(this)->Get(filePath);
+  SharedLock lock(m_mutex);
+  return GetNoLock(filePath);
 }
 
 // --------------------------------------------------------------------------
 MetaDataListIterator FileMetaDataManager::Get(const std::string &filePath) {
-  lock_guard<recursive_mutex> lock(m_mutex);
-  auto pos = m_metaDatas.end();
-  auto it = m_map.find(filePath);
-  if (it != m_map.end()) {
-    pos = UnguardedMakeMetaDataMostRecentlyUsed(it->second);
-  } else {
-    DebugInfo("File not exist " + FormatPath(filePath));
-  }
-  return pos;
+  SharedLock lock(m_mutex);
+  return GetNoLock(filePath);
 }
 
 // --------------------------------------------------------------------------
 MetaDataListConstIterator FileMetaDataManager::Begin() const {
-  lock_guard<recursive_mutex> lock(m_mutex);
+  SharedLock lock(m_mutex);
   return m_metaDatas.cbegin();
 }
 
 // --------------------------------------------------------------------------
 MetaDataListIterator FileMetaDataManager::Begin() {
-  lock_guard<recursive_mutex> lock(m_mutex);
+  SharedLock lock(m_mutex);
   return m_metaDatas.begin();
 }
 
 // --------------------------------------------------------------------------
 MetaDataListConstIterator FileMetaDataManager::End() const {
-  lock_guard<recursive_mutex> lock(m_mutex);
+  SharedLock lock(m_mutex);
   return m_metaDatas.cend();
 }
 
 // --------------------------------------------------------------------------
 MetaDataListIterator FileMetaDataManager::End() {
-  lock_guard<recursive_mutex> lock(m_mutex);
+  SharedLock lock(m_mutex);
   return m_metaDatas.end();
 }
 
 // --------------------------------------------------------------------------
 bool FileMetaDataManager::Has(const std::string &filePath) const {
-  lock_guard<recursive_mutex> lock(m_mutex);
-  return this->Get(filePath) != m_metaDatas.cend();
+  SharedLock lock(m_mutex);
+  return GetNoLock(filePath) != m_metaDatas.cend();
 }
 
 // --------------------------------------------------------------------------
 bool FileMetaDataManager::HasFreeSpace(size_t needCount) const {
-  lock_guard<recursive_mutex> lock(m_mutex);
+  SharedLock lock(m_mutex);
   return m_metaDatas.size() + needCount <= GetMaxCount();
 }
 
@@ -137,14 +135,14 @@ MetaDataListIterator FileMetaDataManager::AddNoLock(
 // --------------------------------------------------------------------------
 MetaDataListIterator FileMetaDataManager::Add(
     shared_ptr<FileMetaData> &&fileMetaData) {
-  lock_guard<recursive_mutex> lock(m_mutex);
+  lock_guard<SharedMutex> lock(m_mutex);
   return AddNoLock(std::move(fileMetaData));
 }
 
 // --------------------------------------------------------------------------
 MetaDataListIterator FileMetaDataManager::Add(
     std::vector<std::shared_ptr<FileMetaData>> &&fileMetaDatas) {
-  lock_guard<recursive_mutex> lock(m_mutex);
+  lock_guard<SharedMutex> lock(m_mutex);
   auto pos = m_metaDatas.end();
   for (auto &meta : fileMetaDatas) {
     pos = AddNoLock(std::move(meta));
@@ -155,7 +153,7 @@ MetaDataListIterator FileMetaDataManager::Add(
 
 // --------------------------------------------------------------------------
 MetaDataListIterator FileMetaDataManager::Erase(const std::string &filePath) {
-  lock_guard<recursive_mutex> lock(m_mutex);
+  lock_guard<SharedMutex> lock(m_mutex);
   auto next = m_metaDatas.end();
   auto it = m_map.find(filePath);
   if (it != m_map.end()) {
@@ -169,7 +167,7 @@ MetaDataListIterator FileMetaDataManager::Erase(const std::string &filePath) {
 
 // --------------------------------------------------------------------------
 void FileMetaDataManager::Clear() {
-  lock_guard<recursive_mutex> lock(m_mutex);
+  lock_guard<SharedMutex> lock(m_mutex);
   m_map.clear();
   m_metaDatas.clear();
 }
@@ -183,7 +181,7 @@ void FileMetaDataManager::Rename(const string &oldFilePath,
     return;
   }
 
-  lock_guard<recursive_mutex> lock(m_mutex);
+  lock_guard<SharedMutex> lock(m_mutex);
   if (m_map.find(newFilePath) != m_map.end()) {
     DebugWarning("File exist, no rename " +
                  FormatPath(oldFilePath, newFilePath));
@@ -202,6 +200,49 @@ void FileMetaDataManager::Rename(const string &oldFilePath,
   }
 }
 
+// --------------------------------------------------------------------------
+void FileMetaDataManager::Rename(const vector<pair<string, string>> &renames) {
+  if (renames.empty()) {
+    return;
+  }
+  lock_guard<SharedMutex> lock(m_mutex);
+  for (auto &rename : renames) {
+    auto &oldFilePath = rename.first;
+    auto &newFilePath = rename.second;
+    auto it = m_map.find(oldFilePath);
+    if (oldFilePath == newFilePath || it == m_map.end()) {
+      continue;
+    }
+    auto pos = it->second;
+    m_map.erase(it);
+    auto stale = m_map.find(newFilePath);
+    if (stale != m_map.end()) {
+      m_metaDatas.erase(stale->second);
+      m_map.erase(stale);
+    }
+    pos->first = newFilePath;
+    pos->second->m_filePath = newFilePath;
+    m_map.emplace(newFilePath, pos);
+  }
+}
+
+// --------------------------------------------------------------------------
+MetaDataListIterator FileMetaDataManager::GetNoLock(
+    const std::string &filePath) const {
+  auto self = const_cast<FileMetaDataManager *>(this);
+  auto it = m_map.find(filePath);
+  if (it == m_map.end()) {
+    DebugInfo("File not exist " + FormatPath(filePath));
+    return self->m_metaDatas.end();
+  }
+  // avoid writing the shared cache line when the bit is already set
+  auto &referenced = it->second->referenced;
+  if (!referenced.load(std::memory_order_relaxed)) {
+    referenced.store(true, std::memory_order_relaxed);
+  }
+  return it->second;
+}
+
 // --------------------------------------------------------------------------
 MetaDataListIterator FileMetaDataManager::UnguardedMakeMetaDataMostRecentlyUsed(
     MetaDataListConstIterator pos) {
@@ -232,7 +273,16 @@ bool FileMetaDataManager::FreeNoLock(size_t needCount, string fileUnfreeable) {
   assert(!m_metaDatas.empty());
   size_t freedCount = 0;
   while (!HasFreeSpaceNoLock(needCount) && !m_metaDatas.empty()) {
-    // Discards the least recently used meta first, which is put at back
+    // Give the meta referenced since last check a second chance. As the bits
+    // are only set under the shared lock, this ends within one round.
+    auto last = std::prev(m_metaDatas.end());
+    if (last->referenced.load(std::memory_order_relaxed)) {
+      last->referenced.store(false, std::memory_order_relaxed);
+      UnguardedMakeMetaDataMostRecentlyUsed(last);
+      continue;
+    }
+
+    // Discards the meta at back
     auto fileId = m_metaDatas.back().first;
     if (m_metaDatas.back().second) {
       if (m_metaDatas.back().second->IsFileOpen()) {
@@ -0,0 +1,140 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+#include "data/NegativeCache.h"
+
+#include <chrono>  // NOLINT
+#include <mutex>  // NOLINT
+#include <string>
+
+namespace QS {
+
+namespace Data {
+
+using std::chrono::milliseconds;
+using std::lock_guard;
+using std::mutex;
+using std::string;
+using std::to_string;
+
+// --------------------------------------------------------------------------
+NegativeCache::NegativeCache(milliseconds ttl, size_t maxCount)
+    : m_ttl(ttl), m_maxCount(maxCount), m_hitCount(0), m_missCount(0) {}
+
+// --------------------------------------------------------------------------
+bool NegativeCache::Has(const string &path) {
+  if (!IsEnabled()) {
+    return false;
+  }
+  lock_guard<mutex> lock(m_mutex);
+  auto it = m_expiries.find(path);
+  if (it != m_expiries.end()) {
+    if (Clock::now() < it->second) {
+      ++m_hitCount;
+      return true;
+    }
+    m_expiries.erase(it);
+  }
+  ++m_missCount;
+  return false;
+}
+
+// --------------------------------------------------------------------------
+void NegativeCache::Add(const string &path) {
+  if (!IsEnabled() || path.empty()) {
+    return;
+  }
+  lock_guard<mutex> lock(m_mutex);
+  auto now = Clock::now();
+  PurgeNoLock(now, 1);
+  auto expiry = now + m_ttl;
+  m_expiries[path] = expiry;
+  m_queue.emplace_back(expiry, path);
+}
+
+// --------------------------------------------------------------------------
+void NegativeCache::Invalidate(const string &path) {
+  if (!IsEnabled() || path.empty()) {
+    return;
+  }
+  lock_guard<mutex> lock(m_mutex);
+  m_expiries.erase(path);
+  if (path.back() == '/') {
+    if (path.size() > 1) {
+      m_expiries.erase(path.substr(0, path.size() - 1));
+    }
+  } else {
+    m_expiries.erase(path + "/");
+  }
+}
+
+// --------------------------------------------------------------------------
+void NegativeCache::InvalidateDirectory(const string &dirPath) {
+  if (!IsEnabled() || dirPath.empty()) {
+    return;
+  }
+  Invalidate(dirPath);
+  string prefix = dirPath.back() == '/' ? dirPath : dirPath + "/";
+  lock_guard<mutex> lock(m_mutex);
+  for (auto it = m_expiries.begin(); it != m_expiries.end();) {
+    if (it->first.compare(0, prefix.size(), prefix) == 0) {
+      it = m_expiries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+// --------------------------------------------------------------------------
+void NegativeCache::Clear() {
+  lock_guard<mutex> lock(m_mutex);
+  m_expiries.clear();
+  m_queue.clear();
+}
+
+// --------------------------------------------------------------------------
+size_t NegativeCache::GetSize() const {
+  lock_guard<mutex> lock(m_mutex);
+  return m_expiries.size();
+}
+
+// --------------------------------------------------------------------------
+string NegativeCache::ToString() const {
+  return "[ttl(ms)=" + to_string(m_ttl.count()) +
+         ", max count=" + to_string(m_maxCount) +
+         ", size=" + to_string(GetSize()) +
+         ", hits:misses=" + to_string(GetHitCount()) + ":" +
+         to_string(GetMissCount()) + "]";
+}
+
+// --------------------------------------------------------------------------
+void NegativeCache::PurgeNoLock(Clock::time_point now, size_t needCount) {
+  while (!m_queue.empty()) {
+    auto &front = m_queue.front();
+    bool full = m_expiries.size() + needCount > m_maxCount;
+    if (!full && now < front.first) {
+      break;  // the others are added later
+    }
+    auto it = m_expiries.find(front.second);
+    if (it != m_expiries.end() && it->second == front.first) {
+      m_expiries.erase(it);
+    }
+    m_queue.pop_front();
+  }
+}
+
+}  // namespace Data
+}  // namespace QS
@@ -17,13 +17,15 @@
 #include "filesystem/Drive.h"
 
 #include <assert.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <time.h>
 
 #include <sys/stat.h>
 #include <sys/types.h>
 
-#include <deque>
+#include <chrono>  // NOLINT
+#include <functional>
 #include <future>  // NOLINT
 #include <memory>
 #include <mutex>  // NOLINT
@@ -32,53 +34,72 @@
 #include <utility>
 #include <vector>
 
+#include "base/CancellationToken.h"
 #include "base/Exception.h"
 #include "base/LogMacros.h"
+#include "base/RoundRobinScheduler.h"
 #include "base/StringUtils.h"
 #include "base/TimeUtils.h"
 #include "base/Utils.h"
+#include "client/BucketCrawler.h"
 #include "client/Client.h"
 #include "client/ClientError.h"
 #include "client/ClientFactory.h"
+#include "client/ClientImpl.h"
+#include "client/Constants.h"
+#include "client/DeleteBatcher.h"
 #include "client/QSError.h"
 #include "client/ClientConfiguration.h"
+#include "client/RateLimiter.h"
 #include "client/TransferHandle.h"
 #include "client/TransferManager.h"
 #include "client/TransferManagerFactory.h"
 #include "configure/Default.h"
 #include "configure/Options.h"
+#include "data/ByteBudget.h"
 #include "data/Cache.h"
 #include "data/Directory.h"
+#include "data/DirectoryStream.h"
 #include "data/FileMetaData.h"
+#include "data/FileMetaDataManager.h"
 #include "data/IOStream.h"
+#include "data/NegativeCache.h"
 #include "data/Size.h"
 
 namespace QS {
 
 namespace FileSystem {
 
+using QS::Client::BucketCrawler;
 using QS::Client::Client;
 using QS::Client::ClientError;
 using QS::Client::ClientFactory;
+using QS::Client::DeleteBatcher;
 using QS::Client::GetMessageForQSError;
 using QS::Client::IsGoodQSError;
 using QS::Client::QSError;
+using QS::Client::RequestPriority;
+using QS::Client::ScopedRequestPriority;
 using QS::Client::TransferHandle;
 using QS::Client::TransferManager;
 using QS::Client::TransferManagerConfigure;
 using QS::Client::TransferManagerFactory;
 using QS::Data::Cache;
 using QS::Data::ContentRangeDeque;
-using QS::Data::ChildrenMultiMapConstIterator;
+using QS::Data::DirectoryStream;
 using QS::Data::DirectoryTree;
 using QS::Data::Entry;
+using QS::Data::EntrySnapshot;
 using QS::Data::FileMetaData;
+using QS::Data::FileMetaDataManager;
 using QS::Data::FileType;
-using QS::Data::FilePathToNodeUnorderedMap;
 using QS::Data::IOStream;
+using QS::Data::NegativeCache;
 using QS::Data::Node;
+using QS::Data::ScopedForcedBytes;
 using QS::Exception::QSException;
 using QS::StringUtils::FormatPath;
+using QS::Threading::CancellationToken;
 using QS::Utils::AppendPathDelim;
 using QS::Utils::DeleteFilesInDirectory;
 using QS::Utils::FileExists;
@@ -87,8 +108,9 @@ using QS::Utils::GetDirName;
 using QS::Utils::GetProcessEffectiveUserID;
 using QS::Utils::GetProcessEffectiveGroupID;
 using QS::Utils::IsRootDirectory;
-using std::deque;
+using std::lock_guard;
 using std::make_shared;
+using std::mutex;
 using std::pair;
 using std::shared_ptr;
 using std::string;
@@ -98,6 +120,29 @@ using std::unique_ptr;
 using std::vector;
 using std::weak_ptr;
 
+namespace {
+
+// time to collect the removals into a batch
+const std::chrono::milliseconds kRemovalLinger(100);
+
+// count of children listed per page of a directory stream
+const uint64_t kStreamPageSize = QS::Client::Constants::BucketListObjectsLimit;
+// count of children kept in memory by a directory stream
+const size_t kStreamWindowSize = 4 * kStreamPageSize;
+
+// interval to save the snapshot of dir tree
+const time_t kSnapshotIntervalInSec = 10 * 60;
+
+// The children of a directory stream added to the dir tree
+struct StreamListing {
+  time_t startTime = time(NULL);
+  uint64_t count = 0;  // count of children listed in order
+  bool growTree = true;
+  vector<string> childPaths;
+};
+
+}  // namespace
+
 static std::unique_ptr<Drive> instance(nullptr);
 static std::once_flag flag;
 
@@ -111,6 +156,10 @@ Drive &Drive::Instance() {
 Drive::Drive()
     : m_mountable(true),
       m_cleanup(false),
+      m_listingHitCount(0),
+      m_staleHitCount(0),
+      m_staleRefreshCount(0),
+      m_snapshotTime(0),
       m_client(ClientFactory::Instance().MakeClient()),
       m_transferManager(std::move(
           TransferManagerFactory::Create(TransferManagerConfigure()))) {
@@ -125,7 +174,55 @@ Drive::Drive()
   m_directoryTree = unique_ptr<DirectoryTree>(new DirectoryTree(
       time(NULL), uid, gid, QS::Configure::Default::GetRootMode()));
 
+  auto &options = QS::Configure::Options::Instance();
+  m_negativeCache = unique_ptr<NegativeCache>(new NegativeCache(
+      std::chrono::seconds(options.GetNegativeTTLInSec()),
+      static_cast<size_t>(options.GetMaxStatCountInK() * QS::Data::Size::K1)));
+
+  // Serve the stat entries of last mount, they are revalidated on their
+  // first access
+  auto &snapshotFile = options.GetSnapshotFile();
+  if (!snapshotFile.empty()) {
+    auto count = m_directoryTree->LoadSnapshot(snapshotFile);
+    Info("Load " + to_string(count) + " stat entries from snapshot " +
+         FormatPath(snapshotFile));
+  }
+  m_snapshotTime.store(time(NULL));
+
   m_transferManager->SetClient(m_client);
+
+  // Batches wait for their requests, so they are handled by the background
+  // executor of client, shared with the other background tasks. The paths
+  // left by a failed batch are retried once, then logged as they are
+  // already removed for the caller.
+  m_deleteBatcher = unique_ptr<DeleteBatcher>(new DeleteBatcher(
+      [this](std::function<void()> task) {
+        GetClient()->GetBackgroundExecutor()->SubmitToThread(std::move(task));
+      },
+      [this](const vector<string> &filePaths) {
+        vector<string> undeleted;
+        auto err = GetClient()->DeleteFiles(filePaths, &undeleted);
+        if (IsGoodQSError(err)) {
+          DebugInfo("Delete " + to_string(filePaths.size()) + " files");
+          return;
+        }
+        if (!undeleted.empty()) {
+          vector<string> retried;
+          retried.swap(undeleted);
+          err = GetClient()->DeleteFiles(retried, &undeleted);
+        }
+        if (!IsGoodQSError(err)) {
+          string paths;
+          for (auto &path : undeleted) {
+            paths += " " + FormatPath(path);
+          }
+          Error("Unable to delete " + to_string(undeleted.size()) +
+                " files " + GetMessageForQSError(err) + paths);
+        }
+      },
+      static_cast<size_t>(
+          QS::Client::Constants::BucketDeleteMultipleObjectsLimit),
+      kRemovalLinger, GetClient()->GetBackgroundPoolSize()));
 }
 
 // --------------------------------------------------------------------------
@@ -134,6 +231,51 @@ Drive::~Drive() { CleanUp(); }
 // --------------------------------------------------------------------------
 void Drive::CleanUp() {
   if (!m_cleanup) {
+    if (m_crawler) {
+      m_crawler->Cancel();
+      if (m_warmUpThread.joinable()) {
+        m_warmUpThread.join();
+      }
+      Info("Warm-up crawl statistics " + m_crawler->ToString());
+    }
+    if (m_transferManager) {
+      Info("Download budget statistics " +
+           m_transferManager->GetDownloadBudget()->ToString());
+      Info("Cancelled download bytes " +
+           to_string(m_transferManager->GetCancelledDownloadBytes()));
+      Info("Transfer concurrency " +
+           m_transferManager->GetConcurrencyController()->ToString());
+    }
+    if (m_client && m_client->GetClientImpl()) {
+      Info("Rate limiter statistics " +
+           m_client->GetClientImpl()->GetRateLimiter()->ToString());
+      Info("Hedged download statistics " +
+           m_client->GetClientImpl()->GetHedgePolicy()->ToString());
+      Info("Adaptive timeout statistics " +
+           m_client->GetClientImpl()->GetAdaptiveTimeout()->ToString());
+    }
+    if (m_client && m_client->GetRetryStrategy().GetBudget()) {
+      Info("Retry budget statistics " +
+           m_client->GetRetryStrategy().GetBudget()->ToString());
+    }
+    if (m_client) {
+      Info("Coalesced stat statistics " +
+           m_client->GetStatFlights().ToString());
+      Info("Coalesced listing statistics " +
+           m_client->GetListFlights().ToString());
+    }
+    if (m_deleteBatcher) {
+      m_deleteBatcher->Flush();
+      Info("Batched removal statistics " + m_deleteBatcher->ToString());
+    }
+    if (m_negativeCache) {
+      Info("Negative lookup statistics " + m_negativeCache->ToString() +
+           ", answered by listings " + to_string(m_listingHitCount.load()));
+    }
+    Info("Stale stat statistics [used:refreshes=" +
+         to_string(m_staleHitCount.load()) + ":" +
+         to_string(m_staleRefreshCount.load()) + "]");
+    SaveSnapshot();
     // abort unfinished multipart uploads
     if (!m_unfinishedMultipartUploadHandles.empty()) {
       for (auto &fileToHandle : m_unfinishedMultipartUploadHandles) {
@@ -148,10 +290,12 @@ void Drive::CleanUp() {
       DeleteFilesInDirectory(diskfolder, true);  // delete folder itself
     }
 
+    m_deleteBatcher.reset();
     m_client.reset();
     m_transferManager.reset();
     m_cache.reset();
     m_directoryTree.reset();
+    m_negativeCache.reset();
     m_unfinishedMultipartUploadHandles.clear();
 
     m_cleanup.store(true);
@@ -214,6 +358,25 @@ shared_ptr<Node> Drive::GetRoot() {
   return m_directoryTree->GetRoot();
 }
 
+// --------------------------------------------------------------------------
+void Drive::StartWarmUp() {
+  auto listings = QS::Configure::Options::Instance().GetWarmUpListings();
+  if (listings == 0 || m_crawler) {
+    return;
+  }
+  m_crawler = unique_ptr<BucketCrawler>(new BucketCrawler(
+      [this](const string &dirPath, vector<string> *subDirPaths) {
+        return WarmUpDirectory(dirPath, subDirPaths);
+      },
+      listings));
+  m_warmUpThread = std::thread([this] {
+    auto start = time(NULL);
+    auto count = m_crawler->Crawl("/");
+    Info("Warm-up crawl listed " + to_string(count) + " dirs in " +
+         to_string(time(NULL) - start) + "s");
+  });
+}
+
 // --------------------------------------------------------------------------
 pair<weak_ptr<Node>, bool> Drive::GetNode(const string &path,
                                           bool updateIfDirectory,
@@ -222,44 +385,48 @@ pair<weak_ptr<Node>, bool> Drive::GetNode(const string &path,
     Error("Null file path");
     return {weak_ptr<Node>(), false};
   }
+  SaveSnapshotPeriodically();
   auto node = m_directoryTree->Find(path).lock();
   bool modified = false;
 
-  auto UpdateNode = [this, &modified](const string &path,
-                                      const shared_ptr<Node> &node) {
-    time_t modifiedSince = 0;
-    modifiedSince = const_cast<const Node &>(*node).GetEntry().GetMTime();
-    auto err = GetClient()->Stat(path, modifiedSince, &modified);
-    if (!IsGoodQSError(err)) {
-      // As user can remove file through other ways such as web console, etc.
-      // So we need to remove file from local dir tree and cache.
-      if (err.GetError() == QSError::KEY_NOT_EXIST) {
-        // remove node
-        DebugInfo("File not exist " + FormatPath(path));
-        m_directoryTree->Remove(path);
-        if (m_cache->HasFile(path)) {
-          m_cache->Erase(path);
-        }
+  auto &options = QS::Configure::Options::Instance();
+  auto expireDurationInMin = options.GetStatExpireInMin();
+  auto maxStaleInMin = static_cast<int32_t>(options.GetMaxStaleInMin());
+  // Read the attributes within one lock, and only read them again when the
+  // node get updated
+  auto snapshot = node ? node->GetSnapshot() : EntrySnapshot();
+  if (snapshot.operable) {
+    if (snapshot.cachedTime == 0) {
+      // loaded from the snapshot of last mount, use the attributes, and
+      // revalidate them in background whatever the expiration is
+      ++m_staleHitCount;
+      RefreshNodeAsync(path, snapshot.st.st_mtime);
+    } else if (QS::TimeUtils::IsExpire(snapshot.cachedTime,
+                                       expireDurationInMin)) {
+      if (maxStaleInMin > 0 &&
+          !QS::TimeUtils::IsExpire(snapshot.cachedTime,
+                                   expireDurationInMin + maxStaleInMin)) {
+        // use the stale attributes, and refresh them in background
+        ++m_staleHitCount;
+        RefreshNodeAsync(path, snapshot.st.st_mtime);
       } else {
-        DebugError(GetMessageForQSError(err));
+        RefreshNode(path, snapshot.st.st_mtime, &modified);
+        snapshot = node->GetSnapshot();
       }
     }
-  };
-
-  auto expireDurationInMin =
-      QS::Configure::Options::Instance().GetStatExpireInMin();
-  if (node && *node) {
-    if (QS::TimeUtils::IsExpire(node->GetCachedTime(),
-                                expireDurationInMin)) {
-      UpdateNode(path, node);
-    }
+  } else if (!node &&
+             (m_negativeCache->Has(path) || IsAbsentInListing(path))) {
+    // object storage has answered it is not existing recently
+    return {weak_ptr<Node>(), false};
   } else {
     auto err = GetClient()->Stat(path);  // head it
     if (IsGoodQSError(err)) {
       node = m_directoryTree->Find(path).lock();
+      snapshot = node ? node->GetSnapshot() : EntrySnapshot();
     } else {
       if (err.GetError() == QSError::KEY_NOT_EXIST) {
         DebugInfo("File not exist " + FormatPath(path));
+        m_negativeCache->Add(path);
       } else {
         DebugError(GetMessageForQSError(err));
       }
@@ -271,9 +438,9 @@ pair<weak_ptr<Node>, bool> Drive::GetNode(const string &path,
   // not be considered as an error.
   // The modified time is only the meta of an object, we should not take
   // modified time as an precondition to decide if we need to update dir or not.
-  if (node && *node && node->IsDirectory() && updateIfDirectory &&
-      (QS::TimeUtils::IsExpire(node->GetCachedTime(),
-                               expireDurationInMin) ||
+  if (snapshot.IsDirectory() && updateIfDirectory &&
+      (snapshot.cachedTime == 0 ||
+       QS::TimeUtils::IsExpire(snapshot.cachedTime, expireDurationInMin) ||
        node->IsEmpty())) {
     auto ReceivedHandler = [](const ClientError<QSError> &err) {
       DebugErrorIf(!IsGoodQSError(err), GetMessageForQSError(err));
@@ -291,11 +458,258 @@ pair<weak_ptr<Node>, bool> Drive::GetNode(const string &path,
   return {node, modified};
 }
 
+// --------------------------------------------------------------------------
+void Drive::RefreshNode(const string &path, time_t modifiedSince,
+                        bool *modified) {
+  auto err = GetClient()->Stat(path, modifiedSince, modified);
+  if (IsGoodQSError(err)) {
+    if (!*modified) {
+      // not modified, so the attributes are good for another period
+      auto node = m_directoryTree->Find(path).lock();
+      if (node) {
+        node->SetCachedTime(time(NULL));
+      }
+    }
+  } else {
+    // As user can remove file through other ways such as web console, etc.
+    // So we need to remove file from local dir tree and cache.
+    if (err.GetError() == QSError::KEY_NOT_EXIST) {
+      // remove node
+      DebugInfo("File not exist " + FormatPath(path));
+      m_directoryTree->Remove(path);
+      m_negativeCache->Add(path);
+      if (m_cache->HasFile(path)) {
+        m_cache->Erase(path);
+      }
+    } else {
+      DebugError(GetMessageForQSError(err));
+    }
+  }
+}
+
+// --------------------------------------------------------------------------
+void Drive::RefreshNodeAsync(const string &path, time_t modifiedSince) {
+  // The refreshes wait for their head requests, so they are run by the
+  // background executor of client, and the ones queued or in progress are
+  // bounded by its pool size. The stale attributes are used until a later
+  // lookup submits the refresh again.
+  auto maxRefreshing = GetClient()->GetBackgroundPoolSize();
+  {
+    lock_guard<mutex> lock(m_refreshMutex);
+    if (m_refreshingPaths.size() >= maxRefreshing ||
+        !m_refreshingPaths.emplace(path).second) {
+      return;  // too many refreshes, or a refresh is in progress already
+    }
+  }
+  ++m_staleRefreshCount;
+  GetClient()->GetBackgroundExecutor()->Submit([this, path, modifiedSince] {
+    bool modified = false;
+    RefreshNode(path, modifiedSince, &modified);
+    lock_guard<mutex> lock(m_refreshMutex);
+    m_refreshingPaths.erase(path);
+  });
+}
+
+// --------------------------------------------------------------------------
+bool Drive::WarmUpDirectory(const string &dirPath,
+                            vector<string> *subDirPaths) {
+  // give way to the requests someone is waiting for
+  ScopedRequestPriority priority(RequestPriority::Background);
+  time_t listedTime = time(NULL);
+  vector<string> childPaths;
+  string marker;
+  do {
+    if (!FileMetaDataManager::Instance().HasFreeSpace(kStreamPageSize)) {
+      // keep the stat entries of the accessed files from being released
+      Info("Stop warm-up crawl as stat entries reach the max count");
+      m_crawler->Cancel();
+      return false;
+    }
+    vector<shared_ptr<FileMetaData>> childMetas;
+    auto err = GetClient()->ListDirectoryPage(dirPath, &marker,
+                                              kStreamPageSize, &childMetas);
+    if (!IsGoodQSError(err)) {
+      DebugError(GetMessageForQSError(err));
+      return false;
+    }
+    for (auto &meta : childMetas) {
+      childPaths.push_back(meta->GetFilePath());
+      if (meta->IsDirectory()) {
+        subDirPaths->push_back(meta->GetFilePath());
+      }
+    }
+    m_directoryTree->GrowChildren(dirPath, std::move(childMetas));
+  } while (!marker.empty() && !m_crawler->IsCancelled());
+
+  if (marker.empty()) {
+    m_directoryTree->SetDirectoryListed(dirPath, childPaths, listedTime);
+  }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+void Drive::SaveSnapshot() {
+  auto &snapshotFile = QS::Configure::Options::Instance().GetSnapshotFile();
+  if (snapshotFile.empty() || !m_directoryTree) {
+    return;
+  }
+  lock_guard<mutex> lock(m_snapshotMutex);
+  if (!m_directoryTree->SaveSnapshot(snapshotFile)) {
+    Warning("Fail to save snapshot " + FormatPath(snapshotFile));
+  }
+}
+
+// --------------------------------------------------------------------------
+void Drive::SaveSnapshotPeriodically() {
+  if (QS::Configure::Options::Instance().GetSnapshotFile().empty()) {
+    return;
+  }
+  auto now = time(NULL);
+  auto last = m_snapshotTime.load();
+  if (now < last + kSnapshotIntervalInSec ||
+      !m_snapshotTime.compare_exchange_strong(last, now)) {
+    return;  // saved recently or being saved by another thread
+  }
+  GetClient()->GetExecutor()->Submit([this] { SaveSnapshot(); });
+}
+
+// --------------------------------------------------------------------------
+bool Drive::IsAbsentInListing(const string &path) {
+  auto ttl = QS::Configure::Options::Instance().GetNegativeTTLInSec();
+  if (ttl <= 0 || IsRootDirectory(path)) {
+    return false;
+  }
+  auto parent = m_directoryTree->Find(GetDirName(path)).lock();
+  if (!(parent && *parent)) {
+    return false;
+  }
+  auto listedTime = parent->GetListedTime();
+  if (listedTime > 0 && time(NULL) < listedTime + ttl) {
+    ++m_listingHitCount;
+    return true;
+  }
+  return false;
+}
+
+// --------------------------------------------------------------------------
+void Drive::InvalidateNegativeLookups(const string &path, bool recursive) {
+  if (recursive) {
+    m_negativeCache->InvalidateDirectory(path);
+  } else {
+    m_negativeCache->Invalidate(path);
+  }
+  // the listing of the parent dir misses the path
+  auto parent = m_directoryTree->Find(GetDirName(path)).lock();
+  if (parent) {
+    parent->SetListedTime(0);
+  }
+}
+
 // --------------------------------------------------------------------------
 weak_ptr<Node> Drive::GetNodeSimple(const string &path) {
   return m_directoryTree->Find(path);
 }
 
+// --------------------------------------------------------------------------
+weak_ptr<Node> Drive::GetFileOrDirectorySimple(const string &path) {
+  return m_directoryTree->FindFileOrDirectory(path);
+}
+
+// --------------------------------------------------------------------------
+string Drive::ResolveFileOrDirectory(const string &path) {
+  if (path.empty() || path.back() == '/') {
+    return path;
+  }
+  auto node = GetFileOrDirectorySimple(path).lock();
+  if (node) {
+    return node->GetName().back() == '/' ? AppendPathDelim(path) : path;
+  }
+
+  auto dirPath = AppendPathDelim(path);
+  auto isAbsent = [this](const string &p) {
+    return m_negativeCache->Has(p) || IsAbsentInListing(p);
+  };
+  if (isAbsent(path) && isAbsent(dirPath)) {
+    // object storage has answered they are not existing recently
+    return string();
+  }
+
+  bool isDir = false;
+  auto err = GetClient()->StatFileOrDirectory(path, &isDir);
+  if (IsGoodQSError(err)) {
+    return isDir ? dirPath : path;
+  }
+  if (err.GetError() == QSError::KEY_NOT_EXIST) {
+    DebugInfo("File not exist " + FormatPath(path));
+    m_negativeCache->Add(path);
+    m_negativeCache->Add(dirPath);
+  } else {
+    DebugError(GetMessageForQSError(err));
+  }
+  return string();
+}
+
+// --------------------------------------------------------------------------
+unique_ptr<DirectoryStream> Drive::OpenDirectoryStream(const string &dirPath) {
+  auto node = m_directoryTree->Find(dirPath).lock();
+  if (!(node && *node && node->IsDirectory())) {
+    return unique_ptr<DirectoryStream>(nullptr);
+  }
+  auto &options = QS::Configure::Options::Instance();
+  auto listedTime = node->GetListedTime();
+  if (listedTime > 0 &&
+      !QS::TimeUtils::IsExpire(listedTime, options.GetStatExpireInMin())) {
+    return unique_ptr<DirectoryStream>(nullptr);
+  }
+
+  auto maxTreeCount = static_cast<uint64_t>(options.GetMaxStatCountInK() *
+                                            QS::Data::Size::K1);
+  auto listing = make_shared<StreamListing>();
+  auto fetcher = [this, dirPath, maxTreeCount, listing](
+                     uint64_t offset, string *marker,
+                     vector<DirectoryStream::Child> *children) {
+    vector<shared_ptr<FileMetaData>> metas;
+    auto err = GetClient()->ListDirectoryPage(dirPath, marker,
+                                              kStreamPageSize, &metas);
+    if (!IsGoodQSError(err)) {
+      DebugError(GetMessageForQSError(err));
+      return false;
+    }
+    for (auto &meta : metas) {
+      children->push_back({meta->MyBaseName(), meta->ToStat()});
+    }
+
+    // only grow the tree with the pages listed in order at the first time
+    if (!listing->growTree || offset != listing->count) {
+      return true;
+    }
+    listing->count += metas.size();
+    if (listing->count > maxTreeCount) {
+      DebugInfo("Too many children, stop adding them to tree " +
+                FormatPath(dirPath));
+      listing->growTree = false;
+      vector<string>().swap(listing->childPaths);
+      return true;
+    }
+    for (auto &meta : metas) {
+      listing->childPaths.push_back(meta->GetFilePath());
+    }
+    m_directoryTree->GrowChildren(dirPath, std::move(metas));
+    if (marker->empty()) {
+      m_directoryTree->SetDirectoryListed(dirPath, listing->childPaths,
+                                          listing->startTime);
+    }
+    return true;
+  };
+
+  auto maxListCount =
+      QS::Client::ClientConfiguration::Instance().GetMaxListCount();
+  return unique_ptr<DirectoryStream>(new DirectoryStream(
+      std::move(fetcher),
+      maxListCount > 0 ? static_cast<uint64_t>(maxListCount) : 0,
+      kStreamWindowSize));
+}
+
 // --------------------------------------------------------------------------
 struct statvfs Drive::GetFilesystemStatistics() {
   struct statvfs statv;
@@ -346,15 +760,46 @@ void Drive::RemoveFile(const string &filePath, bool async) {
     }
   };
 
-  if (async) {  // delete file asynchronously
+  if (async && m_deleteBatcher) {  // delete file asynchronously in batch
+    // Remove it locally at once, so the following lookups never find the
+    // stale node while the batch is pending. A hard link is only a node of
+    // dir tree, as QSClient::DeleteFile does not delete its object.
+    auto node = m_directoryTree->Find(filePath).lock();
+    bool hardLink = node && *node &&
+                    (node->IsHardLink() ||
+                     (!node->IsDirectory() && node->GetNumLink() >= 2));
+    m_directoryTree->Remove(filePath);
+    if (m_cache->HasFile(filePath)) {
+      m_cache->Erase(filePath);
+    }
+    if (!hardLink) {
+      m_negativeCache->Add(filePath);
+      m_deleteBatcher->Add(filePath);
+    }
+  } else if (async) {
     GetClient()->GetExecutor()->SubmitAsyncPrioritized(
         ReceivedHandler,
         [this, filePath] { return GetClient()->DeleteFile(filePath); });
   } else {
+    WaitForRemoval(filePath);
     ReceivedHandler(GetClient()->DeleteFile(filePath));
   }
 }
 
+// --------------------------------------------------------------------------
+void Drive::FlushRemovals() {
+  if (m_deleteBatcher) {
+    m_deleteBatcher->Flush();
+  }
+}
+
+// --------------------------------------------------------------------------
+void Drive::WaitForRemoval(const string &path) {
+  if (m_deleteBatcher && m_deleteBatcher->IsPending(path)) {
+    m_deleteBatcher->Flush();
+  }
+}
+
 // --------------------------------------------------------------------------
 void Drive::HardLink(const string &filePath, const string &hardlinkPath) {
   // DO NOT use it for now.
@@ -367,6 +812,7 @@ void Drive::HardLink(const string &filePath, const string &hardlinkPath) {
   }
 
   m_directoryTree->HardLink(filePath, hardlinkPath);
+  InvalidateNegativeLookups(hardlinkPath);
 }
 
 // --------------------------------------------------------------------------
@@ -390,6 +836,7 @@ void Drive::MakeFile(const string &filePath, mode_t mode, dev_t dev) {
   }
 
   if (type == FileType::File) {
+    WaitForRemoval(filePath);
     auto err = GetClient()->MakeFile(filePath);
     if (!IsGoodQSError(err)) {
       DebugError(GetMessageForQSError(err));
@@ -397,6 +844,7 @@ void Drive::MakeFile(const string &filePath, mode_t mode, dev_t dev) {
     }
 
     DebugInfo("Create file " + FormatPath(filePath));
+    InvalidateNegativeLookups(filePath);
 
     // QSClient::MakeFile doesn't update directory tree (refer it for details)
     // with the created file node, So we call Stat synchronizely.
@@ -417,6 +865,7 @@ void Drive::MakeFile(const string &filePath, mode_t mode, dev_t dev) {
 
 // --------------------------------------------------------------------------
 void Drive::MakeDir(const string &dirPath, mode_t mode) {
+  WaitForRemoval(dirPath);
   auto err = GetClient()->MakeDirectory(dirPath);
   if (!IsGoodQSError(err)) {
     DebugError(GetMessageForQSError(err));
@@ -424,6 +873,7 @@ void Drive::MakeDir(const string &dirPath, mode_t mode) {
   }
 
   DebugInfo("Create dir " + FormatPath(dirPath));
+  InvalidateNegativeLookups(dirPath);
 
   // QSClient::MakeDirectory doesn't grow directory tree with the created dir
   // node, So we call Stat synchronizely.
@@ -457,10 +907,35 @@ void Drive::OpenFile(const string &filePath, bool async) {
     }
   }
 
+  {
+    lock_guard<mutex> lock(m_openCountsMutex);
+    ++m_openCounts[filePath];
+  }
   node->SetFileOpen(true);
   m_cache->SetFileOpen(filePath, true);
 }
 
+// --------------------------------------------------------------------------
+void Drive::ReleaseFile(const string &filePath) {
+  {
+    lock_guard<mutex> lock(m_openCountsMutex);
+    auto it = m_openCounts.find(filePath);
+    if (it != m_openCounts.end()) {
+      if (--it->second > 0) {
+        return;  // still opened by others
+      }
+      m_openCounts.erase(it);
+    }
+  }
+  m_cache->CancelDownloads(filePath);
+}
+
+// --------------------------------------------------------------------------
+bool Drive::IsFileOpen(const string &filePath) {
+  lock_guard<mutex> lock(m_openCountsMutex);
+  return m_openCounts.find(filePath) != m_openCounts.end();
+}
+
 // --------------------------------------------------------------------------
 size_t Drive::ReadFile(const string &filePath, off_t offset, size_t size,
                        char *buf) {
@@ -497,7 +972,11 @@ size_t Drive::ReadFile(const string &filePath, off_t offset, size_t size,
   // Download file if not found in cache or if cache need update
   bool fileContentExist = m_cache->HasFileData(filePath, offset, downloadSize);
   if (!fileContentExist || modified) {
-    // download synchronizely for request file part
+    // download synchronizely for request file part, the bytes are forced
+    // against the download budget as the reading could not be deferred, and
+    // capped as reading is never run by a transfer worker
+    ScopedForcedBytes forced(m_transferManager->GetDownloadBudget().get(),
+                             downloadSize);
     auto stream = make_shared<IOStream>(downloadSize);
     auto handle =
         m_transferManager->DownloadFile(filePath, offset, downloadSize, stream);
@@ -546,11 +1025,22 @@ void Drive::ReadSymlink(const std::string &linkPath) {
 
 // --------------------------------------------------------------------------
 void Drive::RenameFile(const string &filePath, const string &newFilePath) {
+  WaitForRemoval(newFilePath);
   // Do Renaming
   auto err = GetClient()->MoveFile(filePath, newFilePath);
 
   // Update meta(such as mtime, .etc)
   if (IsGoodQSError(err)) {
+    InvalidateNegativeLookups(newFilePath);
+    {
+      // the file opened will be released with the new path
+      lock_guard<mutex> lock(m_openCountsMutex);
+      auto it = m_openCounts.find(filePath);
+      if (it != m_openCounts.end()) {
+        m_openCounts[newFilePath] += it->second;
+        m_openCounts.erase(filePath);
+      }
+    }
     auto res = GetNode(newFilePath, false);
     auto node = res.first.lock();
     if (node) {
@@ -568,49 +1058,38 @@ void Drive::RenameFile(const string &filePath, const string &newFilePath) {
 // --------------------------------------------------------------------------
 void Drive::RenameDir(const string &dirPath, const string &newDirPath,
                       bool async) {
+  // Make sure the removed children are not moved
+  FlushRemovals();
   // Do Renaming
   auto ReceivedHandler = [this, dirPath,
                           newDirPath](const ClientError<QSError> &err) {
+    // the objects moved could be looked up as not existing before
+    InvalidateNegativeLookups(newDirPath, true);
     if (IsGoodQSError(err)) {
-      // Rename local cache
-      auto node = GetNodeSimple(dirPath).lock();
-      auto childPaths = node->GetChildrenIdsRecursively();
-      size_t len = dirPath.size();
-      deque<string> childTargetPaths;
-      for (auto &path : childPaths) {
-        if (path.substr(0, len) != dirPath) {
-          DebugError("Directory has an invalid child file [dir=" + dirPath +
-                     " child=" + path + "]");
-          childTargetPaths.emplace_back(path);  // put old path
-        }
-        childTargetPaths.emplace_back(newDirPath + path.substr(len));
+      // All objects have been moved, rename local cache and dir tree in bulk
+      if (m_cache) {
+        m_cache->RenameDirectory(dirPath, newDirPath);
       }
-      while (!childPaths.empty() && !childTargetPaths.empty()) {
-        auto source = childPaths.back();
-        childPaths.pop_back();
-        auto target = childTargetPaths.back();
-        childTargetPaths.pop_back();
-        if (m_cache && m_cache->HasFile(source)) {
-          m_cache->Rename(source, target);
-        }
-      }
-
-      // Remove old dir node from dir tree
-      if (m_directoryTree) {
-        m_directoryTree->Remove(dirPath);
-      }
-
-      // Add new dir node to dir tree
-      auto res = GetNode(newDirPath, true, false);  // update dir sync
-      node = res.first.lock();
-      if (node) {
+      if (m_directoryTree &&
+          m_directoryTree->RenameDirectory(dirPath, newDirPath)) {
         DebugInfo("Rename dir " + FormatPath(dirPath, newDirPath));
-      } else {
-        DebugWarning("Fail to rename dir " + FormatPath(dirPath));
+        return;
       }
     } else {
       DebugError(GetMessageForQSError(err));
     }
+
+    // Fall back to synchronize with object storage
+    if (m_directoryTree) {
+      m_directoryTree->Remove(dirPath);
+    }
+    auto res = GetNode(newDirPath, true, false);  // update dir sync
+    auto node = res.first.lock();
+    if (node) {
+      DebugInfo("Rename dir " + FormatPath(dirPath, newDirPath));
+    } else {
+      DebugWarning("Fail to rename dir " + FormatPath(dirPath));
+    }
   };
 
   if (async) {
@@ -629,6 +1108,7 @@ void Drive::RenameDir(const string &dirPath, const string &newDirPath,
 // pathname resolution.
 void Drive::SymLink(const string &filePath, const string &linkPath) {
   assert(!filePath.empty() && !linkPath.empty());
+  WaitForRemoval(linkPath);
   auto err = GetClient()->SymLink(filePath, linkPath);
   if (!IsGoodQSError(err)) {
     DebugError("Fail to create a symbolic link [path=" + filePath +
@@ -638,6 +1118,7 @@ void Drive::SymLink(const string &filePath, const string &linkPath) {
   }
 
   DebugInfo("Create symlink " + FormatPath(filePath, linkPath));
+  InvalidateNegativeLookups(linkPath);
 
   // QSClient::Symlink doesn't update directory tree (refer it for details)
   // with the created symlink node, So we call Stat synchronizely.
@@ -673,6 +1154,8 @@ void Drive::TruncateFile(const string &filePath, size_t newSize) {
 
 // --------------------------------------------------------------------------
 void Drive::UploadFile(const string &filePath, bool async) {
+  // the pending removal must not delete the object being uploaded
+  WaitForRemoval(filePath);
   auto res = GetNode(filePath, false);
   auto node = res.first.lock();
 
@@ -685,8 +1168,12 @@ void Drive::UploadFile(const string &filePath, bool async) {
                    filePath](const shared_ptr<TransferHandle> &handle) {
     if (handle) {
       node->SetNeedUpload(false);
-      node->SetFileOpen(false);
-      m_cache->SetFileOpen(filePath, false);
+      // closing the file cancels its speculative downloads, which could be
+      // still wanted by the others opening it
+      if (!IsFileOpen(filePath)) {
+        node->SetFileOpen(false);
+        m_cache->SetFileOpen(filePath, false);
+      }
       if (handle->IsMultipart()) {
         m_unfinishedMultipartUploadHandles.emplace(handle->GetObjectKey(),
                                                    handle);
@@ -715,8 +1202,9 @@ void Drive::UploadFile(const string &filePath, bool async) {
   time_t mtime = node->GetMTime();
   auto ranges = m_cache->GetUnloadedRanges(filePath, 0, fileSize);
   if (async) {
-    GetTransferManager()->GetExecutor()->SubmitAsync(
-        Callback, [this, filePath, fileSize, ranges, mtime]() {
+    GetTransferManager()->GetScheduler()->SubmitAsync(
+        filePath, Callback, [this, filePath, fileSize, ranges, mtime]() {
+          ScopedRequestPriority priority(RequestPriority::Background);
           // download unloaded pages for file
           // this is need as user could open a file and edit a part of it,
           // but you need the completed file in order to upload it.
@@ -769,8 +1257,12 @@ int Drive::WriteFile(const string &filePath, off_t offset, size_t size,
 void Drive::DownloadFileContentRanges(const string &filePath,
                                       const ContentRangeDeque &ranges,
                                       time_t mtime, bool async) {
-  auto DownloadRange = [this, filePath, async,
-                        mtime](const pair<off_t, size_t> &range) {
+  // Asynchronous downloads are speculative, bind them with the token of the
+  // file, so they are dropped once the file is closed or removed from cache.
+  shared_ptr<CancellationToken> token =
+      async ? m_cache->GetCancellationToken(filePath, mtime) : nullptr;
+  auto DownloadRange = [this, filePath, async, mtime,
+                        token](const pair<off_t, size_t> &range) {
     off_t offset = range.first;
     size_t size = range.second;
     // Download file if not found in cache or if cache need update
@@ -789,13 +1281,44 @@ void Drive::DownloadFileContentRanges(const string &filePath,
         if (downloadSize_ <= 0) {
           break;
         }
+        if (token && token->IsCancelled()) {
+          DebugInfo("Download cancelled [offset:" + to_string(offset_) + "] " +
+                    FormatPath(filePath));
+          break;
+        }
+
+        // Hold the download budget before allocating the stream, this bounds
+        // the pending download streams in total. The download is just
+        // deferred when the budget is exhausted, as the unloaded ranges will
+        // be submitted again by the following reading.
+        // Synchronous download never waits on the budget, as it could be
+        // running in a transfer worker which the budget holders are queued
+        // for, it forces the bytes without the cap.
+        auto &budget = GetTransferManager()->GetDownloadBudget();
+        unique_ptr<ScopedForcedBytes> forced;
+        if (async) {
+          if (!budget->TryAcquire(downloadSize_)) {
+            DebugInfo("Download budget exhausted, defer downloading [offset:" +
+                      to_string(offset_) + "] " + FormatPath(filePath));
+            break;
+          }
+        } else {
+          forced.reset(
+              new ScopedForcedBytes(budget.get(), downloadSize_, false));
+        }
 
         auto stream_ = make_shared<IOStream>(downloadSize_);
-        auto Callback = [this, filePath, offset_, downloadSize_, stream_,
-                         mtime](const shared_ptr<TransferHandle> &handle) {
+        auto Callback = [this, filePath, offset_, downloadSize_, stream_, mtime,
+                         token,
+                         async](const shared_ptr<TransferHandle> &handle) {
           if (handle) {
             handle->WaitUntilFinished();
-            if (handle->DoneTransfer() && !handle->HasFailedParts()) {
+            if (token && token->IsCancelled()) {
+              // the file is gone, drop the data
+              if (handle->DoneTransfer()) {
+                m_transferManager->AddCancelledDownloadBytes(downloadSize_);
+              }
+            } else if (handle->DoneTransfer() && !handle->HasFailedParts()) {
               bool success = m_cache->Write(filePath, offset_, downloadSize_,
                                             std::move(stream_), mtime);
               DebugErrorIf(!success,
@@ -804,13 +1327,27 @@ void Drive::DownloadFileContentRanges(const string &filePath,
                                to_string(downloadSize_) + "]");
             }
           }
+          if (async) {
+            m_transferManager->GetDownloadBudget()->Release(downloadSize_);
+          }
         };
 
         if (async) {
-          GetTransferManager()->GetExecutor()->SubmitAsync(
-              Callback, [this, filePath, offset_, downloadSize_, stream_]() {
-                return m_transferManager->DownloadFile(filePath, offset_,
-                                                       downloadSize_, stream_);
+          // schedule per file, so a large file will not starve the others
+          GetTransferManager()->GetScheduler()->SubmitAsync(
+              filePath, Callback,
+              [this, filePath, offset_, downloadSize_, stream_, token]() {
+                ScopedRequestPriority priority(RequestPriority::Background);
+                if (token->IsCancelled()) {
+                  m_transferManager->AddCancelledDownloadBytes(downloadSize_);
+                  return shared_ptr<TransferHandle>(nullptr);
+                }
+                // Download synchronously, as this task is running in a
+                // transfer worker, queuing the parts to the same workers
+                // and waiting for them could exhaust the workers. The token
+                // is checked between the parts.
+                return m_transferManager->DownloadFile(
+                    filePath, offset_, downloadSize_, stream_, false, token);
               });
         } else {
           auto handle = m_transferManager->DownloadFile(filePath, offset_,
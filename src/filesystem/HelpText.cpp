@@ -32,8 +32,15 @@ namespace HelpText {
 using QS::Configure::Default::GetDefaultCredentialsFile;
 using QS::Configure::Default::GetDefaultDiskCacheDirectory;
 using QS::Configure::Default::GetDefaultLogDirectory;
+using QS::Configure::Default::GetDefaultHedgePercent;
+using QS::Configure::Default::GetDefaultNegativeTTLInSec;
+using QS::Configure::Default::GetDefaultMaxStaleInMin;
+using QS::Configure::Default::GetDefaultWarmUpListings;
 using QS::Configure::Default::GetDefaultHostName;
 using QS::Configure::Default::GetDefaultProtocolName;
+using QS::Configure::Default::GetDefaultTimeoutCeilingInMs;
+using QS::Configure::Default::GetDefaultTimeoutFloorInMs;
+using QS::Configure::Default::GetDefaultMaxDownloadInFlightSize;
 using QS::Configure::Default::GetDefaultParallelTransfers;
 using QS::Configure::Default::GetDefaultTransferBufSize;
 using QS::Configure::Default::GetDefaultZone;
@@ -88,6 +95,19 @@ void ShowQSFSHelp() {
                         << to_string(GetMaxStatCount() / QS::Data::Size::K1) << "K\n"
   "  -e, --statexpire   Expire time(minutes) for stat entries, negative value will\n"
   "                     disable stat expire, default is no expire\n"
+  "  -N, --negativettl  Time(seconds) to remember the paths not existing, lookups\n"
+  "                     of them within it cost no request, 0 means disable it,\n"
+  "                     default is " << to_string(GetDefaultNegativeTTLInSec()) << "\n"
+  "  -E, --maxstale     Time(minutes) after stat expire, within which the expired\n"
+  "                     stat entries are used while being refreshed in background,\n"
+  "                     0 means disable it, default is " << to_string(GetDefaultMaxStaleInMin()) << "\n"
+  "  -F, --snapshot     Specify the file to save the directory tree periodically and at\n"
+  "                     unmount, which is loaded at mount to serve the stat entries\n"
+  "                     without listing again, default is no snapshot\n"
+  "  -W, --warmup       Count of directory listings in parallel to crawl the whole\n"
+  "                     bucket at mount, which warms up the stat entries for find\n"
+  "                     or du, 0 means disable it, no more than the count of\n"
+  "                     threads, default is " << to_string(GetDefaultWarmUpListings()) << "\n"
   "  -i, --maxlist      Max count of files of ls operation, negative value will list\n"
   "                     all files, default is " << to_string(GetMaxListObjectsCount()) <<"\n"
   "  -n, --numtransfer  Max number file tranfers to run in parallel, you can increase\n"
@@ -96,6 +116,25 @@ void ShowQSFSHelp() {
   "  -u, --bufsize      File transfer buffer size(MB), this should be larger than 8MB,\n"
   "                     default is " 
                         << to_string(GetDefaultTransferBufSize() / QS::Data::Size::MB1) << "MB\n"
+  "  -B, --maxdownload  Max size(MB) of file data being downloaded or queued for\n"
+  "                     download at a time, prefetching of file data will be deferred\n"
+  "                     when exceeded, default is "
+                        << to_string(GetDefaultMaxDownloadInFlightSize() / QS::Data::Size::MB1) << "MB\n"
+  "  -x, --downloadrate Max download rate(KB/s), prefetching is throttled before\n"
+  "                     reading, 0 means unlimited, default is 0\n"
+  "  -y, --uploadrate   Max upload rate(KB/s), 0 means unlimited, default is 0\n"
+  "  -q, --requestrate  Max number of requests sent to object storage per second,\n"
+  "                     0 means unlimited, default is 0\n"
+  "  -k, --hedgerate    Max percent(0-100) of range downloads to hedge, a duplicate\n"
+  "                     request is sent if a download is slower than most recent\n"
+  "                     ones, 0 means disable hedging, default is "
+                        << to_string(GetDefaultHedgePercent()) << "\n"
+  "  -j, --mintimeout   Min timeout(ms) of file transfers and listing, which are\n"
+  "                     derived from the speed of recent ones, default is "
+                        << to_string(GetDefaultTimeoutFloorInMs()) << "\n"
+  "  -w, --maxtimeout   Max timeout(ms) of file transfers and listing, 0 means\n"
+  "                     unbounded, default is "
+                        << to_string(GetDefaultTimeoutCeilingInMs()) << "\n"
   "  -H, --host         Host name, default is " << GetDefaultHostName() << "\n" <<
   "  -p, --protocol     Protocol could be https or http, default is " <<
                                               GetDefaultProtocolName() << "\n" <<
@@ -127,8 +166,14 @@ void ShowQSFSUsage() {
   "       [-r|--retries=[value]] [-R|reqtimeout=[value]]\n"
   "       [-Z|--maxcache=[value]] [-D|--diskdir=[value]]\n"
   "       [-t|--maxstat=[value]] [-e|--statexpire=[value]]\n"
+  "       [-N|--negativettl=[value]] [-E|--maxstale=[value]]\n"
+  "       [-F|--snapshot=[file path]] [-W|--warmup=[value]]\n"
   "       [-i|--maxlist=[value]]\n"
   "       [-n|--numtransfer=[value]] [-u|--bufsize=value]]\n"
+  "       [-B|--maxdownload=[value]]\n"
+  "       [-x|--downloadrate=[value]] [-y|--uploadrate=[value]]\n"
+  "       [-q|--requestrate=[value]] [-k|--hedgerate=[value]]\n"
+  "       [-j|--mintimeout=[value]] [-w|--maxtimeout=[value]]\n"
   "       [-H|--host=[value]] [-p|--protocol=[value]]\n"
   "       [-P|--port=[value]] [-a|--agent=[value]]\n"
   "       [-C|--clearlogdir] [-f|--foreground] \n"
@@ -38,12 +38,15 @@
 #include "configure/Default.h"
 #include "configure/Options.h"
 #include "data/Directory.h"
+#include "data/DirectoryStream.h"
 #include "filesystem/Drive.h"
 
 namespace QS {
 
 namespace FileSystem {
 
+using QS::Data::DirectoryStream;
+using QS::Data::EntrySnapshot;
 using QS::Data::Node;
 using QS::Exception::QSException;
 using QS::Configure::Default::GetNameMaxLen;
@@ -97,19 +100,20 @@ shared_ptr<Node> CheckParentDir(const string& path, int amode, int* ret,
     parent = res.first.lock();
   }
 
-  if (!(parent && *parent)) {
+  auto snapshot = parent ? parent->GetSnapshot() : EntrySnapshot();
+  if (!snapshot.operable) {
     *ret = -EINVAL;
     throw QSException("No parent directory " + FormatPath(path));
   }
 
   // Check whether parent is directory
-  if (!parent->IsDirectory()) {
+  if (!snapshot.IsDirectory()) {
     *ret = -EINVAL;
     throw QSException("Parent is not a directory " + FormatPath(dirName));
   }
 
   // Check access permission
-  if (!parent->FileAccess(GetFuseContextUID(), GetFuseContextGID(), amode)) {
+  if (!snapshot.FileAccess(GetFuseContextUID(), GetFuseContextGID(), amode)) {
     *ret = -EACCES;
     throw QSException("No access permission (" + AccessMaskToString(amode) +
                       ") for directory" + FormatPath(dirName));
@@ -178,14 +182,12 @@ void FillStatvfs(const struct statvfs& source, struct statvfs* target) {
 //          - 2nd member is the path maybe appended with "/"
 //
 pair<weak_ptr<Node>, string> GetFileSimple(const char* path) {
-  string appendPath = path;
-  auto& drive = Drive::Instance();
-  auto node = drive.GetNodeSimple(path).lock();
-  if (!node && string(path).back() != '/') {
-    appendPath = AppendPathDelim(path);
-    node = drive.GetNodeSimple(appendPath).lock();
+  string path_ = path;
+  auto node = Drive::Instance().GetFileOrDirectorySimple(path_).lock();
+  if (node && path_.back() != '/' && node->GetName().back() == '/') {
+    path_ = AppendPathDelim(path_);
   }
-  return {node, appendPath};
+  return {node, path_};
 }
 
 // --------------------------------------------------------------------------
@@ -204,23 +206,13 @@ tuple<weak_ptr<Node>, bool, string> GetFile(const char* path,
                                             bool updateIfIsDir = false,
                                             bool updateDirAsync = false) {
   auto& drive = Drive::Instance();
-  auto out = GetFileSimple(path);
-  if (out.first.lock()) {  // found node in local dir tree
-    // connect to object storage to update file
-    auto path_ = out.second;
-    auto res = drive.GetNode(path_, updateIfIsDir, updateDirAsync);
-    return std::make_tuple(res.first, res.second, path_);
-  } else {  // not found in local dir tree
-    // connect to object storage to retrive file
-    string appendPath = path;
-    auto res = drive.GetNode(path, updateIfIsDir, updateDirAsync);
-    auto node = res.first.lock();
-    if (!node && string(path).back() != '/') {
-      appendPath = AppendPathDelim(path);
-      res = drive.GetNode(appendPath, updateIfIsDir, updateDirAsync);
-    }
-    return std::make_tuple(res.first, res.second, appendPath);
+  // resolve "path" and "path/" at once, in local dir tree or object storage
+  auto path_ = drive.ResolveFileOrDirectory(path);
+  if (path_.empty()) {
+    return std::make_tuple(weak_ptr<Node>(), false, string(path));
   }
+  auto res = drive.GetNode(path_, updateIfIsDir, updateDirAsync);
+  return std::make_tuple(res.first, res.second, path_);
 }
 
 }  // namespace
@@ -254,7 +246,7 @@ void InitializeFUSECallbacks(struct fuse_operations* fuseOps) {
   // fuseOps->removexattr = NULL;
   fuseOps->opendir = qsfs_opendir;
   fuseOps->readdir = qsfs_readdir;
-  // fuseOps->releasedir = NULL;
+  fuseOps->releasedir = qsfs_releasedir;
   // fuseOps->fsyncdir = NULL;
   fuseOps->init = qsfs_init;
   fuseOps->destroy = qsfs_destroy;
@@ -296,9 +288,9 @@ int qsfs_getattr(const char* path, struct stat* statbuf) {
     // Check file
     auto res = GetFile(path, false);  // not update dir
     auto node = std::get<0>(res).lock();
-    if (node && *node) {
-      auto st = const_cast<const Node&>(*node).GetEntry().ToStat();
-      FillStat(st, statbuf);
+    auto snapshot = node ? node->GetSnapshot() : EntrySnapshot();
+    if (snapshot.operable) {
+      FillStat(snapshot.st, statbuf);
     } else {
       ret = -ENOENT;
       throw QSException("No such file or directory " + FormatPath(path));
@@ -553,6 +545,9 @@ int qsfs_rmdir(const char* path) {
     // Check parent directory
     auto dir = CheckParentDir(path, W_OK | X_OK, &ret, false);
 
+    // Removals of the children may be still pending
+    drive.FlushRemovals();
+
     string path_ = AppendPathDelim(path);
     auto res = drive.GetNode(path_, true);  // update dir synchronizely
     auto node = res.first.lock();
@@ -688,6 +683,7 @@ int qsfs_rename(const char* path, const char* newpath) {
     CheckStickyBit(dir, node, &ret);
 
     // Delete newpath if it exists and it's an empty directory
+    Drive::Instance().FlushRemovals();  // newpath may be pending for removal
     auto nRes = GetFile(newpath, true);  // update dir synchronizely
     auto nNode = std::get<0>(nRes).lock();
     string newpath_ = std::get<2>(nRes);
@@ -1233,6 +1229,9 @@ int qsfs_release(const char* path, struct fuse_file_info* fi) {
     return -EINVAL;
   }
 
+  // count every release, only the last one cancels the speculative downloads
+  Drive::Instance().ReleaseFile(path);
+
   int ret = 0;
   try {
     // "Getattr()" is called before this callback, which already checked X_OK
@@ -1339,25 +1338,29 @@ int qsfs_opendir(const char* path, struct fuse_file_info* fi) {
 
     // Check if dir exists
     auto node = drive.GetNodeSimple(dirPath).lock();
-
-    if (!(node && *node)) {
+    auto snapshot = node ? node->GetSnapshot() : EntrySnapshot();
+    if (!snapshot.operable) {
       ret = -ENOENT;
       throw QSException("No such directory " + FormatPath(path));
     }
 
     // Check if file is dir
-    if (!node->IsDirectory()) {
+    if (!snapshot.IsDirectory()) {
       ret = -ENOTDIR;
       throw QSException("Not a directory " + FormatPath(dirPath));
     }
 
     // Check access permission
-    if (!node->FileAccess(GetFuseContextUID(), GetFuseContextGID(), mask)) {
+    if (!snapshot.FileAccess(GetFuseContextUID(), GetFuseContextGID(), mask)) {
       ret = -EACCES;
       throw QSException("No read permission " + FormatPath(dirPath));
     }
 
-    drive.GetNode(dirPath, true);  // update dir synchronizely
+    // A dir not listed recently is listed page by page while reading, so
+    // readdir returns the children as soon as the first page is listed
+    drive.GetNode(dirPath, false);
+    fi->fh = reinterpret_cast<uint64_t>(
+        drive.OpenDirectoryStream(dirPath).release());
   } catch (const QSException& err) {
     Error(err.get());
     if (ret == 0) {
@@ -1372,9 +1375,17 @@ int qsfs_opendir(const char* path, struct fuse_file_info* fi) {
 // --------------------------------------------------------------------------
 // Read directory.
 //
-// Ignores the offset parameter, and passes zero to the filler function's
-// offset. The filler function will not return '1' (unless an error happens),
-// so the whole directory is read in a single readdir operation.
+// For a dir listed recently, the children are read from the dir tree. The
+// offset parameter is ignored, and zero is passed to the filler function's
+// offset, so the whole directory is read in a single readdir operation.
+//
+// Otherwise the children are read from the directory stream opened by
+// opendir, which lists them page by page. The offsets of the children are
+// passed to the filler function, which returns '1' when the buffer is full,
+// and readdir is called again with the offset to resume from.
+//
+// The attributes of the children are passed to the filler function, so the
+// file types are known to the kernel without looking up each child again.
 //
 // FUSE Invariants (https://github.com/libfuse/libfuse/wiki/Invariants)
 // Readdir is only called with an existing directory name
@@ -1396,37 +1407,64 @@ int qsfs_readdir(const char* path, void* buf, fuse_fill_dir_t filler,
     // Check if dir exists
     // As opendir get called before readdir, no need to update dir again.
     auto node = drive.GetNodeSimple(dirPath).lock();
-    if (!(node && *node)) {
+    auto snapshot = node ? node->GetSnapshot() : EntrySnapshot();
+    if (!snapshot.operable) {
       ret = -ENOENT;
       throw QSException("No such directory " + FormatPath(path));
     }
 
     // Check if file is dir
-    if (!node->IsDirectory()) {
+    if (!snapshot.IsDirectory()) {
       ret = -ENOTDIR;
       throw QSException("Not a directory " + FormatPath(dirPath));
     }
 
     // Check access permission
-    if (!node->FileAccess(GetFuseContextUID(), GetFuseContextGID(), R_OK)) {
+    if (!snapshot.FileAccess(GetFuseContextUID(), GetFuseContextGID(), R_OK)) {
       ret = -EACCES;
       throw QSException("No read permission " + FormatPath(dirPath));
     }
 
+    auto stream = reinterpret_cast<DirectoryStream*>(fi->fh);
+    if (stream != nullptr) {
+      // The offset of '.' is 1, '..' is 2, and the one of the nth child is
+      // n + 2, which is the offset to resume from after it.
+      if (offset < 1 && filler(buf, ".", NULL, 1) == 1) return 0;
+      if (offset < 2 && filler(buf, "..", NULL, 2) == 1) return 0;
+      auto childOffset = static_cast<uint64_t>(offset > 2 ? offset - 2 : 0);
+      auto FillChild = [buf, filler](const DirectoryStream::Child& child,
+                                     uint64_t nextOffset) {
+        return filler(buf, child.name.c_str(), &child.st,
+                      static_cast<off_t>(nextOffset + 2)) == 0;
+      };
+      if (!stream->Read(childOffset, FillChild)) {
+        ret = -EIO;
+        throw QSException("Fail to list directory " + FormatPath(dirPath));
+      }
+      return ret;
+    }
+
     // Put the . and .. entries in the filler
     if (filler(buf, ".", NULL, 0) == 1 || filler(buf, "..", NULL, 0) == 1) {
       ret = -ENOMEM;  // out of memeory
       throw QSException("Fuse filler is full! dir: " + dirPath);
     }
 
-    // Put the children into filler
+    // Put the children with their attributes into filler
     auto childs = drive.FindChildren(dirPath, false);
+    struct stat st;
     for (auto& child : childs) {
       if (auto childNode = child.lock()) {
         auto filename = childNode->MyBaseName();
         assert(!filename.empty());
         if (filename.empty()) continue;
-        if (filler(buf, filename.c_str(), NULL, 0) == 1) {
+        auto childSnapshot = childNode->GetSnapshot();
+        if (childSnapshot.operable) {
+          memset(&st, 0, sizeof(st));
+          FillStat(childSnapshot.st, &st);
+        }
+        if (filler(buf, filename.c_str(),
+                   childSnapshot.operable ? &st : NULL, 0) == 1) {
           ret = -ENOMEM;  // out of memory
           throw QSException("Fuse filler is full! dir: " + dirPath +
                             "child: " + filename);
@@ -1447,7 +1485,9 @@ int qsfs_readdir(const char* path, void* buf, fuse_fill_dir_t filler,
 // --------------------------------------------------------------------------
 // Release a directory.
 int qsfs_releasedir(const char* path, struct fuse_file_info* fi) {
-  // Currently no implementation.
+  // Close the directory stream opened by opendir
+  delete reinterpret_cast<DirectoryStream*>(fi->fh);
+  fi->fh = 0;
   return 0;
 }
 
@@ -1475,7 +1515,12 @@ void* qsfs_init(struct fuse_conn_info* conn) {
   // before fuse_main will exit when the process goes into the background.
   QS::Threading::ThreadPoolInitializer::Instance().DoInitialize();
 
-  return static_cast<QS::FileSystem::Drive *>(fuse_get_context()->private_data);
+  auto drive =
+      static_cast<QS::FileSystem::Drive *>(fuse_get_context()->private_data);
+  if (drive != nullptr) {
+    drive->StartWarmUp();
+  }
+  return drive;
 }
 
 // --------------------------------------------------------------------------
@@ -1512,13 +1557,14 @@ int qsfs_access(const char* path, int mask) {
     auto res = GetFile(path, true, async);  // update dir
     auto node = std::get<0>(res).lock();
     string path_ = std::get<2>(res);
-    if (!(node && *node)) {
+    auto snapshot = node ? node->GetSnapshot() : EntrySnapshot();
+    if (!snapshot.operable) {
       ret = -ENOENT;
       throw QSException("No such file or directory " + FormatPath(path_));
     }
 
     // Check access permission
-    if (!node->FileAccess(GetFuseContextUID(), GetFuseContextGID(), mask)) {
+    if (!snapshot.FileAccess(GetFuseContextUID(), GetFuseContextGID(), mask)) {
       ret = -EACCES;
       throw QSException("No access permission(" + AccessMaskToString(mask) +
                         ") for path " + FormatPath(path_));
@@ -51,6 +51,16 @@ using QS::Configure::Default::GetDefaultHostName;
 using QS::Configure::Default::GetDefaultMaxRetries;
 using QS::Configure::Default::GetDefaultPort;
 using QS::Configure::Default::GetDefaultProtocolName;
+using QS::Configure::Default::GetDefaultMaxDownloadInFlightSize;
+using QS::Configure::Default::GetDefaultDownloadRateLimitInKB;
+using QS::Configure::Default::GetDefaultUploadRateLimitInKB;
+using QS::Configure::Default::GetDefaultRequestRateLimit;
+using QS::Configure::Default::GetDefaultHedgePercent;
+using QS::Configure::Default::GetDefaultNegativeTTLInSec;
+using QS::Configure::Default::GetDefaultMaxStaleInMin;
+using QS::Configure::Default::GetDefaultWarmUpListings;
+using QS::Configure::Default::GetDefaultTimeoutFloorInMs;
+using QS::Configure::Default::GetDefaultTimeoutCeilingInMs;
 using QS::Configure::Default::GetDefaultParallelTransfers;
 using QS::Configure::Default::GetDefaultTransferBufSize;
 using QS::Configure::Default::GetDefaultZone;
@@ -84,8 +94,20 @@ static struct options {
   int32_t maxstat = GetMaxStatCount() / QS::Data::Size::K1;    // in K
   int32_t maxlist = GetMaxListObjectsCount();  // max file count for ls
   int32_t statexpire = -1;    // in mins, negative value disable state expire
+  int32_t negativettl = GetDefaultNegativeTTLInSec();  // in seconds
+  int32_t maxstale = GetDefaultMaxStaleInMin();  // in mins
+  const char *snapshot;
+  int32_t warmup = GetDefaultWarmUpListings();  // listings in parallel
   int numtransfer = GetDefaultParallelTransfers();
   int32_t bufsize = GetDefaultTransferBufSize() / QS::Data::Size::MB1;  // in MB
+  int32_t maxdownload =
+      GetDefaultMaxDownloadInFlightSize() / QS::Data::Size::MB1;  // in MB
+  int32_t downloadrate = GetDefaultDownloadRateLimitInKB();  // in KB/s
+  int32_t uploadrate = GetDefaultUploadRateLimitInKB();      // in KB/s
+  int32_t requestrate = GetDefaultRequestRateLimit();        // per second
+  int32_t hedgerate = GetDefaultHedgePercent();              // in percent
+  int32_t mintimeout = GetDefaultTimeoutFloorInMs();         // in ms
+  int32_t maxtimeout = GetDefaultTimeoutCeilingInMs();       // in ms
   int threads = GetClientDefaultPoolSize();
   const char *host;
   const char *protocol;
@@ -118,8 +140,19 @@ static const struct fuse_opt optionSpec[] = {
     OPTION("-t=%li", maxstat),       OPTION("--maxstat=%li",    maxstat),
     OPTION("-i=%li", maxlist),       OPTION("--maxlist=%li",    maxlist),
     OPTION("-e=%li", statexpire),    OPTION("--statexpire=%li", statexpire),
+    OPTION("-N=%i",  negativettl),   OPTION("--negativettl=%i", negativettl),
+    OPTION("-E=%i",  maxstale),      OPTION("--maxstale=%i",    maxstale),
+    OPTION("-F=%s",  snapshot),      OPTION("--snapshot=%s",    snapshot),
+    OPTION("-W=%i",  warmup),        OPTION("--warmup=%i",      warmup),
     OPTION("-n=%i",  numtransfer),   OPTION("--numtransfer=%i", numtransfer),
     OPTION("-u=%li", bufsize),       OPTION("--bufsize=%li",    bufsize),
+    OPTION("-B=%i",  maxdownload),   OPTION("--maxdownload=%i", maxdownload),
+    OPTION("-x=%i",  downloadrate),  OPTION("--downloadrate=%i", downloadrate),
+    OPTION("-y=%i",  uploadrate),    OPTION("--uploadrate=%i",  uploadrate),
+    OPTION("-q=%i",  requestrate),   OPTION("--requestrate=%i", requestrate),
+    OPTION("-k=%i",  hedgerate),     OPTION("--hedgerate=%i",   hedgerate),
+    OPTION("-j=%i", mintimeout),     OPTION("--mintimeout=%i",  mintimeout),
+    OPTION("-w=%i", maxtimeout),     OPTION("--maxtimeout=%i",  maxtimeout),
     OPTION("-T=%i", threads),        OPTION("--threads=%i",     threads),
     OPTION("-H=%s", host),           OPTION("--host=%s",        host),
     OPTION("-p=%s", protocol),       OPTION("--protocol=%s",    protocol),
@@ -152,6 +185,7 @@ void Parse(int argc, char **argv) {
   options.logDirectory   = strdup(GetDefaultLogDirectory().c_str());
   options.logLevel       = strdup(GetDefaultLogLevelName().c_str());
   options.diskdir        = strdup(GetDefaultDiskCacheDirectory().c_str());
+  options.snapshot       = strdup("");
   options.host           = strdup(GetDefaultHostName().c_str());
   options.protocol       = strdup(GetDefaultProtocolName().c_str());
   options.addtionalAgent = strdup("");
@@ -204,6 +238,23 @@ void Parse(int argc, char **argv) {
   qsOptions.SetMaxListCount(options.maxlist);
   qsOptions.SetStatExpireInMin(options.statexpire);
 
+  if (options.negativettl < 0) {
+    PrintWarnMsg("-N|--negativettl", options.negativettl,
+                 GetDefaultNegativeTTLInSec());
+    qsOptions.SetNegativeTTLInSec(GetDefaultNegativeTTLInSec());
+  } else {
+    qsOptions.SetNegativeTTLInSec(options.negativettl);
+  }
+
+  if (options.maxstale < 0) {
+    PrintWarnMsg("-E|--maxstale", options.maxstale, GetDefaultMaxStaleInMin());
+    qsOptions.SetMaxStaleInMin(GetDefaultMaxStaleInMin());
+  } else {
+    qsOptions.SetMaxStaleInMin(options.maxstale);
+  }
+
+  qsOptions.SetSnapshotFile(options.snapshot);
+
   if (options.numtransfer <= 0) {
     PrintWarnMsg("-n|--numtransfer", options.numtransfer,
                  GetDefaultParallelTransfers());
@@ -221,6 +272,63 @@ void Parse(int argc, char **argv) {
     qsOptions.SetTransferBufferSizeInMB(options.bufsize);
   }
 
+  if (options.maxdownload <= 0) {
+    PrintWarnMsg("-B|--maxdownload", options.maxdownload,
+                 GetDefaultMaxDownloadInFlightSize() / QS::Data::Size::MB1);
+    qsOptions.SetMaxDownloadInFlightSizeInMB(
+        GetDefaultMaxDownloadInFlightSize() / QS::Data::Size::MB1);
+  } else {
+    qsOptions.SetMaxDownloadInFlightSizeInMB(options.maxdownload);
+  }
+
+  if (options.downloadrate < 0) {
+    PrintWarnMsg("-x|--downloadrate", options.downloadrate,
+                 GetDefaultDownloadRateLimitInKB());
+    qsOptions.SetDownloadRateLimitInKB(GetDefaultDownloadRateLimitInKB());
+  } else {
+    qsOptions.SetDownloadRateLimitInKB(options.downloadrate);
+  }
+
+  if (options.uploadrate < 0) {
+    PrintWarnMsg("-y|--uploadrate", options.uploadrate,
+                 GetDefaultUploadRateLimitInKB());
+    qsOptions.SetUploadRateLimitInKB(GetDefaultUploadRateLimitInKB());
+  } else {
+    qsOptions.SetUploadRateLimitInKB(options.uploadrate);
+  }
+
+  if (options.requestrate < 0) {
+    PrintWarnMsg("-q|--requestrate", options.requestrate,
+                 GetDefaultRequestRateLimit());
+    qsOptions.SetRequestRateLimit(GetDefaultRequestRateLimit());
+  } else {
+    qsOptions.SetRequestRateLimit(options.requestrate);
+  }
+
+  if (options.hedgerate < 0 || options.hedgerate > 100) {
+    PrintWarnMsg("-k|--hedgerate", options.hedgerate,
+                 GetDefaultHedgePercent());
+    qsOptions.SetHedgePercent(GetDefaultHedgePercent());
+  } else {
+    qsOptions.SetHedgePercent(options.hedgerate);
+  }
+
+  if (options.mintimeout <= 0) {
+    PrintWarnMsg("-j|--mintimeout", options.mintimeout,
+                 GetDefaultTimeoutFloorInMs());
+    qsOptions.SetTimeoutFloorInMs(GetDefaultTimeoutFloorInMs());
+  } else {
+    qsOptions.SetTimeoutFloorInMs(options.mintimeout);
+  }
+
+  if (options.maxtimeout < 0) {
+    PrintWarnMsg("-w|--maxtimeout", options.maxtimeout,
+                 GetDefaultTimeoutCeilingInMs());
+    qsOptions.SetTimeoutCeilingInMs(GetDefaultTimeoutCeilingInMs());
+  } else {
+    qsOptions.SetTimeoutCeilingInMs(options.maxtimeout);
+  }
+
   if (options.threads <= 0) {
     PrintWarnMsg("-T|--threads", options.threads, GetClientDefaultPoolSize());
     qsOptions.SetClientPoolSize(GetClientDefaultPoolSize());
@@ -228,6 +336,19 @@ void Parse(int argc, char **argv) {
     qsOptions.SetClientPoolSize(options.threads);
   }
 
+  // each listing of warm-up crawl holds a thread and a client request, so
+  // they are no more than the client pool size
+  int32_t maxWarmUp = qsOptions.GetClientPoolSize();
+  if (options.warmup < 0) {
+    PrintWarnMsg("-W|--warmup", options.warmup, GetDefaultWarmUpListings());
+    qsOptions.SetWarmUpListings(GetDefaultWarmUpListings());
+  } else if (options.warmup > maxWarmUp) {
+    PrintWarnMsg("-W|--warmup", options.warmup, maxWarmUp);
+    qsOptions.SetWarmUpListings(maxWarmUp);
+  } else {
+    qsOptions.SetWarmUpListings(options.warmup);
+  }
+
   qsOptions.SetHost(options.host);
   qsOptions.SetProtocol(options.protocol);
 
@@ -0,0 +1,149 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#include <stdint.h>
+
+#include "gtest/gtest.h"
+
+#include "client/AdaptiveTimeout.h"
+#include "data/Size.h"
+
+namespace QS {
+
+namespace Client {
+
+using QS::Data::Size::MB1;
+using ::testing::Test;
+
+namespace {
+
+const uint32_t kFloor = 100;
+const uint32_t kCeiling = 60000;
+const uint32_t kDefault = 12345;
+
+}  // namespace
+
+class AdaptiveTimeoutTest : public Test {
+ protected:
+  // Feed requests transferring at the given speed
+  void Feed(AdaptiveTimeout *timeout, uint64_t bytes, uint32_t msPerMB,
+            int count) {
+    for (int i = 0; i < count; ++i) {
+      timeout->OnComplete(TimedOperation::Download, bytes,
+                          bytes / MB1 * msPerMB);
+    }
+  }
+};
+
+TEST_F(AdaptiveTimeoutTest, DefaultBeforeMeasured) {
+  AdaptiveTimeout timeout(kFloor, kCeiling);
+  EXPECT_EQ(timeout.GetTimeoutInMs(TimedOperation::Download, MB1, kDefault),
+            kDefault);
+  Feed(&timeout, 8 * MB1, 100, 2);
+  EXPECT_EQ(timeout.GetTimeoutInMs(TimedOperation::Download, MB1, kDefault),
+            kDefault);
+  // other operations are not affected
+  Feed(&timeout, 8 * MB1, 100, 10);
+  EXPECT_EQ(timeout.GetTimeoutInMs(TimedOperation::Upload, MB1, kDefault),
+            kDefault);
+}
+
+TEST_F(AdaptiveTimeoutTest, FollowSpeed) {
+  AdaptiveTimeout fastLink(kFloor, kCeiling);
+  AdaptiveTimeout slowLink(kFloor, kCeiling);
+  Feed(&fastLink, 8 * MB1, 10, 50);
+  Feed(&slowLink, 8 * MB1, 1000, 50);
+  auto fast =
+      fastLink.GetTimeoutInMs(TimedOperation::Download, 8 * MB1, kDefault);
+  auto slow =
+      slowLink.GetTimeoutInMs(TimedOperation::Download, 8 * MB1, kDefault);
+  // about twice of the measured time once the samples are stable
+  EXPECT_GE(fast, 160u);
+  EXPECT_LE(fast, 400u);
+  EXPECT_GE(slow, 16000u);
+  EXPECT_LE(slow, 40000u);
+}
+
+TEST_F(AdaptiveTimeoutTest, ScaleWithSize) {
+  AdaptiveTimeout timeout(kFloor, 0);
+  Feed(&timeout, 8 * MB1, 100, 50);
+  auto small = timeout.GetTimeoutInMs(TimedOperation::Download, MB1, kDefault);
+  auto large =
+      timeout.GetTimeoutInMs(TimedOperation::Download, 64 * MB1, kDefault);
+  EXPECT_GT(large, 30 * small);
+}
+
+TEST_F(AdaptiveTimeoutTest, MarginGrowsWithDeviation) {
+  AdaptiveTimeout stable(kFloor, 0);
+  AdaptiveTimeout jittery(kFloor, 0);
+  Feed(&stable, 8 * MB1, 100, 50);
+  for (int i = 0; i < 25; ++i) {
+    Feed(&jittery, 8 * MB1, 50, 1);
+    Feed(&jittery, 8 * MB1, 150, 1);
+  }
+  EXPECT_GT(jittery.GetTimeoutInMs(TimedOperation::Download, 8 * MB1, 0),
+            stable.GetTimeoutInMs(TimedOperation::Download, 8 * MB1, 0));
+}
+
+TEST_F(AdaptiveTimeoutTest, Bounds) {
+  AdaptiveTimeout timeout(kFloor, kCeiling);
+  timeout.OnComplete(TimedOperation::ListObjects, 100, 0);
+  Feed(&timeout, 64 * MB1, 10000, 10);
+  for (int i = 0; i < 10; ++i) {
+    timeout.OnComplete(TimedOperation::ListObjects, 100, 1);
+  }
+  EXPECT_EQ(timeout.GetTimeoutInMs(TimedOperation::ListObjects, 100, kDefault),
+            kFloor);
+  EXPECT_EQ(
+      timeout.GetTimeoutInMs(TimedOperation::Download, 64 * MB1, kDefault),
+      kCeiling);
+}
+
+TEST_F(AdaptiveTimeoutTest, TimeoutBacksOff) {
+  AdaptiveTimeout timeout(kFloor, 0);
+  Feed(&timeout, 8 * MB1, 100, 50);
+  auto before =
+      timeout.GetTimeoutInMs(TimedOperation::Download, 8 * MB1, kDefault);
+  timeout.OnTimeout(TimedOperation::Download);
+  auto after =
+      timeout.GetTimeoutInMs(TimedOperation::Download, 8 * MB1, kDefault);
+  EXPECT_GE(after, 2 * before - 1);
+  EXPECT_EQ(timeout.GetTimeoutCount(TimedOperation::Download), 1u);
+  EXPECT_EQ(timeout.GetTimeoutCount(TimedOperation::Upload), 0u);
+}
+
+TEST_F(AdaptiveTimeoutTest, ZeroEstimateRecovers) {
+  AdaptiveTimeout timeout(0, 0);
+  EXPECT_EQ(timeout.GetFloorInMs(), 1u);
+  for (int i = 0; i < 10; ++i) {
+    timeout.OnComplete(TimedOperation::ListObjects, 100, 0);
+  }
+  EXPECT_EQ(timeout.GetTimeoutInMs(TimedOperation::ListObjects, 100, kDefault),
+            1u);
+  timeout.OnTimeout(TimedOperation::ListObjects);
+  EXPECT_EQ(timeout.GetTimeoutInMs(TimedOperation::ListObjects, 100, kDefault),
+            kDefault);
+}
+
+}  // namespace Client
+}  // namespace QS
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  int code = RUN_ALL_TESTS();
+  return code;
+}
@@ -0,0 +1,172 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+#include <algorithm>
+#include <atomic>  // NOLINT
+#include <chrono>  // NOLINT
+#include <iostream>
+#include <mutex>  // NOLINT
+#include <set>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "client/BucketCrawler.h"
+
+namespace QS {
+
+namespace Client {
+
+using std::atomic;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+using std::lock_guard;
+using std::mutex;
+using std::set;
+using std::string;
+using std::to_string;
+using std::vector;
+using ::testing::Test;
+
+// A stand-in of the bucket with synthetic keys. The dirs at each level have
+// the given count of sub dirs, the dirs at the last level have the given
+// count of files. Listing a dir costs the given latency per page.
+class BucketCrawlerTest : public Test {
+ protected:
+  BucketCrawler::DirectoryLister Lister(const vector<int> &fanouts,
+                                        int filesPerDir, microseconds latency,
+                                        int pageSize = 1000) {
+    return [=](const string &dirPath, vector<string> *subDirPaths) {
+      int running = ++m_running;
+      int maxRunning = m_maxRunning.load();
+      while (running > maxRunning &&
+             !m_maxRunning.compare_exchange_weak(maxRunning, running)) {
+      }
+
+      auto depth = std::count(dirPath.begin(), dirPath.end(), '/') - 1;
+      int subDirs = depth < static_cast<int>(fanouts.size()) ? fanouts[depth]
+                                                              : 0;
+      int files = subDirs == 0 ? filesPerDir : 0;
+      int pages = (subDirs + files + pageSize - 1) / pageSize;
+      for (int i = 0; i < std::max(pages, 1); ++i) {
+        std::this_thread::sleep_for(latency);
+      }
+      for (int i = 0; i < subDirs; ++i) {
+        subDirPaths->push_back(dirPath + "d" + to_string(i) + "/");
+      }
+      m_keys += subDirs + files;
+      {
+        lock_guard<mutex> lock(m_mutex);
+        EXPECT_TRUE(m_listedDirs.insert(dirPath).second) << dirPath;
+      }
+      --m_running;
+      return !m_failedDir.empty() ? dirPath != m_failedDir : true;
+    };
+  }
+
+  mutex m_mutex;
+  set<string> m_listedDirs;
+  string m_failedDir;
+  atomic<uint64_t> m_keys{0};
+  atomic<int> m_running{0};
+  atomic<int> m_maxRunning{0};
+};
+
+TEST_F(BucketCrawlerTest, CrawlAllDirs) {
+  BucketCrawler crawler(Lister({3, 4}, 10, microseconds(0)), 4);
+  // 1 + 3 + 3 * 4 dirs
+  EXPECT_EQ(crawler.Crawl("/"), 16U);
+  EXPECT_EQ(m_listedDirs.size(), 16U);
+  EXPECT_EQ(m_listedDirs.count("/d2/d3/"), 1U);
+  EXPECT_EQ(m_keys.load(), 3U + 3 * 4 + 3 * 4 * 10);
+  EXPECT_EQ(crawler.GetListedCount(), 16U);
+  EXPECT_EQ(crawler.GetFailedCount(), 0U);
+}
+
+TEST_F(BucketCrawlerTest, CrawlSubDir) {
+  BucketCrawler crawler(Lister({3, 4}, 10, microseconds(0)), 2);
+  EXPECT_EQ(crawler.Crawl("/d1/"), 5U);
+  EXPECT_EQ(m_listedDirs.count("/"), 0U);
+  EXPECT_EQ(m_listedDirs.count("/d1/d0/"), 1U);
+}
+
+TEST_F(BucketCrawlerTest, ConcurrencyIsBounded) {
+  BucketCrawler crawler(Lister({20}, 10, microseconds(2000)), 4);
+  EXPECT_EQ(crawler.Crawl("/"), 21U);
+  EXPECT_LE(m_maxRunning.load(), 4);
+  EXPECT_GT(m_maxRunning.load(), 1);
+}
+
+TEST_F(BucketCrawlerTest, FailedDir) {
+  m_failedDir = "/d1/";
+  BucketCrawler crawler(Lister({3, 4}, 10, microseconds(0)), 4);
+  // the sub dirs output by the failed listing are still crawled
+  EXPECT_EQ(crawler.Crawl("/"), 15U);
+  EXPECT_EQ(crawler.GetFailedCount(), 1U);
+  EXPECT_EQ(m_listedDirs.size(), 16U);
+}
+
+TEST_F(BucketCrawlerTest, Cancel) {
+  BucketCrawler *pCrawler = nullptr;
+  auto lister = Lister({10, 10}, 10, microseconds(100));
+  BucketCrawler crawler(
+      [&](const string &dirPath, vector<string> *subDirPaths) {
+        bool success = lister(dirPath, subDirPaths);
+        if (pCrawler->GetListedCount() >= 4) {
+          pCrawler->Cancel();
+        }
+        return success;
+      },
+      2);
+  pCrawler = &crawler;
+  auto listed = crawler.Crawl("/");
+  EXPECT_TRUE(crawler.IsCancelled());
+  EXPECT_GE(listed, 4U);
+  EXPECT_LT(listed, 111U);
+}
+
+// Benchmark: crawl a bucket of 2M keys in 2111 dirs, with a latency of 1ms
+// per page of 1000 keys
+TEST_F(BucketCrawlerTest, DISABLED_BenchmarkCrawl) {
+  for (unsigned concurrency : {1, 4, 16}) {
+    m_listedDirs.clear();
+    m_keys = 0;
+    BucketCrawler crawler(Lister({10, 10, 20}, 1000, microseconds(1000)),
+                          concurrency);
+    auto start = steady_clock::now();
+    auto dirs = crawler.Crawl("/");
+    double ms =
+        duration_cast<microseconds>(steady_clock::now() - start).count() / 1e3;
+    EXPECT_EQ(dirs, 2111U);
+    EXPECT_EQ(m_keys.load(), 2002110U);
+    std::cout << "[ BENCHMARK] crawl " << m_keys.load() << " keys in " << dirs
+              << " dirs with " << concurrency << " workers: " << ms << "ms"
+              << std::endl;
+  }
+}
+
+}  // namespace Client
+}  // namespace QS
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  int code = RUN_ALL_TESTS();
+  return code;
+}
@@ -0,0 +1,157 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#include <chrono>  // NOLINT
+#include <future>  // NOLINT
+#include <memory>
+
+#include "gtest/gtest.h"
+
+#include "base/Logging.h"
+#include "base/Utils.h"
+#include "data/ByteBudget.h"
+
+namespace QS {
+
+namespace Data {
+
+using std::future;
+using std::unique_ptr;
+using ::testing::Test;
+
+// default log dir
+static const char *defaultLogDir = "/tmp/qsfs.test.logs/";
+void InitLog() {
+  QS::Utils::CreateDirectoryIfNotExistsNoLog(defaultLogDir);
+  QS::Logging::InitializeLogging(
+      unique_ptr<QS::Logging::Log>(new QS::Logging::DefaultLog(defaultLogDir)));
+  EXPECT_TRUE(QS::Logging::GetLogInstance() != nullptr)
+      << "log instance is null";
+}
+
+class ByteBudgetTest : public Test {
+ protected:
+  static void SetUpTestCase() { InitLog(); }
+};
+
+TEST_F(ByteBudgetTest, Default) {
+  ByteBudget budget(100);
+  EXPECT_EQ(budget.GetMaxBytes(), 100u);
+  EXPECT_EQ(budget.GetBytesInUse(), 0u);
+  EXPECT_EQ(budget.GetPeakBytesInUse(), 0u);
+  EXPECT_EQ(budget.GetWaitCount(), 0u);
+  EXPECT_EQ(budget.GetRejectCount(), 0u);
+}
+
+TEST_F(ByteBudgetTest, TryAcquire) {
+  ByteBudget budget(100);
+  EXPECT_TRUE(budget.TryAcquire(60));
+  EXPECT_TRUE(budget.TryAcquire(40));
+  EXPECT_FALSE(budget.TryAcquire(1));
+  EXPECT_EQ(budget.GetBytesInUse(), 100u);
+  EXPECT_EQ(budget.GetRejectCount(), 1u);
+
+  budget.Release(60);
+  EXPECT_EQ(budget.GetBytesInUse(), 40u);
+  EXPECT_EQ(budget.GetPeakBytesInUse(), 100u);
+  EXPECT_TRUE(budget.TryAcquire(1));
+}
+
+TEST_F(ByteBudgetTest, OversizeAcquire) {
+  ByteBudget budget(100);
+  // an oversize acquisition is granted only when the budget is free
+  EXPECT_TRUE(budget.TryAcquire(200));
+  EXPECT_FALSE(budget.TryAcquire(1));
+  budget.Release(200);
+  EXPECT_TRUE(budget.TryAcquire(1));
+  EXPECT_FALSE(budget.TryAcquire(200));
+}
+
+TEST_F(ByteBudgetTest, ForceAcquire) {
+  ByteBudget budget(100);
+  budget.ForceAcquire(80);
+  budget.ForceAcquire(80);
+  EXPECT_EQ(budget.GetBytesInUse(), 160u);
+  EXPECT_EQ(budget.GetForcedBytesInUse(), 160u);
+  EXPECT_FALSE(budget.TryAcquire(1));
+  budget.ReleaseForced(160);
+  EXPECT_EQ(budget.GetBytesInUse(), 0u);
+  EXPECT_EQ(budget.GetForcedBytesInUse(), 0u);
+  EXPECT_EQ(budget.GetPeakForcedBytesInUse(), 160u);
+}
+
+TEST_F(ByteBudgetTest, ForceAcquireCapped) {
+  ByteBudget budget(100, 100);
+  budget.Acquire(100);
+  // the forced bytes never wait for the others
+  budget.ForceAcquire(80);
+  EXPECT_EQ(budget.GetBytesInUse(), 180u);
+  future<void> f =
+      std::async(std::launch::async, [&budget] { budget.ForceAcquire(80); });
+  auto status = f.wait_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(status, std::future_status::timeout);
+
+  // but wait for the forced bytes over the cap
+  budget.Release(100);
+  status = f.wait_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(status, std::future_status::timeout);
+  budget.ReleaseForced(80);
+  status = f.wait_for(std::chrono::milliseconds(1000));
+  ASSERT_EQ(status, std::future_status::ready);
+  EXPECT_EQ(budget.GetForcedBytesInUse(), 80u);
+  EXPECT_EQ(budget.GetBytesInUse(), 80u);
+  EXPECT_EQ(budget.GetForcedWaitCount(), 1u);
+  EXPECT_EQ(budget.GetWaitCount(), 0u);
+}
+
+TEST_F(ByteBudgetTest, ScopedForcedBytes) {
+  ByteBudget budget(100, 100);
+  {
+    ScopedForcedBytes forced(&budget, 80);
+    // the uncapped ones never wait
+    ScopedForcedBytes uncapped(&budget, 80, false);
+    EXPECT_EQ(budget.GetForcedBytesInUse(), 160u);
+    EXPECT_EQ(budget.GetBytesInUse(), 160u);
+  }
+  EXPECT_EQ(budget.GetForcedBytesInUse(), 0u);
+  EXPECT_EQ(budget.GetBytesInUse(), 0u);
+  EXPECT_EQ(budget.GetForcedWaitCount(), 0u);
+}
+
+TEST_F(ByteBudgetTest, AcquireBlocksUntilRelease) {
+  ByteBudget budget(100);
+  budget.Acquire(80);
+  future<void> f =
+      std::async(std::launch::async, [&budget] { budget.Acquire(50); });
+  auto status = f.wait_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(status, std::future_status::timeout);
+
+  budget.Release(80);
+  status = f.wait_for(std::chrono::milliseconds(1000));
+  ASSERT_EQ(status, std::future_status::ready);
+  EXPECT_EQ(budget.GetBytesInUse(), 50u);
+  EXPECT_EQ(budget.GetWaitCount(), 1u);
+}
+
+}  // namespace Data
+}  // namespace QS
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  int code = RUN_ALL_TESTS();
+  return code;
+}
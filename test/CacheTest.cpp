@@ -406,6 +406,27 @@ class CacheTest : public Test {
     vector<char> arr4{'0', '1'};
     EXPECT_EQ(buf4, arr4);
   }
+
+  // --------------------------------------------------------------------------
+  void TestRenameDirectory() {
+    uint64_t cacheCap = 100;
+    Cache cache(cacheCap);
+
+    constexpr const char *page1 = "012";
+    constexpr size_t len1 = strlen(page1);
+    cache.Write("/dir/file1", 0, len1, page1, 0);
+    cache.Write("/dir/sub/file2", 0, len1, page1, 0);
+    cache.Write("/dir1/file3", 0, len1, page1, 0);
+
+    cache.RenameDirectory("/dir/", "/newdir/");
+    EXPECT_FALSE(cache.HasFile("/dir/file1"));
+    EXPECT_FALSE(cache.HasFile("/dir/sub/file2"));
+    EXPECT_TRUE(cache.HasFile("/newdir/file1"));
+    EXPECT_TRUE(cache.HasFile("/newdir/sub/file2"));
+    EXPECT_TRUE(cache.HasFile("/dir1/file3"));
+    EXPECT_EQ(cache.GetNumFile(), 3u);
+    EXPECT_EQ(cache.GetSize(), 3 * len1);
+  }
 };
 
 TEST_F(CacheTest, Default) { TestDefault(); }
@@ -422,6 +443,8 @@ TEST_F(CacheTest, Read) { TestRead(); }
 
 TEST_F(CacheTest, ReadDiskFile) { TestReadDiskFile(); }
 
+TEST_F(CacheTest, RenameDirectory) { TestRenameDirectory(); }
+
 }  // namespace Data
 }  // namespace QS
 
@@ -0,0 +1,233 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#include <algorithm>
+#include <atomic>  // NOLINT
+#include <chrono>  // NOLINT
+#include <future>  // NOLINT
+#include <iostream>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "client/ConcurrencyController.h"
+
+namespace QS {
+
+namespace Client {
+
+using std::atomic;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+using std::future;
+using std::vector;
+using ::testing::Test;
+
+// A stand-in of object storage server.
+//
+// Each connection sends at most window bytes per round trip, and all the
+// connections share the bandwidth, so the concurrency needed to fill the
+// link is bandwidth-delay product / window. Requests exceeding the max
+// concurrency of the server are throttled.
+class StandInServer {
+ public:
+  StandInServer(int rttMs, uint64_t windowBytes, uint64_t bytesPerMs,
+                int maxConcurrency)
+      : m_rttMs(rttMs),
+        m_windowBytes(windowBytes),
+        m_bytesPerMs(bytesPerMs),
+        m_maxConcurrency(maxConcurrency),
+        m_active(0),
+        m_throttled(0) {}
+
+  // Return false if the request is throttled
+  bool Transfer(uint64_t bytes) {
+    int active = ++m_active;
+    if (active > m_maxConcurrency) {
+      std::this_thread::sleep_for(milliseconds(m_rttMs));
+      --m_active;
+      ++m_throttled;
+      return false;
+    }
+    double byWindow = static_cast<double>(bytes) / m_windowBytes * m_rttMs;
+    double byBandwidth = static_cast<double>(bytes) * active / m_bytesPerMs;
+    auto ms = m_rttMs + std::max(byWindow, byBandwidth);
+    std::this_thread::sleep_for(
+        std::chrono::microseconds(static_cast<int64_t>(ms * 1000)));
+    --m_active;
+    return true;
+  }
+
+  int GetThrottledCount() const { return m_throttled.load(); }
+
+ private:
+  int m_rttMs;
+  uint64_t m_windowBytes;
+  uint64_t m_bytesPerMs;
+  int m_maxConcurrency;
+  atomic<int> m_active;
+  atomic<int> m_throttled;
+};
+
+class ConcurrencyControllerTest : public Test {
+ protected:
+  struct Result {
+    double partsPerSecond;
+    int throttled;
+  };
+
+  // Transfer parts with given worker threads for a period, all transfers go
+  // through the controller.
+  Result RunTransfers(ConcurrencyController *controller, int threads) {
+    const int rttMs = 5;
+    const uint64_t partSize = 64 * 1024;
+    // link is filled by 16 connections
+    StandInServer server(rttMs, partSize, 16 * partSize / rttMs, 24);
+    const auto period = milliseconds(600);
+    const int retryDelayMs = 20;
+
+    atomic<int> completed(0);
+    auto deadline = steady_clock::now() + period;
+    vector<future<void>> fs;
+    for (int i = 0; i < threads; ++i) {
+      fs.push_back(std::async(std::launch::async, [&] {
+        while (steady_clock::now() < deadline) {
+          auto start = controller->Acquire();
+          bool success = server.Transfer(partSize);
+          controller->Release(start, success ? partSize : 0, !success);
+          if (success) {
+            ++completed;
+          } else {
+            std::this_thread::sleep_for(milliseconds(retryDelayMs));
+          }
+        }
+      }));
+    }
+    for (auto &f : fs) {
+      f.wait();
+    }
+    double seconds = std::chrono::duration<double>(period).count();
+    return {completed.load() / seconds, server.GetThrottledCount()};
+  }
+};
+
+TEST_F(ConcurrencyControllerTest, Default) {
+  ConcurrencyController controller(0, 8, 16);
+  EXPECT_EQ(controller.GetMinLimit(), 1u);
+  EXPECT_EQ(controller.GetMaxLimit(), 8u);
+  EXPECT_EQ(controller.GetLimit(), 8u);
+  EXPECT_EQ(controller.GetInFlight(), 0u);
+}
+
+TEST_F(ConcurrencyControllerTest, AcquireBlocksAtLimit) {
+  ConcurrencyController controller(1, 4, 2);
+  auto start1 = controller.Acquire();
+  controller.Acquire();
+  EXPECT_EQ(controller.GetInFlight(), 2u);
+  future<void> f = std::async(std::launch::async,
+                              [&controller] { controller.Acquire(); });
+  EXPECT_EQ(f.wait_for(milliseconds(100)), std::future_status::timeout);
+  controller.Release(start1, 1, false);
+  ASSERT_EQ(f.wait_for(milliseconds(1000)), std::future_status::ready);
+  EXPECT_EQ(controller.GetInFlight(), 2u);
+}
+
+TEST_F(ConcurrencyControllerTest, MultiplicativeDecrease) {
+  ConcurrencyController controller(1, 16, 16);
+  vector<ConcurrencyController::TimePoint> starts;
+  for (int i = 0; i < 4; ++i) {
+    starts.push_back(controller.Acquire());
+  }
+  // congestion of transfers started before the decrease is counted only once
+  for (auto &start : starts) {
+    controller.Release(start, 0, true);
+  }
+  EXPECT_EQ(controller.GetLimit(), 8u);
+  EXPECT_EQ(controller.GetDecreaseCount(), 1u);
+
+  controller.Release(controller.Acquire(), 0, true);
+  EXPECT_EQ(controller.GetLimit(), 4u);
+  for (int i = 0; i < 10; ++i) {
+    controller.Release(controller.Acquire(), 0, true);
+  }
+  EXPECT_EQ(controller.GetLimit(), 1u);
+}
+
+TEST_F(ConcurrencyControllerTest, AdditiveIncrease) {
+  ConcurrencyController controller(1, 4, 1);
+  size_t notifiedLimit = 0;
+  controller.SetLimitIncreasedHandler(
+      [&notifiedLimit](size_t limit) { notifiedLimit = limit; });
+  // each window has one more transfer than the last one and takes the same
+  // time, so throughput keeps improving
+  for (int window = 1; window <= 5; ++window) {
+    vector<ConcurrencyController::TimePoint> starts;
+    size_t limit = controller.GetLimit();
+    for (size_t i = 0; i < limit; ++i) {
+      starts.push_back(controller.Acquire());
+    }
+    std::this_thread::sleep_for(milliseconds(10));
+    for (auto &start : starts) {
+      controller.Release(start, 1000, false);
+    }
+  }
+  EXPECT_EQ(controller.GetLimit(), 4u);
+  EXPECT_EQ(notifiedLimit, 4u);
+  EXPECT_EQ(controller.GetIncreaseCount(), 3u);
+}
+
+TEST_F(ConcurrencyControllerTest, NoIncreaseIfNotSaturated) {
+  ConcurrencyController controller(1, 4, 2);
+  for (int i = 0; i < 10; ++i) {
+    auto start = controller.Acquire();
+    std::this_thread::sleep_for(milliseconds(1));
+    controller.Release(start, 1000, false);
+  }
+  EXPECT_EQ(controller.GetLimit(), 2u);
+}
+
+TEST_F(ConcurrencyControllerTest, DISABLED_Benchmark) {
+  const int threads = 32;
+  ConcurrencyController low(2, 2, 2);
+  auto resLow = RunTransfers(&low, threads);
+  ConcurrencyController high(32, 32, 32);
+  auto resHigh = RunTransfers(&high, threads);
+  ConcurrencyController adaptive(1, 32, 2);
+  auto resAdaptive = RunTransfers(&adaptive, threads);
+
+  std::cout << "[fixed 2] parts/s: " << resLow.partsPerSecond
+            << ", throttled: " << resLow.throttled << "\n"
+            << "[fixed 32] parts/s: " << resHigh.partsPerSecond
+            << ", throttled: " << resHigh.throttled << "\n"
+            << "[adaptive] parts/s: " << resAdaptive.partsPerSecond
+            << ", throttled: " << resAdaptive.throttled
+            << ", final " << adaptive.ToString() << std::endl;
+
+  EXPECT_GT(resAdaptive.partsPerSecond, 2 * resLow.partsPerSecond);
+  EXPECT_LT(resAdaptive.throttled, resHigh.throttled);
+  EXPECT_GT(adaptive.GetLimit(), 4u);
+}
+
+}  // namespace Client
+}  // namespace QS
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  int code = RUN_ALL_TESTS();
+  return code;
+}
@@ -0,0 +1,179 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#include <atomic>  // NOLINT
+#include <chrono>  // NOLINT
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "client/DeleteBatcher.h"
+
+namespace QS {
+
+namespace Client {
+
+using std::atomic;
+using std::chrono::milliseconds;
+using std::lock_guard;
+using std::mutex;
+using std::string;
+using std::thread;
+using std::to_string;
+using std::vector;
+using ::testing::Test;
+
+// A stand-in of the executor running each task in a new thread, and a
+// handler recording the batches with the given latency.
+class DeleteBatcherTest : public Test {
+ protected:
+  DeleteBatcher::TaskSubmitter Submitter() {
+    return [this](std::function<void()> task) {
+      lock_guard<mutex> lock(m_mutex);
+      m_threads.emplace_back(std::move(task));
+    };
+  }
+
+  DeleteBatcher::BatchHandler Handler(milliseconds latency) {
+    return [this, latency](const vector<string> &batch) {
+      int running = ++m_running;
+      int maxRunning = m_maxRunning.load();
+      while (running > maxRunning &&
+             !m_maxRunning.compare_exchange_weak(maxRunning, running)) {
+      }
+      std::this_thread::sleep_for(latency);
+      {
+        lock_guard<mutex> lock(m_mutex);
+        m_batches.push_back(batch);
+      }
+      --m_running;
+    };
+  }
+
+  void TearDown() override {
+    for (auto &t : m_threads) {
+      t.join();
+    }
+  }
+
+  mutex m_mutex;
+  vector<thread> m_threads;
+  vector<vector<string>> m_batches;
+  atomic<int> m_running{0};
+  atomic<int> m_maxRunning{0};
+};
+
+TEST_F(DeleteBatcherTest, GroupWithinLinger) {
+  DeleteBatcher batcher(Submitter(), Handler(milliseconds(0)), 200,
+                        milliseconds(50));
+  for (int i = 0; i < 10; ++i) {
+    batcher.Add("/dir/file" + to_string(i));
+  }
+  EXPECT_TRUE(batcher.IsPending("/dir/file0"));
+  EXPECT_TRUE(batcher.HasPending());
+  EXPECT_FALSE(batcher.IsPending("/dir/file10"));
+
+  batcher.Flush();
+  ASSERT_EQ(m_batches.size(), 1u);
+  EXPECT_EQ(m_batches[0].size(), 10u);
+  EXPECT_FALSE(batcher.IsPending("/dir/file0"));
+  EXPECT_FALSE(batcher.HasPending());
+  EXPECT_EQ(batcher.GetBatchCount(), 1u);
+  EXPECT_EQ(batcher.GetPathCount(), 10u);
+}
+
+TEST_F(DeleteBatcherTest, DispatchAfterLinger) {
+  DeleteBatcher batcher(Submitter(), Handler(milliseconds(0)), 200,
+                        milliseconds(20));
+  batcher.Add("/file");
+  std::this_thread::sleep_for(milliseconds(200));
+  EXPECT_FALSE(batcher.IsPending("/file"));
+  EXPECT_EQ(batcher.GetBatchCount(), 1u);
+}
+
+TEST_F(DeleteBatcherTest, DispatchFullBatch) {
+  // the linger is long enough so only a full batch gets dispatched
+  DeleteBatcher batcher(Submitter(), Handler(milliseconds(0)), 4,
+                        milliseconds(60000));
+  for (int i = 0; i < 4; ++i) {
+    batcher.Add("/file" + to_string(i));
+  }
+  for (int i = 0; i < 100 && batcher.HasPending(); ++i) {
+    std::this_thread::sleep_for(milliseconds(10));
+  }
+  EXPECT_FALSE(batcher.HasPending());
+  EXPECT_EQ(batcher.GetPathCount(), 4u);
+}
+
+TEST_F(DeleteBatcherTest, ConcurrentBatches) {
+  DeleteBatcher batcher(Submitter(), Handler(milliseconds(50)), 10,
+                        milliseconds(10));
+  for (int i = 0; i < 100; ++i) {
+    batcher.Add("/file" + to_string(i));
+  }
+  batcher.Flush();
+
+  size_t paths = 0;
+  for (auto &batch : m_batches) {
+    EXPECT_LE(batch.size(), 10u);
+    paths += batch.size();
+  }
+  EXPECT_EQ(paths, 100u);
+  EXPECT_GE(m_batches.size(), 10u);
+  EXPECT_GT(m_maxRunning.load(), 1);
+}
+
+TEST_F(DeleteBatcherTest, BoundedBatches) {
+  DeleteBatcher batcher(Submitter(), Handler(milliseconds(50)), 10,
+                        milliseconds(10), 2);
+  for (int i = 0; i < 100; ++i) {
+    batcher.Add("/file" + to_string(i));
+  }
+  batcher.Flush();
+
+  size_t paths = 0;
+  for (auto &batch : m_batches) {
+    paths += batch.size();
+  }
+  EXPECT_EQ(paths, 100u);
+  EXPECT_EQ(m_maxRunning.load(), 2);
+  EXPECT_FALSE(batcher.HasPending());
+}
+
+TEST_F(DeleteBatcherTest, PendingUntilHandled) {
+  DeleteBatcher batcher(Submitter(), Handler(milliseconds(100)), 1,
+                        milliseconds(0));
+  batcher.Add("/file");
+  batcher.Add("/file");
+  std::this_thread::sleep_for(milliseconds(20));
+  // the batch is being handled
+  EXPECT_TRUE(batcher.IsPending("/file"));
+  batcher.Flush();
+  EXPECT_FALSE(batcher.IsPending("/file"));
+}
+
+}  // namespace Client
+}  // namespace QS
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  int code = RUN_ALL_TESTS();
+  return code;
+}
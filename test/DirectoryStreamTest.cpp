@@ -0,0 +1,174 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "data/DirectoryStream.h"
+
+namespace QS {
+
+namespace Data {
+
+using std::string;
+using std::to_string;
+using std::vector;
+using ::testing::Test;
+
+class DirectoryStreamTest : public Test {
+ protected:
+  // Fetcher of a dir of the given count of children, which are listed in
+  // pages of pageSize, the marker is the name of the last listed child
+  DirectoryStream::PageFetcher MakeFetcher(int count, int pageSize) {
+    return [this, count, pageSize](uint64_t offset, string *marker,
+                                   vector<DirectoryStream::Child> *children) {
+      if (m_fail) {
+        return false;
+      }
+      int start = marker->empty() ? 0 : std::stoi(marker->substr(4)) + 1;
+      EXPECT_EQ(static_cast<uint64_t>(start), offset);
+      int end = std::min(start + pageSize, count);
+      for (int i = start; i < end; ++i) {
+        DirectoryStream::Child child;
+        child.name = "file" + to_string(i);
+        memset(&child.st, 0, sizeof(child.st));
+        child.st.st_size = i;
+        children->push_back(child);
+      }
+      *marker = end < count ? "file" + to_string(end - 1) : string();
+      return true;
+    };
+  }
+
+  // Read at most limit children from offset, return the names
+  vector<string> Read(DirectoryStream *stream, uint64_t offset, size_t limit,
+                      uint64_t *next = nullptr) {
+    vector<string> names;
+    EXPECT_TRUE(stream->Read(
+        offset, [&](const DirectoryStream::Child &child, uint64_t off) {
+          if (names.size() >= limit) {
+            return false;
+          }
+          EXPECT_EQ(child.st.st_size, static_cast<off_t>(off - 1));
+          names.push_back(child.name);
+          if (next != nullptr) {
+            *next = off;
+          }
+          return true;
+        }));
+    return names;
+  }
+
+  bool m_fail = false;
+};
+
+TEST_F(DirectoryStreamTest, ReadAll) {
+  DirectoryStream stream(MakeFetcher(25, 10), 0, 100);
+  auto names = Read(&stream, 0, 100);
+  ASSERT_EQ(names.size(), 25u);
+  EXPECT_EQ(names.front(), "file0");
+  EXPECT_EQ(names.back(), "file24");
+  EXPECT_EQ(stream.GetFetchCount(), 3u);
+
+  // read again from the window without listing
+  EXPECT_EQ(Read(&stream, 20, 100).size(), 5u);
+  EXPECT_TRUE(Read(&stream, 25, 100).empty());
+  EXPECT_EQ(stream.GetFetchCount(), 3u);
+}
+
+TEST_F(DirectoryStreamTest, Empty) {
+  DirectoryStream stream(MakeFetcher(0, 10), 0, 100);
+  EXPECT_TRUE(Read(&stream, 0, 100).empty());
+  EXPECT_EQ(stream.GetFetchCount(), 1u);
+}
+
+TEST_F(DirectoryStreamTest, Resume) {
+  DirectoryStream stream(MakeFetcher(25, 10), 0, 100);
+  // list only the pages needed by the read children
+  uint64_t next = 0;
+  auto names = Read(&stream, 0, 4, &next);
+  ASSERT_EQ(names.size(), 4u);
+  EXPECT_EQ(next, 4u);
+  EXPECT_EQ(stream.GetFetchCount(), 1u);
+
+  vector<string> all(names);
+  while (!(names = Read(&stream, next, 4, &next)).empty()) {
+    all.insert(all.end(), names.begin(), names.end());
+  }
+  ASSERT_EQ(all.size(), 25u);
+  for (int i = 0; i < 25; ++i) {
+    EXPECT_EQ(all[i], "file" + to_string(i));
+  }
+  EXPECT_EQ(stream.GetFetchCount(), 3u);
+}
+
+TEST_F(DirectoryStreamTest, BoundedWindow) {
+  DirectoryStream stream(MakeFetcher(1000, 10), 0, 20);
+  uint64_t next = 0;
+  while (!Read(&stream, next, 7, &next).empty()) {
+    EXPECT_LE(stream.GetWindowSize(), 30u);
+  }
+  EXPECT_EQ(next, 1000u);
+  EXPECT_EQ(stream.GetFetchCount(), 100u);
+  EXPECT_GT(stream.GetWindowStart(), 0u);
+
+  // seek back lists again from the page holding the offset
+  auto names = Read(&stream, 505, 3);
+  ASSERT_EQ(names.size(), 3u);
+  EXPECT_EQ(names.front(), "file505");
+  EXPECT_EQ(stream.GetWindowStart(), 500u);
+  EXPECT_EQ(stream.GetFetchCount(), 101u);
+
+  EXPECT_EQ(Read(&stream, 0, 1).front(), "file0");
+  EXPECT_EQ(stream.GetWindowStart(), 0u);
+}
+
+TEST_F(DirectoryStreamTest, MaxCount) {
+  DirectoryStream stream(MakeFetcher(25, 10), 15, 100);
+  auto names = Read(&stream, 0, 100);
+  ASSERT_EQ(names.size(), 15u);
+  EXPECT_EQ(names.back(), "file14");
+  EXPECT_EQ(stream.GetFetchCount(), 2u);
+}
+
+TEST_F(DirectoryStreamTest, FetchFailure) {
+  DirectoryStream stream(MakeFetcher(25, 10), 0, 100);
+  EXPECT_EQ(Read(&stream, 0, 5).size(), 5u);
+  m_fail = true;
+  EXPECT_FALSE(stream.Read(
+      10, [](const DirectoryStream::Child &, uint64_t) { return true; }));
+
+  // the failed page is listed again
+  m_fail = false;
+  auto names = Read(&stream, 10, 100);
+  ASSERT_EQ(names.size(), 15u);
+  EXPECT_EQ(names.front(), "file10");
+}
+
+}  // namespace Data
+}  // namespace QS
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  int code = RUN_ALL_TESTS();
+  return code;
+}
@@ -20,10 +20,15 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <atomic>  // NOLINT
+#include <chrono>  // NOLINT
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT
 #include <utility>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -31,18 +36,26 @@
 #include "base/Utils.h"
 #include "data/Directory.h"
 #include "data/FileMetaData.h"
+#include "data/FileMetaDataManager.h"
 
 namespace {
 
+using QS::Data::DirectoryTree;
 using QS::Data::Entry;
 using QS::Data::FileMetaData;
+using QS::Data::FileMetaDataManager;
 using QS::Data::FileType;
 using QS::Data::Node;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
 using std::make_shared;
 using std::ostream;
 using std::string;
 using std::shared_ptr;
+using std::to_string;
 using std::unique_ptr;
+using std::vector;
 using ::testing::Test;
 using ::testing::Values;
 using ::testing::WithParamInterface;
@@ -163,6 +176,27 @@ INSTANTIATE_TEST_CASE_P(
            MetaData{"/file1", 0, FileType::File, 1, false, true},
            MetaData{"/file2", 1024, FileType::File, 1, false, true}));
 
+TEST(FileMetaDataTest, CompactFields) {
+  string eTag("\"d41d8cd98f00b204e9800998ecf8427e\"");
+  FileMetaData file1("/file1", 0, mtime_, mtime_, uid_, gid_, fileMode_,
+                     FileType::File, "text/plain", eTag);
+  EXPECT_EQ(file1.GetETag(), eTag);
+  EXPECT_EQ(file1.GetMimeType(), "text/plain");
+
+  FileMetaData file2("/file2", 0, mtime_, mtime_, uid_, gid_, fileMode_,
+                     FileType::File, "text/plain", eTag.substr(1, 32));
+  EXPECT_EQ(file2.GetETag(), eTag.substr(1, 32));
+  // the mime type is shared
+  EXPECT_EQ(&file1.GetMimeType(), &file2.GetMimeType());
+
+  // etag which is not a md5 hex string is kept as it is
+  string multipartETag("\"D41D8CD98F00B204E9800998ECF8427E-2\"");
+  FileMetaData file3("/file3", 0, mtime_, mtime_, uid_, gid_, fileMode_,
+                     FileType::File, "", multipartETag);
+  EXPECT_EQ(file3.GetETag(), multipartETag);
+  EXPECT_TRUE(file3.GetMimeType().empty());
+}
+
 TEST_F(NodeTest, DefaultCtor) {
   EXPECT_FALSE(pEmptyNode->operator bool());
   EXPECT_TRUE(pEmptyNode->IsEmpty());
@@ -179,39 +213,685 @@ TEST_F(NodeTest, CustomCtors) {
   EXPECT_EQ(pRootNode->GetFilePath(), pRootEntry->GetFilePath());
 
   EXPECT_EQ(*(pFileNode1->GetParent()), *pRootNode);
+  EXPECT_EQ(pFileNode1->GetName(), "file1");
+  EXPECT_EQ(pFileNode1->GetFilePath(), "/file1");
 
   EXPECT_EQ(pLinkNode->GetSymbolicLink(), string(path));
 }
 
+TEST_F(NodeTest, Snapshot) {
+  EXPECT_FALSE(pEmptyNode->GetSnapshot().operable);
+
+  auto snapshot = pFileNode1->GetSnapshot();
+  EXPECT_TRUE(snapshot.operable);
+  EXPECT_FALSE(snapshot.IsDirectory());
+  EXPECT_FALSE(snapshot.IsSymLink());
+  auto st = const_cast<const Node *>(pFileNode1.get())->GetEntry().ToStat();
+  EXPECT_EQ(snapshot.st.st_mode, st.st_mode);
+  EXPECT_EQ(snapshot.st.st_size, st.st_size);
+  EXPECT_EQ(snapshot.st.st_mtime, st.st_mtime);
+  EXPECT_EQ(snapshot.cachedTime, pFileNode1->GetCachedTime());
+  for (int amode : {F_OK, R_OK, W_OK, X_OK, R_OK | W_OK}) {
+    EXPECT_EQ(snapshot.FileAccess(uid_, gid_, amode),
+              pFileNode1->FileAccess(uid_, gid_, amode));
+    EXPECT_EQ(snapshot.FileAccess(uid_ + 1, gid_ + 1, amode),
+              pFileNode1->FileAccess(uid_ + 1, gid_ + 1, amode));
+  }
+  EXPECT_TRUE(pRootNode->GetSnapshot().IsDirectory());
+}
+
 TEST_F(NodeTest, PublicFunctions) {
   // When sharing resources between tests in test case of NodeTest,
   // as the test order is undefined, so we must restore the state
   // to its original value before passing control to the next test.
-  EXPECT_FALSE(pRootNode->Find(pFileNode1->GetFilePath()));
+  EXPECT_FALSE(pRootNode->Find(pFileNode1->GetName()));
   pRootNode->Insert(pFileNode1);
-  EXPECT_EQ(pRootNode->Find(pFileNode1->GetFilePath()), pFileNode1);
+  EXPECT_EQ(pRootNode->Find(pFileNode1->GetName()), pFileNode1);
   EXPECT_EQ(pRootNode->GetChildren().size(), 1U);
 
-  EXPECT_FALSE(pRootNode->Find(pLinkNode->GetFilePath()));
+  EXPECT_FALSE(pRootNode->Find(pLinkNode->GetName()));
   pRootNode->Insert(pLinkNode);
-  EXPECT_EQ(pRootNode->Find(pLinkNode->GetFilePath()), pLinkNode);
+  EXPECT_EQ(pRootNode->Find(pLinkNode->GetName()), pLinkNode);
   EXPECT_EQ(pRootNode->GetChildren().size(), 2U);
 
-  string oldFilePath = pFileNode1->GetFilePath();
-  string newFilePath("myNewFile1");
-  pRootNode->RenameChild(oldFilePath, newFilePath);
-  EXPECT_FALSE(pRootNode->Find(oldFilePath));
-  EXPECT_TRUE(pRootNode->Find(newFilePath));
-  EXPECT_EQ(pFileNode1->GetFilePath(), newFilePath);
-  pRootNode->RenameChild(newFilePath, oldFilePath);
+  string oldName = pFileNode1->GetName();
+  string newName("myNewFile1");
+  pRootNode->RenameChild(oldName, newName);
+  EXPECT_FALSE(pRootNode->Find(oldName));
+  EXPECT_TRUE(pRootNode->Find(newName));
+  EXPECT_EQ(pFileNode1->GetFilePath(), "/" + newName);
+  EXPECT_EQ(pFileNode1->MyBaseName(), newName);
+  pRootNode->RenameChild(newName, oldName);
 
   pRootNode->Remove(pFileNode1);
-  EXPECT_FALSE(pRootNode->Find(pFileNode1->GetFilePath()));
+  EXPECT_FALSE(pRootNode->Find(pFileNode1->GetName()));
   pRootNode->Remove(pLinkNode);
-  EXPECT_FALSE(pRootNode->Find(pLinkNode->GetFilePath()));
+  EXPECT_FALSE(pRootNode->Find(pLinkNode->GetName()));
   EXPECT_TRUE(pRootNode->IsEmpty());
 }
 
+namespace QS {
+
+namespace Data {
+
+class DirectoryTreeTest : public Test {
+ protected:
+  static void SetUpTestCase() { InitLog(); }
+
+  void SetUp() override {
+    m_tree.reset(
+        new DirectoryTree(mtime_, uid_, gid_, fileMode_ | S_IFDIR));
+  }
+
+  shared_ptr<Node> Grow(const string &path, FileType type = FileType::File) {
+    return m_tree->Grow(make_shared<FileMetaData>(
+        path, 0, mtime_, mtime_, uid_, gid_, fileMode_, type));
+  }
+
+  void TestGrowAndFind() {
+    auto file = Grow("/a/b/c");
+    ASSERT_TRUE(file);
+    EXPECT_EQ(file->GetName(), "c");
+    EXPECT_EQ(file->GetFilePath(), "/a/b/c");
+    EXPECT_EQ(file->MyDirName(), "/a/b/");
+    EXPECT_EQ(file->MyBaseName(), "c");
+
+    // the missing ancestors are added
+    auto dir = m_tree->Find("/a/b/").lock();
+    ASSERT_TRUE(dir && *dir);
+    EXPECT_TRUE(dir->IsDirectory());
+    EXPECT_EQ(dir->GetName(), "b/");
+    EXPECT_EQ(dir->MyBaseName(), "b");
+    EXPECT_EQ(m_tree->Find("/a/b/c").lock(), file);
+    EXPECT_FALSE(m_tree->Find("/a/b").lock());
+    EXPECT_FALSE(m_tree->Find("/a/b/c/").lock());
+    EXPECT_EQ(m_tree->Find("/").lock(), m_tree->GetRoot());
+
+    Grow("/a/d");
+    EXPECT_EQ(m_tree->FindChildren("/a/").size(), 2U);
+    EXPECT_EQ(m_tree->FindChildren("/a/b/").size(), 1U);
+    EXPECT_TRUE(m_tree->FindChildren("/a/e/").empty());
+  }
+
+  void TestRename() {
+    auto file = Grow("/a/b/c");
+    auto dir = m_tree->Find("/a/").lock();
+
+    EXPECT_EQ(m_tree->Rename("/a/b/c", "/a/b/e"), file);
+    EXPECT_EQ(file->GetFilePath(), "/a/b/e");
+    EXPECT_EQ(m_tree->Find("/a/b/e").lock(), file);
+    EXPECT_FALSE(m_tree->Find("/a/b/c").lock());
+
+    // move to another directory
+    EXPECT_EQ(m_tree->Rename("/a/b/e", "/f"), file);
+    EXPECT_EQ(file->GetParent(), m_tree->GetRoot());
+    EXPECT_EQ(m_tree->Find("/f").lock(), file);
+    EXPECT_TRUE(m_tree->Find("/a/b/").lock()->IsEmpty());
+
+    EXPECT_EQ(m_tree->RenameDirectory("/a/", "/x/"), dir);
+    EXPECT_EQ(dir->GetFilePath(), "/x/");
+    EXPECT_TRUE(m_tree->Find("/x/b/").lock());
+    EXPECT_EQ(m_tree->Find("/x/b/").lock()->GetFilePath(), "/x/b/");
+    EXPECT_FALSE(m_tree->Find("/a/").lock());
+    EXPECT_FALSE(m_tree->Find("/a/b/").lock());
+    EXPECT_FALSE(m_tree->RenameDirectory("/x/", "/f"));
+
+    // the meta datas of descendants are rekeyed by the new paths
+    auto &manager = FileMetaDataManager::Instance();
+    auto child = Grow("/x/b/g");
+    EXPECT_EQ(m_tree->RenameDirectory("/x/", "/z/"), dir);
+    EXPECT_TRUE(manager.Has("/z/b/"));
+    EXPECT_TRUE(manager.Has("/z/b/g"));
+    EXPECT_FALSE(manager.Has("/x/b/g"));
+    // growing the old path again does not affect the renamed node
+    auto regrown = Grow("/x/b/g");
+    EXPECT_NE(regrown, child);
+    EXPECT_TRUE(child && *child);
+    EXPECT_EQ(child->GetFilePath(), "/z/b/g");
+    EXPECT_EQ(manager.Get("/z/b/g")->second->GetFilePath(), "/z/b/g");
+    EXPECT_EQ(m_tree->Find("/z/b/g").lock(), child);
+  }
+
+  void TestRemove() {
+    auto file = Grow("/a/b/c");
+    auto dir = m_tree->Find("/a/").lock();
+    m_tree->Remove("/a/");
+    EXPECT_FALSE(m_tree->Find("/a/").lock());
+    EXPECT_FALSE(m_tree->Find("/a/b/c").lock());
+    EXPECT_TRUE(m_tree->GetRoot()->IsEmpty());
+    EXPECT_EQ(m_tree->GetRoot()->GetNumLink(), 2);
+    // the removed nodes still have their paths
+    EXPECT_EQ(dir->GetFilePath(), "/a/");
+    EXPECT_EQ(file->GetFilePath(), "/a/b/c");
+  }
+
+  void TestSetDirectoryListed() {
+    auto file = Grow("/a/b");
+    Grow("/a/c");
+    Grow("/a/d/e");
+    auto dir = m_tree->Find("/a/").lock();
+    EXPECT_EQ(dir->GetListedTime(), 0);
+    EXPECT_EQ(dir->GetNumLink(), 3);
+
+    // the children cached after the listing started are kept
+    time_t now = time(NULL);
+    EXPECT_EQ(m_tree->SetDirectoryListed("/a/", {"/a/b"}, now - 10), dir);
+    EXPECT_EQ(dir->GetListedTime(), now - 10);
+    EXPECT_EQ(dir->GetChildren().size(), 3U);
+
+    // the children cached before the listing started are removed
+    EXPECT_EQ(m_tree->SetDirectoryListed("/a/", {"/a/b"}, now + 10), dir);
+    EXPECT_EQ(dir->GetListedTime(), now + 10);
+    EXPECT_EQ(m_tree->Find("/a/b").lock(), file);
+    EXPECT_FALSE(m_tree->Find("/a/c").lock());
+    EXPECT_FALSE(m_tree->Find("/a/d/").lock());
+    EXPECT_EQ(dir->GetChildren().size(), 1U);
+    EXPECT_EQ(dir->GetNumLink(), 2);
+
+    EXPECT_FALSE(m_tree->SetDirectoryListed("/a/b", {}, now));
+    EXPECT_FALSE(m_tree->SetDirectoryListed("/x/", {}, now));
+  }
+
+  void TestFindFileOrDirectory() {
+    auto file = Grow("/a/x");
+    auto dir = Grow("/a/y/", FileType::Directory);
+    // the names sorted between "y" and "y/"
+    Grow("/a/y-1");
+    Grow("/a/y.txt");
+    Grow("/a/y");
+    auto other = Grow("/a/z/", FileType::Directory);
+    Grow("/a/\xe4");
+
+    EXPECT_EQ(m_tree->FindFileOrDirectory("/a/x").lock(), file);
+    EXPECT_EQ(m_tree->FindFileOrDirectory("/a/z").lock(), other);
+    EXPECT_EQ(m_tree->FindFileOrDirectory("/a/y/").lock(), dir);
+    EXPECT_EQ(m_tree->FindFileOrDirectory("/a").lock(),
+              m_tree->Find("/a/").lock());
+    EXPECT_EQ(m_tree->FindFileOrDirectory("/").lock(), m_tree->GetRoot());
+    // the file goes first if both exist
+    EXPECT_EQ(m_tree->FindFileOrDirectory("/a/y").lock(),
+              m_tree->Find("/a/y").lock());
+    m_tree->Remove("/a/y");
+    EXPECT_EQ(m_tree->FindFileOrDirectory("/a/y").lock(), dir);
+
+    EXPECT_FALSE(m_tree->FindFileOrDirectory("/a/w").lock());
+    EXPECT_FALSE(m_tree->FindFileOrDirectory("/a/y-").lock());
+    EXPECT_FALSE(m_tree->FindFileOrDirectory("/a/zz").lock());
+    EXPECT_FALSE(m_tree->FindFileOrDirectory("/b/x").lock());
+    EXPECT_FALSE(m_tree->FindFileOrDirectory("a/x").lock());
+  }
+
+  void TestGrowChildren() {
+    auto file = Grow("/a/c");
+    auto meta = [](const string &path, FileType type, time_t mtime) {
+      return make_shared<FileMetaData>(path, 0, mtime, mtime, uid_, gid_,
+                                       fileMode_, type);
+    };
+    vector<shared_ptr<FileMetaData>> metas;
+    metas.push_back(meta("/a/d/", FileType::Directory, mtime_));
+    metas.push_back(meta("/a/c", FileType::File, mtime_ + 1));
+    metas.push_back(meta("/a/b", FileType::File, mtime_));
+    metas.push_back(meta("/x/y", FileType::File, mtime_));  // not in dir
+    auto dir = m_tree->GrowChildren("/a/", std::move(metas));
+    ASSERT_TRUE(dir);
+    EXPECT_EQ(dir, m_tree->Find("/a/").lock());
+
+    // the children are sorted, and the existing one is updated in place
+    auto &children = dir->GetChildren();
+    ASSERT_EQ(children.size(), 3U);
+    EXPECT_EQ(children[0]->GetName(), "b");
+    EXPECT_EQ(children[1], file);
+    EXPECT_EQ(children[2]->GetName(), "d/");
+    EXPECT_EQ(file->GetMTime(), mtime_ + 1);
+    EXPECT_EQ(dir->GetNumLink(), 3);
+    EXPECT_EQ(children[0]->GetParent(), dir);
+    EXPECT_EQ(children[0]->GetFilePath(), "/a/b");
+    EXPECT_TRUE(FileMetaDataManager::Instance().Has("/a/b"));
+    EXPECT_TRUE(m_tree->Find("/x/y").lock());
+
+    // the new children are inserted among the existing ones
+    metas.clear();
+    metas.push_back(meta("/a/a", FileType::File, mtime_));
+    metas.push_back(meta("/a/bb", FileType::File, mtime_));
+    metas.push_back(meta("/a/e", FileType::File, mtime_));
+    m_tree->GrowChildren("/a/", std::move(metas));
+    vector<string> names;
+    for (auto &child : dir->GetChildren()) {
+      names.push_back(child->GetName());
+    }
+    EXPECT_EQ(names, vector<string>({"a", "b", "bb", "c", "d/", "e"}));
+
+    // the unchanged child listed again is as fresh as the listing
+    auto b = m_tree->Find("/a/b").lock();
+    ASSERT_TRUE(b);
+    metas.clear();
+    metas.push_back(make_shared<FileMetaData>("/a/b", 0, mtime_ + 100,
+                                              mtime_, uid_, gid_, fileMode_,
+                                              FileType::File));
+    m_tree->GrowChildren("/a/", std::move(metas));
+    EXPECT_EQ(b, m_tree->Find("/a/b").lock());
+    EXPECT_EQ(b->GetMTime(), mtime_);
+    EXPECT_EQ(b->GetCachedTime(), mtime_ + 100);
+
+    // the missing dir is added
+    metas.clear();
+    metas.push_back(meta("/e/f", FileType::File, mtime_));
+    auto newDir = m_tree->GrowChildren("/e/", std::move(metas));
+    ASSERT_TRUE(newDir);
+    EXPECT_EQ(m_tree->Find("/e/f").lock()->GetParent(), newDir);
+
+    EXPECT_FALSE(m_tree->GrowChildren("/a/b", {}));
+  }
+
+  void TestSnapshot() {
+    const string snapshot = "/tmp/qsfs.test.snapshot";
+    string eTag("\"d41d8cd98f00b204e9800998ecf8427e\"");
+    m_tree->Grow(make_shared<FileMetaData>("/a/b", 1024, mtime_ - 10, mtime_,
+                                           uid_, gid_, fileMode_,
+                                           FileType::File, "text/plain", eTag));
+    Grow("/a/c/d");
+    time_t now = time(NULL);
+    m_tree->SetDirectoryListed("/a/", {"/a/b", "/a/c/"}, now - 100);
+    EXPECT_TRUE(m_tree->SaveSnapshot(snapshot));
+
+    m_tree.reset();
+    SetUp();
+    EXPECT_EQ(m_tree->LoadSnapshot(snapshot), 5U);
+    shared_ptr<const Node> file = m_tree->Find("/a/b").lock();
+    ASSERT_TRUE(file && *file);
+    EXPECT_EQ(file->GetFileSize(), 1024U);
+    EXPECT_EQ(file->GetMTime(), mtime_);
+    // the loaded nodes are revalidated on their first access
+    EXPECT_EQ(file->GetCachedTime(), 0);
+    auto meta = file->GetEntry().GetMetaData().lock();
+    EXPECT_EQ(meta->GetMimeType(), "text/plain");
+    EXPECT_EQ(meta->GetETag(), eTag);
+    EXPECT_EQ(m_tree->Find("/a/").lock()->GetListedTime(), 0);
+    EXPECT_TRUE(m_tree->Find("/a/c/d").lock());
+    EXPECT_EQ(m_tree->FindChildren("/a/").size(), 2U);
+
+    // the paths are saved as renamed
+    m_tree->RenameDirectory("/a/", "/z/");
+    EXPECT_TRUE(m_tree->SaveSnapshot(snapshot));
+    m_tree.reset();
+    SetUp();
+    EXPECT_EQ(m_tree->LoadSnapshot(snapshot), 5U);
+    EXPECT_FALSE(m_tree->Find("/a/").lock());
+    EXPECT_TRUE(m_tree->Find("/z/b").lock());
+    EXPECT_TRUE(m_tree->Find("/z/c/d").lock());
+
+    // the loading stops when meta data manager is full
+    auto &manager = FileMetaDataManager::Instance();
+    auto maxCount = manager.m_maxCount;
+    m_tree.reset();
+    manager.Clear();
+    SetUp();
+    manager.m_maxCount = 3;  // root and two more
+    EXPECT_EQ(m_tree->LoadSnapshot(snapshot), 3U);
+    shared_ptr<const Node> dir = m_tree->Find("/z/").lock();
+    EXPECT_TRUE(dir && *dir);
+    EXPECT_TRUE(m_tree->Find("/z/b").lock());
+    EXPECT_FALSE(m_tree->Find("/z/c/").lock());
+    manager.m_maxCount = maxCount;
+
+    // a missing or invalid snapshot loads nothing
+    std::ofstream(snapshot) << "not a snapshot";
+    EXPECT_EQ(m_tree->LoadSnapshot(snapshot), 0U);
+    unlink(snapshot.c_str());
+    EXPECT_EQ(m_tree->LoadSnapshot(snapshot), 0U);
+  }
+
+  // Return the elapsed milliseconds of renaming the dir
+  double RenameDirectory(const string &oldDirPath, const string &newDirPath) {
+    auto start = steady_clock::now();
+    auto dir = m_tree->RenameDirectory(oldDirPath, newDirPath);
+    auto elapsed = steady_clock::now() - start;
+    EXPECT_TRUE(dir);
+    return duration_cast<microseconds>(elapsed).count() / 1e3;
+  }
+
+  // Return the resident bytes per entry of a tree with the given entries
+  double MemoryPerEntry(int dirs, int filesPerDir) {
+    // keep all the meta datas in manager
+    auto &manager = FileMetaDataManager::Instance();
+    auto maxCount = manager.m_maxCount;
+    manager.m_maxCount = dirs * (filesPerDir + 1) + 1;
+
+    string eTag("\"d41d8cd98f00b204e9800998ecf8427e\"");
+    size_t rss = GetResidentBytes();
+    for (int i = 0; i < dirs; ++i) {
+      string dir = "/dir" + to_string(i) + "/";
+      for (int j = 0; j < filesPerDir; ++j) {
+        m_tree->Grow(make_shared<FileMetaData>(
+            dir + "file" + to_string(j), 1024, mtime_, mtime_, uid_, gid_,
+            fileMode_, FileType::File, "application/octet-stream", eTag));
+      }
+    }
+    double bytes = GetResidentBytes() - rss;
+
+    m_tree.reset();
+    manager.m_maxCount = maxCount;
+    return bytes / (dirs * filesPerDir);
+  }
+
+  // Return the count of entries loaded from the snapshot of a tree with the
+  // given entries, and the elapsed milliseconds and the size of the snapshot
+  size_t SaveAndLoadSnapshot(int dirs, int filesPerDir, double *saveMs,
+                             double *loadMs, double *bytes) {
+    const string snapshot = "/tmp/qsfs.test.snapshot";
+    auto &manager = FileMetaDataManager::Instance();
+    auto maxCount = manager.m_maxCount;
+    manager.m_maxCount = dirs * (filesPerDir + 1) + 1;
+
+    string eTag("\"d41d8cd98f00b204e9800998ecf8427e\"");
+    for (int i = 0; i < dirs; ++i) {
+      string dir = "/dir" + to_string(i) + "/";
+      for (int j = 0; j < filesPerDir; ++j) {
+        m_tree->Grow(make_shared<FileMetaData>(
+            dir + "file" + to_string(j), 1024, mtime_, mtime_, uid_, gid_,
+            fileMode_, FileType::File, "application/octet-stream", eTag));
+      }
+    }
+
+    auto start = steady_clock::now();
+    EXPECT_TRUE(m_tree->SaveSnapshot(snapshot));
+    *saveMs =
+        duration_cast<microseconds>(steady_clock::now() - start).count() / 1e3;
+    std::ifstream file(snapshot, std::ios::binary | std::ios::ate);
+    *bytes = static_cast<double>(file.tellg());
+
+    m_tree.reset();
+    SetUp();
+    start = steady_clock::now();
+    auto count = m_tree->LoadSnapshot(snapshot);
+    *loadMs =
+        duration_cast<microseconds>(steady_clock::now() - start).count() / 1e3;
+    EXPECT_TRUE(m_tree->Find("/dir0/file0").lock());
+
+    m_tree.reset();
+    manager.m_maxCount = maxCount;
+    unlink(snapshot.c_str());
+    return count;
+  }
+
+  // Return the elapsed milliseconds of listing a dir with the given files,
+  // the pages are grown one by one or in bulk. The dir is listed again with
+  // a newer mtime if relistMs is not null.
+  double ListLargeDirectory(int files, bool bulk, double *relistMs) {
+    const int kPageSize = 1000;
+    const string dir = "/large/";
+    auto &manager = FileMetaDataManager::Instance();
+    auto maxCount = manager.m_maxCount;
+    manager.m_maxCount = files + 2;
+    SetUp();  // start with a new tree
+
+    auto list = [&](time_t mtime) {
+      double elapsed = 0;
+      char name[32];
+      for (int i = 0; i < files; i += kPageSize) {
+        vector<shared_ptr<FileMetaData>> page;
+        page.reserve(kPageSize);
+        for (int j = i; j < i + kPageSize && j < files; ++j) {
+          snprintf(name, sizeof(name), "file%08d", j);  // in listing order
+          page.push_back(make_shared<FileMetaData>(dir + name, 1024, mtime,
+                                                   mtime, uid_, gid_,
+                                                   fileMode_, FileType::File));
+        }
+        auto start = steady_clock::now();
+        if (bulk) {
+          m_tree->GrowChildren(dir, std::move(page));
+        } else {
+          m_tree->Grow(std::move(page));
+        }
+        elapsed += duration_cast<microseconds>(steady_clock::now() - start)
+                       .count() / 1e3;
+      }
+      return elapsed;
+    };
+    double listMs = list(mtime_);
+    EXPECT_EQ(m_tree->Find(dir).lock()->GetChildren().size(),
+              static_cast<size_t>(files));
+    if (relistMs != nullptr) {
+      *relistMs = list(mtime_ + 1);
+    }
+
+    m_tree.reset();
+    manager.m_maxCount = maxCount;
+    return listMs;
+  }
+
+  // Return the lookups per second of the reader threads, while a writer
+  // keeps updating a directory if withWriter is true
+  double ConcurrentLookups(int readers, bool withWriter) {
+    const int kDirs = 100;
+    const int kFilesPerDir = 100;
+    SetUp();  // start with a new tree
+    for (int i = 0; i < kDirs; ++i) {
+      for (int j = 0; j < kFilesPerDir; ++j) {
+        Grow("/dir" + to_string(i) + "/file" + to_string(j));
+      }
+    }
+
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> lookups(0);
+    vector<std::thread> threads;
+    for (int n = 0; n < readers; ++n) {
+      threads.emplace_back([&, n] {
+        auto &manager = FileMetaDataManager::Instance();
+        uint64_t count = 0;
+        for (int i = n; !stop.load(); ++i) {
+          string path = "/dir" + to_string(i % kDirs) + "/file" +
+                        to_string((i / kDirs) % kFilesPerDir);
+          EXPECT_TRUE(m_tree->Find(path).lock());
+          EXPECT_TRUE(manager.Has(path));
+          ++count;
+        }
+        lookups += count;
+      });
+    }
+    if (withWriter) {
+      threads.emplace_back([&] {
+        for (int i = 0; !stop.load(); ++i) {
+          // list the same children again with a newer mtime
+          string dir = "/dir" + to_string(i % kDirs) + "/";
+          vector<shared_ptr<FileMetaData>> children;
+          for (int j = 0; j < kFilesPerDir; ++j) {
+            children.push_back(make_shared<FileMetaData>(
+                dir + "file" + to_string(j), 0, mtime_ + i + 1, mtime_,
+                uid_, gid_, fileMode_, FileType::File));
+          }
+          m_tree->UpdateDirectory(dir, std::move(children));
+        }
+      });
+    }
+
+    const int kDurationMs = 500;
+    std::this_thread::sleep_for(std::chrono::milliseconds(kDurationMs));
+    stop.store(true);
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    return lookups.load() * 1e3 / kDurationMs;
+  }
+
+  static size_t GetResidentBytes() {
+    size_t size = 0;
+    size_t resident = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> size >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+  }
+
+ protected:
+  unique_ptr<DirectoryTree> m_tree;
+};
+
+TEST_F(DirectoryTreeTest, GrowAndFind) { TestGrowAndFind(); }
+
+TEST_F(DirectoryTreeTest, Rename) { TestRename(); }
+
+TEST_F(DirectoryTreeTest, Remove) { TestRemove(); }
+
+TEST_F(DirectoryTreeTest, SetDirectoryListed) { TestSetDirectoryListed(); }
+
+TEST_F(DirectoryTreeTest, GrowChildren) { TestGrowChildren(); }
+
+TEST_F(DirectoryTreeTest, Snapshot) { TestSnapshot(); }
+
+TEST_F(DirectoryTreeTest, FindFileOrDirectory) { TestFindFileOrDirectory(); }
+
+// The benchmarks are disabled by default, run them with
+// --gtest_also_run_disabled_tests.
+
+// Benchmark: memory of a tree with 1M entries
+TEST_F(DirectoryTreeTest, DISABLED_BenchmarkMemoryPerEntry) {
+  double bytes = MemoryPerEntry(1000, 1000);
+  std::cout << "[ BENCHMARK] tree of 1000000 entries, resident: " << bytes
+            << "B/entry, sizeof(Node): " << sizeof(Node)
+            << "B, sizeof(FileMetaData): " << sizeof(FileMetaData) << "B"
+            << std::endl;
+}
+
+// Benchmark: rename the top directory of a tree with 1M entries
+TEST_F(DirectoryTreeTest, DISABLED_BenchmarkRenameDirectory) {
+  const int kDirs = 1000;
+  const int kFilesPerDir = 1000;
+  auto start = steady_clock::now();
+  for (int i = 0; i < kDirs; ++i) {
+    string dir = "/bench/dir" + to_string(i) + "/";
+    for (int j = 0; j < kFilesPerDir; ++j) {
+      Grow(dir + "file" + to_string(j));
+    }
+  }
+  double growMs =
+      duration_cast<microseconds>(steady_clock::now() - start).count() / 1e3;
+
+  // the meta data of the dir could be released by meta data manager already
+  Grow("/bench/", FileType::Directory);
+  double renameMs = RenameDirectory("/bench/", "/renamed/");
+  EXPECT_TRUE(m_tree->Find("/renamed/dir999/file999").lock());
+  EXPECT_FALSE(m_tree->Find("/bench/dir999/file999").lock());
+
+  std::cout << "[ BENCHMARK] tree of " << kDirs * kFilesPerDir
+            << " entries, grow: " << growMs << "ms, rename dir: " << renameMs
+            << "ms" << std::endl;
+  EXPECT_LT(renameMs, 100.0);
+}
+
+// Benchmark: the tree side of 'ls -l' on a dir of 10000 files, with the
+// attributes passed to readdir or looked up by getattr for each child
+TEST_F(DirectoryTreeTest, DISABLED_BenchmarkListWithAttributes) {
+  const int kFiles = 10000;
+  const string dir = "/large/";
+  for (int i = 0; i < kFiles; ++i) {
+    Grow(dir + "file" + to_string(i));
+  }
+
+  // readdir with the names only, then a getattr for each child
+  auto start = steady_clock::now();
+  int count = 0;
+  for (auto &child : m_tree->FindChildren(dir)) {
+    auto name = child.lock()->MyBaseName();
+    auto node = m_tree->Find(dir + name).lock();
+    count += node->GetSnapshot().operable ? 1 : 0;
+  }
+  double lookupMs =
+      duration_cast<microseconds>(steady_clock::now() - start).count() / 1e3;
+  EXPECT_EQ(count, kFiles);
+
+  // readdir with the attributes
+  start = steady_clock::now();
+  count = 0;
+  for (auto &child : m_tree->FindChildren(dir)) {
+    auto node = child.lock();
+    auto name = node->MyBaseName();
+    count += node->GetSnapshot().operable ? 1 : 0;
+  }
+  double fillMs =
+      duration_cast<microseconds>(steady_clock::now() - start).count() / 1e3;
+  EXPECT_EQ(count, kFiles);
+
+  std::cout << "[ BENCHMARK] list " << kFiles << " files with getattr: "
+            << lookupMs << "ms (" << kFiles << " lookups), with attributes "
+            << "filled: " << fillMs << "ms (0 lookups)" << std::endl;
+}
+
+// Benchmark: save and load the snapshot of a tree with 1M entries, the load
+// is what a mount with a snapshot costs instead of listing the dirs again
+TEST_F(DirectoryTreeTest, DISABLED_BenchmarkSnapshot) {
+  double saveMs = 0;
+  double loadMs = 0;
+  double bytes = 0;
+  auto count = SaveAndLoadSnapshot(1000, 1000, &saveMs, &loadMs, &bytes);
+  EXPECT_EQ(count, 1000U * 1001U + 1U);
+  std::cout << "[ BENCHMARK] snapshot of " << count << " entries, save: "
+            << saveMs << "ms, load: " << loadMs << "ms, size: "
+            << bytes / count << "B/entry" << std::endl;
+}
+
+// Benchmark: list a dir of 1M files page by page, and list it again with
+// all files updated
+TEST_F(DirectoryTreeTest, DISABLED_BenchmarkGrowChildren) {
+  const int kFiles = 1000000;
+  for (bool bulk : {false, true}) {
+    double relistMs = 0;
+    double listMs = ListLargeDirectory(kFiles, bulk, &relistMs);
+    std::cout << "[ BENCHMARK] dir of " << kFiles << " files grown "
+              << (bulk ? "in bulk" : "one by one") << ", list: " << listMs
+              << "ms, relist: " << relistMs << "ms" << std::endl;
+  }
+}
+
+// Benchmark: resolve the paths of dirs without ending '/', which took the
+// lookups of both "path" and "path/" before
+TEST_F(DirectoryTreeTest, DISABLED_BenchmarkFindFileOrDirectory) {
+  const int kDirs = 1000;
+  const int kRounds = 1000;
+  for (int i = 0; i < kDirs; ++i) {
+    Grow("/dir" + to_string(i) + "/", FileType::Directory);
+    Grow("/dir" + to_string(i) + ".txt");
+  }
+
+  for (bool unified : {false, true}) {
+    auto start = steady_clock::now();
+    for (int n = 0; n < kRounds; ++n) {
+      for (int i = 0; i < kDirs; ++i) {
+        string path = "/dir" + to_string(i);
+        shared_ptr<Node> node;
+        if (unified) {
+          node = m_tree->FindFileOrDirectory(path).lock();
+        } else {
+          node = m_tree->Find(path).lock();
+          if (!node) {
+            node = m_tree->Find(path + "/").lock();
+          }
+        }
+        EXPECT_TRUE(node && node->IsDirectory());
+      }
+    }
+    double elapsed =
+        duration_cast<microseconds>(steady_clock::now() - start).count();
+    std::cout << "[ BENCHMARK] " << (unified ? "one lookup" : "two lookups")
+              << ": " << elapsed * 1e3 / (kDirs * kRounds) << "ns/path"
+              << std::endl;
+  }
+}
+
+// Benchmark: concurrent lookups with and without updates of directories
+TEST_F(DirectoryTreeTest, DISABLED_BenchmarkConcurrentLookups) {
+  for (int readers : {1, 2, 4, 8}) {
+    for (bool withWriter : {false, true}) {
+      double rate = ConcurrentLookups(readers, withWriter);
+      std::cout << "[ BENCHMARK] " << readers << " readers"
+                << (withWriter ? " with 1 writer" : "") << ": "
+                << static_cast<uint64_t>(rate) << " lookups/s" << std::endl;
+    }
+  }
+}
+
+}  // namespace Data
+}  // namespace QS
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   int code = RUN_ALL_TESTS();
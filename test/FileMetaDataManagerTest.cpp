@@ -80,8 +80,9 @@ class FileMetaDataManagerTest : public Test {
     EXPECT_TRUE(*(manager.Get("folder1/")->second) == folder1);
     EXPECT_TRUE(*(manager.Begin()->second) == folder1);
 
-    EXPECT_TRUE(manager.Has("file1"));  // will put file1 at front
-    EXPECT_TRUE(*(manager.Begin()->second) == file1);
+    EXPECT_TRUE(manager.Has("file1"));  // only mark file1 as referenced
+    EXPECT_TRUE(*(manager.Begin()->second) == folder1);
+    EXPECT_TRUE(manager.Get("file1")->referenced);
 
     manager.Erase("file1");
     EXPECT_FALSE(manager.Has("file1"));
@@ -124,6 +125,27 @@ class FileMetaDataManagerTest : public Test {
     EXPECT_TRUE(manager.Has("folder1/"));
     EXPECT_FALSE(manager.Has("file1"));
   }
+
+  void TestSecondChance() {
+    FileMetaDataManager manager(2);
+    FileMetaData file1("file1", 2, mtime_, mtime_, uid_, gid_, fileMode_,
+                       FileType::File);
+    FileMetaData file2("file2", 2, mtime_, mtime_, uid_, gid_, fileMode_,
+                       FileType::File);
+    FileMetaData folder1("folder1/", 0, mtime_, mtime_, uid_, gid_, fileMode_,
+                         FileType::Directory);
+
+    manager.Add(make_shared<FileMetaData>(file1));
+    manager.Add(make_shared<FileMetaData>(folder1));
+    EXPECT_FALSE(manager.m_metaDatas.back().referenced);
+    manager.Get("file1");  // file1 is at back, but referenced
+
+    manager.Add(make_shared<FileMetaData>(file2));
+    EXPECT_TRUE(*(manager.Begin()->second) == file2);
+    EXPECT_TRUE(*(manager.m_metaDatas.back().second) == file1);
+    EXPECT_FALSE(manager.m_metaDatas.back().referenced);
+    EXPECT_FALSE(manager.Has("folder1/"));
+  }
 };
 
 TEST_F(FileMetaDataManagerTest, Default) { TestDefault(); }
@@ -134,6 +156,8 @@ TEST_F(FileMetaDataManagerTest, Rename) { TestRename(); }
 
 TEST_F(FileMetaDataManagerTest, Overflow) { TestOverflow(); }
 
+TEST_F(FileMetaDataManagerTest, SecondChance) { TestSecondChance(); }
+
 }  // namespace Data
 }  // namespace QS
 
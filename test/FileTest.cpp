@@ -308,6 +308,29 @@ class FileTest : public Test {
     array<char, len2> arr2{'a', 'b', 'c'};
     EXPECT_EQ(buf3, arr2);
   }
+
+  void TestCancelDownloads() {
+    auto token1 = std::shared_ptr<QS::Threading::CancellationToken>();
+    {
+      File file1("file1", mtime_);
+      token1 = file1.GetCancellationToken();
+      EXPECT_FALSE(token1->IsCancelled());
+
+      // closing an unopened file changes nothing
+      file1.SetOpen(false);
+      EXPECT_FALSE(token1->IsCancelled());
+
+      file1.SetOpen(true);
+      file1.SetOpen(false);
+      EXPECT_TRUE(token1->IsCancelled());
+      auto token2 = file1.GetCancellationToken();
+      EXPECT_FALSE(token2->IsCancelled());
+
+      token1 = token2;
+    }
+    // token is cancelled when file is gone
+    EXPECT_TRUE(token1->IsCancelled());
+  }
 };
 
 TEST_F(FileTest, Default) {
@@ -340,6 +363,8 @@ TEST_F(FileTest, Read) { TestRead(); }
 
 TEST_F(FileTest, ReadDiskFile) { TestReadDiskFile(); }
 
+TEST_F(FileTest, CancelDownloads) { TestCancelDownloads(); }
+
 }  // namespace Data
 }  // namespace QS
 
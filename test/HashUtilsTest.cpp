@@ -0,0 +1,157 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "base/HashUtils.h"
+
+namespace QS {
+
+namespace HashUtils {
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+using std::string;
+using std::to_string;
+using std::unordered_map;
+using std::unordered_set;
+using std::vector;
+using ::testing::Test;
+
+namespace {
+
+// The previous hash, for comparison
+struct PolynomialStringHash {
+  int operator()(const std::string &strToHash) const {
+    int hash = 0;
+    for (const auto &charValue : strToHash) {
+      hash = charValue + 31 * hash;
+    }
+    return hash;
+  }
+};
+
+// Paths of a bucket, which share long prefixes
+vector<string> MakePaths(size_t count) {
+  vector<string> paths;
+  paths.reserve(count);
+  for (size_t i = 0; paths.size() < count; ++i) {
+    string dir = "/data/projects/project" + to_string(i / 1000) +
+                 "/2017/images/batch" + to_string(i / 100) + "/";
+    paths.push_back(dir);
+    for (size_t j = 0; j < 99 && paths.size() < count; ++j, ++i) {
+      paths.push_back(dir + "IMG_" + to_string(i) + ".jpg");
+    }
+  }
+  return paths;
+}
+
+}  // namespace
+
+class HashUtilsTest : public Test {
+ protected:
+  // Return the lookups per second of a map keyed by the paths
+  template <typename Hash>
+  double LookupThroughput(const vector<string> &paths) {
+    unordered_map<string, size_t, Hash> map;
+    for (size_t i = 0; i < paths.size(); ++i) {
+      map.emplace(paths[i], i);
+    }
+
+    const int kRounds = 3;
+    size_t found = 0;
+    auto start = steady_clock::now();
+    for (int round = 0; round < kRounds; ++round) {
+      for (auto &path : paths) {
+        found += map.count(path);
+      }
+    }
+    auto elapsed = duration_cast<microseconds>(steady_clock::now() - start);
+    EXPECT_EQ(found, paths.size() * kRounds);
+    return found * 1e6 / std::max<int64_t>(elapsed.count(), 1);
+  }
+
+  // Return the length of the longest bucket chain
+  template <typename Hash>
+  size_t MaxBucketSize(const vector<string> &paths) {
+    unordered_set<string, Hash> set(paths.begin(), paths.end());
+    size_t maxSize = 0;
+    for (size_t i = 0; i < set.bucket_count(); ++i) {
+      maxSize = std::max(maxSize, set.bucket_size(i));
+    }
+    return maxSize;
+  }
+};
+
+TEST_F(HashUtilsTest, Hash64) {
+  string str("/data/projects/project1/2017/images/batch1/IMG_100.jpg");
+  EXPECT_EQ(Hash64(str.data(), str.size()), Hash64(str.data(), str.size()));
+  EXPECT_NE(Hash64(str.data(), str.size()),
+            Hash64(str.data(), str.size(), 1));
+
+  // every prefix length goes through a different branch of reading
+  unordered_set<uint64_t> hashes;
+  for (size_t len = 0; len <= str.size(); ++len) {
+    hashes.insert(Hash64(str.data(), len));
+  }
+  EXPECT_EQ(hashes.size(), str.size() + 1);
+
+  EXPECT_EQ(StringHash()(str), static_cast<size_t>(Hash64(str.data(),
+                                                           str.size())));
+}
+
+TEST_F(HashUtilsTest, Distribution) {
+  auto paths = MakePaths(100000);
+  unordered_set<uint64_t> hashes;
+  for (auto &path : paths) {
+    hashes.insert(Hash64(path.data(), path.size()));
+  }
+  EXPECT_EQ(hashes.size(), paths.size());  // no collision
+  EXPECT_LE(MaxBucketSize<StringHash>(paths), 10U);
+}
+
+// Benchmark: lookups of a map keyed by 1M paths
+TEST_F(HashUtilsTest, DISABLED_BenchmarkLookup) {
+  auto paths = MakePaths(1000000);
+  double polynomial = LookupThroughput<PolynomialStringHash>(paths);
+  double wyhash = LookupThroughput<StringHash>(paths);
+  std::cout << "[ BENCHMARK] lookups of 1000000 paths, polynomial hash: "
+            << static_cast<uint64_t>(polynomial)
+            << "/s, max bucket: " << MaxBucketSize<PolynomialStringHash>(paths)
+            << ", wyhash: " << static_cast<uint64_t>(wyhash)
+            << "/s, max bucket: " << MaxBucketSize<StringHash>(paths)
+            << std::endl;
+}
+
+}  // namespace HashUtils
+}  // namespace QS
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  int code = RUN_ALL_TESTS();
+  return code;
+}
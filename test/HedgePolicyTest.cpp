@@ -0,0 +1,136 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#include <stdint.h>
+
+#include "gtest/gtest.h"
+
+#include "client/HedgePolicy.h"
+
+namespace QS {
+
+namespace Client {
+
+using ::testing::Test;
+
+class HedgePolicyTest : public Test {
+ protected:
+  // Feed latencies 1, 2, ..., count in ms.
+  void FeedLatencies(HedgePolicy *policy, uint32_t count) {
+    for (uint32_t i = 1; i <= count; ++i) {
+      policy->OnRequest();
+      policy->OnComplete(i);
+    }
+  }
+};
+
+TEST_F(HedgePolicyTest, Disabled) {
+  HedgePolicy policy(0);
+  EXPECT_FALSE(policy.IsEnabled());
+  FeedLatencies(&policy, 100);
+  EXPECT_EQ(policy.GetDelayInMs(), 0u);
+  EXPECT_FALSE(policy.TryHedge());
+  EXPECT_EQ(policy.GetIssuedCount(), 0u);
+}
+
+TEST_F(HedgePolicyTest, NoDelayBeforeEnoughSamples) {
+  HedgePolicy policy(100, 0);
+  FeedLatencies(&policy, 10);
+  EXPECT_EQ(policy.GetDelayInMs(), 0u);
+}
+
+TEST_F(HedgePolicyTest, DelayIsPercentile) {
+  HedgePolicy policy(100, 0, 100, 95);
+  FeedLatencies(&policy, 100);
+  EXPECT_GE(policy.GetDelayInMs(), 90u);
+  EXPECT_LE(policy.GetDelayInMs(), 96u);
+}
+
+TEST_F(HedgePolicyTest, DelayFollowsRecentLatencies) {
+  HedgePolicy policy(100, 0, 32, 50);
+  FeedLatencies(&policy, 32);
+  EXPECT_LE(policy.GetDelayInMs(), 17u);
+  for (int i = 0; i < 32; ++i) {
+    policy.OnComplete(1000);
+  }
+  EXPECT_EQ(policy.GetDelayInMs(), 1000u);
+}
+
+TEST_F(HedgePolicyTest, MinDelay) {
+  HedgePolicy policy(100, 50);
+  FeedLatencies(&policy, 40);
+  EXPECT_EQ(policy.GetDelayInMs(), 50u);
+}
+
+TEST_F(HedgePolicyTest, DelayIsPerSizeClass) {
+  HedgePolicy policy(100, 0, 32, 50);
+  const uint64_t smallBytes = 4 * 1024;
+  const uint64_t largeBytes = 32 * 1024 * 1024;
+  for (int i = 0; i < 32; ++i) {
+    policy.OnComplete(10, smallBytes);
+    policy.OnComplete(1000, largeBytes);
+  }
+  EXPECT_EQ(policy.GetDelayInMs(smallBytes), 10u);
+  EXPECT_EQ(policy.GetDelayInMs(largeBytes), 1000u);
+  // no latency observed for the size class in between yet
+  EXPECT_EQ(policy.GetDelayInMs(2 * 1024 * 1024), 0u);
+}
+
+TEST_F(HedgePolicyTest, HedgeRateIsCapped) {
+  HedgePolicy policy(10);
+  int issued = 0;
+  for (int i = 0; i < 1000; ++i) {
+    policy.OnRequest();
+    if (policy.TryHedge()) {
+      ++issued;
+    }
+  }
+  EXPECT_EQ(issued, 100);
+  EXPECT_EQ(policy.GetIssuedCount(), 100u);
+  EXPECT_EQ(policy.GetRejectedCount(), 900u);
+  EXPECT_EQ(policy.GetRequestCount(), 1000u);
+}
+
+TEST_F(HedgePolicyTest, BudgetIsBounded) {
+  HedgePolicy policy(50);
+  for (int i = 0; i < 1000; ++i) {
+    policy.OnRequest();
+  }
+  int issued = 0;
+  while (policy.TryHedge()) {
+    ++issued;
+  }
+  EXPECT_EQ(issued, 10);
+}
+
+TEST_F(HedgePolicyTest, HedgeWon) {
+  HedgePolicy policy(100);
+  policy.OnRequest();
+  EXPECT_TRUE(policy.TryHedge());
+  policy.OnHedgeWon();
+  EXPECT_EQ(policy.GetIssuedCount(), 1u);
+  EXPECT_EQ(policy.GetWonCount(), 1u);
+}
+
+}  // namespace Client
+}  // namespace QS
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  int code = RUN_ALL_TESTS();
+  return code;
+}
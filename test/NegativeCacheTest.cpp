@@ -0,0 +1,115 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+#include <chrono>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+
+#include "gtest/gtest.h"
+
+#include "data/NegativeCache.h"
+
+namespace QS {
+
+namespace Data {
+
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+using std::string;
+using std::to_string;
+using ::testing::Test;
+
+class NegativeCacheTest : public Test {};
+
+TEST_F(NegativeCacheTest, Default) {
+  NegativeCache cache(seconds(10), 100);
+  EXPECT_TRUE(cache.IsEnabled());
+  EXPECT_FALSE(cache.Has("/a"));
+  cache.Add("/a");
+  EXPECT_TRUE(cache.Has("/a"));
+  EXPECT_FALSE(cache.Has("/a/"));
+  EXPECT_EQ(cache.GetSize(), 1u);
+  EXPECT_EQ(cache.GetHitCount(), 1u);
+  EXPECT_EQ(cache.GetMissCount(), 2u);
+
+  cache.Clear();
+  EXPECT_FALSE(cache.Has("/a"));
+}
+
+TEST_F(NegativeCacheTest, Disabled) {
+  NegativeCache cache(seconds(0), 100);
+  EXPECT_FALSE(cache.IsEnabled());
+  cache.Add("/a");
+  EXPECT_FALSE(cache.Has("/a"));
+  EXPECT_EQ(cache.GetMissCount(), 0u);
+}
+
+TEST_F(NegativeCacheTest, Expire) {
+  NegativeCache cache(milliseconds(20), 100);
+  cache.Add("/a");
+  EXPECT_TRUE(cache.Has("/a"));
+  std::this_thread::sleep_for(milliseconds(30));
+  EXPECT_FALSE(cache.Has("/a"));
+  EXPECT_EQ(cache.GetSize(), 0u);
+
+  // added again after expired
+  cache.Add("/a");
+  EXPECT_TRUE(cache.Has("/a"));
+}
+
+TEST_F(NegativeCacheTest, Invalidate) {
+  NegativeCache cache(seconds(10), 100);
+  cache.Add("/a");
+  cache.Add("/a/");
+  cache.Invalidate("/a/");  // both forms are invalidated
+  EXPECT_FALSE(cache.Has("/a"));
+  EXPECT_FALSE(cache.Has("/a/"));
+
+  cache.Add("/b/c");
+  cache.Add("/b/d/e/");
+  cache.Add("/bc");
+  cache.InvalidateDirectory("/b/");
+  EXPECT_FALSE(cache.Has("/b/c"));
+  EXPECT_FALSE(cache.Has("/b/d/e/"));
+  EXPECT_TRUE(cache.Has("/bc"));
+}
+
+TEST_F(NegativeCacheTest, Overflow) {
+  NegativeCache cache(seconds(10), 3);
+  for (int i = 0; i < 5; ++i) {
+    cache.Add("/file" + to_string(i));
+  }
+  EXPECT_EQ(cache.GetSize(), 3u);
+  // the oldest ones are discarded
+  EXPECT_FALSE(cache.Has("/file0"));
+  EXPECT_FALSE(cache.Has("/file1"));
+  EXPECT_TRUE(cache.Has("/file4"));
+
+  // invalidated paths make room without discarding others
+  cache.Invalidate("/file2");
+  cache.Add("/file5");
+  EXPECT_TRUE(cache.Has("/file3"));
+  EXPECT_TRUE(cache.Has("/file5"));
+}
+
+}  // namespace Data
+}  // namespace QS
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  int code = RUN_ALL_TESTS();
+  return code;
+}
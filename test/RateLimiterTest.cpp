@@ -0,0 +1,184 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#include <chrono>  // NOLINT
+#include <future>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "client/RateLimiter.h"
+
+namespace QS {
+
+namespace Client {
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+using std::future;
+using std::vector;
+using ::testing::Test;
+
+// A stand-in of the object storage client, each request acquires from the
+// rate limiter and then takes the given latency.
+class StandInClient {
+ public:
+  StandInClient(RateLimiter *limiter, milliseconds latency)
+      : m_limiter(limiter), m_latency(latency) {}
+
+  void Download(uint64_t bytes) {
+    m_limiter->AcquireRequest();
+    m_limiter->AcquireDownload(bytes);
+    std::this_thread::sleep_for(m_latency);
+  }
+
+ private:
+  RateLimiter *m_limiter;
+  milliseconds m_latency;
+};
+
+class RateLimiterTest : public Test {
+ protected:
+  // Run downloads in several threads, return the elapsed time in ms.
+  int64_t RunDownloads(StandInClient *client, int threads, int requests,
+                       uint64_t bytes, RequestPriority priority) {
+    auto start = steady_clock::now();
+    vector<future<void>> fs;
+    for (int i = 0; i < threads; ++i) {
+      fs.push_back(std::async(std::launch::async, [=] {
+        ScopedRequestPriority scopedPriority(priority);
+        for (int j = 0; j < requests; ++j) {
+          client->Download(bytes);
+        }
+      }));
+    }
+    for (auto &f : fs) {
+      f.wait();
+    }
+    return std::chrono::duration_cast<milliseconds>(steady_clock::now() -
+                                                    start).count();
+  }
+};
+
+TEST_F(RateLimiterTest, Unlimited) {
+  TokenBucket bucket(0);
+  EXPECT_TRUE(bucket.IsUnlimited());
+  bucket.Acquire(1000000);
+  bucket.Acquire(1000000, RequestPriority::Background);
+  EXPECT_EQ(bucket.GetAcquiredCount(), 2000000u);
+  EXPECT_EQ(bucket.GetWaitCount(RequestPriority::Foreground), 0u);
+  EXPECT_EQ(bucket.GetWaitCount(RequestPriority::Background), 0u);
+}
+
+TEST_F(RateLimiterTest, Burst) {
+  TokenBucket bucket(100, 50);
+  EXPECT_EQ(bucket.GetRate(), 100u);
+  EXPECT_EQ(bucket.GetBurst(), 50u);
+  // a full bucket grants the burst without waiting
+  bucket.Acquire(50, RequestPriority::Background);
+  EXPECT_EQ(bucket.GetWaitCount(RequestPriority::Background), 0u);
+
+  // the following acquisition needs to wait for refilling
+  auto start = steady_clock::now();
+  bucket.Acquire(20, RequestPriority::Background);
+  auto elapsed = steady_clock::now() - start;
+  EXPECT_GE(elapsed, milliseconds(150));
+  EXPECT_EQ(bucket.GetWaitCount(RequestPriority::Background), 1u);
+}
+
+TEST_F(RateLimiterTest, OversizeAcquire) {
+  TokenBucket bucket(1000, 100);
+  // an oversize acquisition is granted once the bucket is full, and the debt
+  // is paid by the following acquisitions
+  bucket.Acquire(300, RequestPriority::Background);
+  auto start = steady_clock::now();
+  bucket.Acquire(1, RequestPriority::Background);
+  auto elapsed = steady_clock::now() - start;
+  EXPECT_GE(elapsed, milliseconds(150));
+}
+
+TEST_F(RateLimiterTest, ThreadPriority) {
+  EXPECT_EQ(RateLimiter::GetThreadPriority(), RequestPriority::Foreground);
+  {
+    ScopedRequestPriority priority(RequestPriority::Background);
+    EXPECT_EQ(RateLimiter::GetThreadPriority(), RequestPriority::Background);
+    {
+      ScopedRequestPriority priority2(RequestPriority::Foreground);
+      EXPECT_EQ(RateLimiter::GetThreadPriority(), RequestPriority::Foreground);
+    }
+    EXPECT_EQ(RateLimiter::GetThreadPriority(), RequestPriority::Background);
+  }
+  EXPECT_EQ(RateLimiter::GetThreadPriority(), RequestPriority::Foreground);
+}
+
+TEST_F(RateLimiterTest, BandwidthLimit) {
+  // 100KB/s, downloading 200KB in 10KB requests from 4 threads, the bucket
+  // holds 100KB at start, so at least 90KB need to be refilled before the
+  // last request is granted
+  RateLimiter limiter(100 * 1024, 0, 0);
+  StandInClient client(&limiter, milliseconds(1));
+  auto elapsed = RunDownloads(&client, 4, 5, 10 * 1024,
+                              RequestPriority::Foreground);
+  EXPECT_GE(elapsed, 800);
+  EXPECT_EQ(limiter.GetDownloadBucket().GetAcquiredCount(), 200 * 1024u);
+  EXPECT_EQ(limiter.GetRequestBucket().GetAcquiredCount(), 20u);
+}
+
+TEST_F(RateLimiterTest, RequestRateLimit) {
+  RateLimiter limiter(0, 0, 50);
+  StandInClient client(&limiter, milliseconds(1));
+  // 50 requests are granted by the burst, the other 25 need 500ms
+  auto elapsed = RunDownloads(&client, 5, 15, 1, RequestPriority::Foreground);
+  EXPECT_GE(elapsed, 400);
+  EXPECT_EQ(limiter.GetRequestBucket().GetAcquiredCount(), 75u);
+}
+
+TEST_F(RateLimiterTest, ForegroundThrottledLast) {
+  // 200 requests per second, background traffic saturates the limit
+  RateLimiter limiter(0, 0, 200);
+  StandInClient client(&limiter, milliseconds(5));
+  auto fBackground = std::async(std::launch::async, [this, &client] {
+    return RunDownloads(&client, 8, 50, 1, RequestPriority::Background);
+  });
+  // wait until the burst is drained
+  std::this_thread::sleep_for(milliseconds(300));
+
+  auto start = steady_clock::now();
+  const int foregroundRequests = 20;
+  for (int i = 0; i < foregroundRequests; ++i) {
+    client.Download(1);
+  }
+  auto foregroundLatency = std::chrono::duration_cast<milliseconds>(
+      steady_clock::now() - start).count() / foregroundRequests;
+  fBackground.wait();
+
+  // background requests take 8 * 5ms = 40ms in average while the foreground
+  // ones are throttled by the rate only
+  EXPECT_LT(foregroundLatency, 20);
+  EXPECT_GT(limiter.GetRequestBucket().GetWaitCount(
+                RequestPriority::Background), 0u);
+}
+
+}  // namespace Client
+}  // namespace QS
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  int code = RUN_ALL_TESTS();
+  return code;
+}
@@ -0,0 +1,211 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#include <stdint.h>
+
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <memory>
+#include <set>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "client/ClientError.h"
+#include "client/QSError.h"
+#include "client/RetryBudget.h"
+#include "client/RetryStrategy.h"
+
+namespace QS {
+
+namespace Client {
+
+using std::make_shared;
+using std::set;
+using std::vector;
+using ::testing::Test;
+
+namespace {
+
+const unsigned kMaxRetries = 3;
+const unsigned kScaleFactor = 10;
+const int kSampleCount = 10000;
+
+ClientError<QSError> MakeError(QSError err, bool retryable) {
+  return ClientError<QSError>(err, retryable);
+}
+
+}  // namespace
+
+class RetryStrategyTest : public Test {
+ protected:
+  // Sample the delays before the first retry
+  vector<uint32_t> SampleFirstDelays(const RetryStrategy &strategy,
+                                     const ClientError<QSError> &error) {
+    vector<uint32_t> delays;
+    for (int i = 0; i < kSampleCount; ++i) {
+      delays.push_back(strategy.CalculateDelayBeforeNextRetry(error, 0, 0));
+    }
+    return delays;
+  }
+
+  double Mean(const vector<uint32_t> &values) {
+    double sum = 0;
+    for (auto value : values) {
+      sum += value;
+    }
+    return sum / values.size();
+  }
+};
+
+TEST_F(RetryStrategyTest, ClassifyError) {
+  EXPECT_EQ(ClassifyRetryError(MakeError(QSError::SERVICE_UNAVAILABLE, true)),
+            RetryErrorClass::Throttle);
+  EXPECT_EQ(ClassifyRetryError(MakeError(QSError::REQUEST_EXPIRED, true)),
+            RetryErrorClass::Timeout);
+  EXPECT_EQ(ClassifyRetryError(MakeError(QSError::NETWORK_CONNECTION, true)),
+            RetryErrorClass::Timeout);
+  EXPECT_EQ(ClassifyRetryError(MakeError(QSError::INTERNAL_FAILURE, true)),
+            RetryErrorClass::ServerError);
+  EXPECT_EQ(ClassifyRetryError(MakeError(QSError::KEY_NOT_EXIST, false)),
+            RetryErrorClass::NonRetryable);
+  EXPECT_EQ(ClassifyRetryError(MakeError(QSError::SERVICE_UNAVAILABLE, false)),
+            RetryErrorClass::NonRetryable);
+}
+
+TEST_F(RetryStrategyTest, ShouldRetry) {
+  RetryStrategy strategy(kMaxRetries, kScaleFactor);
+  auto error = MakeError(QSError::INTERNAL_FAILURE, true);
+  for (unsigned i = 0; i < kMaxRetries; ++i) {
+    EXPECT_TRUE(strategy.ShouldRetry(error, i));
+  }
+  EXPECT_FALSE(strategy.ShouldRetry(error, kMaxRetries));
+  EXPECT_FALSE(
+      strategy.ShouldRetry(MakeError(QSError::ACCESS_DENIED, false), 0));
+}
+
+TEST_F(RetryStrategyTest, PolicyPerErrorClass) {
+  RetryStrategy strategy(kMaxRetries, kScaleFactor);
+  strategy.SetPolicy(RetryErrorClass::Timeout, {1, 5, 100});
+  auto timeout = MakeError(QSError::REQUEST_EXPIRED, true);
+  EXPECT_TRUE(strategy.ShouldRetry(timeout, 0));
+  EXPECT_FALSE(strategy.ShouldRetry(timeout, 1));
+  EXPECT_TRUE(
+      strategy.ShouldRetry(MakeError(QSError::SERVICE_UNAVAILABLE, true), 1));
+
+  // throttling backs off more than other errors
+  auto throttle = strategy.GetPolicy(RetryErrorClass::Throttle);
+  auto serverError = strategy.GetPolicy(RetryErrorClass::ServerError);
+  EXPECT_GT(throttle.baseDelayInMs, serverError.baseDelayInMs);
+  EXPECT_GT(throttle.maxDelayInMs, serverError.maxDelayInMs);
+}
+
+TEST_F(RetryStrategyTest, FirstDelayDistribution) {
+  RetryStrategy strategy(kMaxRetries, kScaleFactor);
+  auto error = MakeError(QSError::INTERNAL_FAILURE, true);
+  auto base = strategy.GetPolicy(RetryErrorClass::ServerError).baseDelayInMs;
+  auto delays = SampleFirstDelays(strategy, error);
+  set<uint32_t> distinct(delays.begin(), delays.end());
+  for (auto delay : delays) {
+    EXPECT_GE(delay, base);
+    EXPECT_LE(delay, 3 * base);
+  }
+  // uniform in [base, 3 * base]
+  EXPECT_NEAR(Mean(delays), 2 * base, 0.05 * base);
+  // the concurrent retries are spread out instead of in lockstep
+  EXPECT_GT(distinct.size(), base);
+}
+
+TEST_F(RetryStrategyTest, DecorrelatedDelayDistribution) {
+  RetryStrategy strategy(kMaxRetries, kScaleFactor);
+  auto error = MakeError(QSError::INTERNAL_FAILURE, true);
+  auto policy = strategy.GetPolicy(RetryErrorClass::ServerError);
+  uint32_t lastDelay = 4 * policy.baseDelayInMs;
+  vector<uint32_t> delays;
+  for (int i = 0; i < kSampleCount; ++i) {
+    auto delay = strategy.CalculateDelayBeforeNextRetry(error, 1, lastDelay);
+    EXPECT_GE(delay, policy.baseDelayInMs);
+    EXPECT_LE(delay, 3 * lastDelay);
+    delays.push_back(delay);
+  }
+  EXPECT_NEAR(Mean(delays), (policy.baseDelayInMs + 3 * lastDelay) / 2.0,
+              0.05 * lastDelay);
+}
+
+TEST_F(RetryStrategyTest, DelayIsCapped) {
+  RetryStrategy strategy(kMaxRetries, kScaleFactor);
+  auto error = MakeError(QSError::SERVICE_UNAVAILABLE, true);
+  auto policy = strategy.GetPolicy(RetryErrorClass::Throttle);
+  uint32_t delay = 0;
+  unsigned cappedCount = 0;
+  for (int i = 0; i < kSampleCount; ++i) {
+    delay = strategy.CalculateDelayBeforeNextRetry(error, i, delay);
+    EXPECT_GE(delay, policy.baseDelayInMs);
+    EXPECT_LE(delay, policy.maxDelayInMs);
+    if (delay == policy.maxDelayInMs) {
+      ++cappedCount;
+    }
+  }
+  EXPECT_GT(cappedCount, 0u);
+}
+
+TEST_F(RetryStrategyTest, RetryBudget) {
+  RetryBudget budget(5, 0);
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_TRUE(budget.TryAcquire());
+  }
+  EXPECT_FALSE(budget.TryAcquire());
+  EXPECT_EQ(budget.GetAcquiredCount(), 5u);
+  EXPECT_EQ(budget.GetRejectedCount(), 1u);
+}
+
+TEST_F(RetryStrategyTest, RetryBudgetRefill) {
+  RetryBudget budget(5, 100);
+  while (budget.TryAcquire()) {
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  int acquired = 0;
+  while (budget.TryAcquire()) {
+    ++acquired;
+  }
+  EXPECT_GE(acquired, 4);
+  EXPECT_LE(acquired, 5);
+}
+
+TEST_F(RetryStrategyTest, BudgetStopsRetryStorm) {
+  auto budget = make_shared<RetryBudget>(10, 0);
+  RetryStrategy strategy(kMaxRetries, kScaleFactor, budget);
+  auto error = MakeError(QSError::SERVICE_UNAVAILABLE, true);
+  int retries = 0;
+  for (int request = 0; request < 100; ++request) {
+    for (unsigned i = 0; strategy.ShouldRetry(error, i); ++i) {
+      ++retries;
+    }
+  }
+  EXPECT_EQ(retries, 10);
+  EXPECT_GT(budget->GetRejectedCount(), 0u);
+}
+
+}  // namespace Client
+}  // namespace QS
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  int code = RUN_ALL_TESTS();
+  return code;
+}
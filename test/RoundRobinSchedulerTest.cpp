@@ -0,0 +1,178 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+
+#include <atomic>  // NOLINT
+#include <chrono>  // NOLINT
+#include <future>  // NOLINT
+#include <iostream>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "base/RoundRobinScheduler.h"
+#include "base/ThreadPool.h"
+
+namespace QS {
+
+namespace Threading {
+
+using std::atomic;
+using std::future;
+using std::lock_guard;
+using std::mutex;
+using std::promise;
+using std::string;
+using std::vector;
+using ::testing::Test;
+
+class RoundRobinSchedulerTest : public Test {
+ protected:
+  void SetUp() override {}
+  void TearDown() override {}
+
+  void InitializePool(ThreadPool *pool) { pool->Initialize(); }
+
+  // Simulate transfers of one large file and several small files submitted
+  // just after it, return the average latency (ms) of the small files.
+  double SmallFileLatency(bool fair) {
+    const int poolSize = 4;
+    const int largeFileParts = 200;
+    const int smallFileCount = 20;
+    const auto partDuration = std::chrono::milliseconds(2);
+
+    ThreadPool pool(poolSize);
+    InitializePool(&pool);
+    RoundRobinScheduler scheduler(&pool);
+    auto DoTransfer = [partDuration] {
+      std::this_thread::sleep_for(partDuration);
+    };
+    auto Submit = [&](const string &key, Task &&task) {
+      if (fair) {
+        scheduler.Submit(key, std::move(task));
+      } else {
+        pool.SubmitToThread(std::move(task));
+      }
+    };
+
+    atomic<int> largeDone(0);
+    promise<void> allLargeDone;
+    for (int i = 0; i < largeFileParts; ++i) {
+      Submit("/large", [&] {
+        DoTransfer();
+        if (++largeDone == largeFileParts) {
+          allLargeDone.set_value();
+        }
+      });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    vector<promise<double>> latencies(smallFileCount);
+    for (int i = 0; i < smallFileCount; ++i) {
+      auto *latency = &latencies[i];
+      Submit("/small" + std::to_string(i), [&, latency] {
+        DoTransfer();
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        latency->set_value(elapsed.count());
+      });
+    }
+
+    double total = 0;
+    for (auto &latency : latencies) {
+      total += latency.get_future().get();
+    }
+    allLargeDone.get_future().wait();
+    return total / smallFileCount;
+  }
+};
+
+TEST_F(RoundRobinSchedulerTest, RunAllTasks) {
+  ThreadPool pool(2);
+  InitializePool(&pool);
+  RoundRobinScheduler scheduler(&pool);
+  atomic<int> count(0);
+  vector<future<void>> futures;
+  for (int i = 0; i < 100; ++i) {
+    auto task = std::make_shared<std::packaged_task<void()>>([&count] {
+      ++count;
+    });
+    futures.emplace_back(task->get_future());
+    scheduler.Submit(std::to_string(i % 3), [task] { (*task)(); });
+  }
+  for (auto &f : futures) {
+    f.wait();
+  }
+  EXPECT_EQ(count.load(), 100);
+  EXPECT_EQ(scheduler.GetQueuedTaskCount(), 0u);
+  EXPECT_EQ(scheduler.GetQueuedKeyCount(), 0u);
+}
+
+TEST_F(RoundRobinSchedulerTest, RoundRobinOrder) {
+  ThreadPool pool(1);
+  InitializePool(&pool);
+  RoundRobinScheduler scheduler(&pool);
+
+  // block the only worker, so the following tasks get queued
+  promise<void> gate;
+  auto gateFuture = gate.get_future().share();
+  scheduler.Submit("gate", [gateFuture] { gateFuture.wait(); });
+
+  mutex lock;
+  vector<string> order;
+  auto Record = [&lock, &order](const string &name) {
+    return [&lock, &order, name] {
+      lock_guard<mutex> guard(lock);
+      order.push_back(name);
+    };
+  };
+  scheduler.Submit("a", Record("a1"));
+  scheduler.Submit("a", Record("a2"));
+  scheduler.Submit("a", Record("a3"));
+  scheduler.Submit("b", Record("b1"));
+  scheduler.Submit("c", Record("c1"));
+  scheduler.Submit("b", Record("b2"));
+
+  promise<void> done;
+  scheduler.Submit("done", [&done] { done.set_value(); });
+  gate.set_value();
+  done.get_future().wait();
+
+  vector<string> expected = {"a1", "b1", "c1", "a2", "b2", "a3"};
+  EXPECT_EQ(order, expected);
+}
+
+// Benchmark: one large transfer mixing with many small transfers
+TEST_F(RoundRobinSchedulerTest, DISABLED_BenchmarkSmallFileLatency) {
+  double fifo = SmallFileLatency(false);
+  double fair = SmallFileLatency(true);
+  std::cout << "[ BENCHMARK] average small file latency, fifo: " << fifo
+            << "ms, round-robin: " << fair << "ms" << std::endl;
+  EXPECT_LT(fair, fifo);
+}
+
+}  // namespace Threading
+}  // namespace QS
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  int code = RUN_ALL_TESTS();
+  return code;
+}
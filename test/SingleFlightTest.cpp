@@ -0,0 +1,115 @@
+// +-------------------------------------------------------------------------
+// | Copyright (C) 2017 Yunify, Inc.
+// +-------------------------------------------------------------------------
+// | Licensed under the Apache License, Version 2.0 (the "License");
+// | You may not use this work except in compliance with the License.
+// | You may obtain a copy of the License in the LICENSE file, or at:
+// |
+// | http://www.apache.org/licenses/LICENSE-2.0
+// |
+// | Unless required by applicable law or agreed to in writing, software
+// | distributed under the License is distributed on an "AS IS" BASIS,
+// | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// | See the License for the specific language governing permissions and
+// | limitations under the License.
+// +-------------------------------------------------------------------------
+
+#include <atomic>  // NOLINT
+#include <chrono>  // NOLINT
+#include <stdexcept>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "base/SingleFlight.h"
+
+namespace QS {
+
+namespace Threading {
+
+using std::chrono::milliseconds;
+using std::string;
+using std::vector;
+using ::testing::Test;
+
+class SingleFlightTest : public Test {
+ protected:
+  // Run the call for the key in count of threads at the same time, return
+  // the count of the threads which share the result of another one
+  int RunConcurrently(SingleFlight<int> *flights, const string &key,
+                      int count, int result) {
+    std::atomic<int> coalescedCount(0);
+    vector<std::thread> threads;
+    for (int i = 0; i < count; ++i) {
+      threads.emplace_back([&] {
+        bool coalesced = false;
+        auto res = flights->Do(key, [&] {
+          ++m_runCount;
+          std::this_thread::sleep_for(milliseconds(100));
+          return result;
+        }, &coalesced);
+        EXPECT_EQ(res, result);
+        if (coalesced) {
+          ++coalescedCount;
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    return coalescedCount.load();
+  }
+
+  std::atomic<int> m_runCount{0};
+};
+
+TEST_F(SingleFlightTest, Sequential) {
+  SingleFlight<int> flights;
+  bool coalesced = true;
+  EXPECT_EQ(flights.Do("a", [] { return 1; }, &coalesced), 1);
+  EXPECT_FALSE(coalesced);
+  EXPECT_EQ(flights.Do("a", [] { return 2; }, &coalesced), 2);
+  EXPECT_FALSE(coalesced);
+  EXPECT_EQ(flights.GetCallCount(), 2u);
+  EXPECT_EQ(flights.GetCoalescedCount(), 0u);
+}
+
+TEST_F(SingleFlightTest, Concurrent) {
+  SingleFlight<int> flights;
+  int coalesced = RunConcurrently(&flights, "a", 8, 42);
+  // the threads starting after the leader finishes run the call again
+  EXPECT_EQ(m_runCount.load() + coalesced, 8);
+  EXPECT_LT(m_runCount.load(), 8);
+  EXPECT_EQ(flights.GetCallCount(), static_cast<uint64_t>(m_runCount.load()));
+  EXPECT_EQ(flights.GetCoalescedCount(), static_cast<uint64_t>(coalesced));
+  EXPECT_EQ(flights.ToString(), "[calls:coalesced=" +
+                                    std::to_string(m_runCount.load()) + ":" +
+                                    std::to_string(coalesced) + "]");
+}
+
+TEST_F(SingleFlightTest, DifferentKeys) {
+  SingleFlight<int> flights;
+  std::thread other([&] { RunConcurrently(&flights, "b", 1, 2); });
+  EXPECT_EQ(RunConcurrently(&flights, "a", 1, 1), 0);
+  other.join();
+  EXPECT_EQ(m_runCount.load(), 2);
+}
+
+TEST_F(SingleFlightTest, Exception) {
+  SingleFlight<int> flights;
+  auto Throw = []() -> int { throw std::runtime_error("failure"); };
+  EXPECT_THROW(flights.Do("a", Throw), std::runtime_error);
+  // the failed call is not kept
+  EXPECT_EQ(flights.Do("a", [] { return 1; }), 1);
+}
+
+}  // namespace Threading
+}  // namespace QS
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  int code = RUN_ALL_TESTS();
+  return code;
+}